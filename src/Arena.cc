@@ -0,0 +1,252 @@
+/* This is file Arena.cc.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+///
+/// This file defines the Arena class.
+
+#include "Arena.hh"
+#include <algorithm>            // for std::max
+#include <cstdint>              // for uintptr_t
+#include <cstdio>               // for vsnprintf
+#include <cstdlib>              // for malloc, free
+#include <cstring>              // for memcpy, strlen
+
+/// Constructor.
+///
+/// \param segment_size is the size of new segments.  Larger
+/// allocations get a segment of their own size.
+Arena::Arena(size_t segment_size)
+  : m_segment_size(std::max(segment_size, (size_t) 64)),
+    m_current(0), m_offset(0), m_before(0), m_allocations(0), m_peak(0)
+{ }
+
+/// Destructor.  Frees all segments.
+Arena::~Arena()
+{
+  clear();
+}
+
+/// Moves on to the next segment that has room for an allocation,
+/// reusing a free segment if one is large enough, or else creating a
+/// new one.
+///
+/// \param n is the size of the allocation.
+///
+/// \param alignment is the alignment of the allocation.
+///
+/// \returns `true` if successful, `false` if there was no memory.
+bool
+Arena::next_segment(size_t n, size_t alignment)
+{
+  // malloc returns memory aligned for any standard type, so only
+  // stricter alignments may need padding at the start of a segment
+  size_t need = n;
+  if (alignment > alignof(std::max_align_t))
+    need += alignment - 1;
+
+  size_t i = m_current;
+  if (i < m_segments.size()) {
+    m_before += m_offset;
+    ++i;
+  }
+  // free segments that are too small are passed over, and are used
+  // again after the next reset() to before them
+  while (i < m_segments.size() && m_segments[i].size < need)
+    ++i;
+  if (i == m_segments.size()) {
+    Segment segment;
+    segment.size = std::max(m_segment_size, need);
+    segment.data = (char*) malloc(segment.size);
+    if (!segment.data) {
+      if (m_current < m_segments.size())
+        m_before -= m_offset;   // stay where we were
+      return false;
+    }
+    m_segments.push_back(segment);
+  }
+  m_current = i;
+  m_offset = 0;
+  return true;
+}
+
+/// Allocates memory.
+///
+/// \param n is the number of bytes to allocate.
+///
+/// \param alignment is the alignment of the memory.  It must be a
+/// power of 2.
+///
+/// \returns a pointer to the memory, or `nullptr` if there was no
+/// memory.  The memory remains valid until the Arena is reset to a
+/// mark from before the allocation, or cleared, or destroyed.
+void*
+Arena::allocate(size_t n, size_t alignment)
+{
+  char* result = nullptr;
+
+  if (m_current < m_segments.size()) {
+    Segment& segment = m_segments[m_current];
+    uintptr_t p = (uintptr_t) (segment.data + m_offset);
+    size_t pad = ((p + alignment - 1) & ~(uintptr_t) (alignment - 1)) - p;
+    if (m_offset + pad + n <= segment.size) {
+      result = segment.data + m_offset + pad;
+      m_offset += pad + n;
+    }
+  }
+  if (!result) {
+    if (!next_segment(n, alignment))
+      return nullptr;
+    Segment& segment = m_segments[m_current];
+    uintptr_t p = (uintptr_t) segment.data;
+    size_t pad = ((p + alignment - 1) & ~(uintptr_t) (alignment - 1)) - p;
+    result = segment.data + pad;
+    m_offset = pad + n;
+  }
+  ++m_allocations;
+  m_peak = std::max(m_peak, m_before + m_offset);
+  return result;
+}
+
+/// Copies text into the Arena.
+///
+/// \param text is the text to copy, up to and including the
+/// terminating null byte.
+///
+/// \returns a pointer to the copy, or `nullptr` if there was no
+/// memory.
+char*
+Arena::strdup(char const* text)
+{
+  size_t n = strlen(text) + 1;
+  char* result = (char*) allocate(n, 1);
+  if (result)
+    memcpy(result, text, n);
+  return result;
+}
+
+/// Prints text into the Arena.
+///
+/// \param format is the printf-style format.
+///
+/// \returns a pointer to the printed text, or `nullptr` if there was no
+/// memory or the format was bad.
+char*
+Arena::sprintf(char const* format, ...)
+{
+  va_list ap;
+
+  va_start(ap, format);
+  char* result = vsprintf(format, ap);
+  va_end(ap);
+  return result;
+}
+
+/// Prints text into the Arena.
+///
+/// \param format is the printf-style format.
+///
+/// \param ap has the arguments to print.
+///
+/// \returns a pointer to the printed text, or `nullptr` if there was no
+/// memory or the format was bad.
+char*
+Arena::vsprintf(char const* format, va_list ap)
+{
+  va_list ap2;
+
+  // print straight into the rest of the current segment, and only if
+  // that is too small print again into a new one
+  char* p = nullptr;
+  size_t room = 0;
+  if (m_current < m_segments.size()) {
+    p = m_segments[m_current].data + m_offset;
+    room = m_segments[m_current].size - m_offset;
+  }
+  va_copy(ap2, ap);
+  int n = vsnprintf(p, room, format, ap2);
+  va_end(ap2);
+  if (n < 0)
+    return nullptr;
+  char* result = (char*) allocate(n + 1, 1);
+  if (result && result != p) {
+    va_copy(ap2, ap);
+    vsnprintf(result, n + 1, format, ap2);
+    va_end(ap2);
+  }
+  return result;
+}
+
+/// \returns the current position, to go back to later with reset().
+Arena::Mark
+Arena::mark() const
+{
+  return Mark{ m_current, m_offset, m_before + m_offset };
+}
+
+/// Frees everything that was allocated since a mark was taken.  The
+/// segments are kept for reuse.
+///
+/// \param mark is the mark, from mark().  Marks taken after it become
+/// invalid.
+void
+Arena::reset(Mark mark)
+{
+  m_current = mark.segment;
+  m_offset = mark.offset;
+  m_before = mark.bytes - mark.offset;
+}
+
+/// Frees everything and releases all segments.  All marks become
+/// invalid.
+void
+Arena::clear()
+{
+  for (auto& segment : m_segments)
+    free(segment.data);
+  m_segments.clear();
+  m_current = m_offset = m_before = 0;
+}
+
+/// \returns the allocation statistics.
+Arena::Statistics
+Arena::statistics() const
+{
+  Statistics result;
+
+  result.allocations = m_allocations;
+  result.bytes = m_before + m_offset;
+  result.peak_bytes = m_peak;
+  result.segments = m_segments.size();
+  result.capacity = 0;
+  for (auto const& segment : m_segments)
+    result.capacity += segment.size;
+  return result;
+}
+
+/// \returns the Arena of the calling thread.  It is created on first
+/// use and destroyed when the thread ends.
+Arena&
+Arena::thread_arena()
+{
+  static thread_local Arena arena;
+
+  return arena;
+}
@@ -0,0 +1,135 @@
+/* This is file Arena.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_ARENA_HH
+#define INCLUDED_ARENA_HH
+
+/// \file
+///
+/// This file declares the Arena class, a stack of bytes made of
+/// segments that never move, for many short-lived allocations such as
+/// temporary strings.
+
+#include <cstdarg>              // for va_list
+#include <cstddef>              // for size_t, max_align_t
+#include <vector>
+
+/// A stack of bytes made of segments that never move.
+///
+/// Unlike a Bytestack, which keeps its data in one buffer that is
+/// reallocated (and so moved and copied) when it grows, an Arena adds
+/// a new segment when the current one is full.  Pointers into an Arena
+/// therefore stay valid until the Arena is reset to a mark from before
+/// they were allocated.  Allocating is O(1): it usually just bumps an
+/// offset.  Resetting to a mark is O(1) too, and keeps the segments for
+/// reuse, so an Arena that is reset regularly stops calling `malloc`
+/// once it has grown to its working size.
+///
+/// An Arena has no locks.  Each thread can use its own, see
+/// thread_arena().
+///
+/// Example:
+///
+/// \code
+/// Arena& arena = Arena::thread_arena();
+/// Arena::Mark mark = arena.mark();
+/// for (...) {
+///   char* line = arena.sprintf("%s = %g", name, value);
+///   ...
+/// }
+/// arena.reset(mark);          // frees all lines at once
+/// \endcode
+class Arena
+{
+public:
+  /// A position in an Arena, from mark(), to go back to with reset().
+  struct Mark
+  {
+    size_t segment;             //!< The index of the segment.
+    size_t offset;              //!< The offset in the segment.
+    size_t bytes;               //!< The number of bytes in use.
+  };
+
+  /// Allocation statistics.
+  struct Statistics
+  {
+    size_t allocations;         //!< The number of allocations so far.
+    size_t bytes;               //!< The number of bytes now in use,
+                                //!< including alignment padding.
+    size_t peak_bytes;          //!< The greatest number of bytes in use.
+    size_t segments;            //!< The number of segments.
+    size_t capacity;            //!< The total size of the segments.
+  };
+
+  explicit Arena(size_t segment_size = 4096);
+  ~Arena();
+
+  /// Not copyable.
+  Arena(Arena const&) = delete;
+  Arena& operator=(Arena const&) = delete;
+
+  void* allocate(size_t n, size_t alignment = alignof(std::max_align_t));
+  char* strdup(char const* text);
+  char* sprintf(char const* format, ...)
+    __attribute__((format(printf, 2, 3)));
+  char* vsprintf(char const* format, va_list ap);
+
+  Mark mark() const;
+  void reset(Mark mark);
+  void clear();
+
+  Statistics statistics() const;
+
+  static Arena& thread_arena();
+
+private:
+  /// A block of memory.
+  struct Segment
+  {
+    char* data;                 //!< The memory.
+    size_t size;                //!< The size of the memory.
+  };
+
+  bool next_segment(size_t n, size_t alignment);
+
+  /// The default size of new segments.
+  size_t m_segment_size;
+
+  /// The segments, in order of use.  Those beyond #m_current are free.
+  std::vector<Segment> m_segments;
+
+  /// The index of the segment that allocations come from.
+  size_t m_current;
+
+  /// The offset of the first free byte in the current segment.
+  size_t m_offset;
+
+  /// The number of bytes in use in the segments before the current
+  /// one.
+  size_t m_before;
+
+  /// The number of allocations so far.
+  size_t m_allocations;
+
+  /// The greatest number of bytes in use so far.
+  size_t m_peak;
+};
+
+#endif
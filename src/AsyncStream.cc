@@ -0,0 +1,485 @@
+/* This is file AsyncStream.cc.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+///
+/// This file defines the AsyncStream class.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_FOPENCOOKIE
+#endif
+
+#include "AsyncStream.hh"
+#include <algorithm>            // for std::min, std::max
+#include <cerrno>
+#include <cstring>              // for memcpy
+#include <fcntl.h>              // for open
+#include <sys/stat.h>           // for fstat
+#include <unistd.h>             // for pread, pwrite, lseek, close
+
+/// Reads from a file at an offset until the requested number of bytes
+/// was read, the end of the file was reached, or an error occurred.
+///
+/// \returns the number of bytes read, or -1 if an error occurred.
+static int64_t
+pread_all(int fd, char* data, size_t n, int64_t offset)
+{
+  size_t done = 0;
+
+  while (done < n) {
+    ssize_t k = pread(fd, data + done, n - done, offset + done);
+    if (k < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    if (!k)                     // end of file
+      break;
+    done += k;
+  }
+  return done;
+}
+
+/// Writes to a file at an offset until all bytes were written or an
+/// error occurred.
+///
+/// \returns `true` if successful, `false` otherwise.
+static bool
+pwrite_all(int fd, char const* data, size_t n, int64_t offset)
+{
+  size_t done = 0;
+
+  while (done < n) {
+    ssize_t k = pwrite(fd, data + done, n - done, offset + done);
+    if (k < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    done += k;
+  }
+  return true;
+}
+
+/// Constructor.  Starts the background thread, which in read mode
+/// immediately starts reading from the current position of the file.
+///
+/// \param fd is the file descriptor of a regular file that is open for
+/// reading or writing.  The AsyncStream takes it over and closes it
+/// in #close.
+///
+/// \param writing says whether to write (`true`) or read (`false`).
+///
+/// \param block_size is the size of each buffer.
+///
+/// \param nblocks is the maximum number of buffers.
+AsyncStream::AsyncStream(int fd, bool writing, size_t block_size,
+                         size_t nblocks)
+  : m_fd(fd), m_writing(writing), m_block_size(std::max<size_t>(block_size, 1)),
+    m_nblocks(std::max<size_t>(nblocks, 1)), m_position(lseek(fd, 0, SEEK_CUR)),
+    m_next(0), m_generation(0), m_busy(false), m_eof(false), m_error(0),
+    m_stop(false)
+{
+  if (m_position < 0)
+    m_position = 0;
+  m_next = m_position;
+  m_fill = { m_position, {}, 0 };
+  m_thread = std::thread(&AsyncStream::run, this);
+}
+
+/// Destructor.  Calls #close if that was not done yet.
+AsyncStream::~AsyncStream()
+{
+  if (m_thread.joinable())
+    close();
+}
+
+/// Reads data.  Waits until enough data was read ahead, or the end of
+/// the file was reached.
+///
+/// \param data points at the room for the data.
+///
+/// \param n is the number of bytes to read.
+///
+/// \returns the number of bytes read, which is less than \a n only at
+/// the end of the file or after an error, or -1 if an error occurred
+/// before any bytes were read.
+int64_t
+AsyncStream::read(void* data, size_t n)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  char* out = (char*) data;
+  size_t done = 0;
+
+  while (done < n) {
+    m_changed.wait(lock, [this] {
+      return !m_blocks.empty() || m_eof || m_error;
+    });
+    if (m_blocks.empty())
+      break;
+    Block& block = m_blocks.front();
+    size_t k = std::min(n - done, block.data.size() - block.used);
+    memcpy(out + done, block.data.data() + block.used, k);
+    block.used += k;
+    done += k;
+    m_position += k;
+    if (block.used == block.data.size()) {
+      m_blocks.pop_front();
+      m_changed.notify_all();   // room for another block
+    }
+  }
+  if (!done && m_error) {
+    errno = m_error;
+    return -1;
+  }
+  return done;
+}
+
+/// Writes data.  The data are copied, and the background thread writes
+/// them to the file later.  Waits only if all buffers are full.
+///
+/// \param data points at the data.
+///
+/// \param n is the number of bytes to write.
+///
+/// \returns \a n, or -1 if an earlier write failed.
+int64_t
+AsyncStream::write(void const* data, size_t n)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  char const* in = (char const*) data;
+  size_t done = 0;
+
+  while (done < n && !m_error) {
+    if (m_fill.data.capacity() < m_block_size)
+      m_fill.data.reserve(m_block_size);
+    size_t k = std::min(n - done, m_block_size - m_fill.data.size());
+    m_fill.data.insert(m_fill.data.end(), in + done, in + done + k);
+    done += k;
+    m_position += k;
+    if (m_fill.data.size() == m_block_size)
+      queue_fill(lock);
+  }
+  if (m_error) {
+    errno = m_error;
+    return -1;
+  }
+  return n;
+}
+
+/// Sets the file position.  In read mode, discards the data that were
+/// read ahead, and starts reading ahead from the new position.  In
+/// write mode, first waits until all data were written.  Leaves
+/// everything as it is if the position does not change.
+///
+/// \param offset is the offset relative to the position given by \a
+/// whence.
+///
+/// \param whence is `SEEK_SET`, `SEEK_CUR`, or `SEEK_END`, as for
+/// `lseek`.
+///
+/// \returns the new position, or -1 if an error occurred.
+int64_t
+AsyncStream::seek(int64_t offset, int whence)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  int64_t target;
+
+  switch (whence) {
+    case SEEK_SET:
+      target = offset;
+      break;
+    case SEEK_CUR:
+      target = m_position + offset;
+      break;
+    case SEEK_END:
+      {
+        if (m_writing) {        // the file must be complete
+          queue_fill(lock);
+          m_changed.wait(lock, [this] { return m_blocks.empty() && !m_busy; });
+        }
+        struct stat st;
+        if (fstat(m_fd, &st))
+          return -1;
+        target = st.st_size + offset;
+      }
+      break;
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+  if (target < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (target == m_position)     // e.g., for ftell()
+    return target;
+
+  if (m_writing) {
+    queue_fill(lock);
+    m_changed.wait(lock, [this] { return m_blocks.empty() && !m_busy; });
+    m_fill.offset = target;
+  } else {
+    m_blocks.clear();
+    m_next = target;
+    m_eof = false;
+    m_error = 0;
+    ++m_generation;             // a block being read is no longer wanted
+    m_changed.notify_all();
+  }
+  m_position = target;
+  return target;
+}
+
+/// Waits until all data that were written so far have reached the
+/// file.  Returns immediately in read mode.
+///
+/// \returns `true` if no read or write failed, `false` otherwise.
+bool
+AsyncStream::wait()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  if (m_writing) {
+    queue_fill(lock);
+    m_changed.wait(lock, [this] { return m_blocks.empty() && !m_busy; });
+  }
+  return !m_error;
+}
+
+/// Writes any remaining data, stops the background thread, and closes
+/// the file.
+///
+/// \returns 0 if successful, -1 if a read or write failed or the file
+/// could not be closed.
+int
+AsyncStream::close()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_writing)
+      queue_fill(lock);
+    m_stop = true;
+    m_changed.notify_all();
+  }
+  m_thread.join();
+
+  int result = m_error? -1: 0;
+  if (::close(m_fd))
+    result = -1;
+  m_fd = -1;
+  return result;
+}
+
+/// Runs the background thread.
+void
+AsyncStream::run()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  if (m_writing)
+    run_writer(lock);
+  else
+    run_reader(lock);
+}
+
+/// Runs the background thread in read mode: reads blocks beyond the
+/// current position until all buffers are full, the end of the file is
+/// reached, or a read fails.
+///
+/// \param lock holds #m_mutex, except while the thread reads.
+void
+AsyncStream::run_reader(std::unique_lock<std::mutex>& lock)
+{
+  while (true) {
+    m_changed.wait(lock, [this] {
+      return m_stop || (!m_eof && !m_error && m_blocks.size() < m_nblocks);
+    });
+    if (m_stop)
+      return;
+
+    Block block = { m_next, std::vector<char>(m_block_size), 0 };
+    uint64_t generation = m_generation;
+    m_busy = true;
+    lock.unlock();
+    int64_t n = pread_all(m_fd, block.data.data(), block.data.size(),
+                          block.offset);
+    int error = (n < 0)? errno: 0;
+    lock.lock();
+    m_busy = false;
+
+    if (generation == m_generation) { // there was no seek meanwhile
+      if (n < 0)
+        m_error = error;
+      else {
+        if ((size_t) n < m_block_size)
+          m_eof = true;
+        if (n) {
+          block.data.resize(n);
+          m_next += n;
+          m_blocks.push_back(std::move(block));
+        }
+      }
+    }
+    m_changed.notify_all();
+  }
+}
+
+/// Runs the background thread in write mode: writes the queued
+/// blocks.  When asked to stop, writes the remaining blocks first.
+///
+/// \param lock holds #m_mutex, except while the thread writes.
+void
+AsyncStream::run_writer(std::unique_lock<std::mutex>& lock)
+{
+  while (true) {
+    m_changed.wait(lock, [this] { return m_stop || !m_blocks.empty(); });
+    if (m_blocks.empty())       // and asked to stop
+      return;
+
+    // the caller only appends blocks, so this reference stays valid
+    Block& block = m_blocks.front();
+    m_busy = true;
+    lock.unlock();
+    bool ok = pwrite_all(m_fd, block.data.data(), block.data.size(),
+                         block.offset);
+    int error = ok? 0: errno;
+    lock.lock();
+    m_busy = false;
+
+    if (!ok && !m_error)
+      m_error = error;
+    m_blocks.pop_front();
+    m_changed.notify_all();
+  }
+}
+
+/// In write mode, queues the block that is being filled for writing,
+/// if it holds any data.  Waits until there is room in the queue.
+/// Discards the data if a write failed earlier.
+///
+/// \param lock holds #m_mutex.
+void
+AsyncStream::queue_fill(std::unique_lock<std::mutex>& lock)
+{
+  if (!m_fill.data.empty()) {
+    m_changed.wait(lock, [this] {
+      return m_blocks.size() < m_nblocks || m_error;
+    });
+    if (!m_error) {
+      m_blocks.push_back(std::move(m_fill));
+      m_changed.notify_all();
+    }
+  }
+  m_fill = { m_position, {}, 0 };
+}
+
+#if HAVE_FOPENCOOKIE
+// the functions through which a stream from fopencookie() uses an
+// AsyncStream
+
+static ssize_t
+async_cookie_read(void* cookie, char* data, size_t n)
+{
+  return ((AsyncStream*) cookie)->read(data, n);
+}
+
+static ssize_t
+async_cookie_write(void* cookie, char const* data, size_t n)
+{
+  int64_t result = ((AsyncStream*) cookie)->write(data, n);
+  return (result < 0)? 0: result; // 0 signals an error
+}
+
+static int
+async_cookie_seek(void* cookie, off64_t* offset, int whence)
+{
+  int64_t result = ((AsyncStream*) cookie)->seek(*offset, whence);
+  if (result < 0)
+    return -1;
+  *offset = result;
+  return 0;
+}
+
+static int
+async_cookie_close(void* cookie)
+{
+  AsyncStream* stream = (AsyncStream*) cookie;
+  int result = stream->close();
+  delete stream;
+  return result? EOF: 0;
+}
+#endif
+
+/// Opens a regular file for asynchronous reading or writing through a
+/// standard `FILE` stream, so that all routines that use `FILE`
+/// streams read ahead or write behind.  `fclose` on the stream closes
+/// the AsyncStream, too.
+///
+/// \param name is the name of the file.
+///
+/// \param writing says whether to open the file for writing, which
+/// truncates it, or for reading.
+///
+/// \param buffer_size is the total size of the buffers, in bytes.
+///
+/// \param stream receives a pointer to the AsyncStream, for example to
+/// call AsyncStream::wait().  It must not be used anymore after the
+/// `FILE` stream was closed.
+///
+/// \returns the `FILE` stream, or `NULL` if the file could not be
+/// opened, if it is not a regular file (e.g., a pipe), or if this
+/// system does not support such streams.  Then the caller may open it
+/// the ordinary way instead.
+FILE*
+async_fopen(char const* name, bool writing, size_t buffer_size,
+            AsyncStream** stream)
+{
+  *stream = NULL;
+#if HAVE_FOPENCOOKIE
+  int fd = writing? open(name, O_WRONLY | O_CREAT | O_TRUNC, 0666):
+    open(name, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+    ::close(fd);
+    return NULL;
+  }
+
+  const size_t block_size = 1 << 20;
+  AsyncStream* s = new AsyncStream(fd, writing, block_size,
+                                   std::max<size_t>(buffer_size/block_size, 2));
+  cookie_io_functions_t functions = { async_cookie_read, async_cookie_write,
+                                      async_cookie_seek, async_cookie_close };
+  FILE* fp = fopencookie(s, writing? "w": "r", functions);
+  if (!fp) {
+    delete s;                   // closes the file
+    return NULL;
+  }
+  *stream = s;
+  return fp;
+#else
+  (void) name;
+  (void) writing;
+  (void) buffer_size;
+  return NULL;
+#endif
+}
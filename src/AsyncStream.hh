@@ -0,0 +1,145 @@
+/* This is file AsyncStream.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_ASYNCSTREAM_HH
+#define INCLUDED_ASYNCSTREAM_HH
+
+/// \file
+///
+/// This file declares a class that reads a file ahead or writes it
+/// behind in a background thread, so that file I/O overlaps with
+/// calculations.
+
+#include <condition_variable>
+#include <cstddef>              // for size_t
+#include <cstdint>              // for int64_t
+#include <cstdio>               // for FILE
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// A class that reads from or writes to a regular file through a
+/// background thread and a bounded number of buffers.
+///
+/// In read mode, the background thread reads the blocks of the file
+/// that follow the current position before they are asked for, until
+/// all buffers are full.  In write mode, the data are copied into the
+/// buffers and written by the background thread, and the writer has to
+/// wait only when all buffers are full.
+///
+/// The calling thread must be the only one that calls the member
+/// functions.  The file can also be used through a standard `FILE`
+/// stream, see async_fopen().
+class AsyncStream
+{
+public:
+  AsyncStream(int fd, bool writing, size_t block_size = 1 << 20,
+              size_t nblocks = 16);
+  ~AsyncStream();
+
+  /// Not copyable.
+  AsyncStream(AsyncStream const&) = delete;
+  AsyncStream& operator=(AsyncStream const&) = delete;
+
+  int64_t read(void* data, size_t n);
+  int64_t write(void const* data, size_t n);
+  int64_t seek(int64_t offset, int whence);
+  bool wait();
+  int close();
+
+  /// Returns `true` for write mode, `false` for read mode.
+  bool writing() const { return m_writing; }
+
+private:
+  /// A buffer with data from or for the file.
+  struct Block
+  {
+    /// The file offset of the first byte.
+    int64_t offset;
+
+    /// The data.
+    std::vector<char> data;
+
+    /// In read mode, the number of bytes already handed out.
+    size_t used;
+  };
+
+  void run();
+  void run_reader(std::unique_lock<std::mutex>& lock);
+  void run_writer(std::unique_lock<std::mutex>& lock);
+  void queue_fill(std::unique_lock<std::mutex>& lock);
+
+  /// The file descriptor.
+  int m_fd;
+
+  /// Write mode (`true`) or read mode (`false`).
+  bool m_writing;
+
+  /// The size of each buffer.
+  size_t m_block_size;
+
+  /// The maximum number of buffers.
+  size_t m_nblocks;
+
+  /// The logical file position of the caller.
+  int64_t m_position;
+
+  /// In read mode, the file offset at which the background thread reads
+  /// next.
+  int64_t m_next;
+
+  /// In read mode, is incremented by each seek, so the background
+  /// thread can tell that the block it just read is no longer wanted.
+  uint64_t m_generation;
+
+  /// The buffers that were read but not yet handed out, or that were
+  /// filled but not yet written.
+  std::deque<Block> m_blocks;
+
+  /// In write mode, the buffer that is being filled.
+  Block m_fill;
+
+  /// Is the background thread busy with a block outside of the lock?
+  bool m_busy;
+
+  /// In read mode, did the background thread reach the end of the file?
+  bool m_eof;
+
+  /// The `errno` of the first failed read or write, or 0.
+  int m_error;
+
+  /// Should the background thread stop?
+  bool m_stop;
+
+  /// Guards all members that both threads use.
+  std::mutex m_mutex;
+
+  /// Signals changes to the members that m_mutex guards.
+  std::condition_variable m_changed;
+
+  /// The background thread.
+  std::thread m_thread;
+};
+
+FILE* async_fopen(char const* name, bool writing, size_t buffer_size,
+                  AsyncStream** stream);
+
+#endif
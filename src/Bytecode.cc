@@ -0,0 +1,1404 @@
+/* This is file Bytecode.cc.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+///
+/// This file defines the bytecode compiler and virtual machine for
+/// loops that do only scalar arithmetic.
+
+# include "config.h"
+# include <algorithm>            // for std::copy
+# include <cmath>                // for std::isnan
+# include <csignal>              // for sig_atomic_t
+# include <cstdio>               // for printf(3) snprintf(4)
+# include <initializer_list>
+# include <string>
+# include <unordered_map>
+# include <vector>
+# include "action.hh"
+# include "Bytecode.hh"
+
+int32_t lux_bytecode = 0;
+
+extern int32_t nFixed, trace, step, nBreakpoint, nWatchVars, executeLevel,
+  noTrace, traceMode;
+
+void breakToTopLevel(void);
+
+namespace {
+
+/// The data types that the virtual machine handles.  The
+/// type-specialized variants of an operation are in this order.  The
+/// order is the same as that of the corresponding Symboltype values.
+enum VmType
+  {
+    VM_INT32,
+    VM_INT64,
+    VM_FLOAT,
+    VM_DOUBLE,
+    VM_NTYPES,
+    VM_UNKNOWN = -1,            ///< not yet known
+    VM_INVALID = -2,            ///< not handled by the virtual machine
+  };
+
+/// The LUX data types corresponding to the VmType values.
+Symboltype const luxType[VM_NTYPES]
+= { LUX_INT32, LUX_INT64, LUX_FLOAT, LUX_DOUBLE };
+
+/// Set by bytecode_defer_break() when the user asked to abort the
+/// calculation while the virtual machine was running.
+volatile sig_atomic_t breakRequested = 0;
+
+/// Returns the VmType corresponding to a LUX data type, or
+/// VM_INVALID.
+VmType
+vmType(Symboltype type)
+{
+  switch (type) {
+  case LUX_INT32:
+    return VM_INT32;
+  case LUX_INT64:
+    return VM_INT64;
+  case LUX_FLOAT:
+    return VM_FLOAT;
+  case LUX_DOUBLE:
+    return VM_DOUBLE;
+  default:
+    return VM_INVALID;
+  }
+}
+
+/// The operations of the virtual machine.  The type-specialized
+/// operations have one opcode per VmType: the base opcode plus the
+/// VmType.  The conversion operations are specialized for the source
+/// type.
+enum Opcode : uint8_t
+  {
+    OP_MOV = 0,                 ///< dst = a
+    OP_ADD = 4,                 ///< dst = a + b
+    OP_SUB = 8,                 ///< dst = a - b
+    OP_MUL = 12,                ///< dst = a*b
+    OP_DIV = 16,                ///< dst = a/b
+    OP_MAX = 20,                ///< dst = a > b? a: b (NaN-aware)
+    OP_MIN = 24,                ///< dst = a < b? a: b (NaN-aware)
+    OP_NEG = 28,                ///< dst = -a
+    OP_EQ = 32,                 ///< dst (INT32) = a == b
+    OP_GT = 36,                 ///< dst (INT32) = a > b
+    OP_GE = 40,                 ///< dst (INT32) = a >= b
+    OP_LT = 44,                 ///< dst (INT32) = a < b
+    OP_LE = 48,                 ///< dst (INT32) = a <= b
+    OP_NE = 52,                 ///< dst (INT32) = a != b
+    OP_AND = 56,                ///< dst = a & b (integer types only)
+    OP_OR = 60,                 ///< dst = a | b (integer types only)
+    OP_XOR = 64,                ///< dst = a ^ b (integer types only)
+    OP_JZ = 68,                 ///< jump to target if a == 0
+    OP_JNZ = 72,                ///< jump to target if a != 0
+    OP_TO_INT32 = 76,           ///< dst (INT32) = a
+    OP_TO_INT64 = 80,           ///< dst (INT64) = a
+    OP_TO_FLOAT = 84,           ///< dst (FLOAT) = a
+    OP_TO_DOUBLE = 88,          ///< dst (DOUBLE) = a
+    OP_FOR_DONE = 92,           ///< jump to target if counter a is past b
+                                ///< in the direction of step dst
+    OP_FOR_NEXT = 96,           ///< a += dst; jump to target unless a is
+                                ///< past b in the direction of dst
+    OP_LOAD = 100,              ///< dst = element of array a at the
+                                ///< INT32 subscripts in type slots
+                                ///< starting at b
+    OP_JMP = 104,               ///< jump to target
+    OP_FOR_SETUP,               ///< make variable a a scalar of type
+    OP_DEFINE,                  ///< give variable a scalar type
+    OP_STOP_NEGATIVE,           ///< stop with result a if INT32 a < 0
+    OP_POLL,                    ///< stop at continuation target if
+                                ///< the tree interpreter must take over
+    OP_END,                     ///< done
+  };
+
+/// Returns the opcode for the variant of operation \a base for data
+/// type \a type.
+constexpr uint8_t
+typed(Opcode base, VmType type)
+{
+  return base + (int) type;
+}
+
+/// An instruction for the virtual machine.  The operands are slot
+/// numbers.  The first slots hold the values of the LUX variables and
+/// constants that the code uses, and the others are registers.
+struct Instruction
+{
+  uint8_t op;                   ///< the Opcode
+  uint8_t type;                 ///< a Symboltype or count, for some
+                                ///< operations
+  int16_t dst;                  ///< the destination slot
+  int16_t a;                    ///< the first operand slot
+  int16_t b;                    ///< the second operand slot
+  int32_t target;               ///< the instruction to jump to, or
+                                ///< the symbol to blame for an error
+};
+
+/// Describes an array that the code reads from.
+struct ArrayRef
+{
+  void* data;                   ///< points at the elements
+  int32_t nelem;                ///< the number of elements
+  int32_t dims[MAX_DIMS];       ///< the dimensions
+};
+
+/// A statement that encloses a point in the code, for finishing the
+/// statement in the tree interpreter from that point.
+struct Frame
+{
+  int32_t statement;            ///< the LUX_EVB symbol
+  int32_t index;                ///< for a block, the index of the
+                                ///< statement that contains the point
+  int16_t start;                ///< for a FOR loop, the start slot
+  int16_t end;                  ///< for a FOR loop, the end slot
+  int16_t step;                 ///< for a FOR loop, the step slot
+  VmType type;                  ///< for a FOR loop, the counter type
+};
+
+/// A compiled statement.
+struct Program
+{
+  /// Identifies the statement tree that was compiled: the class,
+  /// type, and child symbol numbers of its nodes.
+  std::string fingerprint;
+
+  /// The LUX_PRE_EXTRACT nodes and the variables that they subscript.
+  /// The nodes are converted to LUX_EXTRACT once the statement
+  /// compiled.
+  std::vector<std::pair<int32_t, int32_t>> preExtracts;
+
+  /// The variables and constants that the statement uses, in slot
+  /// order.
+  std::vector<int32_t> leaves;
+
+  /// For each leaf, is it assigned to?
+  std::vector<bool> written;
+
+  /// For each leaf, is it a FOR-loop counter?
+  std::vector<bool> counter;
+
+  /// The class, type, and (for arrays) number of dimensions of each
+  /// (resolved) leaf when the code was generated.
+  std::vector<int32_t> signature;
+
+  /// Is #code valid for #signature?
+  bool compiled = false;
+
+  /// The instructions.
+  std::vector<Instruction> code;
+
+  /// The number of registers that #code uses.
+  int32_t nRegisters = 0;
+
+  /// For each OP_POLL instruction, the statements that enclose it,
+  /// innermost first.
+  std::vector<std::vector<Frame>> continuations;
+};
+
+/// Returns the variable that a LUX_EXTRACT or LUX_PRE_EXTRACT node
+/// of a scanned statement subscripts.
+int32_t
+extractTarget(Program const& program, int32_t s)
+{
+  if (symbol_class(s) == LUX_EXTRACT)
+    return extract_target(s);
+  for (auto const& p : program.preExtracts)
+    if (p.first == s)
+      return p.second;
+  return 0;
+}
+
+/// Does the symbol class describe an expression that must be
+/// evaluated, rather than a variable or constant?
+bool
+isExpressionClass(Symbolclass c)
+{
+  return (c >= LUX_SUBROUTINE && c != LUX_UNDEFINED) || c == LUX_META
+    || c == LUX_LIST_PTR || c == LUX_PRE_RANGE || c == LUX_PRE_CLIST || c == LUX_PRE_LIST
+    || c == LUX_FUNC_PTR || c == LUX_SUBSC_PTR;
+}
+
+/// Is the binary operation one that the virtual machine handles?
+bool
+isSupportedBinaryOp(int32_t op)
+{
+  switch (op) {
+  case LUX_ADD: case LUX_SUB: case LUX_MUL: case LUX_DIV: case LUX_MAX:
+  case LUX_MIN: case LUX_EQ: case LUX_GT: case LUX_GE: case LUX_LT:
+  case LUX_LE: case LUX_NE: case LUX_OR: case LUX_AND: case LUX_XOR:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// Walks a statement tree to see if it has only constructs that the
+/// compiler handles, and collects its fingerprint and leaves.  The
+/// tree is not modified.
+class Scanner
+{
+public:
+  /// Constructor.  \a program receives the fingerprint and leaves.
+  Scanner(Program& program) : m_program(program) { }
+
+  /// Scans a statement.  Returns `true` if the statement can be
+  /// compiled, `false` otherwise.
+  bool
+  statement(int32_t s)
+  {
+    if (s <= 0 || symbol_class(s) != LUX_EVB)
+      return false;
+    int16_t* args = evb_args(s);
+    switch (evb_type(s)) {
+    case EVB_REPLACE:
+      node(s, { EVB_REPLACE, replace_lhs(s), replace_rhs(s) });
+      if (replace_lhs(s) < nFixed)
+        return false;
+      return leaf(replace_lhs(s), true, false)
+        && expression(replace_rhs(s));
+    case EVB_BLOCK:
+      {
+        int32_t n = block_num_statements(s);
+        int16_t* ptr = block_statements(s);
+        node(s, { EVB_BLOCK });
+        children(ptr, n);
+        while (n--)
+          if (!statement(*ptr++))
+            return false;
+        return true;
+      }
+    case EVB_IF:
+      node(s, { EVB_IF, args[0], args[1], args[2] });
+      return expression(args[0]) && statement(args[1])
+        && (!args[2] || statement(args[2]));
+    case EVB_FOR:
+      node(s, { EVB_FOR, for_loop_symbol(s), for_start(s), for_end(s),
+                for_step(s), for_body(s) });
+      if (for_loop_symbol(s) < nFixed)
+        return false;
+      return leaf(for_loop_symbol(s), true, true)
+        && expression(for_start(s)) && expression(for_end(s))
+        && expression(for_step(s)) && statement(for_body(s));
+    case EVB_WHILE_DO:
+      node(s, { EVB_WHILE_DO, args[0], args[1] });
+      return expression(args[0]) && statement(args[1]);
+    case EVB_DO_WHILE: case EVB_REPEAT:
+      node(s, { evb_type(s), args[0], args[1] });
+      return statement(args[0]) && expression(args[1]);
+    default:
+      return false;
+    }
+  }
+
+  /// Scans an expression.  Returns `true` if the expression can be
+  /// compiled, `false` otherwise.
+  bool
+  expression(int32_t s)
+  {
+    if (s <= 0)
+      return false;
+    Symbolclass c = symbol_class(s);
+    if (!isExpressionClass(c))
+      return leaf(s, false, false);
+    switch (c) {
+    case LUX_BIN_OP:
+      node(s, { bin_op_type(s), bin_op_lhs(s), bin_op_rhs(s) });
+      return isSupportedBinaryOp(bin_op_type(s))
+        && expression(bin_op_lhs(s)) && expression(bin_op_rhs(s));
+    case LUX_IF_OP:
+      node(s, { bin_op_type(s), bin_op_lhs(s), bin_op_rhs(s) });
+      return leaf(LUX_ZERO, false, false) && leaf(LUX_ONE, false, false)
+        && expression(bin_op_lhs(s)) && expression(bin_op_rhs(s));
+    case LUX_INT_FUNC:
+      node(s, { int_func_number(s) });
+      children(int_func_arguments(s), int_func_num_arguments(s));
+      return int_func_number(s) == LUX_NEG_FUN
+        && int_func_num_arguments(s) == 1
+        && expression(int_func_arguments(s)[0]);
+    case LUX_PRE_EXTRACT: case LUX_EXTRACT:
+      {
+        int32_t target;
+        ExtractSec* eptr;
+        if (c == LUX_PRE_EXTRACT) {
+          // resolve the subscripted variable like evalExtractRhs()
+          // would, but leave the node alone until the statement is
+          // known to compile
+          if (pre_extract_num_sec(s) != 1)
+            return false;
+          target = lookForVarName(pre_extract_name(s), curContext);
+          if (target <= 0)
+            return false;
+          eptr = pre_extract_ptr(s);
+          m_program.preExtracts.push_back({s, target});
+        } else {
+          if (extract_num_sec(s) != 1)
+            return false;
+          target = extract_target(s);
+          eptr = extract_ptr(s);
+        }
+        if (target <= 0 || eptr->type != LUX_RANGE || eptr->number < 1
+            || eptr->number > MAX_DIMS)
+          return false;
+        node(s, { target, eptr->type, eptr->number });
+        children(eptr->ptr.i16, eptr->number);
+        if (!leaf(target, false, false))
+          return false;
+        for (int32_t i = 0; i < eptr->number; ++i)
+          if (!expression(eptr->ptr.i16[i]))
+            return false;
+        return true;
+      }
+    default:
+      return false;
+    }
+  }
+
+private:
+  /// Adds a number to the fingerprint.
+  void
+  add(int32_t x)
+  {
+    m_program.fingerprint.append((char const*) &x, sizeof(x));
+  }
+
+  /// Adds a node to the fingerprint: its class, and \a fields that
+  /// hold its type and the symbol numbers of its children.
+  void
+  node(int32_t s, std::initializer_list<int32_t> fields)
+  {
+    add(symbol_class(s));
+    for (int32_t x : fields)
+      add(x);
+  }
+
+  /// Adds the symbol numbers of \a n children to the fingerprint.
+  void
+  children(int16_t const* p, int32_t n)
+  {
+    add(n);
+    while (n--)
+      add(*p++);
+  }
+
+  /// Records a leaf.  Always returns `true`.
+  bool
+  leaf(int32_t s, bool written, bool counter)
+  {
+    auto it = m_index.find(s);
+    size_t i;
+    if (it == m_index.end()) {
+      i = m_index[s] = m_program.leaves.size();
+      m_program.leaves.push_back(s);
+      m_program.written.push_back(false);
+      m_program.counter.push_back(false);
+    } else
+      i = it->second;
+    if (written)
+      m_program.written[i] = true;
+    if (counter)
+      m_program.counter[i] = true;
+    return true;
+  }
+
+  Program& m_program;
+  std::unordered_map<int32_t, size_t> m_index;
+};
+
+/// Generates code for a statement tree that the Scanner accepted, for
+/// the current classes and types of its leaves.
+class Compiler
+{
+public:
+  /// Constructor.
+  ///
+  /// \param program is the program to generate code for.  Its leaves
+  /// and signature must have been set.
+  ///
+  /// \param resolved are the leaves with transfer symbols resolved.
+  Compiler(Program& program, std::vector<int32_t> const& resolved)
+    : m_program(program),
+      m_nleaves(program.leaves.size()),
+      m_type(m_nleaves),
+      m_element(m_nleaves, VM_INVALID),
+      m_ndim(m_nleaves),
+      m_defined(m_nleaves),
+      m_undefinedAtEntry(m_nleaves)
+  {
+    for (size_t i = 0; i < m_nleaves; ++i) {
+      int32_t s = resolved[i];
+      Symbolclass c = symbol_class(s);
+      m_type[i] = (c == LUX_SCALAR? vmType(scalar_type(s)): VM_INVALID);
+      if (c == LUX_ARRAY) {
+        m_element[i] = vmType(array_type(s));
+        m_ndim[i] = array_num_dims(s);
+      }
+      m_defined[i] = (m_type[i] >= 0);
+      m_undefinedAtEntry[i] = (c == LUX_UNDEFINED || c == LUX_UNUSED);
+      if (m_program.counter[i] && m_type[i] < 0) {
+        // the FOR statement will make it a scalar
+        m_type[i] = VM_UNKNOWN;
+        m_undefinedAtEntry[i] = true;
+      } else if (m_undefinedAtEntry[i] && m_program.written[i])
+        m_type[i] = VM_UNKNOWN;
+    }
+  }
+
+  /// Generates the code.  Returns `true` for success, `false` if the
+  /// statement cannot be compiled for the current types.
+  bool
+  compile(int32_t s)
+  {
+    m_program.code.clear();
+    m_program.continuations.clear();
+    m_program.nRegisters = 0;
+    if (!statement(s))
+      return false;
+    emit(OP_END);
+    return true;
+  }
+
+private:
+  /// Appends an instruction and returns its index.
+  size_t
+  emit(uint8_t op, int16_t dst = 0, int16_t a = 0, int16_t b = 0,
+       uint8_t type = 0)
+  {
+    m_program.code.push_back(Instruction{op, type, dst, a, b, 0});
+    return m_program.code.size() - 1;
+  }
+
+  /// Returns the index of the next instruction.
+  int32_t
+  here() const
+  {
+    return m_program.code.size();
+  }
+
+  /// Sets the jump target of an instruction to the next instruction.
+  void
+  land(size_t jump)
+  {
+    m_program.code[jump].target = here();
+  }
+
+  /// Emits an instruction that lets the tree interpreter take over at
+  /// the end of the body of the innermost enclosing loop.
+  void
+  poll()
+  {
+    m_program.code[emit(OP_POLL)].target = m_program.continuations.size();
+    m_program.continuations.emplace_back(m_frames.rbegin(), m_frames.rend());
+  }
+
+  /// Returns the slot of a new register.
+  int16_t
+  newRegister()
+  {
+    return m_nleaves + m_program.nRegisters++;
+  }
+
+  /// Returns the slot of a leaf.
+  int16_t
+  leafSlot(int32_t s) const
+  {
+    for (size_t i = 0; i < m_nleaves; ++i)
+      if (m_program.leaves[i] == s)
+        return i;
+    return -1;
+  }
+
+  /// Returns a slot that holds the value of \a slot converted from
+  /// type \a from to type \a to.  If \a copy is true, then the result
+  /// is always in a new register.
+  int16_t
+  convert(int16_t slot, VmType from, VmType to, bool copy = false)
+  {
+    if (from == to && !copy)
+      return slot;
+    int16_t r = newRegister();
+    emit(typed((Opcode) (OP_TO_INT32 + 4*(int) to), from), r, slot);
+    return r;
+  }
+
+  /// Generates code for an expression.  Returns the slot that holds
+  /// the result, or -1 if the expression cannot be compiled.  \a type
+  /// receives the type of the result.  \a single is set to `true` if
+  /// the last emitted instruction is the only one that writes the
+  /// result, so its destination may be changed.
+  int16_t
+  expression(int32_t s, VmType& type, bool& single)
+  {
+    single = false;
+    switch (symbol_class(s)) {
+    case LUX_BIN_OP:
+      {
+        VmType lt, rt;
+        bool dummy;
+        int16_t l = expression(bin_op_lhs(s), lt, dummy);
+        if (l < 0)
+          return -1;
+        int16_t r = expression(bin_op_rhs(s), rt, dummy);
+        if (r < 0)
+          return -1;
+        // INT64 with FLOAT yields DOUBLE in LUX, but the calculation
+        // is done in FLOAT; leave that to the tree interpreter
+        if ((lt == VM_INT64 && rt == VM_FLOAT)
+            || (lt == VM_FLOAT && rt == VM_INT64))
+          return -1;
+        VmType top = (lt > rt? lt: rt);
+        Opcode base;
+        type = top;
+        switch (bin_op_type(s)) {
+        case LUX_ADD: base = OP_ADD; break;
+        case LUX_SUB: base = OP_SUB; break;
+        case LUX_MUL: base = OP_MUL; break;
+        case LUX_DIV: base = OP_DIV; break;
+        case LUX_MAX: base = OP_MAX; break;
+        case LUX_MIN: base = OP_MIN; break;
+        case LUX_EQ: base = OP_EQ; type = VM_INT32; break;
+        case LUX_GT: base = OP_GT; type = VM_INT32; break;
+        case LUX_GE: base = OP_GE; type = VM_INT32; break;
+        case LUX_LT: base = OP_LT; type = VM_INT32; break;
+        case LUX_LE: base = OP_LE; type = VM_INT32; break;
+        case LUX_NE: base = OP_NE; type = VM_INT32; break;
+        case LUX_AND: base = OP_AND; break;
+        case LUX_OR: base = OP_OR; break;
+        case LUX_XOR: base = OP_XOR; break;
+        default:
+          return -1;
+        }
+        if (base >= OP_AND && base <= OP_XOR && top > VM_INT64)
+          return -1;            // LUX reports an error
+        l = convert(l, lt, top);
+        r = convert(r, rt, top);
+        int16_t d = newRegister();
+        emit(typed(base, top), d, l, r);
+        single = true;
+        return d;
+      }
+    case LUX_IF_OP:
+      {
+        int16_t zero = leafSlot(LUX_ZERO), one = leafSlot(LUX_ONE);
+        if (m_type[zero] != VM_INT32 || m_type[one] != VM_INT32)
+          return -1;
+        bool andif = (bin_op_type(s) == LUX_ANDIF);
+        VmType lt, rt;
+        bool dummy;
+        int16_t d = newRegister();
+        // ANDIF: d = 0; if (!l || !r) done; d = 1
+        // ORIF: d = 1; if (l || r) done; d = 0
+        emit(typed(OP_MOV, VM_INT32), d, andif? zero: one);
+        int16_t l = expression(bin_op_lhs(s), lt, dummy);
+        if (l < 0)
+          return -1;
+        size_t jump1 = emit(typed(andif? OP_JZ: OP_JNZ, lt), 0, l);
+        int16_t r = expression(bin_op_rhs(s), rt, dummy);
+        if (r < 0)
+          return -1;
+        size_t jump2 = emit(typed(andif? OP_JZ: OP_JNZ, rt), 0, r);
+        emit(typed(OP_MOV, VM_INT32), d, andif? one: zero);
+        land(jump1);
+        land(jump2);
+        type = VM_INT32;
+        return d;
+      }
+    case LUX_INT_FUNC:            // only negation gets here
+      {
+        bool dummy;
+        int16_t a = expression(int_func_arguments(s)[0], type, dummy);
+        if (a < 0)
+          return -1;
+        int16_t d = newRegister();
+        emit(typed(OP_NEG, type), d, a);
+        single = true;
+        return d;
+      }
+    case LUX_PRE_EXTRACT: case LUX_EXTRACT: // only subscripted arrays
+      {
+        int16_t x = leafSlot(extractTarget(m_program, s));
+        ExtractSec* eptr = (symbol_class(s) == LUX_EXTRACT? extract_ptr(s):
+                            pre_extract_ptr(s));
+        int32_t n = eptr->number;
+        if (m_element[x] < 0 || (n != 1 && n != m_ndim[x]))
+          return -1;            // LUX reports an error
+        int16_t subscript[MAX_DIMS];
+        VmType subscriptType[MAX_DIMS];
+        bool dummy;
+        for (int32_t i = 0; i < n; ++i) {
+          subscript[i] = expression(eptr->ptr.i16[i], subscriptType[i],
+                                    dummy);
+          if (subscript[i] < 0)
+            return -1;
+        }
+        // like int_arg(); and the subscripts must be in consecutive
+        // registers
+        int16_t first = convert(subscript[0], subscriptType[0], VM_INT32,
+                                n > 1);
+        for (int32_t i = 1; i < n; ++i)
+          convert(subscript[i], subscriptType[i], VM_INT32, true);
+        int16_t d = newRegister();
+        type = m_element[x];
+        emit(typed(OP_LOAD, type), d, x, first, n);
+        m_program.code.back().target = s;
+        single = true;
+        return d;
+      }
+    default:                      // a leaf
+      {
+        int16_t i = leafSlot(s);
+        if (!m_defined[i] || m_type[i] < 0)
+          return -1;
+        type = m_type[i];
+        return i;
+      }
+    }
+  }
+
+  /// Generates code for an expression that is used as a loop
+  /// condition, which LUX converts to INT32 (like int_arg()).
+  /// Returns the slot, or -1 if the expression cannot be compiled.
+  int16_t
+  condition(int32_t s)
+  {
+    VmType type;
+    bool single;
+    int16_t c = expression(s, type, single);
+    return c < 0? -1: convert(c, type, VM_INT32);
+  }
+
+  /// Generates code for a statement.  Returns `true` for success,
+  /// `false` if the statement cannot be compiled.
+  bool
+  statement(int32_t s)
+  {
+    int16_t* args = evb_args(s);
+    switch (evb_type(s)) {
+    case EVB_REPLACE:
+      {
+        int16_t i = leafSlot(replace_lhs(s));
+        VmType type;
+        bool single;
+        int16_t r = expression(replace_rhs(s), type, single);
+        if (r < 0)
+          return false;
+        if (m_type[i] == VM_UNKNOWN)
+          m_type[i] = type;
+        else if (m_type[i] != type)
+          return false;         // the variable would change type
+        if (single && r >= (int16_t) m_nleaves)
+          m_program.code.back().dst = i;
+        else
+          emit(typed(OP_MOV, type), i, r);
+        if (m_undefinedAtEntry[i])
+          emit(OP_DEFINE, 0, i, 0, luxType[type]);
+        m_defined[i] = true;
+        return true;
+      }
+    case EVB_BLOCK:
+      {
+        int32_t n = block_num_statements(s);
+        int16_t* ptr = block_statements(s);
+        for (int32_t i = 0; i < n; ++i) {
+          m_frames.push_back(Frame{s, i});
+          if (!statement(ptr[i]))
+            return false;
+          m_frames.pop_back();
+        }
+        return true;
+      }
+    case EVB_IF:
+      {
+        VmType type;
+        bool single;
+        int16_t c = expression(args[0], type, single);
+        if (c < 0)
+          return false;
+        size_t toElse = emit(typed(OP_JZ, type), 0, c);
+        std::vector<bool> defined = m_defined;
+        if (!statement(args[1]))
+          return false;
+        m_defined = defined;
+        if (args[2]) {
+          size_t toEnd = emit(OP_JMP);
+          land(toElse);
+          if (!statement(args[2]))
+            return false;
+          m_defined = defined;
+          land(toEnd);
+        } else
+          land(toElse);
+        return true;
+      }
+    case EVB_FOR:
+      {
+        VmType st, et, pt;
+        bool single;
+        int16_t start = expression(for_start(s), st, single);
+        int16_t end = start < 0? -1: expression(for_end(s), et, single);
+        int16_t step = end < 0? -1: expression(for_step(s), pt, single);
+        if (step < 0)
+          return false;
+        // like lux_for()
+        if ((st == VM_INT64 && et == VM_FLOAT)
+            || (st == VM_FLOAT && et == VM_INT64))
+          return false;
+        VmType hi = (st > et? st: et);
+        if (for_step(s) != LUX_ONE && pt > hi)
+          hi = pt;
+        if (hi != VM_INT32 && hi != VM_INT64)
+          return false;         // leave Kahan-summed counters to lux_for
+        int16_t c = leafSlot(for_loop_symbol(s));
+        if (m_type[c] >= 0 && m_type[c] != hi)
+          return false;
+        m_type[c] = hi;
+        start = convert(start, st, hi, true);
+        end = convert(end, et, hi, true);
+        step = convert(step, pt, hi, true);
+        emit(OP_FOR_SETUP, 0, c, 0, luxType[hi]);
+        emit(typed(OP_MOV, hi), c, start);
+        size_t exit = emit(typed(OP_FOR_DONE, hi), step, c, end);
+        int32_t body = here();
+        std::vector<bool> defined = m_defined;
+        m_defined[c] = true;
+        m_frames.push_back(Frame{s, 0, start, end, step, hi});
+        if (!statement(for_body(s)))
+          return false;
+        poll();
+        m_frames.pop_back();
+        m_program.code[emit(typed(OP_FOR_NEXT, hi), step, c, end)].target
+          = body;
+        land(exit);
+        m_defined = defined;
+        m_defined[c] = true;
+        return true;
+      }
+    case EVB_WHILE_DO:
+      {
+        int32_t top = here();
+        int16_t c = condition(args[0]);
+        if (c < 0)
+          return false;
+        size_t exit = emit(typed(OP_JZ, VM_INT32), 0, c);
+        std::vector<bool> defined = m_defined;
+        m_frames.push_back(Frame{s});
+        if (!statement(args[1]))
+          return false;
+        poll();
+        m_frames.pop_back();
+        m_program.code[emit(OP_JMP)].target = top;
+        land(exit);
+        m_defined = defined;
+        return true;
+      }
+    case EVB_DO_WHILE: case EVB_REPEAT:
+      {
+        // the body is executed at least once
+        int32_t top = here();
+        m_frames.push_back(Frame{s});
+        if (!statement(args[0]))
+          return false;
+        poll();
+        m_frames.pop_back();
+        int16_t c = condition(args[1]);
+        if (c < 0)
+          return false;
+        // like execute(): a negative condition ends the loop, and
+        // becomes the result of the statement
+        emit(OP_STOP_NEGATIVE, 0, c);
+        m_program.code[emit(typed(evb_type(s) == EVB_DO_WHILE? OP_JNZ: OP_JZ,
+                                  VM_INT32), 0, c)].target = top;
+        return true;
+      }
+    default:
+      return false;
+    }
+  }
+
+  Program& m_program;
+
+  /// The number of leaves.
+  size_t m_nleaves;
+
+  /// The type of each leaf.
+  std::vector<VmType> m_type;
+
+  /// The element type of each leaf that is an array.
+  std::vector<VmType> m_element;
+
+  /// The number of dimensions of each leaf that is an array.
+  std::vector<int32_t> m_ndim;
+
+  /// For each leaf, does it certainly have a value at the current
+  /// point in the code?
+  std::vector<bool> m_defined;
+
+  /// For each leaf, was it undefined before the statement?
+  std::vector<bool> m_undefinedAtEntry;
+
+  /// The statements that enclose the code being generated, outermost
+  /// first.
+  std::vector<Frame> m_frames;
+};
+
+/// Accesses a slot as a value of type T.
+template<typename T> T& value(Scalar& p);
+template<> inline int32_t& value<int32_t>(Scalar& p) { return p.i32; }
+template<> inline int64_t& value<int64_t>(Scalar& p) { return p.i64; }
+template<> inline float& value<float>(Scalar& p) { return p.f; }
+template<> inline double& value<double>(Scalar& p) { return p.d; }
+
+/// Runs compiled code.
+///
+/// \param code points at the instructions.
+///
+/// \param s points at the slots.
+///
+/// \param arrays points at the descriptions of the leaves that are
+/// arrays.
+///
+/// \param symbols points at the (resolved) leaf symbols.
+///
+/// \param continuation receives the index of the continuation if an
+/// OP_POLL instruction stopped the code, or else -1.
+///
+/// \returns the result of the statement, for execute().
+int32_t
+run(Instruction const* code, Scalar* s, ArrayRef const* arrays,
+    int32_t const* symbols, int32_t* continuation)
+{
+  Instruction const* pc = code;
+
+  *continuation = -1;
+#define VM_INT_CASES(base, ...)                                    \
+  case typed(base, VM_INT32): { typedef int32_t T; __VA_ARGS__; } break; \
+  case typed(base, VM_INT64): { typedef int64_t T; __VA_ARGS__; } break;
+#define VM_CASES(base, ...)                                        \
+  VM_INT_CASES(base, __VA_ARGS__)                                  \
+  case typed(base, VM_FLOAT): { typedef float T; __VA_ARGS__; } break; \
+  case typed(base, VM_DOUBLE): { typedef double T; __VA_ARGS__; } break;
+#define A value<T>(s[in.a])
+#define B value<T>(s[in.b])
+#define D value<T>(s[in.dst])
+#define FLAG value<int32_t>(s[in.dst])
+
+  while (1) {
+    Instruction const& in = *pc++;
+    switch (in.op) {
+      VM_CASES(OP_MOV, D = A)
+      VM_CASES(OP_ADD, D = A + B)
+      VM_CASES(OP_SUB, D = A - B)
+      VM_CASES(OP_MUL, D = A*B)
+      VM_CASES(OP_DIV, D = A/B)
+      // like lux_max() and lux_min(): NaN wins
+      VM_CASES(OP_MAX, T x = A; T y = B; D = x > y? x: std::isnan(x)? x: y)
+      VM_CASES(OP_MIN, T x = A; T y = B; D = x < y? x: std::isnan(x)? x: y)
+      VM_CASES(OP_NEG, D = -A)
+      VM_CASES(OP_EQ, FLAG = (A == B))
+      VM_CASES(OP_GT, FLAG = (A > B))
+      VM_CASES(OP_GE, FLAG = (A >= B))
+      VM_CASES(OP_LT, FLAG = (A < B))
+      VM_CASES(OP_LE, FLAG = (A <= B))
+      VM_CASES(OP_NE, FLAG = (A != B))
+      VM_INT_CASES(OP_AND, D = A & B)
+      VM_INT_CASES(OP_OR, D = A | B)
+      VM_INT_CASES(OP_XOR, D = A ^ B)
+      VM_CASES(OP_JZ, if (!A) pc = code + in.target)
+      VM_CASES(OP_JNZ, if (A) pc = code + in.target)
+      VM_CASES(OP_TO_INT32, value<int32_t>(s[in.dst]) = (int32_t) A)
+      VM_CASES(OP_TO_INT64, value<int64_t>(s[in.dst]) = (int64_t) A)
+      VM_CASES(OP_TO_FLOAT, value<float>(s[in.dst]) = (float) A)
+      VM_CASES(OP_TO_DOUBLE, value<double>(s[in.dst]) = (double) A)
+      VM_CASES(OP_FOR_DONE, if (D >= 0? A > B: A < B) pc = code + in.target)
+      VM_CASES(OP_FOR_NEXT,
+               T c = (A += D);
+               if (D >= 0? c <= B: c >= B) pc = code + in.target)
+      VM_CASES(OP_LOAD,
+               // like lux_subsc_func(): a single subscript addresses
+               // the array as if it were one-dimensional
+               ArrayRef const& x = arrays[in.a];
+               Scalar const* subscript = &s[in.b];
+               int32_t index;
+               if (in.type == 1) {
+                 index = subscript->i32;
+                 if (index < 0 || index >= x.nelem)
+                   return cerror(ILL_SUBSC, in.target, index, x.nelem);
+               } else {
+                 index = 0;
+                 for (int32_t i = in.type - 1; i >= 0; --i) {
+                   int32_t j = subscript[i].i32;
+                   if (j < 0 || j >= x.dims[i])
+                     return cerror(ILL_SUBSC, in.target, j, x.dims[i]);
+                   index = index*x.dims[i] + j;
+                 }
+               }
+               D = ((T const*) x.data)[index])
+    case OP_JMP:
+      pc = code + in.target;
+      break;
+    case OP_FOR_SETUP:          // like lux_for()
+      undefine(symbols[in.a]);
+      symbol_class(symbols[in.a]) = LUX_SCALAR;
+      scalar_type(symbols[in.a]) = (Symboltype) in.type;
+      break;
+    case OP_DEFINE:
+      symbol_class(symbols[in.a]) = LUX_SCALAR;
+      scalar_type(symbols[in.a]) = (Symboltype) in.type;
+      break;
+    case OP_STOP_NEGATIVE:
+      if (s[in.a].i32 < 0)
+        return s[in.a].i32;
+      break;
+    case OP_POLL:               // like the test in execute()
+      if (trace || step || nBreakpoint || nWatchVars || breakRequested) {
+        *continuation = in.target;
+        return LUX_OK;
+      }
+      break;
+    case OP_END:
+      return LUX_OK;
+    }
+  }
+#undef VM_INT_CASES
+#undef VM_CASES
+#undef A
+#undef B
+#undef D
+#undef FLAG
+}
+
+/// Copies the values of the assigned variables from the slots back
+/// into their symbols.
+void
+writeBack(Program const& program, std::vector<int32_t> const& resolved,
+          Scalar const* slots)
+{
+  for (size_t i = 0; i < program.leaves.size(); ++i)
+    if (program.written[i] && symbol_class(resolved[i]) == LUX_SCALAR)
+      scalar_value(resolved[i]) = slots[i];
+}
+
+/// Finishes a FOR loop in the tree interpreter, like lux_for(),
+/// after the end of its body.
+template<typename T>
+int32_t
+finishFor(int32_t s, T& counter, T start, T end, T inc)
+{
+  int32_t action = ((trace > executeLevel && !noTrace)
+                    || step > executeLevel);
+  while (1) {
+    counter += inc;
+    if (inc >= 0? counter > end: counter < end)
+      return LUX_OK;
+    if (action) {
+      printf("FOR-loop: ");     // show for-loop status
+      printf("%1lld,%1lld,%1lld; counter %s = %1lld\n", (long long) start,
+             (long long) end, (long long) inc,
+             symbolIdent(for_loop_symbol(s), 0), (long long) counter);
+    }
+    int32_t n = execute(for_body(s));
+    if (n == LUX_ERROR)
+      printf("(counter %s = %1lld)", symbolIdent(for_loop_symbol(s), 0),
+             (long long) counter);
+    if (n < 0)
+      return n;
+  }
+}
+
+/// Finishes a statement in the tree interpreter, like execute().
+///
+/// \param frame describes the statement.
+///
+/// \param slots points at the slots of the code.
+///
+/// \param n is the result of the body of the loop, or of the
+/// statement of the block, that was just finished.
+///
+/// \returns the result of the statement.
+int32_t
+finishStatement(Frame const& frame, Scalar const* slots, int32_t n)
+{
+  int32_t s = frame.statement;
+  int16_t* args = evb_args(s);
+
+  switch (evb_type(s)) {
+  case EVB_BLOCK:
+    {
+      int32_t nstatements = block_num_statements(s);
+      for (int32_t i = frame.index + 1; n >= 0 && i < nstatements; ++i)
+        n = execute(block_statements(s)[i]);
+    }
+    return n;
+  case EVB_FOR:
+    if (n < 0)
+      return n;
+    if (frame.type == VM_INT32)
+      return finishFor(s, scalar_value(for_loop_symbol(s)).i32,
+                       slots[frame.start].i32, slots[frame.end].i32,
+                       slots[frame.step].i32);
+    return finishFor(s, scalar_value(for_loop_symbol(s)).i64,
+                     slots[frame.start].i64, slots[frame.end].i64,
+                     slots[frame.step].i64);
+  case EVB_WHILE_DO:
+    while (n > 0) {
+      int32_t c = eval(args[0]);
+      n = (symbol_class(c) == LUX_SCALAR? int_arg(c): 0);
+      zapTemp(c);
+      if (!n)
+        break;
+      n = execute(args[1]);
+    }
+    break;
+  case EVB_DO_WHILE: case EVB_REPEAT:
+    while (n > 0) {
+      int32_t c = eval(args[1]);
+      n = int_arg(c);
+      if (symbol_class(c) != LUX_SCALAR)
+        n = LUX_ERROR;
+      zapTemp(c);
+      if (n < 0 || (evb_type(s) == EVB_DO_WHILE? !n: n))
+        break;
+      n = execute(args[0]);
+    }
+    break;
+  default:                      // no other statements enclose loop bodies
+    break;
+  }
+  if (!n || n == LOOP_BREAK)
+    n = 1;
+  return n;
+}
+
+/// Finishes a statement in the tree interpreter after the code
+/// stopped at the end of a loop body.
+///
+/// \param frames are the statements that enclose the end of the loop
+/// body, innermost first.
+///
+/// \param slots points at the slots of the code.
+///
+/// \returns the result of the statement, for execute().
+int32_t
+finishInTree(std::vector<Frame> const& frames, Scalar const* slots)
+{
+  // enter the statements from the outside in, as execute() would have
+  std::vector<bool> quiet(frames.size());
+  for (size_t i = frames.size(); i-- > 0; ) {
+    int32_t mode = (evb_type(frames[i].statement) == EVB_BLOCK? T_BLOCK:
+                    T_LOOP);
+    executeLevel++;
+    quiet[i] = !(traceMode & mode);
+    if (quiet[i])
+      noTrace++;
+  }
+  int32_t n = LUX_OK;
+  for (size_t i = 0; i < frames.size(); ++i) {
+    if (n >= 0)
+      n = finishStatement(frames[i], slots, n);
+    executeLevel--;
+    if (quiet[i])
+      noTrace--;
+  }
+  return n;
+}
+
+/// Describes the code that is running, so that the variables can be
+/// copied back if the calculation is aborted.
+struct ActiveRun
+{
+  Program const* program;
+  std::vector<int32_t> const* resolved;
+  Scalar const* slots;
+};
+
+/// The code that is running, or `nullptr`.
+ActiveRun* active = nullptr;
+
+/// Runs compiled code on the current values of its leaves.  The
+/// values of scalar leaves are copied into the slots first, and the
+/// values of assigned variables are copied back when the code ends,
+/// whether normally or because of an error.  If the code stops at the
+/// end of a loop body because the tree interpreter must take over,
+/// then the tree interpreter finishes the statement.
+///
+/// \param program is the program to run.
+///
+/// \param resolved are the leaves with transfer symbols resolved.
+///
+/// \param finished is set to `true` if the tree interpreter finished
+/// the statement, and to `false` otherwise.
+///
+/// \returns the result of the statement, for execute().
+int32_t
+runProgram(Program const& program, std::vector<int32_t> const& resolved,
+           bool& finished)
+{
+  size_t nleaves = program.leaves.size();
+  std::vector<Scalar> slots(nleaves + program.nRegisters);
+  std::vector<ArrayRef> arrays(nleaves);
+  for (size_t i = 0; i < nleaves; ++i) {
+    int32_t s = resolved[i];
+    switch (symbol_class(s)) {
+    case LUX_SCALAR:
+      slots[i] = scalar_value(s);
+      break;
+    case LUX_ARRAY:
+      arrays[i].data = array_data(s);
+      arrays[i].nelem = array_size(s);
+      std::copy(array_dims(s), array_dims(s) + array_num_dims(s),
+                arrays[i].dims);
+      break;
+    default:
+      break;
+    }
+  }
+  ActiveRun current{&program, &resolved, slots.data()};
+  active = &current;
+  int32_t continuation;
+  int32_t result = run(program.code.data(), slots.data(), arrays.data(),
+                       resolved.data(), &continuation);
+  active = nullptr;
+  writeBack(program, resolved, slots.data());
+  finished = (continuation >= 0);
+  if (finished) {
+    if (breakRequested) {       // deferred by bytecode_defer_break()
+      breakRequested = 0;
+      breakToTopLevel();
+    }
+    result = finishInTree(program.continuations[continuation], slots.data());
+  }
+  return result;
+}
+
+/// Returns a text representation of the value of a scalar symbol, or
+/// of its class if it is not a scalar.
+std::string
+describe(int32_t s)
+{
+  char buffer[64];
+  if (symbol_class(s) != LUX_SCALAR)
+    return className(symbol_class(s));
+  switch (scalar_type(s)) {
+  case LUX_INT32:
+    snprintf(buffer, sizeof(buffer), "%d", scalar_value(s).i32);
+    break;
+  case LUX_INT64:
+    snprintf(buffer, sizeof(buffer), "%lld", (long long) scalar_value(s).i64);
+    break;
+  case LUX_FLOAT:
+    snprintf(buffer, sizeof(buffer), "%.9g", scalar_value(s).f);
+    break;
+  case LUX_DOUBLE:
+    snprintf(buffer, sizeof(buffer), "%.17g", scalar_value(s).d);
+    break;
+  default:
+    return typeName(scalar_type(s));
+  }
+  return std::string(buffer) + " (" + typeName(scalar_type(s)) + ")";
+}
+
+/// Do two symbols have the same class, type, and (scalar) value?
+bool
+sameScalar(SymbolImpl const& a, SymbolImpl const& b)
+{
+  if (a.sclass != b.sclass)
+    return false;
+  if (a.sclass != LUX_SCALAR)
+    return true;
+  if (a.type != b.type)
+    return false;
+  switch (a.type) {
+  case LUX_INT32:
+    return a.spec.scalar.i32 == b.spec.scalar.i32;
+  case LUX_INT64:
+    return a.spec.scalar.i64 == b.spec.scalar.i64;
+  case LUX_FLOAT:
+    return a.spec.scalar.f == b.spec.scalar.f
+      || (std::isnan(a.spec.scalar.f) && std::isnan(b.spec.scalar.f));
+  case LUX_DOUBLE:
+    return a.spec.scalar.d == b.spec.scalar.d
+      || (std::isnan(a.spec.scalar.d) && std::isnan(b.spec.scalar.d));
+  default:
+    return true;
+  }
+}
+
+/// The compiled statements, by symbol number.
+std::unordered_map<int32_t, Program> programs;
+
+/// Are we executing a statement with the tree interpreter to compare
+/// the results with those of the bytecode?
+bool comparing = false;
+
+} // namespace
+
+/// Executes a loop statement as bytecode, if possible.
+///
+/// \param[in] symbol is the LUX_EVB symbol of the statement.
+///
+/// \param[out] result receives the return value for execute(), if
+/// the statement was executed.
+///
+/// \returns `true` if the statement was executed, `false` if it must
+/// be executed by the tree interpreter.
+bool
+bytecode_execute(int32_t symbol, int32_t* result)
+{
+  if (!lux_bytecode || comparing)
+    return false;
+
+  Program scanned;
+  if (!Scanner(scanned).statement(symbol))
+    return false;
+
+  if (programs.size() > 4096)   // forget statements that no longer exist
+    programs.clear();
+  Program& program = programs[symbol];
+  if (program.fingerprint != scanned.fingerprint)
+    program = std::move(scanned);
+
+  // resolve the leaves, and check that the values we write cannot
+  // also be reached through other leaves
+  size_t nleaves = program.leaves.size();
+  std::vector<int32_t> resolved(nleaves);
+  std::vector<int32_t> signature(nleaves);
+  for (size_t i = 0; i < nleaves; ++i) {
+    int32_t s = program.leaves[i];
+    if (!program.counter[i] && symbol_class(s) == LUX_TRANSFER)
+      s = transfer(s);
+    if (s <= 0)
+      return false;
+    resolved[i] = s;
+    switch (symbol_class(s)) {
+    case LUX_SCALAR:
+      signature[i] = LUX_SCALAR << 8 | scalar_type(s);
+      break;
+    case LUX_ARRAY:
+      signature[i] = array_num_dims(s) << 16 | LUX_ARRAY << 8 | array_type(s);
+      break;
+    default:
+      signature[i] = symbol_class(s) << 8;
+      break;
+    }
+  }
+  for (size_t i = 0; i < nleaves; ++i)
+    if (program.written[i])
+      for (size_t j = 0; j < nleaves; ++j)
+        if (j != i && resolved[j] == resolved[i])
+          return false;
+
+  if (program.signature != signature) {
+    program.signature = signature;
+    program.compiled = Compiler(program, resolved).compile(symbol);
+  }
+  if (!program.compiled)
+    return false;
+
+  if (!program.preExtracts.empty()) {
+    // the statement compiled, so now convert the nodes like
+    // evalExtractRhs() would, and update the fingerprint to match
+    for (auto const& p : program.preExtracts)
+      preExtractToExtract(p.first, p.second);
+    program.preExtracts.clear();
+    Program rescanned;
+    Scanner(rescanned).statement(symbol);
+    program.fingerprint = std::move(rescanned.fingerprint);
+  }
+
+  bool finished;
+  if (lux_bytecode != 2) {
+    *result = runProgram(program, resolved, finished);
+    return true;
+  }
+
+  // run the bytecode, remember the results, restore the variables,
+  // run the tree interpreter, and compare.  We can only restore
+  // variables that hold no allocated memory.
+  std::vector<SymbolImpl> before, after;
+  for (size_t i = 0; i < nleaves; ++i) {
+    if (program.written[i]) {
+      Symbolclass c = symbol_class(resolved[i]);
+      if (c != LUX_SCALAR && c != LUX_UNDEFINED && c != LUX_UNUSED)
+        return false;
+      before.push_back(sym[resolved[i]]);
+    }
+  }
+  *result = runProgram(program, resolved, finished);
+  if (finished)                 // no comparison possible
+    return true;
+  size_t k = 0;
+  for (size_t i = 0; i < nleaves; ++i) {
+    if (program.written[i]) {
+      after.push_back(sym[resolved[i]]);
+      sym[resolved[i]] = before[k++];
+    }
+  }
+  comparing = true;
+  *result = execute(symbol);
+  comparing = false;
+  k = 0;
+  for (size_t i = 0; i < nleaves; ++i) {
+    if (program.written[i]) {
+      int32_t s = resolved[i];
+      if (!sameScalar(sym[s], after[k])) {
+        SymbolImpl tree = sym[s];
+        sym[s] = after[k];
+        std::string vm = describe(s);
+        sym[s] = tree;
+        printf("BYTECODE - %s is %s, but %s in bytecode\n",
+               symbolIdent(program.leaves[i], I_PARENT), describe(s).c_str(),
+               vm.c_str());
+      }
+      ++k;
+    }
+  }
+  return true;
+}
+
+/// Asks the virtual machine to abort the calculation at the end of
+/// the current loop body, when the variables are in a consistent
+/// state.  For the interrupt handler.
+///
+/// \returns `true` if the virtual machine is running and will abort
+/// the calculation, `false` if the caller must do that itself.
+bool
+bytecode_defer_break(void)
+{
+  if (!active)
+    return false;
+  breakRequested = 1;
+  return true;
+}
+
+/// Cleans up after a calculation that may have been aborted while
+/// bytecode was running or being compared.  For cleanUp().
+void
+bytecode_cleanup(void)
+{
+  if (active) {
+    // a fault inside the virtual machine aborted the calculation;
+    // the slots hold the results of the completed instructions
+    writeBack(*active->program, *active->resolved, active->slots);
+    active = nullptr;
+  }
+  breakRequested = 0;
+  comparing = false;
+}
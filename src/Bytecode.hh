@@ -0,0 +1,69 @@
+/* This is file Bytecode.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_BYTECODE_HH
+#define INCLUDED_BYTECODE_HH
+
+/// \file
+///
+/// This file declares the bytecode compiler and virtual machine for
+/// loops that do only scalar arithmetic.
+///
+/// The tree interpreter (execute() and eval()) evaluates every node of
+/// a statement through the symbol table, creating and deleting
+/// temporary symbols as it goes.  For loops whose statements involve
+/// only assignments of scalar arithmetic to scalar variables, that
+/// bookkeeping dominates the running time.  Such loops can instead be
+/// compiled into a list of instructions for a register-based virtual
+/// machine, with instructions specialized for the data types of the
+/// operands.  The values of the scalar variables are copied into the
+/// registers of the virtual machine when the loop starts, and those of
+/// the assigned variables are copied back when the loop ends, so loop
+/// counters and accumulators are plain numbers in between.  Elements
+/// of numerical arrays can be read through scalar subscripts.
+///
+/// A compiled loop is valid for the data types that its variables
+/// had when it was compiled.  It is compiled again when it is entered
+/// with variables of different types, and is not used if the loop
+/// statements were changed since it was compiled.  A loop that
+/// contains anything that the compiler does not handle is executed by
+/// the tree interpreter.
+///
+/// At the end of each loop body the virtual machine checks whether
+/// tracing, stepping, breakpoints, or watch variables were switched
+/// on, for example through the interrupt handler.  If so, then it
+/// copies the variables back and the tree interpreter finishes the
+/// statement.
+
+#include <cstdint>              // for int32_t
+
+/// Selects whether loops are compiled into bytecode.  It is
+/// accessible from LUX as `!bytecode`.  If it is 0, then all
+/// statements are executed by the tree interpreter.  If it is 1, then
+/// loops that can be compiled are executed as bytecode.  If it is 2,
+/// then such loops are executed both ways, and differences between
+/// the results are reported.
+extern int32_t lux_bytecode;
+
+bool bytecode_execute(int32_t symbol, int32_t* result);
+bool bytecode_defer_break(void);
+void bytecode_cleanup(void);
+
+#endif
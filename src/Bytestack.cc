@@ -22,6 +22,7 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
     when more data is pushed unto it. */
 
 #include "action.hh"
+#include "Arena.hh"
 #include "Bytestack.hh"
 // HEADERS
 #include <stdarg.h>
@@ -61,6 +62,45 @@ default_Bytestack(void)
   return stack;
 }
 
+/** Describes where the last temporary result of the calling thread
+    is in the Arena of that thread. */
+struct Temporary {
+  //* The position before the result.
+  Arena::Mark before;
+  //* The position after the result.
+  Arena::Mark after;
+  /** The number of allocations from the Arena after the result, or 0
+      if there is no result. */
+  size_t allocations;
+};
+
+static thread_local Temporary temporary;
+
+/** Returns the Arena of the calling thread, ready for a new temporary
+    result.  The previous temporary result is freed, unless the Arena
+    was used for something else since. */
+static Arena&
+temp_begin(void)
+{
+  Arena& arena = Arena::thread_arena();
+  Arena::Mark mark = arena.mark();
+  if (temporary.allocations
+      && arena.statistics().allocations == temporary.allocations
+      && mark.segment == temporary.after.segment
+      && mark.offset == temporary.after.offset)
+    arena.reset(temporary.before);
+  temporary.before = arena.mark();
+  return arena;
+}
+
+/** Records where the new temporary result ends. */
+static void
+temp_end(Arena& arena)
+{
+  temporary.after = arena.mark();
+  temporary.allocations = arena.statistics().allocations;
+}
+
 /** Creates an empty Byte stack.
  *
  * \return The Byte stack, or \c NULL if a problem occurred.
@@ -115,7 +155,8 @@ Bytestack_delete(Bytestack b)
     to the default Byte stack.
 
     \param n the minimum number of bytes to add.  More bytes than this
-    may in fact be added.
+    may in fact be added: the size at least doubles, so that pushing
+    many small items does not reallocate and copy the stack each time.
 
     \return 0 upon success, non-zero upon error. */
 static int32_t
@@ -125,6 +166,8 @@ enlarge(Bytestack b, size_t n)
 
   if (!b)
     b = default_Bytestack();
+  if (n < b->size)
+    n = b->size;
   n = (((n - 1)/256) + 1)*256;
   p = (char*) realloc(b->begin, (size_t) (b->size + n));
   if (p) {
@@ -296,97 +339,100 @@ Bytestack_restore(Bytestack b, int32_t size)
 }
 
 /**
- * Temporarily stores a text string on a Byte stack.
+ * Temporarily stores a text string.
  *
- * \param stack the Byte stack.  May be \c NULL, which indicates the
- * default Byte stack.
+ * \param stack is not used.  The copy is stored in the Arena of the
+ * calling thread (see Arena::thread_arena()), so that it does not
+ * move when other data is pushed unto a Byte stack.
  *
- * \param text the text to temporarily store on the Byte stack.
+ * \param text the text to temporarily store.
  *
- * Pushes and immediately pops the \p text from Byte stack \p stack
- * again.  In effect, a temporary copy of the text is created, which
- * is retained only until the next data is pushed unto the Byte stack.
+ * In effect, a temporary copy of the text is created, which is
+ * retained only until the next temporary result is created by the
+ * same thread.
  *
- * The memory holding the temporary copy remains owned by the Byte
- * stack and must not be changed or freed by the caller.
+ * The memory holding the temporary copy remains owned by the Arena
+ * and must not be changed or freed by the caller.
  *
- * \return a pointer to the temporary copy of the text.
+ * \return a pointer to the temporary copy of the text, or \c NULL if
+ * there was no memory.
  */
 char *
 Bytestack_temp_text(Bytestack stack, const char *text)
 {
-  return Bytestack_pop(stack, Bytestack_push_text(stack, text));
+  Arena& arena = temp_begin();
+  char *result = arena.strdup(text);
+  temp_end(arena);
+  return result;
 }
 
 /**
- * Temporarily stores data on a Byte stack.
+ * Temporarily stores data.
  *
- * \param stack the Byte stack.  May be \c NULL, which indicates the
- * default Byte stack.
+ * \param stack is not used, as for Bytestack_temp_text().
  *
  * \param begin the location of the first Byte to store.
  * \param end one beyond the location of the last Byte to store.
  *
- * Pushes and immediately pops the data from the Byte stack \p stack
- * again.  In effect, a temporary copy of the data is created, which
- * is retained only until the next data is pushed unto the Byte stack.
+ * In effect, a temporary copy of the data is created, which is
+ * retained only until the next temporary result is created by the
+ * same thread.
  *
- * The memory holding the temporary copy remains owned by the Byte
- * stack and must not be changed or freed by the caller.
+ * The memory holding the temporary copy remains owned by the Arena
+ * and must not be changed or freed by the caller.
  *
  * \return a pointer to the beginning of the temporary copy of the
- * data.
+ * data, or \c NULL if there was no memory.
  */
 void *
 Bytestack_temp_data(Bytestack stack, const void *begin,
                     const void *end)
 {
-  return Bytestack_pop(stack, Bytestack_push_data(stack, begin, end));
+  size_t n = (const char *) end - (const char *) begin;
+  Arena& arena = temp_begin();
+  void *result = arena.allocate(n);
+  if (result)
+    memcpy(result, begin, n);
+  temp_end(arena);
+  return result;
 }
 
 /**
- * Temporarily stores text on a Byte stack.
+ * Temporarily stores printed text.
  *
- * \param stack the Byte stack.  May be \c NULL, which indicates the
- * default Byte stack.
+ * \param stack is not used, as for Bytestack_temp_text().
  *
  * \param fmt the printf-style format string to guide the printing of
- * text to the Byte stack.
+ * the text.
  *
  * \param ap the list of arguments to print.
  *
- * Pushes (under guidance of the format \p fmt) and immediately pops
- * the text from the Byte stack again.  In effect, a temporary copy of
- * the text is created, which is retained only until the next data is
- * pushed unto the Byte stack.
+ * In effect, a temporary copy of the text is created, which is
+ * retained only until the next temporary result is created by the
+ * same thread.
  *
- * The memory holding the temporary copy remains owned by the Byte
- * stack and must not be changed or freed by the caller.
+ * The memory holding the temporary copy remains owned by the Arena
+ * and must not be changed or freed by the caller.
  *
- * \return a pointer to the temporary copy of the text.
+ * \return a pointer to the temporary copy of the text, or \c NULL if
+ * there was no memory or the format was bad.
  */
 char *
 Bytestack_temp_vsprintf(Bytestack stack, const char *fmt, va_list ap)
 {
-  return Bytestack_pop(stack, Bytestack_vsprintf(stack, fmt, ap));
+  Arena& arena = temp_begin();
+  char *result = arena.vsprintf(fmt, ap);
+  temp_end(arena);
+  return result;
 }
 
 /**
- * Temporarily stores text on a Byte stack.
+ * Temporarily stores printed text, like Bytestack_temp_vsprintf().
  *
- * \param stack the Byte stack.  May be \c NULL, which indicates the
- * default Byte stack.
+ * \param stack is not used.
  *
  * \param fmt the printf-style format string to guide the printing of
- * text to the Byte stack.
- *
- * Pushes (under guidance of the format \p fmt) and immediately pops
- * the text from the Byte stack again.  In effect, a temporary copy of
- * the text is created, which is retained only until the next data is
- * pushed unto the Byte stack.
- *
- * The memory holding the temporary copy remains owned by the Byte
- * stack and must not be changed or freed by the caller.
+ * the text.
  *
  * \return a pointer to the temporary copy of the text.
  */
@@ -401,6 +447,14 @@ Bytestack_temp_sprintf(Bytestack stack, const char *fmt, ...)
   return result;
 }
 
+/**
+ * Temporarily stores printed text, like Bytestack_temp_vsprintf().
+ *
+ * \param format the printf-style format string to guide the printing
+ * of the text.
+ *
+ * \return a pointer to the temporary copy of the text.
+ */
 char *temp_sprintf(const char *format, ...)
 {
   va_list ap;
@@ -513,15 +567,19 @@ Bytestack_vsprintf(Bytestack b, const char *fmt, va_list ap)
 {
   size_t n1, n2;
   Bytestack_index index;
+  va_list ap2;
 
   if (!b)
     b = default_Bytestack();
   index = Bytestack_top(b);
   n1 = b->size - b->cur;
-  n2 = vsnprintf(b->begin + b->cur, n1, fmt, ap);
+  va_copy(ap2, ap);             // in case we must print again
+  n2 = vsnprintf(b->begin + b->cur, n1, fmt, ap2);
+  va_end(ap2);
   if (n2 >= n1) {
-    enlarge(b, n2 - n1);
-    vsnprintf(b->begin + b->cur, n1, fmt, ap);
+    if (enlarge(b, n2 + 1 - n1))
+      return -1;
+    vsnprintf(b->begin + b->cur, n2 + 1, fmt, ap);
   }
   b->cur += n2;
   if (b->cur > b->max)
@@ -0,0 +1,258 @@
+/* This is file ChebyshevEphemeris.cc.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+///
+/// This file defines the ChebyshevEphemeris class.
+///
+/// The binary file written by ChebyshevEphemeris::write() consists of
+/// the 8 characters `LUXCHEB1`, followed by the segment length, the
+/// accuracy, and the origin (as doubles), and the number of segments
+/// (as a uint64_t).  For each segment there follow its index (as an
+/// int64_t), the number of coefficients per coordinate (as a
+/// uint32_t), its error (as a double), and the coefficients (as
+/// doubles).  All numbers are in the native byte order.
+
+#include <algorithm>            // for std::max
+#include <cmath>
+#include <cstring>              // for memcmp
+
+#include "ChebyshevEphemeris.hh"
+
+/// The magic characters at the beginning of a file.
+static char const magic[8] = { 'L', 'U', 'X', 'C', 'H', 'E', 'B', '1' };
+
+/// Evaluates a Chebyshev series through Clenshaw's recurrence.
+///
+/// \param c points at the coefficients.
+///
+/// \param n is the number of coefficients.
+///
+/// \param x is the argument, between -1 and +1.
+///
+/// \returns the value of the series.
+static double
+clenshaw(double const* c, size_t n, double x)
+{
+  double b1 = 0;
+  double b2 = 0;
+  for (size_t j = n - 1; j > 0; --j) {
+    double b = 2*x*b1 - b2 + c[j];
+    b2 = b1;
+    b1 = b;
+  }
+  return x*b1 - b2 + c[0];
+}
+
+/// Constructor.
+///
+/// \param segment_length is the length of each segment, in the units
+/// of time of the function.  Shorter segments need polynomials of
+/// lower degree for the same accuracy.
+///
+/// \param accuracy is the desired accuracy of the coordinates, in the
+/// units of the function.
+///
+/// \param origin is the time at which a segment begins.
+ChebyshevEphemeris::ChebyshevEphemeris(double segment_length,
+                                       double accuracy, double origin)
+  : m_segment_length(segment_length > 0? segment_length: 1),
+    m_accuracy(std::abs(accuracy)),
+    m_origin(origin)
+{ }
+
+/// Returns the index of the segment that contains a time.
+///
+/// \param t is the time.
+///
+/// \returns the segment index.
+int64_t
+ChebyshevEphemeris::segment_index(double t) const
+{
+  return (int64_t) std::floor((t - m_origin)/m_segment_length);
+}
+
+/// Returns the approximate coordinates for a time.
+///
+/// \param t is the time.
+///
+/// \param f is the function that calculates the exact coordinates.
+/// It is called only if the segment that contains \p t was not
+/// calculated yet.
+///
+/// \returns the approximate coordinates.
+ChebyshevEphemeris::Coords3
+ChebyshevEphemeris::operator()(double t, Function const& f)
+{
+  int64_t index = segment_index(t);
+  auto it = m_segments.find(index);
+  if (it == m_segments.end())
+    it = m_segments.emplace(index, fit(index, f)).first;
+
+  std::vector<double> const& c = it->second.coefficients;
+  size_t n = c.size()/3;
+  double x = 2*(t - m_origin - index*m_segment_length)/m_segment_length - 1;
+  Coords3 result;
+  for (size_t i = 0; i < 3; ++i)
+    result[i] = clenshaw(&c[i*n], n, x);
+  return result;
+}
+
+/// Is the segment that contains a time already calculated?
+///
+/// \param t is the time.
+///
+/// \returns `true` if the segment is available, `false` otherwise.
+bool
+ChebyshevEphemeris::has_segment(double t) const
+{
+  return m_segments.count(segment_index(t)) > 0;
+}
+
+/// Returns the greatest difference between an approximation and the
+/// function that was found at the test points of all segments.  This
+/// exceeds the requested accuracy only if the maximum degree did not
+/// suffice for some segment.
+double
+ChebyshevEphemeris::max_error() const
+{
+  double result = 0;
+  for (auto const& entry : m_segments)
+    result = std::max(result, entry.second.error);
+  return result;
+}
+
+/// Calculates the Chebyshev polynomial for a segment.
+///
+/// \param index is the index of the segment.
+///
+/// \param f is the function that calculates the coordinates.
+///
+/// \returns the segment.
+ChebyshevEphemeris::Segment
+ChebyshevEphemeris::fit(int64_t index, Function const& f) const
+{
+  double start = m_origin + index*m_segment_length;
+  double half = m_segment_length/2;
+  Segment segment;
+  for (unsigned degree = 8; degree <= max_degree; degree *= 2) {
+    size_t n = degree + 1;
+    // the function values at the Chebyshev nodes
+    std::vector<Coords3> values(n);
+    for (size_t k = 0; k < n; ++k) {
+      double x = std::cos(M_PI*(k + 0.5)/n);
+      values[k] = f(start + half*(x + 1));
+    }
+    segment.coefficients.assign(3*n, 0.0);
+    for (size_t j = 0; j < n; ++j) {
+      for (size_t k = 0; k < n; ++k) {
+        double w = std::cos(M_PI*j*(k + 0.5)/n);
+        for (size_t i = 0; i < 3; ++i)
+          segment.coefficients[i*n + j] += w*values[k][i];
+      }
+      for (size_t i = 0; i < 3; ++i)
+        segment.coefficients[i*n + j] *= (j? 2.0: 1.0)/n;
+    }
+
+    // compare with the function halfway between the nodes, where the
+    // error of the approximation is greatest
+    segment.error = 0;
+    for (size_t k = 1; k < n; ++k) {
+      double t = start + half*(std::cos(M_PI*k/n) + 1);
+      Coords3 exact = f(t);
+      double x = 2*(t - start)/m_segment_length - 1;
+      for (size_t i = 0; i < 3; ++i)
+        segment.error
+          = std::max(segment.error,
+                     std::abs(clenshaw(&segment.coefficients[i*n], n, x)
+                              - exact[i]));
+    }
+    if (segment.error <= m_accuracy)
+      break;
+  }
+  return segment;
+}
+
+/// Writes the segment length, accuracy, origin, and segments to a
+/// binary file.
+///
+/// \param out is the file to write to.
+///
+/// \returns `true` for success, `false` for failure.
+bool
+ChebyshevEphemeris::write(FILE* out) const
+{
+  uint64_t count = m_segments.size();
+  if (fwrite(magic, sizeof(magic), 1, out) != 1
+      || fwrite(&m_segment_length, sizeof(double), 1, out) != 1
+      || fwrite(&m_accuracy, sizeof(double), 1, out) != 1
+      || fwrite(&m_origin, sizeof(double), 1, out) != 1
+      || fwrite(&count, sizeof(count), 1, out) != 1)
+    return false;
+  for (auto const& entry : m_segments) {
+    uint32_t n = entry.second.coefficients.size()/3;
+    if (fwrite(&entry.first, sizeof(entry.first), 1, out) != 1
+        || fwrite(&n, sizeof(n), 1, out) != 1
+        || fwrite(&entry.second.error, sizeof(double), 1, out) != 1
+        || fwrite(entry.second.coefficients.data(), sizeof(double), 3*n, out)
+        != 3*n)
+      return false;
+  }
+  return true;
+}
+
+/// Reads the segment length, accuracy, origin, and segments from a
+/// binary file written by write(), replacing the current ones.
+///
+/// \param in is the file to read from.
+///
+/// \returns `true` for success, `false` for failure.  In case of
+/// failure the object is not changed.
+bool
+ChebyshevEphemeris::read(FILE* in)
+{
+  char header[sizeof(magic)];
+  ChebyshevEphemeris result;
+  uint64_t count;
+  if (fread(header, sizeof(header), 1, in) != 1
+      || memcmp(header, magic, sizeof(magic))
+      || fread(&result.m_segment_length, sizeof(double), 1, in) != 1
+      || fread(&result.m_accuracy, sizeof(double), 1, in) != 1
+      || fread(&result.m_origin, sizeof(double), 1, in) != 1
+      || fread(&count, sizeof(count), 1, in) != 1
+      || !(result.m_segment_length > 0))
+    return false;
+  while (count--) {
+    int64_t index;
+    uint32_t n;
+    Segment segment;
+    if (fread(&index, sizeof(index), 1, in) != 1
+        || fread(&n, sizeof(n), 1, in) != 1
+        || n == 0 || n > max_degree + 1
+        || fread(&segment.error, sizeof(double), 1, in) != 1)
+      return false;
+    segment.coefficients.resize(3*n);
+    if (fread(segment.coefficients.data(), sizeof(double), 3*n, in) != 3*n)
+      return false;
+    result.m_segments[index] = std::move(segment);
+  }
+  *this = std::move(result);
+  return true;
+}
@@ -0,0 +1,122 @@
+/* This is file ChebyshevEphemeris.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_CHEBYSHEVEPHEMERIS_HH
+#define INCLUDED_CHEBYSHEVEPHEMERIS_HH
+
+/// \file
+///
+/// This file declares the ChebyshevEphemeris class, which approximates
+/// an expensive ephemeris by piecewise Chebyshev polynomials.
+
+#include <array>
+#include <cstddef>              // for size_t
+#include <cstdint>              // for int64_t
+#include <cstdio>               // for FILE
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/// A cache of piecewise Chebyshev approximations of the 3 coordinates
+/// of an object as a function of time.
+///
+/// Time is divided into segments of fixed length.  The first time that
+/// a time in a segment is requested, the coordinates are calculated at
+/// the Chebyshev nodes of that segment through a user-supplied
+/// function, and a Chebyshev polynomial is fitted to them.  The degree
+/// of the polynomial is raised until the approximation agrees with the
+/// function to within the requested accuracy at points between the
+/// nodes, or until the maximum degree is reached.  Later requests for
+/// times in the same segment take only a polynomial evaluation.
+///
+/// The segments can be written to and read from a compact binary file,
+/// so that they need to be calculated only once.
+///
+/// Example:
+///
+/// \code
+/// ChebyshevEphemeris cache(8, 1e-10);
+/// auto f = [](double JD) { return expensive_position(JD); };
+/// ChebyshevEphemeris::Coords3 pos = cache(2451545.3, f);
+/// \endcode
+class ChebyshevEphemeris
+{
+public:
+  /// The type of the coordinates.
+  typedef std::array<double, 3> Coords3;
+
+  /// The type of the function that calculates the coordinates for a
+  /// time.
+  typedef std::function<Coords3(double)> Function;
+
+  /// The highest degree of polynomial that is fitted.
+  static const unsigned max_degree = 32;
+
+  ChebyshevEphemeris(double segment_length = 8, double accuracy = 1e-10,
+                     double origin = 0);
+
+  Coords3 operator()(double t, Function const& f);
+
+  bool has_segment(double t) const;
+
+  /// Returns the number of segments that have been calculated.
+  size_t size() const { return m_segments.size(); }
+
+  /// Returns the length of the segments.
+  double segment_length() const { return m_segment_length; }
+
+  /// Returns the requested accuracy.
+  double accuracy() const { return m_accuracy; }
+
+  double max_error() const;
+
+  bool write(FILE* out) const;
+  bool read(FILE* in);
+
+private:
+  /// A segment of time with its Chebyshev polynomial.
+  struct Segment
+  {
+    /// The Chebyshev coefficients of the 3 coordinates, with all
+    /// coefficients of the first coordinate first.
+    std::vector<double> coefficients;
+
+    /// The greatest difference between the polynomial and the function
+    /// found at the test points.
+    double error;
+  };
+
+  int64_t segment_index(double t) const;
+  Segment fit(int64_t index, Function const& f) const;
+
+  /// The length of each segment.
+  double m_segment_length;
+
+  /// The requested accuracy of the coordinates.
+  double m_accuracy;
+
+  /// The time at which segment 0 begins.
+  double m_origin;
+
+  /// The calculated segments, by index.
+  std::unordered_map<int64_t, Segment> m_segments;
+};
+
+#endif
@@ -0,0 +1,212 @@
+/* This is file EpochCache.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_EPOCHCACHE_HH
+#define INCLUDED_EPOCHCACHE_HH
+
+/// \file
+///
+/// This file defines the EpochCache class template, which remembers
+/// quantities that are expensive to calculate for a limited number of
+/// epochs.
+
+#include <array>
+#include <cstddef>              // for size_t
+#include <cstdint>              // for uint64_t
+#include <cstring>              // for memcpy
+#include <vector>
+
+/// A cache of values of type \a T that depend on \a N epochs (or
+/// other `double` numbers), such as the nutation for a date or the
+/// precession matrix between two equinoxes.
+///
+/// The cache has a fixed number of slots, in sets of #ways slots.
+/// Each key maps to a single set, and a new value replaces the least
+/// recently used value in its set.  This bounds the memory use and
+/// makes lookups cheap, and works well when the same handful of epochs
+/// is used over and over again.  The slot that was used last is tried
+/// first.  Keys match only if they are exactly equal.  A cache with no
+/// slots caches nothing.
+///
+/// Example:
+///
+/// \code
+/// static EpochCache<1, double> cache(64);
+/// double value = cache({JD}, [](double const* key) {
+///   return expensive_function(key[0]);
+/// });
+/// \endcode
+///
+/// \tparam N is the number of `double` numbers in a key.
+///
+/// \tparam T is the type of the cached values.
+template<size_t N, typename T>
+class EpochCache
+{
+public:
+  /// The type of the keys.
+  typedef std::array<double, N> Key;
+
+  /// The number of slots per set.
+  static const size_t ways = 4;
+
+  /// Constructor.
+  ///
+  /// \param capacity is the number of slots.  It is rounded up to a
+  /// multiple of #ways.
+  EpochCache(size_t capacity = 0)
+  {
+    set_capacity(capacity);
+  }
+
+  /// Returns the value for a key, calculating and remembering it if
+  /// it is not in the cache yet.
+  ///
+  /// \tparam F is the type of the function that calculates a value.
+  ///
+  /// \param key is the key.
+  ///
+  /// \param f is the function that calculates the value.  It is
+  /// called with a pointer to the \a N numbers of the key.
+  ///
+  /// \returns the value.
+  template<typename F>
+  T
+  operator()(Key const& key, F f)
+  {
+    if (m_slots.empty()) {
+      ++m_misses;
+      return f(key.data());
+    }
+    ++m_time;
+    if (m_slots[m_last].used && m_slots[m_last].key == key) {
+      ++m_hits;
+      m_slots[m_last].time = m_time;
+      return m_slots[m_last].value;
+    }
+    size_t first = index(key)*ways;
+    size_t oldest = first;
+    for (size_t i = first; i < first + ways; ++i) {
+      Slot& slot = m_slots[i];
+      if (slot.used && slot.key == key) {
+        ++m_hits;
+        slot.time = m_time;
+        m_last = i;
+        return slot.value;
+      }
+      if (slot.time < m_slots[oldest].time)
+        oldest = i;
+    }
+    ++m_misses;
+    Slot& slot = m_slots[oldest];
+    slot.value = f(key.data());
+    slot.key = key;
+    slot.used = true;
+    slot.time = m_time;
+    m_last = oldest;
+    return slot.value;
+  }
+
+  /// Returns the number of slots.
+  size_t capacity() const { return m_slots.size(); }
+
+  /// Changes the number of slots.  This forgets all values.
+  ///
+  /// \param capacity is the new number of slots.
+  void
+  set_capacity(size_t capacity)
+  {
+    m_slots.clear();
+    m_slots.resize((capacity + ways - 1)/ways*ways);
+    m_last = 0;
+  }
+
+  /// Forgets all values and resets the statistics.
+  void
+  clear()
+  {
+    set_capacity(m_slots.size());
+    m_hits = m_misses = 0;
+  }
+
+  /// Returns the number of lookups that found their value in the
+  /// cache.
+  size_t hits() const { return m_hits; }
+
+  /// Returns the number of lookups that had to calculate their value.
+  size_t misses() const { return m_misses; }
+
+private:
+  /// A slot of the cache.
+  struct Slot
+  {
+    /// The key.
+    Key key;
+
+    /// The value.
+    T value;
+
+    /// Does the slot hold a value?
+    bool used = false;
+
+    /// When the slot was last used.
+    uint64_t time = 0;
+  };
+
+  /// Returns the index of the set for a key.
+  ///
+  /// \param key is the key.
+  ///
+  /// \returns the set index.
+  size_t
+  index(Key const& key) const
+  {
+    // the low bits of epochs are often zero, so all bits are mixed
+    uint64_t h = 0;
+    for (double x : key) {
+      uint64_t bits;
+      memcpy(&bits, &x, sizeof(bits));
+      h = (h ^ bits)*0x9e3779b97f4a7c15ULL;
+      h ^= h >> 32;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h % (m_slots.size()/ways);
+  }
+
+  /// The slots.
+  std::vector<Slot> m_slots;
+
+  /// The index of the slot that was used last.
+  size_t m_last = 0;
+
+  /// The number of lookups so far, to find the least recently used
+  /// slot.
+  uint64_t m_time = 0;
+
+  /// The number of lookups that found their value.
+  size_t m_hits = 0;
+
+  /// The number of lookups that calculated their value.
+  size_t m_misses = 0;
+};
+
+#endif
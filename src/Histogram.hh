@@ -0,0 +1,229 @@
+/* This is file Histogram.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_HISTOGRAM_HH
+#define INCLUDED_HISTOGRAM_HH
+
+/// \file
+///
+/// This file defines functions that accumulate values into bins, for
+/// functions such as HIST and TOTAL with a class argument.  Each thread
+/// fills a private copy of the bins, and the copies are added together
+/// at the end.
+
+#include <algorithm>            // for std::min
+#include <cstddef>              // for size_t
+#include <cstdint>              // for int32_t, uint32_t
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "Parallel.hh"
+
+/// Returns the bin index for a value, for histograms whose first bin
+/// belongs to value \a min.  Floating-point values are truncated after
+/// subtracting \a min.
+///
+/// \tparam T is the type of the value.
+///
+/// \param value is the value.
+///
+/// \param min is the value of the first bin.
+///
+/// \returns the bin index.
+template<typename T>
+inline int32_t
+histogram_index(T value, int32_t min)
+{
+  return static_cast<int32_t>(value - min);
+}
+
+/// Returns into how many slices to cut \a count values for accumulating
+/// them into \a nbins bins.  Each slice but the first needs a private
+/// copy of the bins, so a slice must hold many more values than there
+/// are bins for the copies to pay off.
+///
+/// If \a Bin is an integer type then the order in which values are
+/// added does not matter, and there is one slice per thread.  Otherwise
+/// the number of slices does not depend on the number of threads, so
+/// that the results do not depend on it either.
+///
+/// \tparam Bin is the type of the bins.
+///
+/// \param nbins is the number of bins.
+///
+/// \param count is the number of values.
+///
+/// \returns the number of slices, at least 1.
+template<typename Bin>
+size_t
+histogram_slices(size_t nbins, size_t count)
+{
+  const size_t min_per_slice = 1 << 16;
+  const size_t max_slices = 32;
+
+  size_t n = count/std::max(min_per_slice, 4*nbins);
+  if (std::is_integral_v<Bin>)
+    n = std::min(n, parallel_thread_count(count, min_per_slice));
+  else
+    n = std::min(n, max_slices);
+  return n? n: 1;
+}
+
+/// Accumulates \a count values into \a nbins bins, spreading the work
+/// across threads.
+///
+/// The values are cut into slices (see histogram_slices()).  The first
+/// slice is accumulated straight into \a bins, and each of the others
+/// into a private, zeroed copy.  The copies are then added into \a bins
+/// in slice order.
+///
+/// Example, counting the values of `data` that lie between 0 and 99:
+///
+/// \code
+/// std::vector<int32_t> bins(100);
+/// histogram(bins.data(), bins.size(), n,
+///           [&data](size_t begin, size_t end, int32_t* b) {
+///             count_values(data + begin, end - begin, 0, b);
+///           });
+/// \endcode
+///
+/// \tparam Bin is the type of the bins.  It must be value-initialized
+/// to zero and support `+`.
+///
+/// \tparam F is the type of the callable.
+///
+/// \param bins points at the bins, which must be initialized.
+///
+/// \param nbins is the number of bins.
+///
+/// \param count is the number of values.
+///
+/// \param add is a callable that, when called as `add(begin, end, b)`,
+/// adds the values with indices from \a begin up to (but not including)
+/// \a end to bins `b`.  It is called from several threads at once, for
+/// disjoint ranges and different bins.
+template<typename Bin, typename F>
+void
+histogram(Bin* bins, size_t nbins, size_t count, F add)
+{
+  size_t nslices = histogram_slices<Bin>(nbins, count);
+  if (nslices <= 1) {
+    add(0, count, bins);
+    return;
+  }
+
+  std::vector<Bin> partial((nslices - 1)*nbins);
+  parallel_chunks(parallel_thread_count(nslices), nslices,
+                  [&](size_t, size_t first, size_t last) {
+                    for (size_t s = first; s < last; ++s)
+                      add(count*s/nslices, count*(s + 1)/nslices,
+                          s? &partial[(s - 1)*nbins]: bins);
+                  });
+  parallel_for(nbins, 1 << 14, [&](size_t begin, size_t end) {
+    for (size_t s = 1; s < nslices; ++s) {
+      Bin const* b = &partial[(s - 1)*nbins];
+      for (size_t i = begin; i < end; ++i)
+        bins[i] = bins[i] + b[i];
+    }
+  });
+}
+
+/// Counts values into bins.  For 8-bit and 16-bit integer values, the
+/// counting goes through interleaved tables indexed by the values
+/// themselves, so that runs of equal values do not have to wait for
+/// each other's increments.
+///
+/// \tparam T is the type of the values.
+///
+/// \tparam Bin is the type of the bins.
+///
+/// \param data points at the values.
+///
+/// \param n is the number of values.
+///
+/// \param min is the value that goes into the first bin.  All values
+/// must be at least \a min, and fit in the bins.
+///
+/// \param bins points at the bins.
+template<typename T, typename Bin>
+void
+count_values(T const* data, size_t n, int32_t min, Bin* bins)
+{
+  if constexpr (std::is_integral_v<T> && sizeof(T) <= 2) {
+    const size_t nvalues = size_t(1) << (8*sizeof(T));
+    const size_t ntables = sizeof(T) == 1? 4: 2;
+    if (n >= 4*nvalues) {
+      typedef std::make_unsigned_t<T> U;
+      std::vector<uint32_t> tables(ntables*nvalues);
+      while (n) {
+        // the table entries must not overflow
+        size_t m = std::min(n, (size_t) std::numeric_limits<int32_t>::max());
+        size_t i = 0;
+        for ( ; i + ntables <= m; i += ntables)
+          for (size_t t = 0; t < ntables; ++t)
+            ++tables[t*nvalues + (U) data[i + t]];
+        for ( ; i < m; ++i)
+          ++tables[(U) data[i]];
+        for (size_t v = 0; v < nvalues; ++v) {
+          uint32_t c = 0;
+          for (size_t t = 0; t < ntables; ++t) {
+            c += tables[t*nvalues + v];
+            tables[t*nvalues + v] = 0;
+          }
+          if (c)
+            bins[histogram_index((T) (U) v, min)] += c;
+        }
+        data += m;
+        n -= m;
+      }
+      return;
+    }
+  }
+  for (size_t i = 0; i < n; ++i)
+    ++bins[histogram_index(data[i], min)];
+}
+
+/// Adds weights into bins.
+///
+/// \tparam T is the type of the values.
+///
+/// \tparam Bin is the type of the bins.
+///
+/// \param data points at the values.
+///
+/// \param weights points at the weights, one for each value.
+///
+/// \param n is the number of values.
+///
+/// \param min is the value that goes into the first bin.  All values
+/// must be at least \a min, and fit in the bins.
+///
+/// \param bins points at the bins.
+template<typename T, typename Bin>
+void
+sum_weights(T const* data, double const* weights, size_t n, int32_t min,
+            Bin* bins)
+{
+  for (size_t i = 0; i < n; ++i)
+    bins[histogram_index(data[i], min)] += weights[i];
+}
+
+#endif
@@ -0,0 +1,199 @@
+/* This is file Hyperslab.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_HYPERSLAB_HH
+#define INCLUDED_HYPERSLAB_HH
+
+/// \file
+///
+/// This file defines the Hyperslab class, which describes a
+/// rectangular block of elements selected from an array, such as part
+/// of a data cube in a FITS file.
+
+#include <cstddef>              // for size_t
+#include <cstdint>              // for int32_t
+#include <vector>
+
+/// A rectangular block of elements selected from a multidimensional
+/// array that is stored with its first dimension varying fastest.
+/// The selection is described by a start index and an element count
+/// for each dimension.
+///
+/// The selected elements are visited in runs of elements that are
+/// adjacent in the array.  Dimensions that are selected completely
+/// merge with the next dimension, so selecting all of an array yields
+/// a single run.
+///
+/// Example, selecting the second and third planes of a 100 by 100 by
+/// 10 cube:
+///
+/// \code
+/// int32_t dims[] = { 100, 100, 10 };
+/// int32_t start[] = { 0, 0, 1 };
+/// int32_t count[] = { 100, 100, 2 };
+/// Hyperslab slab(3, dims, start, count);
+/// slab.for_each_run([](size_t first, size_t n) {
+///   // elements first through first + n - 1 of the cube
+/// });
+/// \endcode
+class Hyperslab
+{
+public:
+  /// Constructor.
+  ///
+  /// \param ndim is the number of dimensions of the array.
+  ///
+  /// \param dims points at the dimensions of the array.
+  ///
+  /// \param start points at the index of the first selected element
+  /// along each dimension, or is `nullptr` to start at index 0 along
+  /// all dimensions.
+  ///
+  /// \param count points at the number of selected elements along each
+  /// dimension, or is `nullptr` to select everything from the start
+  /// index onwards.  A count of 0 or less also selects everything from
+  /// the start index onwards.
+  Hyperslab(int32_t ndim, int32_t const* dims, int32_t const* start = nullptr,
+            int32_t const* count = nullptr)
+    : m_dims(dims, dims + ndim), m_start(ndim), m_count(ndim),
+      m_valid(true)
+  {
+    for (int32_t i = 0; i < ndim; ++i) {
+      m_start[i] = start? start[i]: 0;
+      m_count[i] = (count && count[i] > 0)? count[i]: dims[i] - m_start[i];
+      if (m_start[i] < 0 || m_count[i] <= 0
+          || m_start[i] + m_count[i] > dims[i])
+        m_valid = false;
+    }
+  }
+
+  /// Returns `true` if the selection lies inside the array and selects
+  /// at least one element along each dimension, and `false` otherwise.
+  bool valid() const { return m_valid; }
+
+  /// Returns the number of dimensions.
+  int32_t ndim() const { return m_dims.size(); }
+
+  /// Returns the number of selected elements along a dimension.
+  ///
+  /// \param i is the index of the dimension.
+  int32_t count(int32_t i) const { return m_count[i]; }
+
+  /// Returns the number of selected elements.
+  size_t
+  size() const
+  {
+    size_t n = 1;
+    for (int32_t c : m_count)
+      n *= c;
+    return n;
+  }
+
+  /// Returns the index into the whole array of the last selected
+  /// element.
+  size_t
+  last() const
+  {
+    size_t index = 0;
+    size_t step = 1;
+    for (size_t i = 0; i < m_dims.size(); ++i) {
+      index += (m_start[i] + m_count[i] - 1)*step;
+      step *= m_dims[i];
+    }
+    return index;
+  }
+
+  /// Calls a function for each run of adjacent selected elements, in
+  /// the order in which they appear in the array.
+  ///
+  /// \tparam F is the type of the callable.
+  ///
+  /// \param f is the callable.  It is called as `f(first, n)`, where
+  /// `first` is the index into the whole array of the first element of
+  /// the run, and `n` is the number of elements in the run.
+  template<typename F>
+  void
+  for_each_run(F f) const
+  {
+    if (!m_valid)
+      return;
+    int32_t ndim = m_dims.size();
+    if (!ndim) {
+      f(0, 1);
+      return;
+    }
+
+    // merge leading dimensions that are selected completely
+    size_t run = 1;
+    int32_t outer = 0;
+    while (outer < ndim) {
+      run *= m_count[outer];
+      if (m_count[outer] != m_dims[outer])
+        break;
+      ++outer;
+    }
+    if (outer < ndim)
+      ++outer;                  // the partial dimension is in the run
+
+    // the steps between the elements of each dimension
+    std::vector<size_t> step(ndim);
+    size_t s = 1;
+    for (int32_t i = 0; i < ndim; ++i) {
+      step[i] = s;
+      s *= m_dims[i];
+    }
+
+    size_t first = 0;
+    for (int32_t i = 0; i < ndim; ++i)
+      first += m_start[i]*step[i];
+
+    // iterate over the remaining dimensions like an odometer
+    std::vector<int32_t> index(ndim);
+    while (true) {
+      f(first, run);
+      int32_t i = outer;
+      while (i < ndim) {
+        first += step[i];
+        if (++index[i] < m_count[i])
+          break;
+        first -= m_count[i]*step[i];
+        index[i] = 0;
+        ++i;
+      }
+      if (i == ndim)
+        break;
+    }
+  }
+
+private:
+  /// The dimensions of the array.
+  std::vector<int32_t> m_dims;
+
+  /// The index of the first selected element along each dimension.
+  std::vector<int32_t> m_start;
+
+  /// The number of selected elements along each dimension.
+  std::vector<int32_t> m_count;
+
+  /// Is the selection valid?
+  bool m_valid;
+};
+
+#endif
@@ -0,0 +1,415 @@
+/* This is file LevenbergMarquardt.cc.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+///
+/// This file defines class LevenbergMarquardt for non-linear
+/// least-squares fitting.
+
+#include <algorithm>            // for std::copy, std::max
+#include <atomic>
+#include <cfloat>               // for DBL_EPSILON
+#include <cmath>                // for sqrt, fabs, isfinite
+
+#include "LevenbergMarquardt.hh"
+#include "Parallel.hh"
+
+/// Replaces a symmetric positive-definite matrix by its Cholesky
+/// factor.
+///
+/// \param[in,out] a points at the `n` by `n` matrix.  Its lower
+/// triangle is replaced by the lower-triangular Cholesky factor.
+///
+/// \param[in] n is the dimension of the matrix.
+///
+/// \returns `true` if the matrix is positive-definite, `false`
+/// otherwise.
+static bool
+cholesky_decompose(double* a, size_t n)
+{
+  for (size_t j = 0; j < n; ++j) {
+    double d = a[j*n + j];
+    for (size_t k = 0; k < j; ++k)
+      d -= a[j*n + k]*a[j*n + k];
+    if (!(d > 0))
+      return false;
+    d = sqrt(d);
+    a[j*n + j] = d;
+    for (size_t i = j + 1; i < n; ++i) {
+      double s = a[i*n + j];
+      for (size_t k = 0; k < j; ++k)
+        s -= a[i*n + k]*a[j*n + k];
+      a[i*n + j] = s/d;
+    }
+  }
+  return true;
+}
+
+/// Solves `L L^T x = b` for `x`, with `L` a Cholesky factor returned
+/// by cholesky_decompose().
+///
+/// \param[in] l points at the `n` by `n` Cholesky factor.
+///
+/// \param[in,out] b points at the `n` right-hand side values, which
+/// are replaced by the solution.
+///
+/// \param[in] n is the dimension of the matrix.
+static void
+cholesky_solve(double const* l, double* b, size_t n)
+{
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t k = 0; k < i; ++k)
+      b[i] -= l[i*n + k]*b[k];
+    b[i] /= l[i*n + i];
+  }
+  for (size_t i = n; i-- > 0; ) {
+    for (size_t k = i + 1; k < n; ++k)
+      b[i] -= l[k*n + i]*b[k];
+    b[i] /= l[i*n + i];
+  }
+}
+
+/// Constructor.
+///
+/// \param nPar is the number of model parameters.
+///
+/// \param nData is the number of data values.
+///
+/// \param y points at the `nData` data values.  They must remain
+/// available while the instance is in use.
+///
+/// \param weights points at the `nData` weights of the data values,
+/// or is `nullptr` if all data values have weight 1.  For
+/// statistically meaningful error estimates, the weights should be
+/// proportional to the inverse of the variance of the data values.
+LevenbergMarquardt::LevenbergMarquardt(size_t nPar, size_t nData,
+                                       double const* y,
+                                       double const* weights)
+  : m_nPar(nPar), m_nData(nData), m_y(y), m_weights(weights),
+    m_lowbound(nullptr), m_highbound(nullptr), m_step(nPar, -1.0),
+    m_free(nPar), m_max_iterations(100), m_tolerance(1e-10),
+    m_parallel(false), m_chi2(0), m_iterations(0)
+{
+  for (size_t j = 0; j < nPar; ++j)
+    m_free[j] = j;
+}
+
+/// Specifies bounds on the parameters.
+///
+/// \param lowbound points at the `nPar` lower bounds, or is `nullptr`
+/// if there are no lower bounds.
+///
+/// \param highbound points at the `nPar` upper bounds, or is `nullptr`
+/// if there are no upper bounds.
+void
+LevenbergMarquardt::set_bounds(double const* lowbound,
+                               double const* highbound)
+{
+  m_lowbound = lowbound;
+  m_highbound = highbound;
+}
+
+/// Specifies the finite-difference step sizes of the parameters.
+/// Parameters with a step size equal to 0 are held fixed.  The
+/// absolute value of the other step sizes is used for calculating
+/// finite-difference derivatives.
+///
+/// \param step points at the `nPar` step sizes.
+void
+LevenbergMarquardt::set_steps(double const* step)
+{
+  m_free.clear();
+  for (size_t j = 0; j < m_nPar; ++j) {
+    m_step[j] = fabs(step[j]);
+    if (step[j])
+      m_free.push_back(j);
+  }
+}
+
+/// Specifies the maximum number of iterations.  The default is 100.
+///
+/// \param count is the maximum number of iterations.
+void
+LevenbergMarquardt::set_max_iterations(size_t count)
+{
+  m_max_iterations = count;
+}
+
+/// Specifies the convergence criterion.  The fit has converged when
+/// the chi-square decreases by less than this fraction in an
+/// iteration.  The default is 1e-10.
+///
+/// \param tolerance is the convergence criterion.
+void
+LevenbergMarquardt::set_tolerance(double tolerance)
+{
+  m_tolerance = tolerance;
+}
+
+/// Specifies whether finite-difference derivatives may be calculated
+/// in parallel.  This requires the model to be thread-safe.  The
+/// default is `false`.
+///
+/// \param parallel says whether to calculate in parallel.
+void
+LevenbergMarquardt::set_parallel(bool parallel)
+{
+  m_parallel = parallel;
+}
+
+/// Returns the chi-square of model values.
+///
+/// \param model_values points at the `nData` model values.
+///
+/// \returns the weighted sum of the squares of the differences
+/// between the data values and the model values.
+double
+LevenbergMarquardt::chi2(double const* model_values) const
+{
+  double sum = 0;
+  for (size_t i = 0; i < m_nData; ++i) {
+    double r = m_y[i] - model_values[i];
+    sum += (m_weights? m_weights[i]: 1)*r*r;
+  }
+  return sum;
+}
+
+/// Moves parameter values that are out of bounds to the nearest
+/// bound.
+///
+/// \param par points at the `nPar` parameter values.
+void
+LevenbergMarquardt::enforce_bounds(double* par) const
+{
+  for (size_t j = 0; j < m_nPar; ++j) {
+    if (m_lowbound && par[j] < m_lowbound[j])
+      par[j] = m_lowbound[j];
+    else if (m_highbound && par[j] > m_highbound[j])
+      par[j] = m_highbound[j];
+  }
+}
+
+/// Calculates the Jacobian, from \a jacobian if that is set, or else
+/// from finite differences of \a model.
+///
+/// \param model calculates model values.
+///
+/// \param jacobian calculates the Jacobian, or is empty.
+///
+/// \param par points at the `nPar` parameter values.
+///
+/// \param model_values points at the `nData` model values for \a par.
+///
+/// \param jac points at where the `nData*nPar` derivatives are stored.
+///
+/// \returns `true` for success, `false` if \a model or \a jacobian
+/// failed.
+bool
+LevenbergMarquardt::jacobian(Model const& model, Jacobian const& jacobian,
+                             double const* par, double const* model_values,
+                             double* jac)
+{
+  if (jacobian)
+    return jacobian(par, model_values, jac);
+
+  size_t nFree = m_free.size();
+  std::atomic<bool> ok(true);
+  auto columns = [&](size_t begin, size_t end) {
+    std::vector<double> trial(par, par + m_nPar);
+    std::vector<double> shifted(m_nData);
+    for (size_t a = begin; a < end && ok; ++a) {
+      size_t j = m_free[a];
+      double h = m_step[j];
+      if (!(h > 0))             // relative, but not too small near zero
+        h = std::max(1e-7*fabs(par[j]), sqrt(DBL_EPSILON));
+      // step away from a bound if there is one on this side
+      if (m_highbound && par[j] + h > m_highbound[j])
+        h = -h;
+      trial[j] = par[j] + h;
+      if (!model(trial.data(), shifted.data())) {
+        ok = false;
+        return;
+      }
+      h = trial[j] - par[j];    // the step that was actually made
+      for (size_t i = 0; i < m_nData; ++i)
+        jac[i*m_nPar + j] = (shifted[i] - model_values[i])/h;
+      trial[j] = par[j];
+    }
+  };
+  if (m_parallel)
+    parallel_for(nFree, 1, columns);
+  else
+    columns(0, nFree);
+  return ok;
+}
+
+/// Fits the model to the data.
+///
+/// \param model calculates model values.
+///
+/// \param jacobian calculates the Jacobian, or is empty (e.g.,
+/// `nullptr`) to calculate the Jacobian from finite differences of
+/// the model values.
+///
+/// \param par points at the `nPar` parameter values.  On entry, they
+/// must contain the initial estimates.  On exit, they contain the
+/// best-fit values.
+///
+/// \returns the reason why the fit ended.
+LevenbergMarquardt::Status
+LevenbergMarquardt::fit(Model const& model, Jacobian const& jacobian,
+                        double* par)
+{
+  size_t nFree = m_free.size();
+  std::vector<double> model_values(m_nData), trial_values(m_nData);
+  std::vector<double> jac(m_nData*m_nPar, 0.0);
+  std::vector<double> beta(nFree), delta(nFree), curvature(nFree*nFree);
+  std::vector<double> trial(m_nPar);
+
+  m_alpha.assign(nFree*nFree, 0.0);
+  m_iterations = 0;
+  enforce_bounds(par);
+  if (!model(par, model_values.data()))
+    return MODEL_FAILED;
+  m_chi2 = chi2(model_values.data());
+
+  double lambda = 1e-3;
+  bool stale = true;            // is m_alpha out of date?
+  Status status = MAX_ITERATIONS;
+  while (m_iterations < m_max_iterations) {
+    ++m_iterations;
+    if (!this->jacobian(model, jacobian, par, model_values.data(),
+                        jac.data()))
+      return MODEL_FAILED;
+
+    // calculate the curvature matrix and the gradient
+    std::fill(m_alpha.begin(), m_alpha.end(), 0.0);
+    std::fill(beta.begin(), beta.end(), 0.0);
+    for (size_t i = 0; i < m_nData; ++i) {
+      double w = m_weights? m_weights[i]: 1;
+      double r = w*(m_y[i] - model_values[i]);
+      double const* row = &jac[i*m_nPar];
+      for (size_t a = 0; a < nFree; ++a) {
+        double ja = w*row[m_free[a]];
+        beta[a] += row[m_free[a]]*r;
+        for (size_t b = 0; b <= a; ++b)
+          m_alpha[a*nFree + b] += ja*row[m_free[b]];
+      }
+    }
+    for (size_t a = 0; a < nFree; ++a)
+      for (size_t b = 0; b < a; ++b)
+        m_alpha[b*nFree + a] = m_alpha[a*nFree + b];
+    stale = false;
+
+    if (!m_chi2) {              // perfect fit
+      status = CONVERGED;
+      break;
+    }
+
+    // seek a step that decreases the chi-square
+    bool improved = false;
+    double old_chi2 = m_chi2;
+    while (lambda < 1e12) {
+      std::copy(m_alpha.begin(), m_alpha.end(), curvature.begin());
+      for (size_t a = 0; a < nFree; ++a) {
+        double& d = curvature[a*nFree + a];
+        d = d? d*(1 + lambda): lambda;
+      }
+      std::copy(beta.begin(), beta.end(), delta.begin());
+      if (!cholesky_decompose(curvature.data(), nFree)) {
+        lambda *= 10;
+        continue;
+      }
+      cholesky_solve(curvature.data(), delta.data(), nFree);
+      std::copy(par, par + m_nPar, trial.begin());
+      for (size_t a = 0; a < nFree; ++a)
+        trial[m_free[a]] += delta[a];
+      enforce_bounds(trial.data());
+      if (!model(trial.data(), trial_values.data()))
+        return MODEL_FAILED;
+      double trial_chi2 = chi2(trial_values.data());
+      if (trial_chi2 <= m_chi2 && std::isfinite(trial_chi2)) {
+        std::copy(trial.begin(), trial.end(), par);
+        model_values.swap(trial_values);
+        m_chi2 = trial_chi2;
+        lambda = std::max(lambda/10, 1e-12);
+        improved = true;
+        stale = true;
+        break;
+      }
+      lambda *= 10;
+    }
+    if (!improved || old_chi2 - m_chi2 <= m_tolerance*old_chi2) {
+      status = CONVERGED;
+      break;
+    }
+  }
+
+  if (stale) {
+    // update the curvature matrix for the final parameter values, so
+    // errors() reports the right thing
+    if (!this->jacobian(model, jacobian, par, model_values.data(),
+                        jac.data()))
+      return MODEL_FAILED;
+    std::fill(m_alpha.begin(), m_alpha.end(), 0.0);
+    for (size_t i = 0; i < m_nData; ++i) {
+      double w = m_weights? m_weights[i]: 1;
+      double const* row = &jac[i*m_nPar];
+      for (size_t a = 0; a < nFree; ++a)
+        for (size_t b = 0; b < nFree; ++b)
+          m_alpha[a*nFree + b] += w*row[m_free[a]]*row[m_free[b]];
+    }
+  }
+  return status;
+}
+
+/// Returns estimates of the standard errors in the best-fit
+/// parameter values, derived from the curvature matrix at the best
+/// fit and scaled by the reduced chi-square.
+///
+/// \param err points at where the `nPar` error estimates are stored.
+/// Parameters that were held fixed get error estimate 0.
+///
+/// \returns `true` for success, `false` if the errors could not be
+/// estimated (for example because the curvature matrix is singular).
+/// In the latter case, the error estimates are set to infinity.
+bool
+LevenbergMarquardt::errors(double* err) const
+{
+  size_t nFree = m_free.size();
+  std::fill(err, err + m_nPar, 0.0);
+  if (m_alpha.size() != nFree*nFree)
+    return false;
+
+  std::vector<double> l(m_alpha), column(nFree);
+  bool ok = cholesky_decompose(l.data(), nFree);
+  double scale = (m_nData > nFree? m_chi2/(m_nData - nFree): 1);
+  for (size_t a = 0; a < nFree; ++a) {
+    if (ok) {
+      // the diagonal element a of the inverse of the curvature matrix
+      std::fill(column.begin(), column.end(), 0.0);
+      column[a] = 1;
+      cholesky_solve(l.data(), column.data(), nFree);
+      err[m_free[a]] = sqrt(column[a]*scale);
+    } else
+      err[m_free[a]] = INFINITY;
+  }
+  return ok;
+}
@@ -0,0 +1,162 @@
+/* This is file LevenbergMarquardt.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LEVENBERGMARQUARDT_HH_
+#define LEVENBERGMARQUARDT_HH_
+
+/// \file
+///
+/// This file declares a class for non-linear least-squares fitting
+/// using the Levenberg-Marquardt method.
+
+#include <cstddef>              // for size_t
+#include <functional>
+#include <vector>
+
+/// A class for fitting a model with a number of parameters to data
+/// values, by minimizing the weighted sum of the squares of the
+/// differences between the data values and the model values (the
+/// chi-square), using the Levenberg-Marquardt method.
+///
+/// The model is provided as a callable that calculates the model
+/// values for given parameter values.  The derivatives of the model
+/// values with respect to the parameters (the Jacobian) are either
+/// provided by another callable or are calculated from finite
+/// differences of the model values.  The finite-difference
+/// derivatives can be calculated in parallel if the model is
+/// thread-safe.
+///
+/// Parameters can be held fixed, and can be restricted to lie
+/// between lower and upper bounds.
+///
+/// Example:
+///
+/// \code
+/// LevenbergMarquardt lm(2, n, y);
+/// auto model = [&x, n](double const* par, double* m) {
+///   for (size_t i = 0; i < n; ++i)
+///     m[i] = par[0] + par[1]*x[i];
+///   return true;
+/// };
+/// double par[2] = { 0, 1 };
+/// lm.fit(model, nullptr, par);
+/// \endcode
+class LevenbergMarquardt
+{
+public:
+  /// Calculates model values.  The first argument points at the
+  /// parameter values, the second one at where the model values must
+  /// be stored.  Returns `true` for success, `false` for failure.
+  using Model = std::function<bool(double const*, double*)>;
+
+  /// Calculates the Jacobian.  The first argument points at the
+  /// parameter values, the second one at the model values for those
+  /// parameter values, and the third one at where the derivatives
+  /// must be stored: element `i*nPar + j` receives the derivative of
+  /// model value `i` with respect to parameter `j`.  Returns `true`
+  /// for success, `false` for failure.
+  using Jacobian = std::function<bool(double const*, double const*, double*)>;
+
+  /// The reasons why a fit may end.
+  enum Status {
+    /// The fit converged.
+    CONVERGED,
+
+    /// The maximum number of iterations was reached.
+    MAX_ITERATIONS,
+
+    /// The model or the Jacobian reported a failure.
+    MODEL_FAILED,
+  };
+
+  LevenbergMarquardt(size_t nPar, size_t nData, double const* y,
+                     double const* weights = nullptr);
+
+  void set_bounds(double const* lowbound, double const* highbound);
+  void set_steps(double const* step);
+  void set_max_iterations(size_t count);
+  void set_tolerance(double tolerance);
+  void set_parallel(bool parallel);
+
+  Status fit(Model const& model, Jacobian const& jacobian, double* par);
+
+  /// Returns the chi-square of the best fit.
+  double chi2() const { return m_chi2; }
+
+  /// Returns the number of iterations of the last fit.
+  size_t iterations() const { return m_iterations; }
+
+  bool errors(double* err) const;
+
+private:
+  bool jacobian(Model const& model, Jacobian const& jacobian,
+                double const* par, double const* model_values, double* jac);
+  double chi2(double const* model_values) const;
+  void enforce_bounds(double* par) const;
+
+  /// The number of parameters.
+  size_t m_nPar;
+
+  /// The number of data values.
+  size_t m_nData;
+
+  /// Points at the data values.
+  double const* m_y;
+
+  /// Points at the weights of the data values, or is `nullptr` if all
+  /// data values have weight 1.
+  double const* m_weights;
+
+  /// Points at the lower bounds of the parameters, or is `nullptr`.
+  double const* m_lowbound;
+
+  /// Points at the upper bounds of the parameters, or is `nullptr`.
+  double const* m_highbound;
+
+  /// The finite-difference step sizes of the parameters.  A parameter
+  /// with step size 0 is held fixed.  A negative step size means that
+  /// the step size is chosen automatically.
+  std::vector<double> m_step;
+
+  /// The indices of the parameters that are not held fixed.
+  std::vector<size_t> m_free;
+
+  /// The maximum number of iterations.
+  size_t m_max_iterations;
+
+  /// The fit converges when the relative decrease of the chi-square
+  /// in an iteration is less than this.
+  double m_tolerance;
+
+  /// Calculate finite-difference derivatives in parallel?
+  bool m_parallel;
+
+  /// The chi-square of the best fit.
+  double m_chi2;
+
+  /// The number of iterations of the last fit.
+  size_t m_iterations;
+
+  /// The curvature matrix J^T W J for the free parameters at the best
+  /// fit, with W the diagonal matrix of the weights.
+  std::vector<double> m_alpha;
+};
+
+#endif
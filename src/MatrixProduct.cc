@@ -0,0 +1,243 @@
+/* This is file MatrixProduct.cc.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+///
+/// This file defines the matrix_product() function.
+
+#include "MatrixProduct.hh"
+#include "Parallel.hh"
+#include <algorithm>            // for std::min, std::max, std::fill
+#include <vector>
+
+namespace {
+
+  /// Sizes of the blocks and of the kernel, per element type.
+  ///
+  /// The kernel keeps an `MR` by `NR` block of the result in
+  /// registers.  A `KC` by `NR` panel of the right-hand matrix stays in
+  /// the level-1 cache, and an `MC` by `KC` block of the left-hand
+  /// matrix in the level-2 cache.
+  template<typename T>
+  struct Blocking;
+
+  template<>
+  struct Blocking<double>
+  {
+    static constexpr size_t MR = 4;
+    static constexpr size_t NR = 6;
+    static constexpr size_t KC = 256;
+    static constexpr size_t MC = 96;
+  };
+
+  template<>
+  struct Blocking<float>
+  {
+    static constexpr size_t MR = 8;
+    static constexpr size_t NR = 6;
+    static constexpr size_t KC = 256;
+    static constexpr size_t MC = 192;
+  };
+
+  /// The greatest number of result columns per work item.
+  constexpr size_t NC_MAX = 1024;
+
+  /// Products with fewer multiplications than this are calculated
+  /// directly, without copying blocks.
+  constexpr size_t SMALL = 32768;
+
+  /// Adds the product of an `MR` by `kc` panel and a `kc` by `NR` panel
+  /// to a block of the result.
+  ///
+  /// \param kc is the length of the panels.
+  ///
+  /// \param a points at the left-hand panel, stored by column.
+  ///
+  /// \param b points at the right-hand panel, stored by row.
+  ///
+  /// \param c points at the block of the result.
+  ///
+  /// \param ldc is the distance between columns of the result.
+  ///
+  /// \param mr is the number of rows of the block, at most `MR`.
+  ///
+  /// \param nr is the number of columns of the block, at most `NR`.
+  template<typename T>
+  void
+  kernel(size_t kc, T const* a, T const* b, T* c, size_t ldc, size_t mr,
+         size_t nr)
+  {
+    constexpr size_t MR = Blocking<T>::MR;
+    constexpr size_t NR = Blocking<T>::NR;
+    T acc[NR][MR] = { };
+
+    for (size_t p = 0; p < kc; ++p) {
+      for (size_t j = 0; j < NR; ++j)
+        for (size_t i = 0; i < MR; ++i)
+          acc[j][i] += a[i]*b[j];
+      a += MR;
+      b += NR;
+    }
+    for (size_t j = 0; j < nr; ++j)
+      for (size_t i = 0; i < mr; ++i)
+        c[i + j*ldc] += acc[j][i];
+  }
+
+  /// Calculates columns `j0` through `j0 + nc - 1` of the product of an
+  /// `m` by `k` matrix and a `k` by `n` matrix.
+  ///
+  /// \param ap is a buffer of at least `MC*KC` elements.
+  ///
+  /// \param bp is a buffer of at least `KC*nc` elements, with \a nc
+  /// rounded up to a multiple of `NR`.
+  template<typename T>
+  void
+  product_block(T const* a, T const* b, T* c, size_t m, size_t k,
+                size_t j0, size_t nc, T* ap, T* bp)
+  {
+    constexpr size_t MR = Blocking<T>::MR;
+    constexpr size_t NR = Blocking<T>::NR;
+    constexpr size_t KC = Blocking<T>::KC;
+    constexpr size_t MC = Blocking<T>::MC;
+
+    c += j0*m;
+    b += j0*k;
+    std::fill(c, c + m*nc, T(0));
+    for (size_t pc = 0; pc < k; pc += KC) {
+      size_t kc = std::min(KC, k - pc);
+
+      // copy the right-hand block by row in panels of NR columns,
+      // padded with zeros
+      T* q = bp;
+      for (size_t jr = 0; jr < nc; jr += NR)
+        for (size_t p = 0; p < kc; ++p)
+          for (size_t j = 0; j < NR; ++j)
+            *q++ = (jr + j < nc)? b[pc + p + (jr + j)*k]: T(0);
+
+      for (size_t ic = 0; ic < m; ic += MC) {
+        size_t mc = std::min(MC, m - ic);
+
+        // copy the left-hand block by column in panels of MR rows,
+        // padded with zeros
+        q = ap;
+        for (size_t ir = 0; ir < mc; ir += MR)
+          for (size_t p = 0; p < kc; ++p) {
+            T const* s = a + ic + ir + (pc + p)*m;
+            for (size_t i = 0; i < MR; ++i)
+              *q++ = (ir + i < mc)? s[i]: T(0);
+          }
+
+        for (size_t jr = 0; jr < nc; jr += NR)
+          for (size_t ir = 0; ir < mc; ir += MR)
+            kernel(kc, ap + ir*kc, bp + jr*kc, c + ic + ir + jr*m, m,
+                   std::min(MR, mc - ir), std::min(NR, nc - jr));
+      }
+    }
+  }
+
+  /// Calculates the product of an `m` by `k` matrix and a `k` by `n`
+  /// matrix without blocking, for small matrices.
+  template<typename T>
+  void
+  product_small(T const* a, T const* b, T* c, size_t m, size_t k, size_t n)
+  {
+    if (m < 8) {
+      // columns too short to gain from vector instructions; sum each
+      // element in a register instead
+      for (size_t j = 0; j < n; ++j)
+        for (size_t i = 0; i < m; ++i) {
+          T sum = 0;
+          for (size_t p = 0; p < k; ++p)
+            sum += a[i + p*m]*b[p + j*k];
+          c[i + j*m] = sum;
+        }
+      return;
+    }
+    for (size_t j = 0; j < n; ++j) {
+      T* cj = c + j*m;
+      std::fill(cj, cj + m, T(0));
+      for (size_t p = 0; p < k; ++p) {
+        T bpj = b[p + j*k];
+        T const* ap = a + p*m;
+        for (size_t i = 0; i < m; ++i)
+          cj[i] += ap[i]*bpj;
+      }
+    }
+  }
+}
+
+template<typename T>
+void
+matrix_product(T const* a, T const* b, T* c, size_t m, size_t k, size_t n,
+               size_t na, size_t nb, bool outer)
+{
+  constexpr size_t NR = Blocking<T>::NR;
+  constexpr size_t KC = Blocking<T>::KC;
+  constexpr size_t MC = Blocking<T>::MC;
+
+  size_t npairs = outer? na*nb: na;
+  if (!npairs || !m || !n)
+    return;
+  size_t work = m*k*n;          // multiplications per product
+
+  // cut each product into column blocks, enough to keep all threads
+  // busy when there are few products
+  size_t nc = n;
+  if (work >= SMALL) {
+    size_t nthreads = parallel_thread_count(npairs*((n + NR - 1)/NR));
+    size_t split = (nthreads + npairs - 1)/npairs;
+    nc = (n + split - 1)/split;
+    nc = std::min(((nc + NR - 1)/NR)*NR, NC_MAX);
+  }
+  size_t nblocks = (n + nc - 1)/nc;
+  size_t item_work = m*std::max(k, (size_t) 1)*nc;
+  size_t min_per_thread = std::max((size_t) 1, ((size_t) 1 << 18)/item_work);
+
+  parallel_for(npairs*nblocks, min_per_thread,
+               [&](size_t begin, size_t end) {
+    std::vector<T> ap, bp;
+    if (work >= SMALL) {
+      ap.resize(MC*KC);
+      bp.resize(KC*((nc + NR - 1)/NR)*NR);
+    }
+    for (size_t item = begin; item < end; ++item) {
+      size_t pair = item/nblocks;
+      size_t ia = outer? pair % na: pair;
+      size_t ib = outer? pair/na: pair;
+      T const* ai = a + ia*m*k;
+      T const* bi = b + ib*k*n;
+      T* ci = c + pair*m*n;
+      if (work < SMALL)
+        product_small(ai, bi, ci, m, k, n);
+      else {
+        size_t j0 = (item % nblocks)*nc;
+        product_block(ai, bi, ci, m, k, j0, std::min(nc, n - j0),
+                      ap.data(), bp.data());
+      }
+    }
+  });
+}
+
+template void matrix_product<float>(float const*, float const*, float*,
+                                    size_t, size_t, size_t, size_t, size_t,
+                                    bool);
+template void matrix_product<double>(double const*, double const*, double*,
+                                     size_t, size_t, size_t, size_t, size_t,
+                                     bool);
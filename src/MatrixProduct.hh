@@ -0,0 +1,72 @@
+/* This is file MatrixProduct.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_MATRIXPRODUCT_HH
+#define INCLUDED_MATRIXPRODUCT_HH
+
+/// \file
+///
+/// This file declares a function that calculates the matrix products
+/// of stacks of matrices, using several threads.
+
+#include <cstddef>              // for size_t
+
+/// Calculates the matrix products of stacks of matrices.
+///
+/// All matrices are stored in column-major order, one after the other,
+/// as in LUX arrays: element (r, c) of an `m` by `k` matrix is at index
+/// `r + c*m`.
+///
+/// Large products are calculated in blocks that fit in the processor
+/// caches, with the blocks copied into the order in which a small
+/// register-sized kernel reads them.  The work is split across threads
+/// both by matrix and by column blocks of the result, so a single
+/// large product uses several threads too.  The sums are calculated in
+/// type `T`.
+///
+/// \tparam T is the type of the elements, `float` or `double`.
+///
+/// \param a points at the first `m` by `k` matrix.
+///
+/// \param b points at the first `k` by `n` matrix.
+///
+/// \param c points at the first `m` by `n` result matrix.
+///
+/// \param m is the number of rows of the matrices from \a a.
+///
+/// \param k is the number of columns of the matrices from \a a, and
+/// the number of rows of the matrices from \a b.
+///
+/// \param n is the number of columns of the matrices from \a b.
+///
+/// \param na is the number of matrices at \a a.
+///
+/// \param nb is the number of matrices at \a b.
+///
+/// \param outer says which products to calculate.  If `false`, then
+/// \a na must equal \a nb, and result `i` is the product of matrices
+/// `i` from \a a and \a b.  If `true`, then result `ia + na*ib` is the
+/// product of matrix `ia` from \a a and matrix `ib` from \a b, for all
+/// combinations.
+template<typename T>
+void matrix_product(T const* a, T const* b, T* c, size_t m, size_t k,
+                    size_t n, size_t na, size_t nb, bool outer);
+
+#endif
@@ -0,0 +1,54 @@
+/* This is file Parallel.cc.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+///
+/// This file defines the thread count bookkeeping for parallel
+/// calculations.
+
+#include "Parallel.hh"
+
+int32_t lux_nthreads = 0;
+thread_local bool parallel_worker = false;
+
+/// Returns the number of threads to use for processing a number of
+/// work items.
+///
+/// \param count is the number of work items.
+///
+/// \param min_per_thread is the least number of work items that
+/// makes it worthwhile to start another thread.
+///
+/// \returns the number of threads, which is at least 1.  It is 1 if
+/// called from within a worker thread, so parallel regions do not
+/// nest.
+size_t
+parallel_thread_count(size_t count, size_t min_per_thread)
+{
+  if (parallel_worker)
+    return 1;
+  size_t n = (lux_nthreads > 0? lux_nthreads
+              : std::thread::hardware_concurrency());
+  if (!min_per_thread)
+    min_per_thread = 1;
+  if (n > count/min_per_thread)
+    n = count/min_per_thread;
+  return n? n: 1;
+}
@@ -0,0 +1,115 @@
+/* This is file Parallel.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_PARALLEL_HH
+#define INCLUDED_PARALLEL_HH
+
+/// \file
+///
+/// This file declares facilities for splitting a range of independent
+/// work items across several threads.  The LUX interpreter itself is
+/// not thread-safe, so the work done in the threads must not touch
+/// symbols, the symbol table, or any other interpreter state.
+
+#include <cstddef>              // for size_t
+#include <cstdint>              // for int32_t
+#include <thread>
+#include <vector>
+
+/// The maximum number of threads to use for parallel calculations.
+/// It is accessible from LUX as `!nthreads`.  A value of 0 or less
+/// means "as many as the hardware supports".
+extern int32_t lux_nthreads;
+
+/// Is the current thread a worker thread started by #parallel_chunks?
+/// Used to prevent nested parallel regions from starting yet more
+/// threads.
+extern thread_local bool parallel_worker;
+
+size_t parallel_thread_count(size_t count, size_t min_per_thread = 1);
+
+/// Splits the range [0, \a count) into \a nchunks consecutive chunks
+/// of nearly equal size and calls \a f(chunk, begin, end) for each of
+/// them, each in its own thread.  The calling thread processes the
+/// last chunk itself.  Returns when all chunks have been processed.
+///
+/// The chunk boundaries depend only on \a count and \a nchunks, so
+/// callers that need results that do not depend on the number of
+/// threads should choose \a nchunks independent of the thread count
+/// and combine the per-chunk results in chunk order.
+///
+/// \tparam F is the type of the callable.
+///
+/// \param nchunks is the number of chunks.
+///
+/// \param count is the number of work items.
+///
+/// \param f is the callable that processes a single chunk.
+template<typename F>
+void
+parallel_chunks(size_t nchunks, size_t count, F f)
+{
+  if (nchunks <= 1 || count <= 1) {
+    if (count)
+      f(0, 0, count);
+    return;
+  }
+  if (nchunks > count)
+    nchunks = count;
+
+  auto worker = [&f](size_t chunk, size_t begin, size_t end) {
+    parallel_worker = true;
+    f(chunk, begin, end);
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(nchunks - 1);
+  size_t begin = 0;
+  for (size_t chunk = 0; chunk < nchunks - 1; ++chunk) {
+    size_t end = count*(chunk + 1)/nchunks;
+    threads.emplace_back(worker, chunk, begin, end);
+    begin = end;
+  }
+  f(nchunks - 1, begin, count);
+  for (auto& t : threads)
+    t.join();
+}
+
+/// Splits the range [0, \a count) across as many threads as
+/// #parallel_thread_count says are useful, and calls \a f(begin, end)
+/// for each of the subranges.
+///
+/// \tparam F is the type of the callable.
+///
+/// \param count is the number of work items.
+///
+/// \param min_per_thread is the least number of work items that
+/// makes it worthwhile to start another thread.
+///
+/// \param f is the callable that processes a subrange.
+template<typename F>
+void
+parallel_for(size_t count, size_t min_per_thread, F f)
+{
+  parallel_chunks(parallel_thread_count(count, min_per_thread), count,
+                  [&f](size_t, size_t begin, size_t end) { f(begin, end); });
+}
+
+#endif
@@ -0,0 +1,138 @@
+/* This is file PathIndex.cc.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+///
+/// This file defines the PathIndex class.
+
+#include "PathIndex.hh"
+#include <dirent.h>             // for opendir, readdir, closedir
+#include <sys/stat.h>           // for stat
+
+/// Returns the modification time of a directory in nanoseconds, or 0
+/// if the directory cannot be examined.  The sub-second part matters
+/// because files may be added within a second of a scan.
+static int64_t
+directory_mtime(std::string const& directory)
+{
+  struct stat st;
+
+  if (stat(directory.c_str(), &st) || !S_ISDIR(st.st_mode))
+    return 0;
+  return st.st_mtim.tv_sec*(int64_t) 1000000000 + st.st_mtim.tv_nsec;
+}
+
+/// Reads the names of the files in a directory.
+///
+/// \param[in] directory is the name of the directory.
+///
+/// \param[out] entry receives the modification time of the directory
+/// and the names of the files in it.
+void
+PathIndex::scan(std::string const& directory, Entry& entry)
+{
+  entry.files.clear();
+  entry.mtime = directory_mtime(directory);
+  if (!entry.mtime)
+    return;
+  DIR* dir = opendir(directory.c_str());
+  if (!dir) {
+    entry.mtime = 0;
+    return;
+  }
+  while (struct dirent* d = readdir(dir)) {
+    if (d->d_name[0] != '.')
+      entry.files.insert(d->d_name);
+  }
+  closedir(dir);
+}
+
+/// Sets the directories to index.  The directories are scanned only
+/// if they differ from the current ones.
+///
+/// \param directories are the names of the directories, in search
+/// order.
+///
+/// \returns `true` if the directories were scanned, `false` if the
+/// index was already up to date.
+bool
+PathIndex::set_directories(std::vector<std::string> const& directories)
+{
+  if (directories == m_directories)
+    return false;
+  m_directories = directories;
+  rebuild();
+  return true;
+}
+
+/// Scans all directories again.
+void
+PathIndex::rebuild()
+{
+  m_entries.resize(m_directories.size());
+  for (size_t i = 0; i < m_directories.size(); ++i)
+    scan(m_directories[i], m_entries[i]);
+}
+
+/// Scans again those directories whose modification time has changed
+/// since they were last scanned.
+///
+/// \returns `true` if any directory was scanned again, `false`
+/// otherwise.
+bool
+PathIndex::refresh()
+{
+  bool changed = false;
+  for (size_t i = 0; i < m_directories.size(); ++i) {
+    if (directory_mtime(m_directories[i]) != m_entries[i].mtime) {
+      scan(m_directories[i], m_entries[i]);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+/// Seeks the first directory that contains a file with one of the
+/// specified names.  Within a directory, the names are tried in the
+/// specified order.
+///
+/// \param[in] names are the file names to seek.
+///
+/// \param[out] directory receives the index of the directory in which
+/// a file was found.
+///
+/// \param[out] name receives the index of the name that was found.
+///
+/// \returns `true` if a file was found, `false` otherwise.
+bool
+PathIndex::locate(std::vector<std::string> const& names, size_t& directory,
+                  size_t& name) const
+{
+  for (size_t i = 0; i < m_entries.size(); ++i) {
+    for (size_t j = 0; j < names.size(); ++j) {
+      if (m_entries[i].files.count(names[j])) {
+        directory = i;
+        name = j;
+        return true;
+      }
+    }
+  }
+  return false;
+}
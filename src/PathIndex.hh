@@ -0,0 +1,84 @@
+/* This is file PathIndex.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PATHINDEX_HH_
+#define PATHINDEX_HH_
+
+/// \file
+///
+/// This file declares a class that remembers which files are present
+/// in the directories of a search path.
+
+#include <cstddef>              // for size_t
+#include <cstdint>              // for int64_t
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/// A class that indexes the names of the files in a list of
+/// directories, so that the first directory that contains a file with
+/// a given name can be found without probing the file system for each
+/// directory.  This matters when the directories are on a slow
+/// (network) file system.
+///
+/// The index of a directory is rebuilt when the modification time of
+/// the directory changes, which happens when files are added to or
+/// removed from it.  Those modification times are checked only when
+/// asked to, so a caller that finds a name missing from the index
+/// should call #refresh and try again.
+class PathIndex
+{
+public:
+  bool set_directories(std::vector<std::string> const& directories);
+  void rebuild();
+  bool refresh();
+
+  /// Returns the indexed directories, in search order.
+  std::vector<std::string> const& directories() const { return m_directories; }
+
+  /// Returns the names of the files in directory number \a i.
+  std::unordered_set<std::string> const&
+  files(size_t i) const { return m_entries[i].files; }
+
+  bool locate(std::vector<std::string> const& names, size_t& directory,
+              size_t& name) const;
+
+private:
+  /// The index of a single directory.
+  struct Entry
+  {
+    /// The modification time of the directory (in nanoseconds) when
+    /// it was indexed, or 0 if it could not be read.
+    int64_t mtime;
+
+    /// The names of the files in the directory.
+    std::unordered_set<std::string> files;
+  };
+
+  static void scan(std::string const& directory, Entry& entry);
+
+  /// The directories, in search order.
+  std::vector<std::string> m_directories;
+
+  /// The indexes of the directories, in the same order.
+  std::vector<Entry> m_entries;
+};
+
+#endif
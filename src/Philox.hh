@@ -0,0 +1,157 @@
+/* This is file Philox.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_PHILOX_HH
+#define INCLUDED_PHILOX_HH
+
+/// \file
+///
+/// This file defines the Philox4x32-10 counter-based pseudo-random
+/// number generator.
+
+#include <cstddef>              // for size_t
+#include <cstdint>              // for uint32_t, uint64_t
+
+/// The Philox4x32-10 counter-based pseudo-random number generator
+/// from Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3"
+/// (SC11, 2011).  It maps a 128-bit counter and a 64-bit key to 128
+/// pseudo-random bits.  There is no state other than the key, so any
+/// element of the sequence can be calculated directly from its
+/// counter, which makes it easy to generate parts of a long sequence
+/// in parallel with results that do not depend on how the work is
+/// divided.
+class Philox
+{
+public:
+  /// Constructor.
+  ///
+  /// \param seed is the key.
+  explicit Philox(uint64_t seed = 0)
+    : m_key{ (uint32_t) seed, (uint32_t) (seed >> 32) }
+  { }
+
+  /// Calculates the 128 pseudo-random bits for a counter.
+  ///
+  /// \param[in] counter is the lower 64 bits of the 128-bit counter.
+  ///
+  /// \param[out] out receives the pseudo-random bits.
+  ///
+  /// \param[in] stream is the upper 64 bits of the 128-bit counter.
+  /// Different streams yield independent sequences.
+  void
+  bits(uint64_t counter, uint32_t out[4], uint64_t stream = 0) const
+  {
+    uint32_t c0 = (uint32_t) counter, c1 = (uint32_t) (counter >> 32);
+    uint32_t c2 = (uint32_t) stream, c3 = (uint32_t) (stream >> 32);
+    uint32_t k0 = m_key[0], k1 = m_key[1];
+
+    for (int round = 0; round < 10; ++round) {
+      uint64_t p0 = (uint64_t) 0xD2511F53*c0;
+      uint64_t p1 = (uint64_t) 0xCD9E8D57*c2;
+      c0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+      c1 = (uint32_t) p1;
+      c2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+      c3 = (uint32_t) p0;
+      k0 += 0x9E3779B9;
+      k1 += 0xBB67AE85;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+  }
+
+  /// Calculates two uniformly distributed pseudo-random numbers
+  /// between 0 and 1 (exclusive) for a counter.  Each number has 53
+  /// random bits.
+  ///
+  /// \param[in] counter is the 64-bit counter.
+  ///
+  /// \param[out] u receives the two numbers.
+  void
+  uniform(uint64_t counter, double u[2]) const
+  {
+    uint32_t r[4];
+
+    bits(counter, r);
+    u[0] = ((((uint64_t) r[0] << 32 | r[1]) >> 11) + 0.5)*0x1p-53;
+    u[1] = ((((uint64_t) r[2] << 32 | r[3]) >> 11) + 0.5)*0x1p-53;
+  }
+
+  /// Calculates the pseudo-random bits for a number of consecutive
+  /// counters.  The rounds are done for a group of counters at a time
+  /// so the compiler can vectorize them.
+  ///
+  /// \param[in] counter is the lower 64 bits of the first counter.
+  ///
+  /// \param[in] stream is the upper 64 bits of the counters.
+  ///
+  /// \param[out] out receives 4*\a count pseudo-random 32-bit words,
+  /// for the counters in order.
+  ///
+  /// \param[in] count is the number of counters.
+  void
+  fill(uint64_t counter, uint64_t stream, uint32_t* out, size_t count) const
+  {
+    const size_t lanes = 8;
+    uint32_t c0[lanes], c1[lanes], c2[lanes], c3[lanes];
+
+    while (count >= lanes) {
+      uint32_t k0 = m_key[0], k1 = m_key[1];
+      for (size_t l = 0; l < lanes; ++l) {
+        c0[l] = (uint32_t) (counter + l);
+        c1[l] = (uint32_t) ((counter + l) >> 32);
+        c2[l] = (uint32_t) stream;
+        c3[l] = (uint32_t) (stream >> 32);
+      }
+      for (int round = 0; round < 10; ++round) {
+        for (size_t l = 0; l < lanes; ++l) {
+          uint64_t p0 = (uint64_t) 0xD2511F53*c0[l];
+          uint64_t p1 = (uint64_t) 0xCD9E8D57*c2[l];
+          uint32_t n0 = (uint32_t) (p1 >> 32) ^ c1[l] ^ k0;
+          uint32_t n2 = (uint32_t) (p0 >> 32) ^ c3[l] ^ k1;
+          c1[l] = (uint32_t) p1;
+          c3[l] = (uint32_t) p0;
+          c0[l] = n0;
+          c2[l] = n2;
+        }
+        k0 += 0x9E3779B9;
+        k1 += 0xBB67AE85;
+      }
+      for (size_t l = 0; l < lanes; ++l) {
+        out[4*l] = c0[l];
+        out[4*l + 1] = c1[l];
+        out[4*l + 2] = c2[l];
+        out[4*l + 3] = c3[l];
+      }
+      out += 4*lanes;
+      counter += lanes;
+      count -= lanes;
+    }
+    for (; count; --count, out += 4)
+      bits(counter++, out, stream);
+  }
+
+private:
+  /// The key.
+  uint32_t m_key[2];
+};
+
+#endif
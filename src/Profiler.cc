@@ -0,0 +1,342 @@
+/* This is file Profiler.cc.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+///
+/// This file defines the Profiler class.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_CLOCK_GETTIME, HAVE_MALLINFO2
+#endif
+
+#include <algorithm>            // for std::sort
+#include <chrono>
+#include <ctime>                // for clock_gettime, clock
+#include <map>
+#if HAVE_MALLINFO2
+# include <malloc.h>            // for mallinfo2
+#endif
+
+#include "Profiler.hh"
+
+/// Returns the number of bytes that are currently allocated from the
+/// heap, or 0 if that cannot be determined.
+static int64_t
+bytes_in_use()
+{
+#if HAVE_MALLINFO2
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+/// Returns the key of a routine.
+static uint64_t
+routine_key(Profiler::Kind kind, int32_t id)
+{
+  return (uint64_t) kind << 32 | (uint32_t) id;
+}
+
+/// Constructor.  The profiler is not yet active.
+Profiler::Profiler()
+  : m_active(false),
+    m_memory(false),
+    m_started{0, 0},
+    m_collected(0)
+{
+  reset();
+}
+
+/// Starts or resumes collecting data.
+///
+/// \param memory says whether to measure the net number of bytes
+/// allocated by routines.  That takes extra time for every call.
+void
+Profiler::start(bool memory)
+{
+  if (m_active)
+    return;
+  m_active = true;
+  m_memory = memory;
+  m_started = now();
+}
+
+/// Stops collecting data.  Routines that have not been left yet are
+/// treated as if they were left now.
+void
+Profiler::stop()
+{
+  if (!m_active)
+    return;
+  leave(0);
+  m_collected += now().wall - m_started.wall;
+  m_active = false;
+}
+
+/// Forgets all collected data.
+void
+Profiler::reset()
+{
+  m_nodes.clear();
+  m_nodes.push_back(Node{0, 0, Statistics(), {}});
+  m_stack.clear();
+  m_lines.clear();
+  m_collected = 0;
+  if (m_active)
+    m_started = now();
+}
+
+/// Returns the current wall-clock time and CPU time.
+Profiler::Moment
+Profiler::now() const
+{
+  Moment m;
+  m.wall = std::chrono::duration<double>
+    (std::chrono::steady_clock::now().time_since_epoch()).count();
+#if HAVE_CLOCK_GETTIME
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  m.cpu = ts.tv_sec + 1e-9*ts.tv_nsec;
+#else
+  m.cpu = (double) clock()/CLOCKS_PER_SEC;
+#endif
+  return m;
+}
+
+/// Records that a routine is entered.
+///
+/// \param kind is the kind of routine.
+///
+/// \param id identifies the routine among those of the same kind.
+///
+/// \param name is the name of the routine.  It is copied the first
+/// time that the routine is called from a particular path.
+///
+/// \returns the depth to pass to leave().
+size_t
+Profiler::enter(Kind kind, int32_t id, char const* name)
+{
+  size_t depth = m_stack.size();
+  if (!m_active)
+    return depth;
+  size_t parent = depth? m_stack.back().node: 0;
+  uint64_t key = routine_key(kind, id);
+  size_t node;
+  auto it = m_nodes[parent].children.find(key);
+  if (it == m_nodes[parent].children.end()) {
+    node = m_nodes.size();
+    m_nodes[parent].children[key] = node;
+    m_nodes.push_back(Node{parent, key, Statistics(), {}});
+    m_nodes[node].statistics.name = name? name: "?";
+  } else
+    node = it->second;
+  m_stack.push_back(Frame{node, now(), 0, 0,
+                          m_memory? bytes_in_use(): 0});
+  return depth;
+}
+
+/// Records that a routine is left.
+///
+/// \param depth is the value returned by the corresponding call of
+/// enter().  Any routines entered since then that were not left (for
+/// example because execution was interrupted) are left too.
+void
+Profiler::leave(size_t depth)
+{
+  while (m_stack.size() > depth)
+    close_frame();
+}
+
+/// Leaves the most recently entered routine.
+void
+Profiler::close_frame()
+{
+  Frame const& frame = m_stack.back();
+  Moment end = now();
+  double wall = end.wall - frame.start.wall;
+  double cpu = end.cpu - frame.start.cpu;
+  Statistics& s = m_nodes[frame.node].statistics;
+  ++s.calls;
+  s.wall += wall;
+  s.cpu += cpu;
+  s.self_wall += wall - frame.child_wall;
+  s.self_cpu += cpu - frame.child_cpu;
+  if (m_memory)
+    s.bytes += bytes_in_use() - frame.bytes;
+  m_stack.pop_back();
+  if (!m_stack.empty()) {
+    m_stack.back().child_wall += wall;
+    m_stack.back().child_cpu += cpu;
+  }
+}
+
+/// Records the execution of a source line.
+///
+/// \param context identifies the routine or file that the line is in.
+///
+/// \param name is the name of the routine or file.  It is copied the
+/// first time that the line is recorded.
+///
+/// \param line is the line number.
+///
+/// \param start is the value of now() when the line started.
+void
+Profiler::line(int32_t context, char const* name, int32_t line,
+               Moment const& start)
+{
+  if (!m_active)
+    return;
+  Moment end = now();
+  uint64_t key = (uint64_t) (uint32_t) context << 32 | (uint32_t) line;
+  LineStatistics& s = m_lines[key];
+  if (!s.count) {
+    s.context = name? name: "?";
+    s.line = line;
+  }
+  ++s.count;
+  s.wall += end.wall - start.wall;
+  s.cpu += end.cpu - start.cpu;
+}
+
+/// Returns the statistics of each routine, summed over all paths
+/// through which it was called, sorted by decreasing time spent in
+/// the routine itself.  Time spent in recursive calls is counted
+/// once in the time with callees.
+std::vector<Profiler::Statistics>
+Profiler::routines() const
+{
+  std::map<uint64_t, Statistics> byKey;
+  for (size_t i = 1; i < m_nodes.size(); ++i) {
+    Node const& node = m_nodes[i];
+    Statistics& s = byKey[node.key];
+    s.name = node.statistics.name;
+    s.calls += node.statistics.calls;
+    s.self_wall += node.statistics.self_wall;
+    s.self_cpu += node.statistics.self_cpu;
+    bool recursive = false;
+    for (size_t j = node.parent; j; j = m_nodes[j].parent)
+      if (m_nodes[j].key == node.key) {
+        recursive = true;
+        break;
+      }
+    if (!recursive) {
+      s.wall += node.statistics.wall;
+      s.cpu += node.statistics.cpu;
+      s.bytes += node.statistics.bytes;
+    }
+  }
+  std::vector<Statistics> result;
+  for (auto const& entry : byKey)
+    result.push_back(entry.second);
+  std::sort(result.begin(), result.end(),
+            [](Statistics const& a, Statistics const& b) {
+              return a.self_wall > b.self_wall;
+            });
+  return result;
+}
+
+/// Returns the statistics of each source line, sorted by decreasing
+/// time.
+std::vector<Profiler::LineStatistics>
+Profiler::lines() const
+{
+  std::vector<LineStatistics> result;
+  for (auto const& entry : m_lines)
+    result.push_back(entry.second);
+  std::sort(result.begin(), result.end(),
+            [](LineStatistics const& a, LineStatistics const& b) {
+              return a.wall > b.wall;
+            });
+  return result;
+}
+
+/// Returns the wall-clock time during which data was collected.
+double
+Profiler::total_wall() const
+{
+  return m_collected + (m_active? now().wall - m_started.wall: 0);
+}
+
+/// Prints a report.
+///
+/// \param out is the stream to print to.
+///
+/// \param count is the maximum number of routines (and lines) to
+/// show.
+///
+/// \param with_lines says whether to show source lines, too.
+void
+Profiler::report(FILE* out, size_t count, bool with_lines) const
+{
+  std::vector<Statistics> r = routines();
+  fprintf(out, "Profile of %.3f s:\n", total_wall());
+  fprintf(out, "%10s %10s %10s %10s %10s %12s  %s\n", "calls", "time",
+          "self", "cpu", "self cpu", m_memory? "bytes": "", "routine");
+  for (size_t i = 0; i < r.size() && i < count; ++i) {
+    fprintf(out, "%10llu %10.4f %10.4f %10.4f %10.4f ",
+            (unsigned long long) r[i].calls, r[i].wall, r[i].self_wall,
+            r[i].cpu, r[i].self_cpu);
+    if (m_memory)
+      fprintf(out, "%12lld", (long long) r[i].bytes);
+    else
+      fprintf(out, "%12s", "");
+    fprintf(out, "  %s\n", r[i].name.c_str());
+  }
+  if (with_lines) {
+    std::vector<LineStatistics> l = lines();
+    fprintf(out, "%10s %10s %10s  %s\n", "count", "time", "cpu", "line");
+    for (size_t i = 0; i < l.size() && i < count; ++i)
+      fprintf(out, "%10llu %10.4f %10.4f  %s:%d\n",
+              (unsigned long long) l[i].count, l[i].wall, l[i].cpu,
+              l[i].context.c_str(), l[i].line);
+  }
+}
+
+/// Returns the semicolon-separated names of the routines on the path
+/// from the root of the call tree to a node.
+std::string
+Profiler::path(size_t node) const
+{
+  std::string result;
+  if (m_nodes[node].parent)
+    result = path(m_nodes[node].parent) + ';';
+  for (char c : m_nodes[node].statistics.name)
+    result += (c == ';' || c == ' ')? '_': c;
+  return result;
+}
+
+/// Writes the call tree in the "collapsed stack" format that flame
+/// graph tools read: one line per path of routine calls, with the
+/// semicolon-separated routine names followed by a space and the time
+/// spent in the last routine itself, in microseconds.
+///
+/// \returns `true` for success, `false` if writing failed.
+bool
+Profiler::write_collapsed(FILE* out) const
+{
+  for (size_t i = 1; i < m_nodes.size(); ++i) {
+    long long us = (long long) (m_nodes[i].statistics.self_wall*1e6 + 0.5);
+    if (us > 0 && fprintf(out, "%s %lld\n", path(i).c_str(), us) < 0)
+      return false;
+  }
+  return !ferror(out);
+}
@@ -0,0 +1,163 @@
+/* This is file Profiler.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_PROFILER_HH
+#define INCLUDED_PROFILER_HH
+
+/// \file
+///
+/// This file declares the Profiler class, which measures where the
+/// time goes in LUX programs.
+
+#include <cstddef>              // for size_t
+#include <cstdint>              // for int32_t, int64_t, uint64_t
+#include <cstdio>               // for FILE
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// An instrumenting profiler.  The interpreter reports when it enters
+/// and leaves routines, and how long statements take.  The profiler
+/// keeps a call tree with the number of calls, the wall-clock time,
+/// the CPU time, and (optionally) the net number of bytes allocated
+/// for each path of routine calls, and the number of executions and
+/// the time of each source line.
+///
+/// Example:
+///
+/// \code
+/// Profiler p;
+/// p.start();
+/// size_t depth = p.enter(Profiler::USER, 17, "FOO");
+/// // ... do the work of FOO ...
+/// p.leave(depth);
+/// p.stop();
+/// p.report(stdout, 20, false);
+/// \endcode
+class Profiler
+{
+public:
+  /// The kinds of routines.
+  enum Kind
+    {
+      USER,                     ///< a user-defined routine
+      FUNCTION,                 ///< an internal function
+      SUBROUTINE,               ///< an internal subroutine
+    };
+
+  /// A moment in time, in seconds.
+  struct Moment
+  {
+    double wall;                ///< the wall-clock time
+    double cpu;                 ///< the CPU time of the process
+  };
+
+  /// Statistics of a routine or a path of routine calls.
+  struct Statistics
+  {
+    std::string name;           ///< the name
+    uint64_t calls = 0;         ///< the number of calls
+    double wall = 0;            ///< the wall-clock time, with callees
+    double self_wall = 0;       ///< the wall-clock time, without callees
+    double cpu = 0;             ///< the CPU time, with callees
+    double self_cpu = 0;        ///< the CPU time, without callees
+    int64_t bytes = 0;          ///< the net bytes allocated, with callees
+  };
+
+  /// Statistics of a source line.
+  struct LineStatistics
+  {
+    std::string context;        ///< the name of the routine or file
+    int32_t line = 0;           ///< the line number
+    uint64_t count = 0;         ///< the number of executions
+    double wall = 0;            ///< the wall-clock time
+    double cpu = 0;             ///< the CPU time
+  };
+
+  Profiler();
+
+  void start(bool memory = false);
+  void stop();
+  void reset();
+
+  /// Is the profiler collecting data?
+  bool active() const { return m_active; }
+
+  size_t enter(Kind kind, int32_t id, char const* name);
+  void leave(size_t depth);
+
+  Moment now() const;
+  void line(int32_t context, char const* name, int32_t line,
+            Moment const& start);
+
+  std::vector<Statistics> routines() const;
+  std::vector<LineStatistics> lines() const;
+  double total_wall() const;
+
+  void report(FILE* out, size_t count, bool with_lines) const;
+  bool write_collapsed(FILE* out) const;
+
+private:
+  /// A node of the call tree.
+  struct Node
+  {
+    size_t parent;              ///< the index of the parent node
+    uint64_t key;               ///< identifies the routine
+    Statistics statistics;      ///< the statistics
+    /// the child nodes, by routine key
+    std::unordered_map<uint64_t, size_t> children;
+  };
+
+  /// A routine that has been entered but not yet left.
+  struct Frame
+  {
+    size_t node;                ///< the index of the node
+    Moment start;               ///< when the routine was entered
+    double child_wall;          ///< the wall-clock time of callees
+    double child_cpu;           ///< the CPU time of callees
+    int64_t bytes;              ///< bytes in use when entered
+  };
+
+  void close_frame();
+  std::string path(size_t node) const;
+
+  /// Is the profiler collecting data?
+  bool m_active;
+
+  /// Is the profiler measuring memory use?
+  bool m_memory;
+
+  /// When collecting started, if active.
+  Moment m_started;
+
+  /// The total wall-clock time spent collecting, for earlier runs.
+  double m_collected;
+
+  /// The nodes of the call tree.  Node 0 is the root.
+  std::vector<Node> m_nodes;
+
+  /// The routines that have been entered but not yet left.
+  std::vector<Frame> m_stack;
+
+  /// The statistics of source lines, by context and line number.
+  std::unordered_map<uint64_t, LineStatistics> m_lines;
+};
+
+#endif
@@ -0,0 +1,529 @@
+/* This is file Reduction.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_REDUCTION_HH
+#define INCLUDED_REDUCTION_HH
+
+/// \file
+///
+/// This file defines the ReductionShape class, which sums values
+/// along some of the dimensions of an array, for functions such as
+/// TOTAL, MEAN, SDEV, VARIANCE, and STATS, and helpers for combining
+/// partial results.
+
+#include <algorithm>            // for std::min, std::max
+#include <cmath>                // for std::isnan
+#include <cstddef>              // for size_t, ptrdiff_t
+#include <cstdint>              // for int32_t
+#include <limits>
+#include <vector>
+
+#include "Parallel.hh"
+
+/// A pair of sums, such as a weighted sum and the sum of the weights,
+/// or a sum and the number of values that went into it.
+///
+/// \tparam T is the type of the sums.
+template<typename T>
+struct WeightedSum
+{
+  T sum;                        //!< The sum of the (weighted) values.
+  T weight;                     //!< The sum of the weights.
+};
+
+/// Adds two WeightedSums.
+///
+/// \param a is the first WeightedSum.
+///
+/// \param b is the second WeightedSum.
+///
+/// \returns the sum.
+template<typename T>
+inline WeightedSum<T>
+operator+(WeightedSum<T> const& a, WeightedSum<T> const& b)
+{
+  return WeightedSum<T>{ a.sum + b.sum, a.weight + b.weight };
+}
+
+/// The number, extremes, mean, and sum of squared deviations from the
+/// mean of a set of values.  Moments of two sets combine into the
+/// moments of their union with `+`, following Chan, Golub, and LeVeque
+/// (1979), "Updating Formulae and a Pairwise Algorithm for Computing
+/// Sample Variances".  A default-constructed instance describes an
+/// empty set.
+struct Moments
+{
+  double count = 0;             //!< The number of values.
+  double min = 0;               //!< The least value.
+  double max = 0;               //!< The greatest value.
+  double mean = 0;              //!< The mean value.
+  double m2 = 0;                //!< The sum of squared deviations from #mean.
+
+  /// Returns the moments of a number of values.  A NaN value makes
+  /// all of the moments except #count NaN.
+  ///
+  /// \param values points at the values.
+  ///
+  /// \param count is the number of values.
+  ///
+  /// \returns the moments.
+  static Moments
+  of(double const* values, size_t count)
+  {
+    Moments result;
+    if (!count)
+      return result;
+    const size_t lanes = 8;
+    double lo[lanes], hi[lanes], sum[lanes] = {};
+    for (size_t k = 0; k < lanes; ++k)
+      lo[k] = hi[k] = values[0];
+    size_t i = 0;
+    for ( ; i + lanes <= count; i += lanes)
+      for (size_t k = 0; k < lanes; ++k) {
+        double x = values[i + k];
+        lo[k] = (x < lo[k])? x: lo[k];
+        hi[k] = (x > hi[k])? x: hi[k];
+        sum[k] += x;
+      }
+    for (size_t k = 0; i < count; ++i, ++k) {
+      double x = values[i];
+      lo[k] = (x < lo[k])? x: lo[k];
+      hi[k] = (x > hi[k])? x: hi[k];
+      sum[k] += x;
+    }
+    result.count = count;
+    result.min = lo[0];
+    result.max = hi[0];
+    for (size_t k = 1; k < lanes; ++k) {
+      result.min = std::min(result.min, lo[k]);
+      result.max = std::max(result.max, hi[k]);
+    }
+    result.mean = (((sum[0] + sum[1]) + (sum[2] + sum[3]))
+                   + ((sum[4] + sum[5]) + (sum[6] + sum[7])))/count;
+    if (std::isnan(result.mean)) {
+      // comparisons with NaN are false, so the extremes may have
+      // missed it
+      for (i = 0; i < count; ++i)
+        if (std::isnan(values[i])) {
+          result.min = result.max = result.mean = result.m2 = values[i];
+          return result;
+        }
+    }
+    double m2[lanes] = {};
+    for (i = 0; i + lanes <= count; i += lanes)
+      for (size_t k = 0; k < lanes; ++k) {
+        double d = values[i + k] - result.mean;
+        m2[k] += d*d;
+      }
+    for (size_t k = 0; i < count; ++i, ++k) {
+      double d = values[i] - result.mean;
+      m2[k] += d*d;
+    }
+    result.m2 = ((m2[0] + m2[1]) + (m2[2] + m2[3]))
+      + ((m2[4] + m2[5]) + (m2[6] + m2[7]));
+    return result;
+  }
+};
+
+/// Combines the moments of two sets of values.
+///
+/// \param a is the moments of the first set.
+///
+/// \param b is the moments of the second set.
+///
+/// \returns the moments of the union of the sets.
+inline Moments
+operator+(Moments const& a, Moments const& b)
+{
+  if (!a.count)
+    return b;
+  if (!b.count)
+    return a;
+  Moments result;
+  result.count = a.count + b.count;
+  if (std::isnan(a.min) || std::isnan(b.min))
+    result.min = result.max = result.mean = result.m2
+      = std::numeric_limits<double>::quiet_NaN();
+  else {
+    result.min = std::min(a.min, b.min);
+    result.max = std::max(a.max, b.max);
+    double delta = b.mean - a.mean;
+    double f = b.count/result.count;
+    result.mean = a.mean + delta*f;
+    result.m2 = a.m2 + b.m2 + delta*delta*a.count*f;
+  }
+  return result;
+}
+
+/// Combines a stream of values pairwise, keeping only a logarithmic
+/// number of partial results.  This is for sums over more values than
+/// fit in memory at once, such as those in file arrays.  The result
+/// depends only on the values and their order.
+///
+/// \tparam A is the type of the values.  It must support `+`.
+template<typename A>
+class PairwiseStream
+{
+public:
+  /// Adds the next value.
+  ///
+  /// \param value is the value.
+  void
+  add(A const& value)
+  {
+    m_partial.push_back(value);
+    m_level.push_back(0);
+    // like carries in a binary counter
+    while (m_level.size() > 1
+           && m_level[m_level.size() - 2] == m_level.back()) {
+      size_t n = m_partial.size();
+      m_partial[n - 2] = m_partial[n - 2] + m_partial[n - 1];
+      ++m_level[n - 2];
+      m_partial.pop_back();
+      m_level.pop_back();
+    }
+  }
+
+  /// Returns the combination of all values added so far.  A
+  /// default-constructed value is returned if there were none.
+  A
+  result() const
+  {
+    if (m_partial.empty())
+      return A{};
+    A result = m_partial.back();
+    for (size_t i = m_partial.size() - 1; i-- > 0; )
+      result = m_partial[i] + result;
+    return result;
+  }
+
+private:
+  std::vector<A> m_partial;     //!< The partial results.
+  std::vector<int> m_level;     //!< The tree level of each partial result.
+};
+
+/// Describes a reduction of an array along some of its dimensions,
+/// and sums values along those dimensions.
+///
+/// The dimensions are those of a LoopInfo after standardLoop() with
+/// `SL_AXESBLOCK`: the first \a naxes dimensions are summed over, and
+/// each combination of the remaining coordinates yields one output.
+/// Outputs are numbered in the order in which LoopInfo::advanceLoop()
+/// visits them.
+///
+/// The sum for an output is calculated the same way every time: the
+/// values are taken in consecutive blocks of #block_size values, each
+/// block is added up in #lanes interleaved partial sums (which the
+/// compiler can map onto SIMD registers), and the partial sums and
+/// then the block sums are combined pairwise.  The rounding error then
+/// grows only slowly with the number of values.  Blocks or outputs are
+/// shared out over threads (see #parallel_for), but which values are
+/// added together in which order does not depend on the number of
+/// threads, so the results do not either.
+///
+/// Example:
+///
+/// \code
+/// ReductionShape shape(srcinfo.rndim, srcinfo.rdims, srcinfo.rsinglestep,
+///                      srcinfo.naxes);
+/// shape.for_each_output([&](size_t k) {
+///   tgt[k] = shape.reduce<double>(k, [src](ptrdiff_t i) {
+///     return (double) src[i];
+///   });
+/// });
+/// \endcode
+class ReductionShape
+{
+public:
+  /// The number of values that are summed together before the result
+  /// is combined with those of other blocks.
+  static const size_t block_size = 1024;
+
+  /// The number of interleaved partial sums per block.
+  static const size_t lanes = 8;
+
+  /// The least number of values per thread that makes it worthwhile
+  /// to start another thread.
+  static const size_t min_per_thread = 1 << 15;
+
+  /// Constructor.
+  ///
+  /// \param ndim is the number of dimensions.
+  ///
+  /// \param dims points at the \a ndim dimensions.
+  ///
+  /// \param steps points at the \a ndim step sizes (in elements) of
+  /// the dimensions.
+  ///
+  /// \param naxes is the number of leading dimensions to sum over.
+  ReductionShape(int32_t ndim, int32_t const* dims, int32_t const* steps,
+                 int32_t naxes)
+    : m_dims(dims, dims + ndim),
+      m_steps(steps, steps + ndim),
+      m_naxes(std::min(std::max(naxes, 1), std::max(ndim, 1))),
+      m_length(1),
+      m_outputs(1)
+  {
+    if (m_dims.empty()) {
+      m_dims.push_back(1);
+      m_steps.push_back(1);
+    }
+    for (size_t i = 0; i < m_dims.size(); ++i)
+      (i < m_naxes? m_length: m_outputs) *= m_dims[i];
+    m_output_threads
+      = (m_outputs > 1)
+      ? parallel_thread_count(m_outputs,
+                              std::max(min_per_thread/std::max(m_length,
+                                                               (size_t) 1),
+                                       (size_t) 1))
+      : 1;
+  }
+
+  /// Returns the number of outputs.
+  size_t outputs() const { return m_outputs; }
+
+  /// Returns the number of values that go into each output.
+  size_t length() const { return m_length; }
+
+  /// Returns the offset (in elements) of the first value for an
+  /// output.
+  ///
+  /// \param output is the index of the output.
+  ///
+  /// \returns the offset.
+  ptrdiff_t
+  offset(size_t output) const
+  {
+    ptrdiff_t result = 0;
+    for (size_t i = m_naxes; i < m_dims.size() && output; ++i) {
+      result += (ptrdiff_t) (output % m_dims[i])*m_steps[i];
+      output /= m_dims[i];
+    }
+    return result;
+  }
+
+  /// Calls a function for each output, spread over threads if there
+  /// are enough outputs to make that worthwhile.  The function must
+  /// not touch interpreter state.
+  ///
+  /// \tparam F is the type of the function.
+  ///
+  /// \param f is the function, which is called with the index of the
+  /// output.
+  template<typename F>
+  void
+  for_each_output(F f) const
+  {
+    parallel_chunks(m_output_threads, m_outputs,
+                    [&f](size_t, size_t begin, size_t end) {
+                      for (size_t k = begin; k < end; ++k)
+                        f(k);
+                    });
+  }
+
+  /// Returns the sum of values for an output.  If the outputs are not
+  /// already spread over threads, then the blocks of this output are.
+  ///
+  /// \tparam A is the type of the sum.  It must be default-constructible
+  /// to zero and support `+`.
+  ///
+  /// \tparam F is the type of the function that returns the values.
+  ///
+  /// \param output is the index of the output.
+  ///
+  /// \param value is the function that returns the value to add for
+  /// an element.  It is called with the offset (in elements) of the
+  /// element from the start of the array, possibly from several
+  /// threads at once.
+  ///
+  /// \returns the sum.
+  template<typename A, typename F>
+  A
+  reduce(size_t output, F value) const
+  {
+    return reduce_blocks<A>(output, [this, &value](size_t output,
+                                                  size_t begin, size_t end) {
+      A lane[lanes] = {};
+      for_each_run(output, begin, end,
+                   [&lane, &value](ptrdiff_t offset, ptrdiff_t step,
+                                   size_t count) {
+                     if (step == 1)
+                       add_run<A, true>(lane, offset, step, count, value);
+                     else
+                       add_run<A, false>(lane, offset, step, count, value);
+                   });
+      return pairwise(lane, lanes);
+    });
+  }
+
+  /// Combines results for the blocks of an output pairwise.  If the
+  /// outputs are not already spread over threads, then the blocks of
+  /// this output are.
+  ///
+  /// \tparam A is the type of the result.  It must support `+`,
+  /// which need not be commutative but must be associative (at least
+  /// approximately).
+  ///
+  /// \tparam F is the type of the function that calculates the result
+  /// for a block.
+  ///
+  /// \param output is the index of the output.
+  ///
+  /// \param block is the function that calculates the result for a
+  /// block.  It is called with the index of the output and the range
+  /// of indices of the values in the block, which spans at most
+  /// #block_size values, possibly from several threads at once.  Use
+  /// #for_each_run to visit the values.
+  ///
+  /// \returns the combined result.
+  template<typename A, typename F>
+  A
+  reduce_blocks(size_t output, F block) const
+  {
+    size_t nblocks = (m_length + block_size - 1)/block_size;
+    if (nblocks <= 1)
+      return block(output, 0, m_length);
+    std::vector<A> partial(nblocks);
+    auto blocks = [&](size_t begin, size_t end) {
+      for (size_t b = begin; b < end; ++b)
+        partial[b] = block(output, b*block_size,
+                           std::min((b + 1)*block_size, m_length));
+    };
+    if (m_output_threads > 1)
+      blocks(0, nblocks);
+    else
+      parallel_for(nblocks, min_per_thread/block_size, blocks);
+    return pairwise(partial.data(), nblocks);
+  }
+
+  /// Visits a range of the values of an output, in runs of equally
+  /// spaced values.
+  ///
+  /// \tparam F is the type of the function to call for each run.
+  ///
+  /// \param output is the index of the output.
+  ///
+  /// \param begin is the index of the first value to visit.
+  ///
+  /// \param end is one more than the index of the last value to
+  /// visit.
+  ///
+  /// \param f is the function, which is called with the offset (in
+  /// elements) of the first value of the run from the start of the
+  /// array, the step size between the values, and the number of
+  /// values in the run.
+  template<typename F>
+  void
+  for_each_run(size_t output, size_t begin, size_t end, F f) const
+  {
+    ptrdiff_t base = offset(output);
+    size_t row_length = m_dims[0];
+    ptrdiff_t step = m_steps[0];
+    while (begin < end) {
+      size_t row = begin/row_length;
+      size_t column = begin % row_length;
+      size_t count = std::min(end - begin, row_length - column);
+      f(base + row_offset(row) + (ptrdiff_t) column*step, step, count);
+      begin += count;
+    }
+  }
+
+  /// Returns the sum of a number of values, adding them pairwise.
+  ///
+  /// \tparam A is the type of the values.
+  ///
+  /// \param values points at the values.
+  ///
+  /// \param count is the number of values.  It must be at least 1.
+  ///
+  /// \returns the sum.
+  template<typename A>
+  static A
+  pairwise(A const* values, size_t count)
+  {
+    if (count == 1)
+      return values[0];
+    size_t half = count/2;
+    return pairwise(values, half) + pairwise(values + half, count - half);
+  }
+
+private:
+  /// Returns the offset (in elements) of a row, relative to the first
+  /// value of its output.  A row is a run of values along the first
+  /// dimension.
+  ///
+  /// \param row is the index of the row.
+  ///
+  /// \returns the offset.
+  ptrdiff_t
+  row_offset(size_t row) const
+  {
+    ptrdiff_t result = 0;
+    for (size_t i = 1; i < m_naxes && row; ++i) {
+      result += (ptrdiff_t) (row % m_dims[i])*m_steps[i];
+      row /= m_dims[i];
+    }
+    return result;
+  }
+
+  /// Adds a run of equally spaced values to the partial sums.
+  ///
+  /// \tparam A is the type of the sums.
+  ///
+  /// \tparam unit says whether the values are adjacent.  Then the
+  /// compiler knows the step size and can vectorize the loop.
+  ///
+  /// \tparam F is the type of the function that returns the values.
+  ///
+  /// \param lane points at the #lanes partial sums.
+  ///
+  /// \param offset is the offset of the first value.
+  ///
+  /// \param step is the step size between the values.
+  ///
+  /// \param count is the number of values.
+  ///
+  /// \param value is the function that returns the values.
+  template<typename A, bool unit, typename F>
+  static void
+  add_run(A* lane, ptrdiff_t offset, ptrdiff_t step, size_t count,
+          F& value)
+  {
+    if (unit)
+      step = 1;
+    size_t i = 0;
+    for ( ; i + lanes <= count; i += lanes, offset += lanes*step)
+      for (size_t k = 0; k < lanes; ++k)
+        lane[k] = lane[k] + value(offset + (ptrdiff_t) k*step);
+    for (size_t k = 0; i < count; ++i, ++k)
+      lane[k] = lane[k] + value(offset + (ptrdiff_t) k*step);
+  }
+
+  std::vector<int32_t> m_dims;  //!< The dimensions.
+  std::vector<int32_t> m_steps; //!< The step sizes of the dimensions.
+  size_t m_naxes;               //!< The number of dimensions to sum over.
+  size_t m_length;              //!< The number of values per output.
+  size_t m_outputs;             //!< The number of outputs.
+
+  /// The number of threads over which the outputs are spread.
+  size_t m_output_threads;
+};
+
+#endif
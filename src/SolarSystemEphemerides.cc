@@ -3,6 +3,8 @@
 #if HAVE_LIBSOFA_C
 # include <algorithm>
 # include <cmath>
+# include <cstdio>
+# include <cstring>             // for memcmp
 # include <calceph.h>
 # include <sofa.h>
 # include "SolarSystemEphemerides.hh"
@@ -13,6 +15,9 @@ void astropos(double JD, int target_object, int observer_object, double xyz[3]);
 /// The default length unit is LengthUnit::AU (Astronomical Unit).
 SolarSystemEphemerides::SolarSystemEphemerides()
   : m_angle_unit(),
+    m_cache_accuracy_AU(1e-10),
+    m_cache_enabled(false),
+    m_cache_segment_days(8),
     m_coordinate_system(),
     m_custom_angle_unit_rad(1),
     m_custom_length_unit_m(1),
@@ -134,6 +139,127 @@ SolarSystemEphemerides::set_equinox(double JD)
   return *this;
 }
 
+/// Makes subsequent ephemerides come from a cache of Chebyshev polynomial
+/// approximations.  Each combination of target, observer, coordinate system,
+/// and equinox gets its own cache.  A segment of the cache is calculated from
+/// about 20 to 70 exact positions the first time that a date in it is
+/// requested.  After that, ephemerides for dates in that segment take only a
+/// polynomial evaluation.  This pays off when many dates per segment are
+/// requested.
+///
+/// \param segment_days is the length of the segments, in days.  Segments that
+/// are too long for the requested accuracy get polynomials of the highest
+/// degree, and are less accurate than requested.  Segments of 8 days are fine
+/// for the planets.  The Moon needs shorter segments.
+///
+/// \param accuracy_AU is the desired accuracy of the cartesian coordinates, in
+/// AU.  The rounding of Julian Day numbers limits the attainable accuracy to
+/// about 1e-11 AU.
+///
+/// \returns a reference to the current object.
+SolarSystemEphemerides&
+SolarSystemEphemerides::enable_cache(double segment_days, double accuracy_AU)
+{
+  if (segment_days != m_cache_segment_days
+      || accuracy_AU != m_cache_accuracy_AU) {
+    m_caches.clear();
+    m_cache_segment_days = segment_days;
+    m_cache_accuracy_AU = accuracy_AU;
+  }
+  m_cache_enabled = true;
+  return *this;
+}
+
+/// Makes subsequent ephemerides be calculated exactly, and forgets the cache.
+///
+/// \returns a reference to the current object.
+SolarSystemEphemerides&
+SolarSystemEphemerides::disable_cache()
+{
+  m_cache_enabled = false;
+  m_caches.clear();
+  return *this;
+}
+
+/// Writes the cache to a binary file, so that load_cache() can read it back
+/// in a later session.  The file is not portable between machines with
+/// different byte orders.
+///
+/// \param file is the name of the file.
+///
+/// \returns `true` for success, `false` for failure.
+bool
+SolarSystemEphemerides::save_cache(char const* file) const
+{
+  FILE* fp = fopen(file, "wb");
+  if (!fp)
+    return false;
+  uint32_t count = m_caches.size();
+  bool ok = fwrite("LUXSSEC1", 8, 1, fp) == 1
+    && fwrite(&count, sizeof(count), 1, fp) == 1;
+  for (auto it = m_caches.begin(); ok && it != m_caches.end(); ++it) {
+    int32_t key[4] = { static_cast<int32_t>(std::get<0>(it->first)),
+                       static_cast<int32_t>(std::get<1>(it->first)),
+                       static_cast<int32_t>(std::get<2>(it->first)),
+                       static_cast<int32_t>(std::get<3>(it->first)) };
+    double equinox_JD = std::get<4>(it->first);
+    ok = fwrite(key, sizeof(key), 1, fp) == 1
+      && fwrite(&equinox_JD, sizeof(equinox_JD), 1, fp) == 1
+      && it->second.write(fp);
+  }
+  if (fclose(fp))
+    ok = false;
+  return ok;
+}
+
+/// Reads a cache written by save_cache(), and enables the cache with the
+/// segment length and accuracy of the cache that was read.
+///
+/// \param file is the name of the file.
+///
+/// \returns `true` for success, `false` for failure.  In case of failure the
+/// current cache is not changed.
+bool
+SolarSystemEphemerides::load_cache(char const* file)
+{
+  FILE* fp = fopen(file, "rb");
+  if (!fp)
+    return false;
+  std::map<CacheKey, ChebyshevEphemeris> caches;
+  double segment_days = m_cache_segment_days;
+  double accuracy_AU = m_cache_accuracy_AU;
+  char magic[8];
+  uint32_t count;
+  bool ok = fread(magic, sizeof(magic), 1, fp) == 1
+    && !memcmp(magic, "LUXSSEC1", sizeof(magic))
+    && fread(&count, sizeof(count), 1, fp) == 1;
+  while (ok && count--) {
+    int32_t key[4];
+    double equinox_JD;
+    ChebyshevEphemeris cache;
+    ok = fread(key, sizeof(key), 1, fp) == 1
+      && fread(&equinox_JD, sizeof(equinox_JD), 1, fp) == 1
+      && cache.read(fp);
+    if (ok) {
+      segment_days = cache.segment_length();
+      accuracy_AU = cache.accuracy();
+      caches[CacheKey(static_cast<SolarSystemObject>(key[0]),
+                      static_cast<SolarSystemObject>(key[1]),
+                      static_cast<CoordinateSystem>(key[2]),
+                      static_cast<Equinox>(key[3]), equinox_JD)]
+        = std::move(cache);
+    }
+  }
+  fclose(fp);
+  if (ok) {
+    m_caches = std::move(caches);
+    m_cache_segment_days = segment_days;
+    m_cache_accuracy_AU = accuracy_AU;
+    m_cache_enabled = true;
+  }
+  return ok;
+}
+
 /// Returns the 3-dimensional cartesian (x, y, z) geocentric coordinates of a
 /// Solar System object.
 ///
@@ -166,7 +292,7 @@ SolarSystemEphemerides::cartesian_heliocentric(double JD,
 
 /// Returns the 3-dimensional cartesian (x, y, z) coordinates of a Solar System
 /// object relative to another one, without transforming them to the desired
-/// units.
+/// units.  If the cache is enabled, then the coordinates come from the cache.
 ///
 /// \param JD is the Julian Day number for which the position is desired.
 ///
@@ -181,6 +307,39 @@ SolarSystemEphemerides::Coords3
 SolarSystemEphemerides::cartesian_bare_units(double JD,
                                              SolarSystemObject target,
                                              SolarSystemObject observer) const {
+  if (!m_cache_enabled)
+    return cartesian_bare_units_uncached(JD, target, observer);
+
+  CacheKey key(target, observer, m_coordinate_system, m_equinox,
+               m_equinox_JD);
+  auto it = m_caches.find(key);
+  if (it == m_caches.end())
+    it = m_caches.emplace(key,
+                          ChebyshevEphemeris(m_cache_segment_days,
+                                             m_cache_accuracy_AU,
+                                             AstronomicalConstants::J2000))
+      .first;
+  return it->second(JD, [&](double t) {
+      return cartesian_bare_units_uncached(t, target, observer);
+    });
+}
+
+/// Returns the 3-dimensional cartesian (x, y, z) coordinates of a Solar System
+/// object relative to another one, without transforming them to the desired
+/// units, and without consulting the cache.
+///
+/// \param JD is the Julian Day number for which the position is desired.
+///
+/// \param target identifies the target object.
+///
+/// \param observer identifies the object where the observer resides (in the
+/// center).
+///
+/// \returns the cartesian coordinates coordinates of the target object relative
+/// to the observer.
+SolarSystemEphemerides::Coords3
+SolarSystemEphemerides::cartesian_bare_units_uncached
+(double JD, SolarSystemObject target, SolarSystemObject observer) const {
   Coords3 result;
 
   astropos(JD, static_cast<int>(target), static_cast<int>(observer),
@@ -4,6 +4,8 @@
 // standard includes
 
 #include <array>
+#include <map>
+#include <tuple>
 
 // our features include
 #include "config.h"
@@ -11,6 +13,7 @@
 // our includes
 
 #include "AstronomicalConstants.hh"
+#include "ChebyshevEphemeris.hh"
 
 /// An enumeration of Solar System objects and (planetary) systems.  Names
 /// without a suffix represent the barycenter of the named object.  Names with
@@ -84,6 +87,10 @@ public:
   SolarSystemEphemerides& set_equinox(double JD);
   SolarSystemEphemerides& set_length_unit(LengthUnit unit);
   SolarSystemEphemerides& set_length_unit(double unit_m);
+  SolarSystemEphemerides& enable_cache(double segment_days = 8,
+                                       double accuracy_AU = 1e-10);
+  SolarSystemEphemerides& disable_cache();
+  bool load_cache(char const* file);
 
   // const members
 
@@ -97,9 +104,22 @@ public:
     const;
   Coords3 polar_geocentric(double JD, SolarSystemObject target) const;
   Coords3 polar_heliocentric(double JD, SolarSystemObject target) const;
+  bool save_cache(char const* file) const;
 
 private:
+  /// Identifies a cache of ephemerides: the target, the observer, the
+  /// coordinate system, the equinox, and the Julian Day of the equinox.
+  typedef std::tuple<SolarSystemObject, SolarSystemObject, CoordinateSystem,
+                     Equinox, double> CacheKey;
+
+  Coords3 cartesian_bare_units_uncached(double JD, SolarSystemObject target,
+                                        SolarSystemObject observer) const;
+
   AngleUnit        m_angle_unit;
+  double           m_cache_accuracy_AU;
+  bool             m_cache_enabled;
+  double           m_cache_segment_days;
+  mutable std::map<CacheKey, ChebyshevEphemeris> m_caches;
   CoordinateSystem m_coordinate_system;
   mutable double   m_coordinate_transform[3][3];
   double           m_custom_angle_unit_rad;
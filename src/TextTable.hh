@@ -0,0 +1,445 @@
+/* This is file TextTable.hh.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_TEXTTABLE_HH
+#define INCLUDED_TEXTTABLE_HH
+
+/// \file
+///
+/// This file defines the TextTable class, which parses a table of
+/// numbers stored as text, such as a CSV file, using several threads.
+
+#include <algorithm>            // for std::max
+#include <charconv>             // for std::from_chars
+#include <cmath>                // for NAN
+#include <cstdint>              // for int32_t, int64_t, SIZE_MAX
+#include <cstring>              // for memchr
+#include <limits>
+#include <vector>
+
+#include "Parallel.hh"
+
+/// A table of numbers stored as text, with one row per line.
+///
+/// The fields on a line are separated by a comma or semicolon with
+/// optional whitespace around it, or by whitespace alone.  Two commas
+/// or semicolons with nothing but whitespace between them enclose an
+/// empty field.  Lines that are empty or whose first non-whitespace
+/// character is `#` are skipped.  The number of columns is the number
+/// of fields on the first row.
+///
+/// Each column gets the narrowest of the kinds Int32, Int64, and Double
+/// that can hold all of its values.  Empty fields, fields that are not
+/// numbers, and fields missing from short rows are read as NaN, so they
+/// make their column a Double column.
+///
+/// The text is cut into chunks of whole lines, and the chunks are
+/// scanned by different threads: once when the TextTable is
+/// constructed, to count the rows and find the kinds of the columns,
+/// and once more by read(), to parse the values into their targets.
+///
+/// Example, reading the first two columns of a table into arrays of
+/// doubles:
+///
+/// \code
+/// TextTable table(text, size);
+/// std::vector<double> x(table.rows()), y(table.rows());
+/// size_t columns[] = { 0, 1 };
+/// TextTable::Target targets[] = { { x.data(), TextTable::Double, 1 },
+///                                 { y.data(), TextTable::Double, 1 } };
+/// table.read(columns, targets, 2);
+/// \endcode
+class TextTable
+{
+public:
+  /// The kinds of column values, from narrow to wide.
+  enum Kind : uint8_t { Int32, Int64, Double };
+
+  /// Where to put the values of a column.
+  struct Target
+  {
+    void* data;                 //!< Where the value of the first row goes.
+    Kind kind;                  //!< The kind of the values at #data.
+    size_t stride;              //!< The step between rows, in values.
+  };
+
+  /// Constructor.  Scans the text for rows and columns.
+  ///
+  /// \param text points at the text.  It must remain available for as
+  /// long as the TextTable is used.
+  ///
+  /// \param size is the number of characters in the text.
+  ///
+  /// \param skip is the number of lines to skip at the start of the
+  /// text, whatever their contents.
+  ///
+  /// \param maxrows is the greatest number of rows to read.
+  TextTable(char const* text, size_t size, size_t skip = 0,
+            size_t maxrows = SIZE_MAX)
+    : m_columns(0), m_rows(0)
+  {
+    char const* begin = text;
+    char const* end = text + size;
+    while (skip-- && begin < end)
+      begin = next_line(begin, end);
+    if (maxrows != SIZE_MAX) {
+      // find the end of the last wanted row
+      char const* p = begin;
+      size_t n = 0;
+      while (n < maxrows && p < end) {
+        char const* q = next_line(p, end);
+        if (!is_skipped(p, q))
+          ++n;
+        p = q;
+      }
+      end = p;
+    }
+
+    // cut the text into chunks of whole lines
+    size_t nchunks = parallel_thread_count(end - begin, min_chunk_size);
+    m_chunks.resize(nchunks);
+    char const* p = begin;
+    for (size_t k = 0; k < nchunks; ++k) {
+      m_chunks[k].begin = p;
+      if (k + 1 < nchunks)
+        p = std::max(p, next_line(begin + (end - begin)*(k + 1)/nchunks,
+                                  end));
+      else
+        p = end;
+      m_chunks[k].end = p;
+    }
+
+    parallel_chunks(nchunks, nchunks, [this](size_t, size_t first,
+                                             size_t last) {
+      for (size_t k = first; k < last; ++k)
+        scan(m_chunks[k]);
+    });
+
+    // combine the chunks
+    for (Chunk& chunk : m_chunks) {
+      if (chunk.rows && !m_rows)
+        m_columns = chunk.first_fields;
+      chunk.first_row = m_rows;
+      m_rows += chunk.rows;
+    }
+    m_kinds.assign(m_columns, Int32);
+    for (Chunk const& chunk : m_chunks) {
+      if (!chunk.rows)
+        continue;
+      for (size_t c = 0; c < m_columns; ++c)
+        if (c >= chunk.min_fields)
+          m_kinds[c] = Double;  // some rows lack this column
+        else
+          m_kinds[c] = std::max(m_kinds[c], chunk.kinds[c]);
+    }
+  }
+
+  /// Returns the number of rows.
+  size_t rows() const { return m_rows; }
+
+  /// Returns the number of columns.
+  size_t columns() const { return m_columns; }
+
+  /// Returns the kind of a column.
+  ///
+  /// \param column is the index of the column.
+  Kind kind(size_t column) const { return m_kinds[column]; }
+
+  /// Parses columns into their targets.
+  ///
+  /// \param columns points at the indices of the columns to parse.
+  /// Each index must be less than columns().  A column that is listed
+  /// more than once is parsed into each of its targets.
+  ///
+  /// \param targets points at the targets, one for each column.  A
+  /// target must have room for rows() values, spaced by its stride.
+  /// The kind of a target may differ from the kind of its column.
+  ///
+  /// \param n is the number of columns.
+  void
+  read(size_t const* columns, Target const* targets, size_t n) const
+  {
+    // the first target that each field goes to, if any, and the next
+    // target of the same column after each target
+    std::vector<ptrdiff_t> slot(m_columns, -1);
+    std::vector<ptrdiff_t> next(n, -1);
+    for (size_t i = n; i-- > 0; ) {
+      next[i] = slot[columns[i]];
+      slot[columns[i]] = i;
+    }
+
+    parallel_chunks(m_chunks.size(), m_chunks.size(),
+                    [&](size_t, size_t first, size_t last) {
+      for (size_t k = first; k < last; ++k) {
+        size_t row = m_chunks[k].first_row;
+        for_each_row(m_chunks[k].begin, m_chunks[k].end,
+                     [&](char const* line, char const* line_end) {
+          size_t nfields = for_each_field(line, line_end,
+                                          [&](size_t f, char const* b,
+                                              char const* e) {
+            if (f < m_columns)
+              for (ptrdiff_t t = slot[f]; t >= 0; t = next[t])
+                store(targets[t], row, b, e);
+          });
+          // fields missing from short rows
+          for (size_t f = nfields; f < m_columns; ++f)
+            for (ptrdiff_t t = slot[f]; t >= 0; t = next[t])
+              store(targets[t], row, nullptr, nullptr);
+          ++row;
+        });
+      }
+    });
+  }
+
+  /// Returns the narrowest kind that can hold the value of a field.
+  ///
+  /// \param begin points at the first character of the field.
+  ///
+  /// \param end points just beyond the last character of the field.
+  static Kind
+  classify(char const* begin, char const* end)
+  {
+    char const* p = begin;
+    if (p < end && (*p == '-' || *p == '+'))
+      ++p;
+    if (p == end)
+      return Double;            // empty, or only a sign
+    for (char const* q = p; q < end; ++q)
+      if (*q < '0' || *q > '9')
+        return Double;
+    if (end - p <= 9)
+      return Int32;
+    int64_t value;
+    if (!parse(begin, end, value))
+      return Double;            // too large for 64 bits
+    return (value >= std::numeric_limits<int32_t>::min()
+            && value <= std::numeric_limits<int32_t>::max())? Int32: Int64;
+  }
+
+  /// Parses a field.
+  ///
+  /// \tparam T is the type of the value.
+  ///
+  /// \param begin points at the first character of the field.
+  ///
+  /// \param end points just beyond the last character of the field.
+  ///
+  /// \param value receives the value.
+  ///
+  /// \returns `true` if the whole field was a valid number of type \a
+  /// T, `false` otherwise.
+  template<typename T>
+  static bool
+  parse(char const* begin, char const* end, T& value)
+  {
+    if (begin < end && *begin == '+'
+        && !(end - begin > 1 && (begin[1] == '-' || begin[1] == '+')))
+      ++begin;                  // from_chars does not accept '+'
+    auto result = std::from_chars(begin, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+  }
+
+  /// Calls a function for each field on a line.
+  ///
+  /// \tparam F is the type of the callable.
+  ///
+  /// \param p points at the start of the line.
+  ///
+  /// \param end points at the end of the line, not including the line
+  /// terminator.
+  ///
+  /// \param f is the callable.  It is called as `f(index, begin,
+  /// field_end)` for each field, with `index` counting from 0.
+  ///
+  /// \returns the number of fields.
+  template<typename F>
+  static size_t
+  for_each_field(char const* p, char const* end, F f)
+  {
+    size_t index = 0;
+    p = skip_blanks(p, end);
+    while (p < end) {
+      char const* b = p;
+      while (p < end && !is_separator(*p))
+        ++p;
+      f(index++, b, p);
+      p = skip_blanks(p, end);
+      if (p < end && (*p == ',' || *p == ';')) {
+        p = skip_blanks(p + 1, end);
+        if (p == end)
+          f(index++, p, p);     // empty last field
+      }
+    }
+    return index;
+  }
+
+private:
+  /// The least number of characters worth giving to a separate thread.
+  static const size_t min_chunk_size = 1 << 20;
+
+  /// A range of lines, processed by a single thread.
+  struct Chunk
+  {
+    char const* begin = nullptr; //!< The first character.
+    char const* end = nullptr;  //!< Just beyond the last character.
+    size_t rows = 0;            //!< The number of rows.
+    size_t first_row = 0;       //!< The index of the first row.
+    size_t first_fields = 0;    //!< The number of fields on the first row.
+    size_t min_fields = 0;      //!< The least number of fields on a row.
+    std::vector<Kind> kinds;    //!< The kind of each field.
+  };
+
+  /// Returns the start of the line after the one at \a p, or \a end.
+  static char const*
+  next_line(char const* p, char const* end)
+  {
+    char const* q = (char const*) memchr(p, '\n', end - p);
+    return q? q + 1: end;
+  }
+
+  /// Returns `true` if \a c is a space or tab.
+  static bool is_blank(char c) { return c == ' ' || c == '\t'; }
+
+  /// Returns `true` if \a c ends a field.
+  static bool
+  is_separator(char c)
+  {
+    return is_blank(c) || c == ',' || c == ';';
+  }
+
+  /// Returns the first position at or after \a p that is not a blank,
+  /// or \a end.
+  static char const*
+  skip_blanks(char const* p, char const* end)
+  {
+    while (p < end && is_blank(*p))
+      ++p;
+    return p;
+  }
+
+  /// Returns `true` if the line from \a p up to \a end is not a row:
+  /// it is empty or a comment.
+  static bool
+  is_skipped(char const* p, char const* end)
+  {
+    p = skip_blanks(p, end);
+    return p == end || *p == '\n' || *p == '\r' || *p == '#';
+  }
+
+  /// Calls a function for each row between \a begin and \a end, as
+  /// `f(line, line_end)`, where `line_end` excludes the line terminator.
+  template<typename F>
+  static void
+  for_each_row(char const* begin, char const* end, F f)
+  {
+    while (begin < end) {
+      char const* next = next_line(begin, end);
+      if (!is_skipped(begin, next)) {
+        char const* e = next;
+        if (e > begin && e[-1] == '\n')
+          --e;
+        if (e > begin && e[-1] == '\r')
+          --e;
+        f(begin, e);
+      }
+      begin = next;
+    }
+  }
+
+  /// Counts the rows of a chunk and finds the kinds of their fields.
+  static void
+  scan(Chunk& chunk)
+  {
+    chunk.min_fields = SIZE_MAX;
+    for_each_row(chunk.begin, chunk.end,
+                 [&chunk](char const* line, char const* line_end) {
+      size_t nfields = for_each_field(line, line_end,
+                                      [&chunk](size_t f, char const* b,
+                                               char const* e) {
+        if (f >= chunk.kinds.size())
+          chunk.kinds.resize(f + 1, Int32);
+        if (chunk.kinds[f] != Double)
+          chunk.kinds[f] = std::max(chunk.kinds[f], classify(b, e));
+      });
+      if (!chunk.rows)
+        chunk.first_fields = nfields;
+      chunk.min_fields = std::min(chunk.min_fields, nfields);
+      ++chunk.rows;
+    });
+  }
+
+  /// Parses a field into a target.  Fields that are not valid numbers
+  /// of the kind of the target yield NaN for Double targets, and 0
+  /// otherwise.
+  ///
+  /// \param target is the target.
+  ///
+  /// \param row is the index of the row.
+  ///
+  /// \param b points at the first character of the field, or is
+  /// `nullptr` for a missing field.
+  ///
+  /// \param e points just beyond the last character of the field.
+  static void
+  store(Target const& target, size_t row, char const* b, char const* e)
+  {
+    size_t i = row*target.stride;
+    switch (target.kind) {
+      case Int32:
+        {
+          int32_t value = 0;
+          if (b && !parse(b, e, value))
+            value = 0;
+          static_cast<int32_t*>(target.data)[i] = value;
+        }
+        break;
+      case Int64:
+        {
+          int64_t value = 0;
+          if (b && !parse(b, e, value))
+            value = 0;
+          static_cast<int64_t*>(target.data)[i] = value;
+        }
+        break;
+      case Double:
+        {
+          double value = NAN;
+          if (b && !parse(b, e, value))
+            value = NAN;
+          static_cast<double*>(target.data)[i] = value;
+        }
+        break;
+    }
+  }
+
+  /// The chunks of the text.
+  std::vector<Chunk> m_chunks;
+
+  /// The kind of each column.
+  std::vector<Kind> m_kinds;
+
+  /// The number of columns.
+  size_t m_columns;
+
+  /// The number of rows.
+  size_t m_rows;
+};
+
+#endif
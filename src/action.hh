@@ -190,6 +190,7 @@ void freeString(int32_t);
 void mark(int32_t);
 void newStack(int32_t);
 void pegMark(void);
+void preExtractToExtract(int32_t, int32_t);
 void printw(char const*);
 void printwf(char const*, ...);
 void protect(int32_t*, int32_t);
@@ -74,6 +74,9 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <algorithm>
 #include <limits>
+#include <map>
+#include <set>
+#include <vector>
 
 #include <assert.h>
 #include <ctype.h>
@@ -86,7 +89,10 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 #include "config.h"
 
 #include "AstronomicalConstants.hh"
+#include "ChebyshevEphemeris.hh"
 #include "Ellipsoid.hh"
+#include "EpochCache.hh"
+#include "Parallel.hh"
 #include "Rotate3d.hh"
 #include "action.hh"
 #include "astrodat2.hh"
@@ -254,6 +260,7 @@ void LBRtoXYZ(double *pos, double *pos2);
 void XYZtoLBR(double *, double *);
 #if HAVE_LIBGSL
 void XYZ_eclipticPrecession(double *pos, double equinox1, double equinox2);
+EpochCache<2, std::array<double, 9>>& XYZ_eclipticPrecessionCache(void);
 #endif
 
 int32_t idiv(int32_t x, int32_t y)
@@ -881,10 +888,8 @@ int32_t lux_calendar(ArgumentCount narg, Symbol ps[])
     = cal_data[fromcalendar].CaltoCJDN;
   void (*CaltoCJD)(double const *date, double *CJDN)
     = cal_data[fromcalendar].CaltoCJD;
-  /*
-    void (*CalStoCJDN)(char * const *date, int32_t *CJDN)
+  void (*CalStoCJDN)(char * const *date, int32_t *CJDN)
     = cal_data[fromcalendar].CalStoCJDN;
-  */
   void (*CalStoCJD)(char * const *date, double *CJD)
     = cal_data[fromcalendar].CalStoCJD;
 
@@ -1086,8 +1091,9 @@ int32_t lux_calendar(ArgumentCount narg, Symbol ps[])
         break;
       }
 
-    // now loop over all dates to translate
-    do {
+    // translates a single date, and advances the source and target
+    // pointers to the next date
+    auto translate = [&](Pointer& src, Pointer& tgt) {
       Scalar timestamp, temp;
 
       // translate input to CJD or CJDN
@@ -1104,6 +1110,15 @@ int32_t lux_calendar(ArgumentCount narg, Symbol ps[])
           CaltoCJDN(&temp.i32, &timestamp.i32); // use LONG translation
           src.d += input_elem_per_date;
           break;
+        case LUX_STRING_ARRAY: case LUX_LSTRING:
+          if (CalStoCJDN)
+            CalStoCJDN(src.sp, &timestamp.i32);
+          else {
+            CalStoCJD(src.sp, &temp.d);
+            timestamp.i32 = (int32_t) floor(temp.d);
+          }
+          src.sp += input_elem_per_date;
+          break;
         default:
           break;
         }
@@ -1125,11 +1140,11 @@ int32_t lux_calendar(ArgumentCount narg, Symbol ps[])
           src.sp += input_elem_per_date;
           break;
         default:
-          return cerror(ILL_TYPE, ps[0]);
+          break;
         }
         break;
       default:
-        return cerror(ILL_TYPE, ps[0]);
+        break;
       }
 
       if (fromtime != totime) {
@@ -1207,10 +1222,38 @@ int32_t lux_calendar(ArgumentCount narg, Symbol ps[])
       default:
         break;
       }
-    } while (tgtinfo.advanceLoop(&tgt.ui8),
+    };
+
+    if (internaltype != LUX_INT32 && internaltype != LUX_DOUBLE)
+      return cerror(ILL_TYPE, ps[0]);
+
+    /* The source and target are traversed in memory order, so when the
+       dates can be translated independently of each other, they are
+       distributed over several threads.  The time scale conversions
+       and the text output are not thread-safe, so those are done in a
+       single thread. */
+    size_t ndates = srcinfo.nelem/input_elem_per_date;
+    if (fromtime == totime && outputtype != LUX_STRING_ARRAY
+        && (size_t) tgtinfo.nelem == ndates*output_elem_per_date) {
+      size_t srcstep = input_elem_per_date*lux_type_size[srcinfo.type];
+      size_t tgtstep = output_elem_per_date*lux_type_size[tgtinfo.type];
+      parallel_for(ndates, 4096, [&](size_t begin, size_t end) {
+        Pointer s, t;
+        s.ui8 = src.ui8 + begin*srcstep;
+        t.ui8 = tgt.ui8 + begin*tgtstep;
+        for (size_t i = begin; i < end; ++i)
+          translate(s, t);
+      });
+    } else {
+      // now loop over all dates to translate
+      do
+        translate(src, tgt);
+      while (tgtinfo.advanceLoop(&tgt.ui8),
              srcinfo.advanceLoop(&src.ui8) < srcinfo.rndim);
-    if (!tgtinfo.loopIsAtStart())
-      return luxerror("Source loop is finished but target loop is not!", ps[0]);
+      if (!tgtinfo.loopIsAtStart())
+        return luxerror("Source loop is finished but target loop is not!",
+                        ps[0]);
+    }
   } else if (narg == 3) {
     if (!symbolIsNumerical(ps[0]))
       return cerror(ONLY_A_S, ps[0]);
@@ -1260,23 +1303,24 @@ int32_t lux_calendar(ArgumentCount narg, Symbol ps[])
       result = array_scratch(LUX_INT32, ndim, dims);
       cjdn.i32 = static_cast<int32_t*>(array_data(result));
     }
-    int32_t ix_year = 0;
-    int32_t ix_month = 0;
-    int32_t ix_day = 0;
-    int32_t date[3];
-    while (n--) {
-      date[0] = year.i32[ix_year];
-      if (++ix_year == n_year)
-        ix_year = 0;
-      date[1] = month.i32[ix_month];
-      if (++ix_month == n_month)
-        ix_month = 0;
-      date[2] = day.i32[ix_day];
-      if (++ix_day == n_day)
-        ix_day = 0;
-      CaltoCJDN(date, cjdn.i32);
-      ++cjdn.i32;
-    }
+    parallel_for(n, 4096, [&](size_t begin, size_t end) {
+      int32_t ix_year = begin % n_year;
+      int32_t ix_month = begin % n_month;
+      int32_t ix_day = begin % n_day;
+      int32_t date[3];
+      for (size_t i = begin; i < end; ++i) {
+        date[0] = year.i32[ix_year];
+        if (++ix_year == n_year)
+          ix_year = 0;
+        date[1] = month.i32[ix_month];
+        if (++ix_month == n_month)
+          ix_month = 0;
+        date[2] = day.i32[ix_day];
+        if (++ix_day == n_day)
+          ix_day = 0;
+        CaltoCJDN(date, &cjdn.i32[i]);
+      }
+    });
   } else {
     return cerror(WRNG_N_ARG, 0);
   }
@@ -2270,44 +2314,98 @@ void rotate(double *pos, double angle_rad, int32_t axis)
   }
 }
 //--------------------------------------------------------------------------
-double  p_ce, p_se, p_pi, p_p;
-void initEclipticPrecession(double JDE, double equinox)
+/* The nutation and the precession parameters are remembered for a
+   limited number of epochs (or pairs of equinoxes), so that reductions
+   of many objects for the same few epochs need not evaluate the series
+   expansions over and over again.  The nutation can also be
+   interpolated between epochs, to a configurable accuracy.  See
+   ASTROCACHE. */
+
+//* The number of epochs for which results are remembered by default
+#define ASTRO_CACHE_SIZE (64)
+
+//* The maximum number of nutation interpolation segments that are
+//* remembered
+#define NUTATION_SEGMENTS_MAX (4096)
+
+//* The nutation for a date
+struct Nutation
+{
+  double dPsi;                  //!< the nutation in longitude
+  double cdPsi;                 //!< the cosine of dPsi
+  double sdPsi;                 //!< the sine of dPsi
+  double dEps;                  //!< the nutation in obliquity
+};
+static EpochCache<1, Nutation> nutationCache(ASTRO_CACHE_SIZE);
+
+/// The interpolated nutation in longitude and obliquity, with 2-day
+/// segments.  Used only if #nutationAccuracy is positive.
+static ChebyshevEphemeris nutationInterpolation(2, 0);
+
+/// The accuracy (in radians) to which the nutation is interpolated
+/// between epochs, or 0 if the nutation is calculated exactly for
+/// each epoch.
+static double nutationAccuracy = 0;
+
+//* The parameters for ecliptic precession from one equinox to another
+struct EclipticPrecession
+{
+  double ce;                    //!< cos(eta)
+  double se;                    //!< sin(eta)
+  double pi;                    //!< Pi
+  double p;                     //!< p
+};
+static EpochCache<2, EclipticPrecession>
+  eclipticPrecessionCache(ASTRO_CACHE_SIZE);
+
+//* The parameters for equatorial precession from one equinox to another
+struct EquatorialPrecession
+{
+  double zeta;                  //!< zeta
+  double z;                     //!< z
+  double ctheta;                //!< cos(theta)
+  double stheta;                //!< sin(theta)
+};
+static EpochCache<2, EquatorialPrecession>
+  equatorialPrecessionCache(ASTRO_CACHE_SIZE);
+//--------------------------------------------------------------------------
+static EclipticPrecession initEclipticPrecession(double JDE, double equinox)
      // initialize for precession from equinox <JDE> to equinox <equinox>
 {
   double        t, eta, T;
+  EclipticPrecession p;
 
   T = (JDE - J2000)/36525.0;
   t = (equinox - JDE)/36525.0;
 
   eta = t*(47.0029 + T*(-0.06603 + T*0.000598)
            + t*(-0.03302 + 0.000598*T + 0.000060*t))*DEG/3600;
-  p_ce = cos(eta);
-  p_se = sin(eta);
-  p_pi = ((T*(3289.4789 + T*0.60622)
+  p.ce = cos(eta);
+  p.se = sin(eta);
+  p.pi = ((T*(3289.4789 + T*0.60622)
          + t*(-869.8089 - T*0.50491 + t*0.03536))/3600 + 174.876384)*DEG;
-  p_p = t*(5029.0966 + T*(2.22226 - T*0.000042)
+  p.p = t*(5029.0966 + T*(2.22226 - T*0.000042)
          + t*(1.11113 - T*0.000042 - t*0.000006))/3600*DEG;
+  return p;
 }
 //--------------------------------------------------------------------------
 void eclipticPrecession(double *pos, double JDE, double equinox)
 /* precess the ecliptical polar coordinates <pos> from the equinox of
    <JDE> (in JDE) to that of <equinox> (in JDE) */
 {
-  static double         oldJDE = DBL_MAX, oldEquinox = DBL_MAX;
   double        a, b, c, cb, sb, s;
 
-  if (JDE != oldJDE || equinox != oldEquinox) {
-    initEclipticPrecession(JDE, equinox);
-    oldJDE = JDE;
-    oldEquinox = equinox;
-  }
+  EclipticPrecession p
+    = eclipticPrecessionCache({JDE, equinox}, [](double const* key) {
+      return initEclipticPrecession(key[0], key[1]);
+    });
   cb = cos(pos[1]);
   sb = sin(pos[1]);
-  s = sin(p_pi - pos[0]);
-  a = p_ce*cb*s - p_se*sb;
-  b = cb*cos(p_pi - pos[0]);
-  c = p_ce*sb + p_se*cb*s;
-  pos[0] = p_p + p_pi - atan2(a,b);
+  s = sin(p.pi - pos[0]);
+  a = p.ce*cb*s - p.se*sb;
+  b = cb*cos(p.pi - pos[0]);
+  c = p.ce*sb + p.se*cb*s;
+  pos[0] = p.p + p.pi - atan2(a,b);
   if (pos[0] < 0)
     pos[0] += TWOPI;
   else if (pos[0] >= TWOPI)
@@ -2320,26 +2418,31 @@ void precessEquatorial(double *ra, double *dec, double JDfrom, double JDto)
    (declination), both measured in radians, from the equinox of JDfrom
    to the equinox of JDto.  LS 2004may03 */
 {
-  static double zeta, z, theta, from = 0, to = 0;
   double A, B, C;
 
-  if (from != JDfrom || to != JDto || !from || !to) {
-    double T, t;
-
-    T = (JDfrom - 2451545.0)/36525.0;
-    t = (JDto - JDfrom)/36525.0;
-    zeta = pol2(pol2(2306.2181, 1.39656, -0.000139, T),
-                0.30188 - 0.000344*T, 0.017998, t)*t/3600*DEG;
-    z = pol2(pol2(2306.2181, 1.39656, -0.000139, T),
-             1.09468 + 0.000066*T, 0.018203, t)*t/3600*DEG;
-    theta = pol2(pol2(2004.3109, -0.85330, -0.000217, T),
-                 -0.42665 - 0.000217*T, -0.041833, t)*t/3600*DEG;
-  }
-  *ra += zeta;
-  A = cos(*dec)*sin(*ra);
-  B = cos(theta)*cos(*dec)*cos(*ra) - sin(theta)*sin(*dec);
-  C = sin(theta)*cos(*dec)*cos(*ra) + cos(theta)*sin(*dec);
-  *ra = atan2(A, B) + z;
+  EquatorialPrecession p
+    = equatorialPrecessionCache({JDfrom, JDto}, [](double const* key) {
+      double T = (key[0] - 2451545.0)/36525.0;
+      double t = (key[1] - key[0])/36525.0;
+      EquatorialPrecession p;
+      p.zeta = pol2(pol2(2306.2181, 1.39656, -0.000139, T),
+                    0.30188 - 0.000344*T, 0.017998, t)*t/3600*DEG;
+      p.z = pol2(pol2(2306.2181, 1.39656, -0.000139, T),
+                 1.09468 + 0.000066*T, 0.018203, t)*t/3600*DEG;
+      double theta = pol2(pol2(2004.3109, -0.85330, -0.000217, T),
+                          -0.42665 - 0.000217*T, -0.041833, t)*t/3600*DEG;
+      p.ctheta = cos(theta);
+      p.stheta = sin(theta);
+      return p;
+    });
+  *ra += p.zeta;
+  double cdec = cos(*dec);
+  double sdec = sin(*dec);
+  double cra = cos(*ra);
+  A = cdec*sin(*ra);
+  B = p.ctheta*cdec*cra - p.stheta*sdec;
+  C = p.stheta*cdec*cra + p.ctheta*sdec;
+  *ra = atan2(A, B) + p.z;
   *dec = asin(C);
 }
 //--------------------------------------------------------------------------
@@ -2821,13 +2924,14 @@ char const *objectName(int32_t objNum)
   }
 }
 //--------------------------------------------------------------------------
-void nutation(double JDE, double *dPsi, double *cdPsi, double *sdPsi,
-              double *dEps)
-// calculates the nutation in longitude and/or obliquity
+static Nutation nutationSeries(double JDE)
+// calculates the nutation in longitude and obliquity from the series
 {
   double        d, m, mm, f, o, *amp, angle, T;
   int16_t       *mul;
   int32_t       i;
+  Nutation      result;
+  double        *dPsi = &result.dPsi, *dEps = &result.dEps;
 
   T = (JDE - J2000)/36525;
   d = mpol3(297.85036, 445267.111480, -0.0019142, 1./189474, T, 360)*DEG;
@@ -2835,38 +2939,46 @@ void nutation(double JDE, double *dPsi, double *cdPsi, double *sdPsi,
   mm = mpol3(134.96298, 477198.867398, 0.0086972, 1./56250, T, 360)*DEG;
   f = mpol3(93.27191, 483202.017538, -0.0036825, 1./327270, T, 360)*DEG;
   o = mpol3(125.04452, -1934.136261, 0.0020708, 1./450000, T, 360)*DEG;
-  if (dPsi)
-    *dPsi = 0.0;
-  if (dEps)
-    *dEps = 0.0;
+  *dPsi = 0.0;
+  *dEps = 0.0;
   mul = nutationMultiples;
   amp = nutationAmplitudes;
-  if (dPsi && dEps) {
-    for (i = 0; i < 63; i++) {
-      angle = mul[0]*d + mul[1]*m + mul[2]*mm + mul[3]*f + mul[4]*o;
-      *dPsi += (amp[0] + amp[1]*T)*4.848136811e-10*sin(angle);
-      *dEps += (amp[2] + amp[3]*T)*4.848136811e-10*cos(angle);
-      mul += 5;
-      amp += 4;
-    }
-    *cdPsi = cos(*dPsi);
-    *sdPsi = sin(*dPsi);
-  } else if (dPsi) {
-    for (i = 0; i < 63; i++) {
-      angle = mul[0]*d + mul[1]*m + mul[2]*mm + mul[3]*f + mul[4]*o;
-      *dPsi += (amp[0] + amp[1]*T)*4.848136811e-10*sin(angle);
-      mul += 5;
-      amp += 4;
-    }
-    *cdPsi = cos(*dPsi);
-    *sdPsi = sin(*dPsi);
-  } else if (dEps)
-    for (i = 0; i < 63; i++) {
-      angle = mul[0]*d + mul[1]*m + mul[2]*mm + mul[3]*f + mul[4]*o;
-      *dEps += (amp[2] + amp[3]*T)*4.848136811e-10*cos(angle);
-      mul += 5;
-      amp += 4;
-    }
+  for (i = 0; i < 63; i++) {
+    angle = mul[0]*d + mul[1]*m + mul[2]*mm + mul[3]*f + mul[4]*o;
+    *dPsi += (amp[0] + amp[1]*T)*4.848136811e-10*sin(angle);
+    *dEps += (amp[2] + amp[3]*T)*4.848136811e-10*cos(angle);
+    mul += 5;
+    amp += 4;
+  }
+  result.cdPsi = cos(*dPsi);
+  result.sdPsi = sin(*dPsi);
+  return result;
+}
+//--------------------------------------------------------------------------
+void nutation(double JDE, double *dPsi, double *cdPsi, double *sdPsi,
+              double *dEps)
+// calculates the nutation in longitude and/or obliquity, from the
+// cache if possible
+{
+  Nutation n = nutationCache({JDE}, [](double const* key) {
+    if (nutationAccuracy <= 0)
+      return nutationSeries(key[0]);
+    if (nutationInterpolation.size() >= NUTATION_SEGMENTS_MAX)
+      nutationInterpolation = ChebyshevEphemeris(2, nutationAccuracy);
+    ChebyshevEphemeris::Coords3 c
+      = nutationInterpolation(key[0], [](double t) {
+        Nutation n = nutationSeries(t);
+        return ChebyshevEphemeris::Coords3{ n.dPsi, n.dEps, 0 };
+      });
+    return Nutation{ c[0], cos(c[0]), sin(c[0]), c[1] };
+  });
+  if (dPsi) {
+    *dPsi = n.dPsi;
+    *cdPsi = n.cdPsi;
+    *sdPsi = n.sdPsi;
+  }
+  if (dEps)
+    *dEps = n.dEps;
 }
 //--------------------------------------------------------------------------
 double obliquity(double JDE, double *dEps)
@@ -2886,6 +2998,68 @@ double obliquity(double JDE, double *dEps)
   return eps;
 }
 //--------------------------------------------------------------------------
+int32_t lux_astrocache(ArgumentCount narg, Symbol ps[])
+// ASTROCACHE [, size, accuracy] [, /RESET, /SHOW] controls the caches
+// of nutation and precession parameters.  <size> is the number of
+// epochs (or pairs of equinoxes) that each cache remembers; 0 disables
+// the caches.  <accuracy> is the accuracy in arcseconds to which the
+// nutation is interpolated between epochs; 0 means that the nutation is
+// calculated exactly for each epoch.  /RESET forgets all cached values.
+// /SHOW shows the settings and the number of cache hits and misses.
+{
+  if (narg > 0 && ps[0]) {
+    int32_t size = int_arg(ps[0]);
+    if (size < 0)
+      return luxerror("Need a nonnegative cache size", ps[0]);
+    nutationCache.set_capacity(size);
+    eclipticPrecessionCache.set_capacity(size);
+    equatorialPrecessionCache.set_capacity(size);
+#if HAVE_LIBGSL
+    XYZ_eclipticPrecessionCache().set_capacity(size);
+#endif
+  }
+  if (narg > 1 && ps[1]) {
+    double accuracy = double_arg(ps[1]);
+    if (accuracy < 0)
+      return luxerror("Need a nonnegative accuracy", ps[1]);
+    nutationAccuracy = accuracy*DEG/3600;
+    nutationCache.clear();
+    nutationInterpolation = ChebyshevEphemeris(2, nutationAccuracy);
+  }
+  if (internalMode & 1) {       // /RESET
+    nutationCache.clear();
+    nutationInterpolation = ChebyshevEphemeris(2, nutationAccuracy);
+    eclipticPrecessionCache.clear();
+    equatorialPrecessionCache.clear();
+#if HAVE_LIBGSL
+    XYZ_eclipticPrecessionCache().clear();
+#endif
+  }
+  if (internalMode & 2) {       // /SHOW
+    printf("ASTROCACHE: %zu epochs per cache; nutation ", nutationCache.capacity());
+    if (nutationAccuracy > 0)
+      printf("interpolated to %g\" in %zu segments\n",
+             nutationAccuracy*RAD*3600, nutationInterpolation.size());
+    else
+      puts("calculated exactly");
+    printf("%-24s %12s %12s\n", "cache", "hits", "misses");
+    printf("%-24s %12zu %12zu\n", "nutation",
+           nutationCache.hits(), nutationCache.misses());
+    printf("%-24s %12zu %12zu\n", "ecliptic precession",
+           eclipticPrecessionCache.hits(), eclipticPrecessionCache.misses());
+    printf("%-24s %12zu %12zu\n", "equatorial precession",
+           equatorialPrecessionCache.hits(),
+           equatorialPrecessionCache.misses());
+#if HAVE_LIBGSL
+    printf("%-24s %12zu %12zu\n", "ecliptic XYZ precession",
+           XYZ_eclipticPrecessionCache().hits(),
+           XYZ_eclipticPrecessionCache().misses());
+#endif
+  }
+  return LUX_OK;
+}
+REGISTER(astrocache, s, astrocache, 0, 2, "1reset:2show");
+//--------------------------------------------------------------------------
 double standardSiderealTime(int32_t JD, double *dPsi, double ceps)
 // returns the sidereal time at longitude zero at 0 UT of the day of which
 // 12 UT corresponds to Julian Day number <JD>, in radians; mean if
@@ -3672,6 +3846,68 @@ void extraElementsHeliocentric(double JDE, double *equinox, double *f,
   f[2] = *r*zfac*sin(zangle + m);
 }
 //--------------------------------------------------------------------------
+/// Heliocentric VSOP87 coordinates of planets, calculated in bulk for
+/// all dates of a call of ASTRON before the dates are processed one
+/// at a time.  VSOPXYZ() uses these for the current date.
+static struct {
+  int32_t source;               //!< S_VSOP87A or S_VSOP87C
+  double tolerance;             //!< the truncation tolerance
+  size_t current;               //!< the index of the current date
+  std::vector<double> T;        //!< the dates, in millennia since J2000.0
+  /// the coordinates, 3 per date, by object
+  std::map<int32_t, std::vector<double>> positions;
+} bulkVSOP;
+//--------------------------------------------------------------------------
+static void prepareBulkVSOP(std::vector<double> const& JDEs,
+                            std::set<int32_t> const& objects,
+                            double tolerance, int32_t source)
+// calculates the VSOP87 heliocentric coordinates of those of the
+// <objects> that are planets for all <JDEs> at once, which is much
+// faster than calculating them one date at a time
+{
+  bulkVSOP.source = source;
+  bulkVSOP.tolerance = tolerance;
+  bulkVSOP.current = 0;
+  bulkVSOP.T.resize(JDEs.size());
+  for (size_t j = 0; j < JDEs.size(); j++)
+    bulkVSOP.T[j] = (JDEs[j] - J2000)/365250; // as in heliocentricXYZr
+  bulkVSOP.positions.clear();
+  for (int32_t object : objects) {
+    if (object < 1 || object > 8)
+      continue;
+    std::vector<double>& pos = bulkVSOP.positions[object];
+    pos.resize(3*JDEs.size());
+    if (source == S_VSOP87C)
+      XYZdatefromVSOPCmany(bulkVSOP.T.data(), JDEs.size(), object,
+                           pos.data(), tolerance);
+    else
+      XYZJ2000fromVSOPAmany(bulkVSOP.T.data(), JDEs.size(), object,
+                            pos.data(), tolerance);
+  }
+}
+//--------------------------------------------------------------------------
+static void VSOPXYZ(double T, int32_t object, double *pos, double tolerance,
+                    int32_t source)
+// returns in <pos> the VSOP87 heliocentric coordinates of planet
+// <object> at <T> millennia since J2000.0, from the bulk results if
+// they are available for that date, or else calculated on the spot
+{
+  if (bulkVSOP.current < bulkVSOP.T.size()
+      && bulkVSOP.T[bulkVSOP.current] == T
+      && bulkVSOP.source == source
+      && bulkVSOP.tolerance == tolerance) {
+    auto it = bulkVSOP.positions.find(object);
+    if (it != bulkVSOP.positions.end()) {
+      memcpy(pos, &it->second[3*bulkVSOP.current], 3*sizeof(double));
+      return;
+    }
+  }
+  if (source == S_VSOP87C)
+    XYZdatefromVSOPC(T, object, pos, tolerance);
+  else
+    XYZJ2000fromVSOPA(T, object, pos, tolerance);
+}
+//--------------------------------------------------------------------------
 void heliocentricXYZr(double JDE, int32_t object, double equinox,
                       double *pos, double *r, double tolerance,
                       int32_t vocal, int32_t source)
@@ -3688,7 +3924,7 @@ void heliocentricXYZr(double JDE, int32_t object, double equinox,
   case 8:
     switch (source) {
     case S_VSOP87A:
-      XYZJ2000fromVSOPA(T, object, pos, tolerance);
+      VSOPXYZ(T, object, pos, tolerance, source);
       /* heliocentric cartesian coordinates referred to the mean
          dynamical ecliptic and equinox of J2000.0 */
       if (vocal) {
@@ -3739,7 +3975,7 @@ void heliocentricXYZr(double JDE, int32_t object, double equinox,
       }
       break;
     case S_VSOP87C:
-      XYZdatefromVSOPC(T, object, pos, tolerance);
+      VSOPXYZ(T, object, pos, tolerance, source);
       /* heliocentric cartesian coordinates referred to the mean
          dynamical ecliptic and equinox of the date */
       if (vocal) {
@@ -4477,8 +4713,23 @@ int32_t lux_astropos(ArgumentCount narg, Symbol ps[])
   if (internalMode & S_TRUNCATEVSOP && !tolerance)
     tolerance = 1e-4;
 
+  // calculate the VSOP87 coordinates of the planets for all dates at
+  // once.  Dates corrected for light-time still get calculated one at
+  // a time.
+  if (nJD > 1 && !vocal) {
+    std::vector<double> jds(nJD);
+    for (j = 0; j < nJD; j++)
+      jds[j] = tdt? JD[j]: JDE(JD[j], +1);
+    std::set<int32_t> objects(object, object + nObjects);
+    objects.insert(object0);
+    if (objects.count(10))      // the Moon is calculated relative to
+      objects.insert(EARTH);    // the Earth
+    prepareBulkVSOP(jds, objects, tolerance, internalMode & S_VSOP);
+  }
+
   // calculate coordinates
   for (j = 0; j < nJD; j++) {   // all dates
+    bulkVSOP.current = j;
     if (vocal)
       printf("ASTRON: calculating for JD = %1$.7f = %1$#-24.6J\n", JD[j]);
     double jd = tdt? JD[j]: JDE(JD[j], +1); // calculate date in TDT
@@ -4829,6 +5080,10 @@ int32_t lux_astropos(ArgumentCount narg, Symbol ps[])
       f += 3;
     }
 
+  // the bulk results don't apply to other calls
+  bulkVSOP.T.clear();
+  bulkVSOP.positions.clear();
+
   return result;
 }
 //-------------------------------------------------------------------
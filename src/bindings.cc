@@ -143,6 +143,8 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 #include "error.hh"
 #include <math.h>
 #include <obstack.h>
+#include <string.h>             // for memcpy
+#include "Parallel.hh"
 #include "bindings.hh"
 
 //* Define which memory allocation routine to use for obstacks.
@@ -153,6 +155,45 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 
 struct obstack *registered_functions = NULL, *registered_subroutines = NULL;
 
+//-----------------------------------------------------------------------
+/// Calls \a compute(i) for each element index \a i in [0, \a count),
+/// spread across threads by parallel_for().  Use this only in binding
+/// functions for C functions that do not touch the LUX interpreter and
+/// keep no state between calls, such as the SOFA routines.
+///
+/// If \a repeat(i) says that element \a i has the same inputs as
+/// element \a i - 1, then \a copy(i) is called instead of \a
+/// compute(i).  It must copy the results of element \a i - 1 to those
+/// of element \a i.  Arrays of time stamps often contain runs of
+/// identical epochs, for which the SOFA routines that depend on the
+/// epoch are expensive to call again.
+///
+/// \param count is the number of elements.
+///
+/// \param min_per_thread is the least number of elements that makes
+/// it worthwhile to start another thread.
+///
+/// \param compute calculates the results for one element.
+///
+/// \param repeat says whether an element repeats the inputs of the
+/// previous one.
+///
+/// \param copy copies the results of the previous element.
+template<typename Compute, typename Repeat, typename Copy>
+static void
+elementwise(size_t count, size_t min_per_thread, Compute compute,
+            Repeat repeat, Copy copy)
+{
+  parallel_for(count, min_per_thread, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        if (i > begin && repeat(i))
+          copy(i);
+        else
+          compute(i);
+      }
+    });
+}
+
 //-----------------------------------------------------------------------
 /// Bind a C++ pointer-count-stride function to a LUX function of type
 /// `iD*;rD&` or `iD*;iL*;rD&`, or subroutine of type `iD*` or
@@ -675,22 +716,25 @@ lux_d_dd_iarq_0z_1_f_(ArgumentCount narg, Symbol ps[], double (*f)(double, doubl
   if (sa.result() < 0)
     return LUX_ERROR;
 
+  double* r = ptrs[1].d;
+  auto run = [&](auto const* x) {
+    elementwise(infos[1].nelem, 256,
+                [&](size_t i) { r[i] = f((double) x[i], 0.0); },
+                [&](size_t i) { return x[i] == x[i - 1]; },
+                [&](size_t i) { r[i] = r[i - 1]; });
+  };
   switch (infos[0].type) {
   case LUX_INT32:
-    while (infos[1].nelem--)
-      *ptrs[1].d++ = f((double) *ptrs[0].i32++, 0.0);
+    run(ptrs[0].i32);
     break;
   case LUX_INT64:
-    while (infos[1].nelem--)
-      *ptrs[1].d++ = f((double) *ptrs[0].i64++, 0.0);
+    run(ptrs[0].i64);
     break;
   case LUX_FLOAT:
-    while (infos[1].nelem--)
-      *ptrs[1].d++ = f((double) *ptrs[0].f++, 0.0);
+    run(ptrs[0].f);
     break;
   case LUX_DOUBLE:
-    while (infos[1].nelem--)
-      *ptrs[1].d++ = f(*ptrs[0].d++, 0.0);
+    run(ptrs[0].d);
     break;
   default:
     break;
@@ -2277,14 +2321,23 @@ lux_v_dT6dp33_iaiqT3rp3p3q_0z11T4_f_(ArgumentCount narg, Symbol ps[],
                             &ptrs, &infos);
   if (sa.result() < 0)
     return LUX_ERROR;
-  while (infos[0].nelem--) {
-    double d, t;
-    d = floor(*ptrs[1].d - 0.5) + 0.5;
-    t = *ptrs[1].d++ - d;
-    f(*ptrs[0].d++, 0.0, d, t, *ptrs[2].d++, *ptrs[3].d++,
-      (double (*)[3]) ptrs[4].d);
-    ptrs[4].d += 9;
-  }
+  double const* i0 = ptrs[0].d;
+  double const* i1 = ptrs[1].d;
+  double const* i2 = ptrs[2].d;
+  double const* i3 = ptrs[3].d;
+  double (*r)[3] = (double (*)[3]) ptrs[4].d;
+  elementwise(infos[0].nelem, 16,
+              [&](size_t i) {
+                double d = floor(i1[i] - 0.5) + 0.5;
+                f(i0[i], 0.0, d, i1[i] - d, i2[i], i3[i], r + 3*i);
+              },
+              [&](size_t i) {
+                return i0[i] == i0[i - 1] && i1[i] == i1[i - 1]
+                  && i2[i] == i2[i - 1] && i3[i] == i3[i - 1];
+              },
+              [&](size_t i) {
+                memcpy(r + 3*i, r + 3*(i - 1), 9*sizeof(double));
+              });
   return sa.result();
 }
 //-----------------------------------------------------------------------
@@ -2548,12 +2601,15 @@ lux_v_dddp33_iarp3p3q_0z1_f_(ArgumentCount narg, Symbol ps[],
   StandardArguments sa(narg, ps, "iD*;rD+3,+3&", &ptrs, &infos);
   if (sa.result() < 0)
     return LUX_ERROR;
+  double const* jd = ptrs[0].d;
   double (*r)[3] = (double (*)[3]) ptrs[1].d;
 
-  while (infos[0].nelem--) {
-    f(*ptrs[0].d++, 0.0, r);
-    r += 3;
-  }
+  elementwise(infos[0].nelem, 16,
+              [&](size_t i) { f(jd[i], 0.0, r + 3*i); },
+              [&](size_t i) { return jd[i] == jd[i - 1]; },
+              [&](size_t i) {
+                memcpy(r + 3*i, r + 3*(i - 1), 9*sizeof(double));
+              });
   return sa.result();
 }
 //-----------------------------------------------------------------------
@@ -2725,8 +2781,18 @@ lux_v_dddpT3_iaoqT3_0z1T3_s_(ArgumentCount narg, Symbol ps[],
   StandardArguments sa(narg, ps, "iD*;oD&;oD&;oD&", &ptrs, &infos);
   if (sa.result() < 0)
     return LUX_ERROR;
-  while (infos[0].nelem--)
-    f(*ptrs[0].d++, 0.0, ptrs[1].d++, ptrs[2].d++, ptrs[3].d++);
+  double const* jd = ptrs[0].d;
+  double* o1 = ptrs[1].d;
+  double* o2 = ptrs[2].d;
+  double* o3 = ptrs[3].d;
+  elementwise(infos[0].nelem, 16,
+              [&](size_t i) { f(jd[i], 0.0, o1 + i, o2 + i, o3 + i); },
+              [&](size_t i) { return jd[i] == jd[i - 1]; },
+              [&](size_t i) {
+                o1[i] = o1[i - 1];
+                o2[i] = o2[i - 1];
+                o3[i] = o3[i - 1];
+              });
   return sa.result();
 }
 //-----------------------------------------------------------------------
@@ -2778,17 +2844,24 @@ lux_v_dddpT3dp33T5_iaoqT3op3p3qocqT4_0z1T8_s_(ArgumentCount narg, Symbol ps[],
                             &ptrs, &infos);
   if (sa.result() < 0)
     return LUX_ERROR;
-  while (infos[0].nelem--) {
-    f(*ptrs[0].d++, 0.0, ptrs[1].d++, ptrs[2].d++, ptrs[3].d++,
-      (double (*)[3]) ptrs[4].d, (double (*)[3]) ptrs[5].d,
-      (double (*)[3]) ptrs[6].d, (double (*)[3]) ptrs[7].d,
-      (double (*)[3]) ptrs[8].d);
-    ptrs[4].d += 9;
-    ptrs[5].d += 9;
-    ptrs[6].d += 9;
-    ptrs[7].d += 9;
-    ptrs[8].d += 9;
-  }
+  double const* jd = ptrs[0].d;
+  elementwise(infos[0].nelem, 16,
+              [&](size_t i) {
+                f(jd[i], 0.0, ptrs[1].d + i, ptrs[2].d + i, ptrs[3].d + i,
+                  (double (*)[3]) (ptrs[4].d + 9*i),
+                  (double (*)[3]) (ptrs[5].d + 9*i),
+                  (double (*)[3]) (ptrs[6].d + 9*i),
+                  (double (*)[3]) (ptrs[7].d + 9*i),
+                  (double (*)[3]) (ptrs[8].d + 9*i));
+              },
+              [&](size_t i) { return jd[i] == jd[i - 1]; },
+              [&](size_t i) {
+                for (int j = 1; j <= 3; ++j)
+                  ptrs[j].d[i] = ptrs[j].d[i - 1];
+                for (int j = 4; j <= 8; ++j)
+                  memcpy(ptrs[j].d + 9*i, ptrs[j].d + 9*(i - 1),
+                         9*sizeof(double));
+              });
   return sa.result();
 }
 //-----------------------------------------------------------------------
@@ -2859,8 +2932,16 @@ lux_v_dddpdp_iaoqoq_0z12_s_(ArgumentCount narg, Symbol ps[],
   StandardArguments sa(narg, ps, "iD*;oD&;oD&", &ptrs, &infos);
   if (sa.result() < 0)
     return LUX_ERROR;
-  while (infos[0].nelem--)
-    f(*ptrs[0].d++, 0.0, ptrs[1].d++, ptrs[2].d++);
+  double const* jd = ptrs[0].d;
+  double* o1 = ptrs[1].d;
+  double* o2 = ptrs[2].d;
+  elementwise(infos[0].nelem, 16,
+              [&](size_t i) { f(jd[i], 0.0, o1 + i, o2 + i); },
+              [&](size_t i) { return jd[i] == jd[i - 1]; },
+              [&](size_t i) {
+                o1[i] = o1[i - 1];
+                o2[i] = o2[i - 1];
+              });
   return sa.result();
 }
 //-----------------------------------------------------------------------
@@ -67,6 +67,11 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
     Hebrew calendar dates begin at sunset of the preceding
     Julian/Gregorian calendar date.
 
+    The functions that translate text with a day number, month name,
+    and year number for calendars with 3 elements per date also accept
+    text in ISO 8601 format (such as `2016-03-17T14:25:03Z`), which is
+    translated much faster.
+
     The Egyptian calendar is according to the era of Seleukos, with
     the epoch corresponding to 26 February -747 on the Julian
     calendar.
@@ -21428,6 +21428,20 @@ int32_t evalLhs(int32_t symbol)
   return luxerror("Unexpected exit from evalLhs()", symbol);
 } // end of evalLhs()
 //----------------------------------------------------------
+void preExtractToExtract(int32_t symbol, int32_t target)
+// changes LUX_PRE_EXTRACT <symbol> into an LUX_EXTRACT symbol with
+// the indicated <target>
+{
+  ExtractSec* eptr;
+
+  symbol_class(symbol) = LUX_EXTRACT;
+  free(pre_extract_name(symbol));
+  eptr = pre_extract_ptr(symbol);
+  free(pre_extract_data(symbol));
+  extract_ptr(symbol) = eptr;
+  extract_target(symbol) = target;
+}
+//----------------------------------------------------------
 int32_t evalExtractRhs(int32_t symbol)
 // evaluate LUX_EXTRACT symbol as rhs
 {
@@ -21504,13 +21518,7 @@ int32_t evalExtractRhs(int32_t symbol)
                      pre_extract_name(symbol));
       if (kind == LUX_INT_FUNC)
         target = -target;
-      // now we change the LUX_PRE_EXTRACT symbol into an LUX_EXTRACT symbol
-      symbol_class(symbol) = LUX_EXTRACT;
-      free(pre_extract_name(symbol));
-      p.v = pre_extract_ptr(symbol);
-      free(pre_extract_data(symbol));
-      extract_ptr(symbol) = (ExtractSec*) p.v;
-      extract_target(symbol) = target;
+      preExtractToExtract(symbol, target);
     }
   } else                        // we assume it's an LUX_EXTRACT symbol
     target = extract_target(symbol);
@@ -32,6 +32,8 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 #include "editor.hh"
 #include "install.hh"
 #include "action.hh"
+#include "Bytecode.hh"
+#include "Profiler.hh"
 
 extern int32_t  nFixed, traceMode;
 
@@ -43,6 +45,9 @@ char    preserveKey;
 
 char const* currentRoutineName = NULL;
 
+/// The profiler, controlled by PROFILE.
+Profiler profiler;
+
 int32_t         lux_convert(int32_t, int32_t *, Symboltype, int32_t),
   convertScalar(Scalar *, int32_t, Symboltype),
         dereferenceScalPointer(int32_t), eval(int32_t),
@@ -701,6 +706,8 @@ int32_t internal_routine(int32_t symbol, InternalRoutine *routine)
  int32_t        nArg, nKeys = 0, i, maxArg, *evalArgs,
         routineNum, n, thisInternalMode = 0, ordinary = 0;
  uint8_t        isSubroutine;
+ bool profiled;
+ size_t profileDepth;
  KeyList        *theKeyList;
  int16_t        *arg;
  char   *name, suppressEval = 0, suppressUnused = 0;
@@ -955,7 +962,14 @@ int32_t internal_routine(int32_t symbol, InternalRoutine *routine)
  internalMode = thisInternalMode;
  if (symbol == pipeExec)
    pipeExec = 0;                // allow piping (for functions)
+ profiled = profiler.active();
+ if (profiled)
+   profileDepth = profiler.enter(isSubroutine? Profiler::SUBROUTINE:
+                                 Profiler::FUNCTION, routineNum,
+                                 routine[routineNum].name);
  i = (*routine[routineNum].ptr)(maxArg, evalArgs); // execute
+ if (profiled)
+   profiler.leave(profileDepth);
  // now get rid of temporary variables created in the routine -- except
  // for the return value, of course
  for (ordinary = 0; ordinary < maxArg; ordinary++)
@@ -1008,6 +1022,8 @@ int32_t usr_routine(int32_t symbol)
  char   type, *name, msg, isError;
  char const* routineTypeNames[] = { "func", "subr", "block" };
  SymbolImpl  *oldpars;
+ bool profiled;
+ size_t profileDepth;
  extern int32_t         returnSym, defined(int32_t, int32_t);
  extern char    evalScalPtr;
  void pushExecutionLevel(int32_t, int32_t), popExecutionLevel(void);
@@ -1287,11 +1303,17 @@ int32_t usr_routine(int32_t symbol)
    if (defined(arg[i], 1))
      nArg++;
  // now execute the statements
+ profiled = profiler.active();
+ if (profiled)
+   profileDepth = profiler.enter(Profiler::USER, routineNum,
+                                 currentRoutineName);
  while (nStmnt--) {
    i = execute(*par++);
    if (i != 1)
      break;
  }
+ if (profiled)
+   profiler.leave(profileDepth);
  // restore old value of !NARG
  nArg = oldNArg;
 
@@ -1792,6 +1814,9 @@ int32_t execute(int32_t symbol)
   void checkTemps(void);
 #endif
   float         newCPUtime;
+  bool          profiled;
+  int32_t       profileContext, profileLine;
+  Profiler::Moment profileStart;
   int32_t       showstats(int32_t, int32_t []), getNewLine(char *, size_t, char const *, char),
     lux_restart(int32_t, int32_t []), showError(int32_t), insert(int32_t, int32_t []),
     nextFreeStackEntry(void);
@@ -1959,12 +1984,49 @@ int32_t execute(int32_t symbol)
     } // end of if (action)
   } // end of if (suppressMsg) else
 
+  // loops that do only scalar arithmetic may be executed as bytecode,
+  // unless we're tracing or debugging.  If that starts during the
+  // loop, then the tree interpreter takes over at the end of the
+  // current loop body.
+  if (lux_bytecode && !trace && !step && !nBreakpoint && !nWatchVars) {
+    switch (evb_type(symbol)) {
+      case EVB_FOR: case EVB_WHILE_DO: case EVB_DO_WHILE: case EVB_REPEAT:
+        if (bytecode_execute(symbol, &n)) {
+          if (n == LUX_ERROR)
+            cerror(-1, symbol);
+          if (symbol_class(symbol) == LUX_EVB // not yet zapped
+              && symbol_context(symbol) == -compileLevel)
+            zap(symbol);
+          return n;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
   oldEVB = currentEVB;          // so it can be restored later
   currentEVB = symbol;          // so we can make temps have this
                                 // context (see nextFree...)
   ptr = evb_args(symbol);       // point at parameters
   returnSym = 0;
   pegMark();
+  // the profiler times simple statements only; the time of compound
+  // statements is the sum of that of their parts
+  switch (evb_type(symbol)) {
+    case EVB_REPLACE: case EVB_INT_SUB: case EVB_INSERT: case EVB_USR_SUB:
+    case EVB_RETURN:
+      profiled = profiler.active();
+      break;
+    default:
+      profiled = false;
+      break;
+  }
+  if (profiled) {
+    profileContext = curContext;
+    profileLine = symbol_line(symbol);
+    profileStart = profiler.now();
+  }
   switch (evb_type(symbol)) {
     default:
       n = luxerror("Sorry, LUX_EVB type %d is not recognized\n",
@@ -2308,6 +2370,10 @@ int32_t execute(int32_t symbol)
       else if (n > 0)
         zapTemp(n);
   }
+  if (profiled)
+    profiler.line(profileContext, profileContext?
+                  symbolProperName(profileContext): "(main)",
+                  profileLine, profileStart);
   if (n == LUX_ERROR)           // some error
     cerror(-1, symbol);
   if (symbol_context(symbol) == -compileLevel)
@@ -2369,6 +2435,39 @@ int32_t lux_execute(ArgumentCount narg, Symbol ps[])
   return n;
 }
 //------------------------------------------------------------------
+int32_t lux_profile(ArgumentCount narg, Symbol ps[])
+// PROFILE[,file][,/START,/STOP,/RESET,/LINES,/MEMORY]
+// controls the profiler.  /RESET forgets the collected data, /START
+// starts or resumes collecting, /STOP stops collecting.  /MEMORY
+// (with /START) also measures the net number of bytes allocated by
+// each routine.  If <file> is specified, then writes the call tree
+// to that file in "collapsed stack" format for flame graph tools.
+// If no file and none of /START, /STOP, /RESET are specified, then
+// shows the routines that took the most time, and also the source
+// lines if /LINES is specified.
+{
+  if (internalMode & 4)         // /RESET
+    profiler.reset();
+  if (internalMode & 1)         // /START
+    profiler.start(internalMode & 16);
+  if (internalMode & 2)         // /STOP
+    profiler.stop();
+  if (narg) {
+    if (!symbolIsStringScalar(ps[0]))
+      return cerror(NEED_STR, ps[0]);
+    FILE* fp = fopen(expand_name(string_arg(ps[0]), NULL), "w");
+    if (!fp)
+      return cerror(ERR_OPEN, ps[0]);
+    bool ok = profiler.write_collapsed(fp);
+    if (fclose(fp) || !ok)
+      return luxerror("Could not write the profile to file %s", ps[0],
+                      string_arg(ps[0]));
+  } else if ((internalMode & 7) == 0)
+    profiler.report(stdout, 20, internalMode & 8);
+  return LUX_OK;
+}
+REGISTER(profile, s, profile, 0, 1, "1start:2stop:4reset:8lines:16memory");
+//------------------------------------------------------------------
 int32_t compileString(char *string)
 // compiles string <string>
 {
@@ -85,11 +85,25 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 #if HAVE_REGEX_H
 #include <regex.h>                // for regcomp(), regfree(), regexec()
 #endif
+#if HAVE_MMAP
+#include <sys/mman.h>                // for mmap(), munmap()
+#endif
 #include "action.hh"
 #include "install.hh"
 #include "editor.hh"                // for BUFSIZE
 #include "format.hh"
+#include "Arena.hh"
+#include "AsyncStream.hh"
+#include "Hyperslab.hh"
+#include "Parallel.hh"
+#include "PathIndex.hh"
+#include "TextTable.hh"
 #include <errno.h>
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #define FMT_INSTALL        1
 #define FMT_CLEANUP        2
@@ -115,6 +129,8 @@ extern        int32_t scrat[];                                /* scratch storage
 FILE        *lux_file[MAXFILES];
 int32_t        lux_file_open[MAXFILES];        // our own flag for each file
 char        *lux_file_name[MAXFILES]; // pointers to open file names
+// the background readers or writers of files opened with /ASYNC
+static AsyncStream *lux_file_async[MAXFILES];
 int32_t        lux_rec_size[MAXFILES];                //for associated variable files
 // items used by ASCII read routines
 int32_t        maxline = BUFSIZE;
@@ -291,6 +307,63 @@ int32_t lux_spawn_f(ArgumentCount narg, Symbol ps[])                // execute a
   return result;
  }
 //-------------------------------------------------------------------------
+/* The index of the files in the directories of the search path of
+   openPathFile(), and the search path (LUX_PATH and ulib) for which it
+   was built.  It is rebuilt when the search path changes, and
+   refreshed from the directory modification times when a file is not
+   found in it. */
+static PathIndex pathIndex;
+static std::string pathIndexPath;
+
+static void updatePathIndex(char const* path)
+// makes sure that <pathIndex> indexes the directories listed (separated
+// by colons) in <path>
+{
+  if (path == pathIndexPath)
+    return;
+  pathIndexPath = path;
+  std::vector<std::string> directories;
+  char *plist = strsave(path);
+  for (char *p = strtok(plist, ":"); p; p = strtok(NULL, ":"))
+    directories.push_back(expand_name(p, NULL));
+  free(plist);
+  pathIndex.set_directories(directories);
+}
+
+static FILE *openIndexedFile(char const* name, int32_t mode)
+/* seeks the file for <name> and <mode> (as for openPathFile()) in the
+   directories indexed by <pathIndex>, and opens it.  Sets <expname>
+   to the directory plus <name>, and <curScrat> to the full file name.
+   Returns the file pointer, or NULL if the file was not found. */
+{
+  std::vector<std::string> names;
+  bool hasExtension = strchr(name, '.') != NULL;
+
+  if (hasExtension)
+    names.push_back(name);
+  else {
+    if (mode == FIND_SUBR || mode == FIND_EITHER)
+      names.push_back(std::string(name) + ".lux");
+    if (mode == FIND_FUNC || mode == FIND_EITHER)
+      names.push_back(std::string(name) + "_f.lux");
+  }
+  for (int32_t attempt = 0; attempt < 2; attempt++) {
+    size_t directory, which;
+    if (pathIndex.locate(names, directory, which)) {
+      std::string const& dir = pathIndex.directories()[directory];
+      sprintf(expname, "%s/%s", dir.c_str(), name);
+      sprintf(curScrat, "%s/%s", dir.c_str(), names[which].c_str());
+      FILE *fin = fopen(curScrat, "r");
+      if (fin)
+        return fin;
+      // the index is out of date
+    }
+    if (!attempt && !pathIndex.refresh())
+      break;                    // nothing changed, so no need to retry
+  }
+  return NULL;
+}
+//-------------------------------------------------------------------------
 FILE *openPathFile(char const* name, int32_t mode)
 /* If name starts with $, then expands environment variable and tries
   to open file with resulting name.  If name starts with /, then searches
@@ -303,6 +376,9 @@ FILE *openPathFile(char const* name, int32_t mode)
   set, then the name is transformed to lower case before the file is
   sought.
   Extension is added only if no extension (.something) is present yet.
+  The directories of LUX_PATH and ulib are searched through an index of
+  their contents (see ULIB,/LIST), so the file system is not probed for
+  every directory.
   LS 10/20/92 */
 /* Headers:
    <stdio.h>: FILE, fopen(), printf()
@@ -311,7 +387,7 @@ FILE *openPathFile(char const* name, int32_t mode)
    <string.h>: strcpy(), strcat(), strtok(), strchr(), strrchr()
  */
 {
-  char        *copy, *p, *plist;
+  char        *copy, *p, *plist, *start;
   FILE        *fin;
   extern int32_t        echo, trace, step, executeLevel, traceMode;
 
@@ -326,7 +402,8 @@ FILE *openPathFile(char const* name, int32_t mode)
   mode &= ~FIND_LOWER;
   p = copy;
   while (isspace((uint8_t) *p++));                        // skip spaces
-  switch (*--p) {
+  start = --p;
+  switch (*p) {
     case '$': case '~': case '/':
       plist = NULL;
       break;
@@ -343,6 +420,15 @@ FILE *openPathFile(char const* name, int32_t mode)
       }
       if (!*curScrat)                // none yet
         strcpy(curScrat, ".");
+      if (!strchr(start, '/')) { // a plain file name; use the index
+        updatePathIndex(curScrat);
+        fin = openIndexedFile(start, mode);
+        free(copy);
+        if (fin && (echo || trace > executeLevel || step > executeLevel
+                    || (traceMode & T_ROUTINEIO)))
+          printf("Reading from file %s\n", curScrat);
+        return fin;
+      }
       plist = strsave(curScrat);
   }
   p = 0;
@@ -387,14 +473,31 @@ FILE *openPathFile(char const* name, int32_t mode)
 }
 //-------------------------------------------------------------------------
 int32_t lux_ulib(ArgumentCount narg, Symbol ps[])
- //set ulib path
+ /* set ulib path.  /REBUILD rebuilds the index of the files in the
+    search path directories, and /LIST shows it. */
 /* Headers:
    <stdio.h>: printf()
    <stdlib.h>: free()
  */
 {
+ if (internalMode & 2)         // /REBUILD
+   pathIndex.rebuild();
+ if (internalMode & 1) {       // /LIST
+   std::vector<std::string> const& dirs = pathIndex.directories();
+   printf("search path index for %s:\n",
+          pathIndexPath.empty()? "(not yet built)": pathIndexPath.c_str());
+   for (size_t i = 0; i < dirs.size(); i++) {
+     size_t count = 0;
+     for (std::string const& f : pathIndex.files(i))
+       if (f.size() > 4 && !f.compare(f.size() - 4, 4, ".lux"))
+         count++;
+     printf("%s: %zu routine file%s\n", dirs[i].c_str(), count,
+            count == 1? "": "s");
+   }
+ }
  if (narg == 0) {
-   printf("current ulib path: %s\n", ulib_path);
+   if (!internalMode)
+     printf("current ulib path: %s\n", ulib_path);
    return LUX_OK;
  }
 
@@ -1210,21 +1313,102 @@ int32_t type_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
   return LUX_OK;
 }
 //-------------------------------------------------------------------------
+/// The pieces of text that type_formatted_ascii() prints for SPRINTF.
+/// The pieces are kept on the thread's Arena, which is reset to where
+/// it was when the FormattedText goes out of scope, so formatting many
+/// values needs neither a fixed-size scratch buffer nor reallocation
+/// of a growing one.
+struct FormattedText
+{
+  /// A piece of text.
+  struct Piece
+  {
+    char const* text;           //!< The text.
+    size_t size;                //!< The length of the text.
+    Piece* next;                //!< The next piece, or `nullptr`.
+  };
+
+  Arena& arena = Arena::thread_arena(); //!< Where the pieces are.
+  Arena::Mark mark = arena.mark(); //!< Where the pieces begin.
+  Piece* first = nullptr;       //!< The first piece.
+  Piece* last = nullptr;        //!< The last piece.
+  size_t size = 0;              //!< The total length of the pieces.
+  bool failed = false;          //!< Did we run out of memory?
+
+  /// Appends a copy of \a text.
+  void
+  add(char const* text)
+  {
+    append(arena.strdup(text));
+  }
+
+  /// Appends printed text.
+  ///
+  /// \param format is the printf-style format.
+  void
+  sprintf(char const* format, ...)
+  {
+    va_list ap;
+
+    va_start(ap, format);
+    append(arena.vsprintf(format, ap));
+    va_end(ap);
+  }
+
+  /// Appends a piece of text that is already on the Arena.
+  void
+  append(char const* text)
+  {
+    Piece* piece = text? (Piece*) arena.allocate(sizeof(Piece),
+                                                 alignof(Piece)): nullptr;
+    if (!piece) {
+      failed = true;
+      return;
+    }
+    *piece = { text, strlen(text), nullptr };
+    (last? last->next: first) = piece;
+    last = piece;
+    size += piece->size;
+  }
+
+  /// \returns a new LUX string with all of the text, or `LUX_ERROR`.
+  int32_t
+  string() const
+  {
+    if (failed || size > INT32_MAX)
+      return cerror(ALLOC_ERR, 0);
+    int32_t result = string_scratch(size);
+    char* p = string_value(result);
+    for (Piece const* piece = first; piece; piece = piece->next) {
+      memcpy(p, piece->text, piece->size);
+      p += piece->size;
+    }
+    *p = '\0';
+    return result;
+  }
+
+  ~FormattedText()
+  {
+    arena.reset(mark);
+  }
+};
+//-------------------------------------------------------------------------
 int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
 /* print using a user-supplied format string.  Arguments are cast to
    the expected type.  If <fp> is equal to NULL, then prints into a
-   string at <curScrat>. 13oct98 */
+   new string, which is returned. 13oct98 */
 /* Headers:
    <stdio.h>: FILE, fputs(), fprintf(), sprintf(), fflush()
    <string.h>: strcpy(), strlen(), strpbrk(), memcpy()
    <stdlib.h>: free()
  */
 {
-  char        *fmt, *thefmt, *save, haveTrailer, dofreefmt, *newfmt, *ptr;
+  char        *fmt, *thefmt, haveTrailer, dofreefmt, *newfmt, *ptr;
   int32_t        iq, n, nn, iq0;
   Pointer        p;
   extern FormatInfo        theFormat;
   int32_t        Sprintf(char *, char *, ...);
+  FormattedText        text;        // if !fp
 
   iq = iq0 = ps[0];                // the format symbol
   if (symbol_class(iq0) == LUX_SCAL_PTR)
@@ -1232,11 +1416,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
   if (symbol_class(iq) != LUX_STRING)
     return cerror(NEED_STR, iq0);
   if (narg == 1) {                // only one symbol: just print it
-    if (fp)
+    if (fp) {
       fputs(string_value(iq), fp);
-    else                        // into curScrat
-      strcpy(curScrat, string_value(iq));
-    return LUX_OK;
+      return LUX_OK;
+    }
+    text.add(string_value(iq));
+    return text.string();
   }
 
   thefmt = fmt = fmttok(string_value(iq)); // install format
@@ -1244,18 +1429,13 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
     return luxerror("Illegal format string", iq0);
   dofreefmt = 0;
 
-  if (!fp)
-    save = curScrat;
-
   narg--;                        // number of arguments after format
   while (narg || theFormat.type == FMT_PLAIN) {
     if (theFormat.type == FMT_PLAIN) { // literal string
-      if (fp) {
+      if (fp)
         fputs(thefmt, fp);
-      } else {
-        strcpy(curScrat, thefmt);
-        curScrat += strlen(curScrat);
-      }
+      else
+        text.add(thefmt);
       if (fmt) {
         fmt = fmttok(NULL);        // next format
         dofreefmt = 0;
@@ -1335,12 +1515,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, (int32_t) *p.ui8++);
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    text.sprintf(thefmt, (int32_t) *p.ui8++);
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_INT16:
@@ -1352,12 +1529,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, (int32_t) *p.i16++);
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    text.sprintf(thefmt, (int32_t) *p.i16++);
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_INT32:
@@ -1369,12 +1543,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, (int32_t) *p.i32++);
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    text.sprintf(thefmt, (int32_t) *p.i32++);
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_INT64:
@@ -1386,12 +1557,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, *p.i64++);
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    text.sprintf(thefmt, *p.i64++);
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_FLOAT:
@@ -1403,12 +1571,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, (int32_t) *p.f++);
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    text.sprintf(thefmt, (int32_t) *p.f++);
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_DOUBLE:
@@ -1420,12 +1585,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, (int32_t) *p.d++);
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    text.sprintf(thefmt, (int32_t) *p.d++);
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_CFLOAT:
@@ -1438,13 +1600,10 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, (int32_t) p.cf->real);
+                    text.sprintf(thefmt, (int32_t) p.cf->real);
                     p.cf++;
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_CDOUBLE:
@@ -1457,13 +1616,10 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, p.cd->real);
+                    text.sprintf(thefmt, (int32_t) p.cd->real);
                     p.cd++;
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_STRING_ARRAY: case LUX_TEMP_STRING:
@@ -1484,12 +1640,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, (double) *p.ui8++);
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    text.sprintf(thefmt, (double) *p.ui8++);
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_INT16:
@@ -1501,12 +1654,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, (double) *p.i16++);
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    text.sprintf(thefmt, (double) *p.i16++);
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_INT32:
@@ -1518,12 +1668,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, (double) *p.i32++);
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    text.sprintf(thefmt, (double) *p.i32++);
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_INT64:
@@ -1535,12 +1682,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, (double) *p.i64++);
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    text.sprintf(thefmt, (double) *p.i64++);
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_FLOAT:
@@ -1552,12 +1696,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, (double) *p.f++);
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    text.sprintf(thefmt, (double) *p.f++);
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_DOUBLE:
@@ -1569,12 +1710,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, (double) *p.d++);
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    text.sprintf(thefmt, (double) *p.d++);
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_CFLOAT:
@@ -1587,13 +1725,10 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, (double) p.cf->real);
+                    text.sprintf(thefmt, (double) p.cf->real);
                     p.cf++;
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_CDOUBLE:
@@ -1606,13 +1741,10 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, p.cd->real);
+                    text.sprintf(thefmt, p.cd->real);
                     p.cd++;
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_STRING_ARRAY: case LUX_TEMP_STRING:
@@ -1629,14 +1761,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1646,14 +1776,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1663,14 +1791,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1680,14 +1806,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1697,14 +1821,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1714,14 +1836,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1735,14 +1855,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1752,14 +1870,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1769,14 +1885,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1786,14 +1900,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1803,14 +1915,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1820,14 +1930,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1839,14 +1947,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1857,14 +1963,12 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (fp)
                     fputs(curScrat, fp);
                   else
-                    curScrat += strlen(curScrat);
+                    text.add(curScrat);
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
                     if (fp)
                       fputs(theFormat.plain, fp);
-                    else {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    else
+                      text.add(theFormat.plain);
                   }
                 }
                 break;
@@ -1885,12 +1989,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   }
                 else
                   while (n--) {
-                    sprintf(curScrat, thefmt, *p.sp++);
-                    curScrat += strlen(curScrat);
-                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                      strcpy(curScrat, theFormat.plain);
-                      curScrat += strlen(curScrat);
-                    }
+                    text.sprintf(thefmt, *p.sp++);
+                    if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                      text.add(theFormat.plain);
                   }
                 break;
               case LUX_TEMP_STRING: case LUX_LSTRING:
@@ -1899,12 +2000,9 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
                   if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
                     fputs(theFormat.plain, fp);
                 } else {
-                  sprintf(curScrat, thefmt, p.s);
-                  curScrat += strlen(curScrat);
-                  if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2))) {
-                    strcpy(curScrat, theFormat.plain);
-                    curScrat += strlen(curScrat);
-                  }
+                  text.sprintf(thefmt, p.s);
+                  if (haveTrailer && (n || !(theFormat.flags & FMT_MIX2)))
+                    text.add(theFormat.plain);
                 }
                 break;
             }
@@ -1929,12 +2027,8 @@ int32_t type_formatted_ascii(ArgumentCount narg, Symbol ps[], FILE *fp)
   lux_type_ascii1:
   if (fp == stdout)
     fflush(stdout);
-  else if (!fp)
-    curScrat = save;
-  return LUX_OK;
+  return fp? LUX_OK: text.string();
   lux_type_ascii2:
-  if (!fp)
-    curScrat = save;
   return LUX_ERROR;
 }
 //-------------------------------------------------------------------------
@@ -1982,19 +2076,44 @@ int32_t lux_close(ArgumentCount narg, Symbol ps[]) /* close subroutine */
   if (lun < 0 || lun >= MAXFILES)
     return cerror(ILL_LUN, *ps);
   if (lux_file_open[lun]) {
-    fclose(lux_file[lun]);
+    if (fclose(lux_file[lun]) && lux_file_async[lun])
+      luxerror("Writing to file %s failed", 0, lux_file_name[lun]);
     lux_file[lun] = NULL;
+    lux_file_async[lun] = NULL; // was deleted by fclose()
     lux_file_open[lun] = 0;
     free(lux_file_name[lun]);
   }
   return 1;
 }
 //-------------------------------------------------------------------------
+/// Closes the luns that were opened with /ASYNC.  exit() flushes the
+/// other luns, but the data of an /ASYNC lun reach its file only when
+/// the lun is closed, and then its background thread ends, too.
+/// open_file() registers this function with atexit(), so QUIT does not
+/// lose data.
+static void
+close_async_luns(void)
+{
+  for (int32_t lun = 0; lun < MAXFILES; lun++)
+    if (lux_file_async[lun]) {
+      fclose(lux_file[lun]);
+      lux_file[lun] = NULL;
+      lux_file_async[lun] = NULL; // was deleted by fclose()
+      lux_file_open[lun] = 0;
+      free(lux_file_name[lun]);
+    }
+}
+//-------------------------------------------------------------------------
 int32_t open_file(ArgumentCount narg, Symbol ps[], char const* access, char function)
  /* generic file opening routine, called by OPENR, OPENW, OPENU routines
     and functions   LS 8jul92
     openu must open a file for reading and writing anywhere in the file.
     add switch /get_lun to find and use the next available lun  LS 1feb95 */
+/* ASYNC=<size> or /ASYNC for OPENR or OPENW reads ahead or writes
+   behind in a background thread, with <size> bytes of buffers (16 MB
+   for /ASYNC), so that I/O on the lun overlaps with calculations.
+   IOWAIT waits for the writes.  /ASYNC luns that are still open at
+   exit are closed then. */
 /* Headers:
    <stdio.h>: FILE, fopen(), fseek(), printf()
    <string.h>: strcmp()
@@ -2003,6 +2122,17 @@ int32_t open_file(ArgumentCount narg, Symbol ps[], char const* access, char func
  FILE        *fp;
  int32_t        lun, result_sym;
  char        *name;
+ size_t        async = 0;
+ AsyncStream        *stream = NULL;
+
+ if (*ps) {                        // ASYNC
+   if (!strcmp(access, "u"))
+     return luxerror("ASYNC is not supported for updating", *ps);
+   double size = double_arg(*ps);
+   if (size > 0)
+     async = (size > 1)? size: 16 << 20;
+ }
+ ps++;
 
  if (function) {                // function call
    result_sym = scalar_scratch(LUX_INT32);
@@ -2047,8 +2177,14 @@ int32_t open_file(ArgumentCount narg, Symbol ps[], char const* access, char func
      printf("%s: ", expname);
      return cerror(ERR_OPEN, 0);
    }
- } else
-   fp = fopen(expand_name(name, NULL), access);
+ } else {
+   fp = NULL;
+   if (async)                        // if impossible, then the ordinary way
+     fp = async_fopen(expand_name(name, NULL), *access == 'w', async,
+                      &stream);
+   if (!fp)
+     fp = fopen(expand_name(name, NULL), access);
+ }
  if (!fp) {                        // could not open the file
    if (function)
      return result_sym;
@@ -2057,7 +2193,15 @@ int32_t open_file(ArgumentCount narg, Symbol ps[], char const* access, char func
      return cerror(ERR_OPEN, 0);
    }
  }
+ if (stream) {
+   static bool close_at_exit = false;
+   if (!close_at_exit) {
+     atexit(close_async_luns);
+     close_at_exit = true;
+   }
+ }
  lux_file[lun] = fp;
+ lux_file_async[lun] = stream;
  lux_file_open[lun] = (*access == 'r')? 1: 2; // read-only or read-write
  lux_file_name[lun] = strsave(expname);
  if (function)
@@ -2106,6 +2250,40 @@ int32_t lux_openu(ArgumentCount narg, Symbol ps[])// openu subroutine
   return open_file(narg, ps, "u", 0);
 }
 //-------------------------------------------------------------------------
+int32_t iowait(ArgumentCount narg, Symbol ps[], int32_t flag)
+/* IOWAIT,lun
+   waits until all data written to <lun> have reached the file.  This
+   matters for luns opened with /ASYNC, where the writing happens in
+   the background.  Returns 1 if all writes so far succeeded, 0 if
+   not.  <flag> is 1 for a subroutine, 0 for a function. */
+{
+  int32_t        lun;
+  bool        ok;
+
+  lun = int_arg(ps[0]);
+  if (lun < 0 || lun >= MAXFILES)
+    return flag? cerror(ILL_LUN, *ps): LUX_ZERO;
+  if (!lux_file_open[lun])
+    return flag? cerror(LUN_CLOSED, *ps): LUX_ZERO;
+  ok = !fflush(lux_file[lun]);
+  if (lux_file_async[lun])
+    ok = lux_file_async[lun]->wait() && ok;
+  if (flag)
+    return ok? LUX_OK: luxerror("Writing to file %s failed", 0,
+                                lux_file_name[lun]);
+  return ok? LUX_ONE: LUX_ZERO;
+}
+//-------------------------------------------------------------------------
+int32_t lux_iowait(ArgumentCount narg, Symbol ps[])
+{
+  return iowait(narg, ps, 1);
+}
+//-------------------------------------------------------------------------
+int32_t lux_iowait_f(ArgumentCount narg, Symbol ps[])
+{
+  return iowait(narg, ps, 0);
+}
+//-------------------------------------------------------------------------
 int32_t lux_rewindf(ArgumentCount narg, Symbol ps[]) //rewind file subroutine
 /* Headers:
    <stdio.h>: fseek()
@@ -4174,19 +4352,210 @@ void astore_one(FILE *fp, int32_t iq)
   }
 }
 //-------------------------------------------------------------------------
+// Version 2 of the LUX ASTORE file format consists of a header, the
+// data of each stored value, and a directory that says where the data
+// of each value are, so ARESTORE can go straight to the values it
+// needs.  Version 1 files hold a symbol record for each value and have
+// no directory.  Numbers are in the byte order of the machine that
+// wrote the file, which the magic number reveals.
+
+/// The magic number of version 1 ASTORE files.
+static const uint32_t astore_magic_1 = 0x6666aaaa;
+
+/// The magic number of version 2 ASTORE files.
+static const uint32_t astore_magic_2 = 0x6666aaab;
+
+/// How the data of a value are stored in a version 2 ASTORE file.
+enum AstoreEncoding
+{
+  ASTORE_RAW,                   //!< the values as they are in memory
+  ASTORE_RICE,                  //!< Rice-compressed integer array values
+  ASTORE_SYMBOL,                //!< a version 1 symbol record
+};
+
+/// An entry in the directory of a version 2 ASTORE file.
+struct AstoreEntry
+{
+  std::string name;             //!< the variable name, empty if unnamed
+  int32_t symclass;             //!< the symbol class
+  int32_t type;                 //!< the data type
+  std::vector<int32_t> dims;    //!< the dimensions of an array
+  int32_t encoding;             //!< an AstoreEncoding
+  int64_t offset;               //!< the file offset of the data
+  int64_t size;                 //!< the number of bytes of data
+  uint32_t checksum;            //!< the Adler-32 checksum of the data
+};
+
+static int32_t rice_compress(uint8_t*, uint8_t*, Symboltype, bool, int32_t,
+                             int32_t, int32_t, int32_t);
+static bool rice_decompress(uint8_t*, uint8_t*, Symboltype, bool, int32_t,
+                            int32_t, int32_t);
+//-------------------------------------------------------------------------
+/// Updates an Adler-32 checksum.
+///
+/// \param adler is the checksum so far, 1 at the start.
+///
+/// \param data points at the next bytes.
+///
+/// \param n is the number of bytes.
+///
+/// \returns the updated checksum.
+static uint32_t
+adler32(uint32_t adler, uint8_t const* data, size_t n)
+{
+  uint32_t a = adler & 0xffff;
+  uint32_t b = adler >> 16;
+
+  while (n) {
+    // 5552 is the most bytes before b might overflow
+    size_t k = std::min<size_t>(n, 5552);
+    n -= k;
+    while (k--) {
+      a += *data++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return (b << 16) | a;
+}
+//-------------------------------------------------------------------------
+/// Writes bytes to a version 2 ASTORE file, and adds them to the size
+/// and checksum of a directory entry.
+///
+/// \returns `true` if successful, `false` otherwise.
+static bool
+astore_write(FILE* fp, void const* data, size_t n, AstoreEntry& entry)
+{
+  entry.size += n;
+  entry.checksum = adler32(entry.checksum, (uint8_t const*) data, n);
+  return !n || fwrite(data, 1, n, fp) == n;
+}
+//-------------------------------------------------------------------------
+/// Writes the data of a value to a version 2 ASTORE file, and fills
+/// in its directory entry except for the name.
+///
+/// \param fp is the file, open for reading and writing.
+///
+/// \param iq is the symbol of the value.
+///
+/// \param compress says whether to Rice-compress integer arrays if that
+/// makes them smaller.
+///
+/// \param entry receives the directory entry.
+///
+/// \returns `true` if successful, `false` otherwise.
+static bool
+astore_value(FILE* fp, int32_t iq, bool compress, AstoreEntry& entry)
+{
+  entry.symclass = symbol_class(iq);
+  entry.type = symbol_type(iq);
+  entry.dims.clear();
+  entry.encoding = ASTORE_RAW;
+  entry.offset = ftello(fp);
+  entry.size = 0;
+  entry.checksum = 1;
+  switch (symbol_class(iq)) {
+    case LUX_UNDEFINED:
+      return true;
+    case LUX_SCALAR:
+      return astore_write(fp, &scalar_value(iq), lux_type_size[entry.type],
+                          entry);
+    case LUX_STRING:
+      return astore_write(fp, string_value(iq), string_size(iq), entry);
+    case LUX_ARRAY:
+      {
+        Symboltype type = array_type(iq);
+        size_t n = array_size(iq);
+
+        entry.dims.assign(array_dims(iq), array_dims(iq) + array_num_dims(iq));
+        if (isStringType(type)) { // length and text of each string
+          char** p = (char**) array_data(iq);
+          for (size_t i = 0; i < n; i++) {
+            int32_t length = p[i]? strlen(p[i]): 0;
+            if (!astore_write(fp, &length, sizeof(length), entry)
+                || !astore_write(fp, p[i], length, entry))
+              return false;
+          }
+          return true;
+        }
+        size_t nbytes = n*lux_type_size[type];
+        if (compress && nbytes >= 25 && nbytes <= INT32_MAX
+            && (type == LUX_INT8 || type == LUX_INT16
+#if SIZEOF_LONG_LONG_INT == 8   // 64-bit integers
+                || type == LUX_INT32
+#endif
+                )) {
+          // keep the compressed data only if they are smaller
+          int32_t nx = array_dims(iq)[0];
+          std::vector<uint8_t> crunched(nbytes);
+          int32_t size = rice_compress(crunched.data(),
+                                       (uint8_t*) array_data(iq), type,
+                                       false, crunch_slice, nx, n/nx,
+                                       nbytes);
+          if (size > 0 && (size_t) size < nbytes) {
+            entry.encoding = ASTORE_RICE;
+            return astore_write(fp, crunched.data(), size, entry);
+          }
+        }
+        return astore_write(fp, array_data(iq), nbytes, entry);
+      }
+    default:                    // the symbol record, as in version 1
+      {
+        astore_one(fp, iq);
+        entry.encoding = ASTORE_SYMBOL;
+        entry.size = ftello(fp) - entry.offset;
+        std::vector<uint8_t> record(entry.size);
+        if (fseeko(fp, entry.offset, SEEK_SET)
+            || fread(record.data(), 1, record.size(), fp) != record.size()
+            || fseeko(fp, 0, SEEK_END))
+          return false;
+        entry.checksum = adler32(1, record.data(), record.size());
+        return true;
+      }
+  }
+}
+//-------------------------------------------------------------------------
+/// Writes the directory of a version 2 ASTORE file.
+///
+/// \returns `true` if successful, `false` otherwise.
+static bool
+astore_write_directory(FILE* fp, std::vector<AstoreEntry> const& entries)
+{
+  bool ok = true;
+  auto put = [fp, &ok](void const* data, size_t n) {
+    ok = ok && (!n || fwrite(data, 1, n, fp) == n);
+  };
+
+  for (auto const& e : entries) {
+    int32_t length = e.name.size();
+    put(&length, sizeof(length));
+    put(e.name.data(), length);
+    int32_t fields[] = { e.symclass, e.type, e.encoding,
+                         (int32_t) e.dims.size() };
+    put(fields, sizeof(fields));
+    put(e.dims.data(), e.dims.size()*sizeof(int32_t));
+    int64_t where[] = { e.offset, e.size };
+    put(where, sizeof(where));
+    put(&e.checksum, sizeof(e.checksum));
+  }
+  return ok;
+}
+//-------------------------------------------------------------------------
 int32_t astore(ArgumentCount narg, Symbol ps[], int32_t flag)
-/* STORE,x1 [, x2, x3, ...], file
+/* ASTORE,x1 [, x2, x3, ...], file [, /COMPRESS]
   stores arbitrary data <x1>, <x2>, etcetera in file <file>.  The names
-  (if any) as well as the data are stored.  LS 11mar97 */
-// currently BIGENDIAN/LITTLEENDIAN is disregarded.
+  (if any) as well as the data are stored, followed by a directory
+  that says where the data of each value are.  /COMPRESS
+  Rice-compresses integer arrays if that makes them smaller.  LS
+  11mar97 */
 // <flag> is 1 for a subroutine, 0 for a function
 /* Headers:
    <stdio.h>: FILE, fopen(), perror(), printf(), fwrite(), fclose()
-   <string.h>: strlen()
  */
 {
-  int32_t        iq, i, intro[2], n;
-  char const* file, *name;
+  int32_t        iq, i;
+  char const* file;
   FILE        *fp;
 
   iq = ps[narg - 1];                // file name
@@ -4200,7 +4569,7 @@ int32_t astore(ArgumentCount narg, Symbol ps[], int32_t flag)
       return flag? cerror(ILL_CLASS, iq): LUX_ZERO;
   }
   // all arguments are OK for storing
-  fp = fopen(expand_name(file, NULL), "w");
+  fp = fopen(expand_name(file, NULL), "w+");
   if (!fp) {
     if (flag) {
       perror("System message:");
@@ -4209,24 +4578,27 @@ int32_t astore(ArgumentCount narg, Symbol ps[], int32_t flag)
     } else
       return LUX_ZERO;
   }
-  intro[0] = 0x6666aaaa;        // identification
-  intro[1] = narg;
-  fwrite(intro, sizeof(int32_t), 2, fp);
-  for (i = 0; i < narg; i++) {
+  // the header: identification, version, number of values, and the
+  // offset of the directory, which we fill in at the end
+  int32_t intro[3] = { (int32_t) astore_magic_2, 2, narg };
+  int64_t diroffset = 0;
+  bool ok = fwrite(intro, sizeof(int32_t), 3, fp) == 3
+    && fwrite(&diroffset, sizeof(diroffset), 1, fp) == 1;
+  std::vector<AstoreEntry> entries(narg);
+  for (i = 0; ok && i < narg; i++) {
     iq = ps[i];
-    if (iq < NAMED_END) {        // a named variable
-      name = symbolProperName(iq);
-      n = strlen(name) + 1;
-      fwrite(&n, sizeof(int32_t), 1, fp); // the name length
-      fwrite(name, sizeof(char), n, fp); // write the name
-    } else {                        // unnamed
-      n = 0;
-      fwrite(&n, sizeof(int32_t), 1, fp);
-    }
-    iq = transfer(iq);
-    astore_one(fp, iq);
+    if (iq < NAMED_END)                // a named variable
+      entries[i].name = symbolProperName(iq);
+    ok = astore_value(fp, transfer(iq), internalMode & 1, entries[i]);
   }
-  fclose(fp);
+  if (ok) {
+    diroffset = ftello(fp);
+    ok = astore_write_directory(fp, entries)
+      && !fseeko(fp, sizeof(intro), SEEK_SET)
+      && fwrite(&diroffset, sizeof(diroffset), 1, fp) == 1;
+  }
+  if (fclose(fp) || !ok)
+    return flag? cerror(WRITE_ERR, ps[narg]): LUX_ZERO;
   return flag? LUX_ONE: 1;
 }
 //-------------------------------------------------------------------------
@@ -4311,8 +4683,10 @@ int32_t arestore_one(FILE* fp, int32_t iq, int32_t reverseOrder)
     if (!fread(p.ui8, n, 1, fp))
       return 1;
     n = file_map_num_dims(iq);
-    endian(file_map_dims(iq), n*sizeof(int32_t), LUX_INT32);
-    endian(&file_map_offset(iq), sizeof(int32_t), LUX_INT32);
+    if (reverseOrder) {
+      endian(file_map_dims(iq), n*sizeof(int32_t), LUX_INT32);
+      endian(&file_map_offset(iq), sizeof(int32_t), LUX_INT32);
+    }
     break;
   case LUX_CLIST:
     if (!fread(&n, sizeof(int32_t), 1, fp))
@@ -4332,32 +4706,432 @@ int32_t arestore_one(FILE* fp, int32_t iq, int32_t reverseOrder)
   return 0;
 }
 //-------------------------------------------------------------------------
+/// Swaps the byte order of data values read from an ASTORE file that
+/// was written on a machine with the other byte order.
+///
+/// \param data points at the values.
+///
+/// \param nbytes is the number of bytes.
+///
+/// \param type is the data type.  The parts of complex values are
+/// swapped separately.
+static void
+astore_swap(void* data, int32_t nbytes, int32_t type)
+{
+  if (isComplexType(type))
+    type = (type == LUX_CFLOAT)? LUX_FLOAT: LUX_DOUBLE;
+  endian(data, nbytes, type);
+}
+//-------------------------------------------------------------------------
+/// Reads the directory of a version 2 ASTORE file.
+///
+/// \param fp is the file.
+///
+/// \param reverse says whether the file has the other byte order.
+///
+/// \param nvalue is the number of entries.
+///
+/// \param offset is the file offset of the directory.
+///
+/// \param entries receives the entries.
+///
+/// \returns `true` if successful, `false` if the directory could not be
+/// read or is damaged.
+static bool
+astore_read_directory(FILE* fp, bool reverse, int32_t nvalue, int64_t offset,
+                      std::vector<AstoreEntry>& entries)
+{
+  bool ok = nvalue >= 0 && offset > 0 && !fseeko(fp, offset, SEEK_SET);
+  auto get = [fp, reverse, &ok](auto& value) {
+    ok = ok && fread(&value, sizeof(value), 1, fp) == 1;
+    if (reverse)
+      endian(&value, sizeof(value), sizeof(value) == 8? LUX_INT64: LUX_INT32);
+  };
+
+  entries.resize(ok? nvalue: 0);
+  for (auto& e : entries) {
+    int32_t length, ndim;
+    get(length);
+    if (!ok || length < 0 || length > 65536)
+      return false;
+    e.name.resize(length);
+    ok = !length || fread(&e.name[0], length, 1, fp) == 1;
+    get(e.symclass);
+    get(e.type);
+    get(e.encoding);
+    get(ndim);
+    if (!ok || ndim < 0 || ndim > MAX_DIMS
+        || e.type < LUX_INT8 || e.type > LUX_CDOUBLE)
+      return false;
+    e.dims.resize(ndim);
+    for (auto& d : e.dims)
+      get(d);
+    get(e.offset);
+    get(e.size);
+    get(e.checksum);
+    if (!ok || e.offset < 0 || e.size < 0)
+      return false;
+  }
+  return ok;
+}
+//-------------------------------------------------------------------------
+/// Turns a variable into a read-only file array (file map) for array
+/// data stored without compression in a version 2 ASTORE file.
+///
+/// \param iq is the variable.
+///
+/// \param e is the directory entry of the data.
+///
+/// \param reverse says whether the file has the other byte order.
+///
+/// \param path is the full name of the file.
+///
+/// \returns `true` if successful, `false` otherwise.
+static bool
+arestore_map(int32_t iq, AstoreEntry const& e, bool reverse, char const* path)
+{
+  int32_t mq = sizeof(Array) + sizeof(int32_t) + strlen(path) + 1;
+  Array* h = (Array*) calloc(1, mq);
+  if (!h)
+    return false;
+  undefine(iq);
+  symbol_class(iq) = LUX_FILEMAP;
+  file_map_type(iq) = (Symboltype) e.type;
+  symbol_memory(iq) = mq;
+  file_map_header(iq) = h;
+  set_file_map_readonly(iq);
+  if (reverse)
+    set_file_map_swap(iq);
+  set_file_map_has_offset(iq);
+  file_map_offset(iq) = e.offset;
+  file_map_num_dims(iq) = e.dims.size();
+  memcpy(file_map_dims(iq), e.dims.data(), e.dims.size()*sizeof(int32_t));
+  strcpy(file_map_file_name(iq), path);
+  return true;
+}
+//-------------------------------------------------------------------------
+/// Restores a value from a version 2 ASTORE file.
+///
+/// \param fp is the file.
+///
+/// \param e is the directory entry of the value.
+///
+/// \param reverse says whether the file has the other byte order.
+///
+/// \param iq is the variable that receives the value.
+///
+/// \param path is the full name of the file if uncompressed numerical
+/// arrays should become file arrays (see arestore_map()), or `NULL` if
+/// they should be read.
+///
+/// \returns `NULL` if successful, or else an error message.
+static char const*
+arestore_value(FILE* fp, AstoreEntry const& e, bool reverse, int32_t iq,
+               char const* path)
+{
+  std::vector<uint8_t> buffer;
+
+  // reads the data, or just checks them if they're already read into
+  // <data>
+  auto get = [fp, &e](void* data, size_t n, bool read) {
+    return (size_t) e.size == n
+      && (!read || !n || fread(data, n, 1, fp) == 1)
+      && adler32(1, (uint8_t const*) data, n) == e.checksum;
+  };
+
+  if (path && e.symclass == LUX_ARRAY && e.encoding == ASTORE_RAW
+      && !isStringType(e.type) && e.offset <= INT32_MAX)
+    return arestore_map(iq, e, reverse, path)? NULL: "Memory allocation error";
+
+  undefine(iq);
+  if (fseeko(fp, e.offset, SEEK_SET))
+    return "File positioning error";
+  if (e.encoding == ASTORE_SYMBOL) {
+    buffer.resize(e.size);
+    if (!get(buffer.data(), buffer.size(), true))
+      return "Read or checksum error";
+    if (fseeko(fp, e.offset, SEEK_SET) || arestore_one(fp, iq, reverse))
+      return "Read error";
+    return NULL;
+  }
+  switch (e.symclass) {
+    case LUX_UNDEFINED:
+      return NULL;
+    case LUX_SCALAR:
+      {
+        Scalar value;
+        if (!isRealType(e.type)
+            || !get(&value, lux_type_size[e.type], true))
+          return "Read or checksum error";
+        if (reverse)
+          endian(&value, lux_type_size[e.type], e.type);
+        redef_scalar(iq, (Symboltype) e.type, &value);
+        return NULL;
+      }
+    case LUX_STRING:
+      if (e.size > INT32_MAX - 1)
+        return "Read error";
+      redef_string(iq, e.size);
+      string_value(iq)[e.size] = '\0';
+      return get(string_value(iq), e.size, true)? NULL:
+        "Read or checksum error";
+    case LUX_ARRAY:
+      {
+        size_t n = 1;
+        for (int32_t d : e.dims)
+          n *= d;
+        if (e.dims.empty() || !n
+            || redef_array(iq, (Symboltype) e.type, e.dims.size(),
+                           (int32_t*) e.dims.data()) == LUX_ERROR)
+          return "Cannot create the array";
+        if (isStringType(e.type)) { // length and text of each string
+          buffer.resize(e.size);
+          if (!get(buffer.data(), buffer.size(), true))
+            return "Read or checksum error";
+          char** p = (char**) array_data(iq);
+          uint8_t const* q = buffer.data();
+          uint8_t const* end = q + buffer.size();
+          for (size_t i = 0; i < n; i++) {
+            int32_t length;
+            if (end - q < (ptrdiff_t) sizeof(length))
+              return "Damaged string array";
+            memcpy(&length, q, sizeof(length));
+            q += sizeof(length);
+            if (reverse)
+              endian(&length, sizeof(length), LUX_INT32);
+            if (length < 0 || end - q < length)
+              return "Damaged string array";
+            if (length) {
+              p[i] = (char*) malloc(length + 1);
+              if (!p[i])
+                return "Memory allocation error";
+              memcpy(p[i], q, length);
+              p[i][length] = '\0';
+              q += length;
+            }
+          }
+          return NULL;
+        }
+        size_t nbytes = n*lux_type_size[e.type];
+        if (e.encoding == ASTORE_RICE) {
+          buffer.resize(e.size);
+          if (e.size < 14 || !get(buffer.data(), buffer.size(), true))
+            return "Read or checksum error";
+          if (!rice_decompress(buffer.data() + 14, (uint8_t*) array_data(iq),
+                               (Symboltype) e.type, false, buffer[12],
+                               e.dims[0], n/e.dims[0]))
+            return "Decompression error";
+          return NULL;
+        }
+        if (!get(array_data(iq), nbytes, true))
+          return "Read or checksum error";
+        if (reverse)
+          astore_swap(array_data(iq), nbytes, e.type);
+        return NULL;
+      }
+    default:
+      return "Unsupported class of data";
+  }
+}
+//-------------------------------------------------------------------------
+/// Restores values from a version 1 ASTORE file, whose header has
+/// been read already.
+///
+/// \param fp is the file.
+///
+/// \param reverse says whether the file has the other byte order.
+///
+/// \param nvalue is the number of values in the file.
+///
+/// \param narg is the number of variables to restore into.
+///
+/// \param ps points at the variables to restore into.
+///
+/// \param names has the names of the values to restore, or is empty
+/// to restore all values.
+///
+/// \param flag is 1 for the subroutine, 0 for the function.
+///
+/// \returns the return value for arestore().
+static int32_t
+arestore_1(FILE* fp, bool reverse, int32_t nvalue, int32_t narg, Symbol ps[],
+           std::vector<std::string> const& names, int32_t flag)
+{
+  std::vector<bool> found(names.size());
+  size_t nfound = 0;
+
+  if (narg && names.empty() && narg < nvalue)
+    nvalue = narg;                // the number of variables to restore
+  // there is no directory, so we must read through the file
+  for (int32_t i = 0;
+       i < nvalue && (names.empty() || nfound < names.size()); i++) {
+    int32_t n, iq;
+
+    if (!fread(&n, sizeof(int32_t), 1, fp))  // size of name
+      return flag? cerror(READ_ERR, 0): LUX_ZERO;
+    if (reverse)
+      endian(&n, sizeof(int32_t), LUX_INT32);
+    if (n < 0)
+      return flag? cerror(READ_ERR, 0): LUX_ZERO;
+    std::string name(n, '\0');
+    if (n && !fread(&name[0], n, 1, fp))
+      return flag? cerror(READ_ERR, 0): LUX_ZERO;
+    name.resize(strlen(name.c_str())); // the stored name includes the \0
+
+    bool skip = false;
+    if (!names.empty()) {
+      size_t k = std::find(names.begin(), names.end(), name) - names.begin();
+      if (k < names.size() && !found[k]) {
+        found[k] = true;
+        nfound++;
+        if (!narg)
+          iq = findVarName(name.c_str(), curContext);
+        else if (k < (size_t) narg)
+          iq = ps[k];
+        else
+          skip = true;
+      } else
+        skip = true;
+    } else if (narg)
+      iq = ps[i];
+    else if (name.empty())        // cannot restore to its name
+      skip = true;
+    else
+      iq = findVarName(name.c_str(), curContext);
+    if (skip)                        // read it into a scratch variable
+      iq = nextFreeTempVariable();
+    if (iq < 0)
+      return flag? LUX_ERROR: LUX_ZERO;
+    undefine(iq);                 // get rid of previous contents, if any
+    if (arestore_one(fp, iq, reverse)) {
+      switch (errno) {
+      case ENOMEM:
+        return flag? cerror(ALLOC_ERR, 0): LUX_ZERO;
+      default:
+        return flag? cerror(READ_ERR, 0): LUX_ZERO;
+      }
+    }
+    if (skip)
+      zap(iq);
+  }
+  for (size_t k = 0; k < names.size(); k++)
+    if (!found[k] && (!narg || k < (size_t) narg))
+      return flag? luxerror("Variable %s not found in the file", 0,
+                            names[k].c_str()): LUX_ZERO;
+  return LUX_ONE;
+}
+//-------------------------------------------------------------------------
+/// Restores values from a version 2 ASTORE file, whose header up to
+/// the directory offset has been read already.
+///
+/// \param path is the full name of the file if uncompressed numerical
+/// arrays should become file arrays, or `NULL` if they should be read.
+///
+/// The other parameters are as for arestore_1().
+///
+/// \returns the return value for arestore().
+static int32_t
+arestore_2(FILE* fp, bool reverse, int32_t nvalue, int32_t narg, Symbol ps[],
+           std::vector<std::string> const& names, char const* path,
+           int32_t flag)
+{
+  int64_t diroffset;
+  std::vector<AstoreEntry> entries;
+
+  if (fread(&diroffset, sizeof(diroffset), 1, fp) != 1)
+    return flag? cerror(READ_ERR, 0): LUX_ZERO;
+  if (reverse)
+    endian(&diroffset, sizeof(diroffset), LUX_INT64);
+  if (!astore_read_directory(fp, reverse, nvalue, diroffset, entries))
+    return flag? luxerror("The directory of the file is damaged", 0):
+      LUX_ZERO;
+
+  // which values to restore, and where to
+  std::vector<std::pair<size_t, int32_t>> todo;
+  if (!names.empty()) {
+    size_t n = narg? std::min<size_t>(narg, names.size()): names.size();
+    for (size_t k = 0; k < n; k++) {
+      auto e = std::find_if(entries.begin(), entries.end(),
+                            [&names, k](AstoreEntry const& e) {
+                              return e.name == names[k];
+                            });
+      if (e == entries.end())
+        return flag? luxerror("Variable %s not found in the file", 0,
+                              names[k].c_str()): LUX_ZERO;
+      todo.emplace_back(e - entries.begin(),
+                        narg? ps[k]: findVarName(names[k].c_str(),
+                                                 curContext));
+    }
+  } else if (narg) {
+    for (int32_t i = 0; i < narg && i < nvalue; i++)
+      todo.emplace_back(i, ps[i]);
+  } else {
+    for (int32_t i = 0; i < nvalue; i++)
+      if (!entries[i].name.empty()) // cannot restore unnamed values
+        todo.emplace_back(i, findVarName(entries[i].name.c_str(),
+                                         curContext));
+  }
+
+  for (auto const& [i, iq] : todo) {
+    if (iq < 0)
+      return flag? LUX_ERROR: LUX_ZERO;
+    char const* message = arestore_value(fp, entries[i], reverse, iq, path);
+    if (message) {
+      undefine(iq);
+      return flag? luxerror("%s in value %d of the file", iq, message,
+                            (int32_t) i + 1): LUX_ZERO;
+    }
+  }
+  return LUX_ONE;
+}
+//-------------------------------------------------------------------------
 int32_t arestore(ArgumentCount narg, Symbol ps[], int32_t flag)
-/* ARESTORE [, x1, x2, x3, ...], file
+/* ARESTORE [, x1, x2, x3, ...], file [, NAMES=names, /MAP]
   restores data <x1>, <x2>, etcetera from file <file>.
   if no data arguments are specified, then the whole contents of
   the file is restored to the variables with the names that are
   also stored in the file.  If data arguments are specified, then
   only the first that many variables are restored and the orgininal
   names associated with the stored variables are ignored.  LS 11mar97 */
-// the one-argument case is currently disallowed due to context
-// problems.  LS 13mar97
+// If <names> (a string or string array) is specified, then only the
+// stored variables with those names are restored, to the data
+// arguments if any, or else to variables with those names.  /MAP turns
+// uncompressed numerical arrays into file arrays instead of reading
+// them.  Version 2 files have a directory, so then only the selected
+// variables are read; version 1 files must be read from the start.
 // flag = 1 -> subroutine
 /* Headers:
-   <stdio.h>: FILE, perror(), fclose(), fseek(), NULL
-   <stdlib.h>: malloc(), free()
+   <stdio.h>: FILE, perror(), fclose(), fopen(), NULL
  */
 {
-  int32_t        iq, i, intro[2], n, nvalue;
-  char        *file, *name, reverseOrder;
-  FILE        *fp;
+  int32_t        iq;
+  uint32_t        intro[2];
+  int32_t        nvalue, result;
+  char const* file;
+  std::vector<std::string> names;
 
   iq = ps[narg - 1];                // file name
   if (symbol_class(iq) != LUX_STRING) // filename is not a string
     return flag? cerror(NEED_STR, iq): LUX_ZERO;
   file = string_arg(iq);
-  --narg;
-  fp = openPathFile(file, 0);
+  if (ps[0]) {                        // NAMES
+    if (symbolIsStringScalar(ps[0]))
+      names.push_back(string_value(ps[0]));
+    else if (symbolIsStringArray(ps[0])) {
+      char** p = (char**) array_data(ps[0]);
+      for (size_t i = 0; i < (size_t) array_size(ps[0]); i++)
+        names.push_back(p[i]? p[i]: "");
+    } else
+      return flag? cerror(NEED_STR, ps[0]): LUX_ZERO;
+  }
+  ps++;                                // skip NAMES
+  narg -= 2;                        // the number of data arguments
+  for (int32_t i = 0; i < narg; i++) // all must be named variables
+    if (ps[i] >= NAMED_END)
+      return flag? luxerror("Need a named variable", ps[i]): LUX_ZERO;
+  // the file is data, so we do not seek it along the routine path
+  std::string path = expand_name(file, NULL);
+  FILE* fp = fopen(path.c_str(), "rb");
   if (!fp) {                        // could not open file for reading
     if (flag) {
       perror("System message:");
@@ -4365,66 +5139,33 @@ int32_t arestore(ArgumentCount narg, Symbol ps[], int32_t flag)
     } else
       return LUX_ZERO;
   }
-  if (!fread(intro, 2*sizeof(int32_t), 1, fp)) // some error
-    return flag? cerror(READ_ERR, 0): LUX_ZERO;
-  if (intro[0] == 0x6666aaaa)        // native Byte order
-    reverseOrder = 0;
-  else if (intro[0] == 0xaaaa6666) // reversed Byte order
-    reverseOrder = 1;
-  else {                        // wrong magic number
+  if (!fread(intro, 2*sizeof(int32_t), 1, fp)) { // some error
     fclose(fp);
-    return flag? luxerror("Not ASTORE file format", iq): LUX_ZERO;
+    return flag? cerror(READ_ERR, 0): LUX_ZERO;
   }
-  nvalue = intro[1];                // number of variables in the file
-  if (reverseOrder)
-    endian((uint8_t *) &nvalue, sizeof(int32_t), LUX_INT32);
-  if (narg && narg < nvalue)
-    nvalue = narg;                // the number of variables to restore
-  if (narg)                        // all arguments must be named variables
-    for (i = 0; i < nvalue; i++)
-      if (ps[i] >= NAMED_END) {        // not a named variable
-        fclose(fp);
-        return flag? luxerror("Need a named variable", ps[i]): LUX_ZERO;
-      }
-  for (i = 0; i < nvalue; i++) {
-    if (!fread(&n, sizeof(int32_t), 1, fp))  // size of name
-      return flag? cerror(READ_ERR, 0): LUX_ZERO;
-    if (reverseOrder)
-      endian(&n, sizeof(int32_t), LUX_INT32);
-    if (!narg) {                // reading all of them: restore original
-                                // names
-      name = (char *) malloc(n);
-      if (!fread(name, n, 1, fp)) { // reading the name failed
-        free(name);
-        return flag? cerror(READ_ERR, 0): LUX_ZERO;
-      }
-      if ((iq = findVarName(name, curContext)) < 0) { /* could not get
-                                                         variable */
-        fclose(fp);
-        free(name);
-        return flag? LUX_ERROR: LUX_ZERO;
-      }
-      free(name);
-    } else {                        // assign value to the next argument
-      // skip the name
-      if (fseek(fp, n, SEEK_CUR)) { // some file positioning error
-        fclose(fp);
-        return flag? LUX_ERROR: LUX_ZERO;
-      }
-      iq = ps[i];
-    }
-    undefine(iq);                 // get rid of previous contents, if any
-    if (arestore_one(fp, iq, curContext)) {
-      switch (errno) {
-      case ENOMEM:
-        return flag? cerror(ALLOC_ERR, 0): LUX_ZERO;
-      default:
-        return flag? cerror(READ_ERR, 0): LUX_ZERO;
-      }
-    }
+  bool reverse = false;
+  switch (intro[0]) {
+    case 0xaaaa6666: case 0xabaa6666: // reversed Byte order
+      reverse = true;
+      endian(intro, sizeof(intro), LUX_INT32);
+      break;
   }
+  if (intro[0] == astore_magic_1) {
+    nvalue = intro[1];                // number of variables in the file
+    result = arestore_1(fp, reverse, nvalue, narg, ps, names, flag);
+  } else if (intro[0] == astore_magic_2 && intro[1] == 2) {
+    if (!fread(&nvalue, sizeof(int32_t), 1, fp))
+      result = flag? cerror(READ_ERR, 0): LUX_ZERO;
+    else {
+      if (reverse)
+        endian(&nvalue, sizeof(int32_t), LUX_INT32);
+      result = arestore_2(fp, reverse, nvalue, narg, ps, names,
+                          (internalMode & 1)? path.c_str(): NULL, flag);
+    }
+  } else                        // wrong magic number or version
+    result = flag? luxerror("Not ASTORE file format", iq): LUX_ZERO;
   fclose(fp);
-  return LUX_ONE;
+  return result;
 }
 //-------------------------------------------------------------------------
 int32_t lux_arestore(ArgumentCount narg, Symbol ps[])
@@ -5249,12 +5990,18 @@ int32_t lux_identify_file(ArgumentCount narg, Symbol ps[])
         type = FILE_TYPE_SUN_RAS;
       break;
     case 102:                        // LUX astore file?
-      if (buf[1] == 102 && buf[2] == 170 && buf[3] == 170)
+      if (buf[1] == 102 && buf[2] == 170 && (buf[3] == 170 || buf[3] == 171))
         type = FILE_TYPE_ANA_ASTORE;
       break;
-    case 170:                        // LUX fz?
+    case 170:                        // LUX fz or littleendian astore?
       if (buf[1] == 170 && buf[2] == 85 && buf[3] == 85)
         type = FILE_TYPE_ANA_FZ;
+      else if (buf[1] == 170 && buf[2] == 102 && buf[3] == 102)
+        type = FILE_TYPE_ANA_ASTORE;
+      break;
+    case 171:                        // littleendian astore version 2?
+      if (buf[1] == 170 && buf[2] == 102 && buf[3] == 102)
+        type = FILE_TYPE_ANA_ASTORE;
       break;
     case 255:                        // JPEG?
       if (buf[1] == 216 && buf[2] == 255 && buf[3] == 224)
@@ -5721,9 +6468,337 @@ void apply_bscale_bzero_blank(uint8_t *ptr, int32_t nelem, float bscale, float b
   }
 }
 //-------------------------------------------------------------------------
-int32_t fits_read(int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, float);
+/// Returns a value stored in big-endian byte order, as FITS data are.
+///
+/// \tparam T is the type of the value.
+///
+/// \param p points at the first byte of the value.
+///
+/// \returns the value.
+template<typename T>
+static inline T
+fits_value(uint8_t const* p)
+{
+  typedef std::conditional_t<sizeof(T) == 1, uint8_t,
+    std::conditional_t<sizeof(T) == 2, uint16_t,
+    std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>> U;
+  U u = 0;
+  for (size_t i = 0; i < sizeof(T); ++i)
+    u = (u << 8) | p[i];
+  T t;
+  memcpy(&t, &u, sizeof(t));
+  return t;
+}
+//-------------------------------------------------------------------------
+/// Converts FITS data values from big-endian raw values to the values
+/// of the target array, applying BSCALE, BZERO, and BLANK on the way.
+///
+/// \tparam In is the type of the raw values.
+///
+/// \tparam Out is the type of the target values.
+///
+/// \param raw points at the raw values.
+///
+/// \param n is the number of values.
+///
+/// \param out points at the target values.
+///
+/// \param scale says whether to apply \a bscale, \a bzero, and \a
+/// blank.
+///
+/// \param bscale is the scale factor.
+///
+/// \param bzero is the offset.
+///
+/// \param blank is the raw integer value that indicates a missing
+/// value.
+///
+/// \param targetblank is the target value for missing values.
+template<typename In, typename Out>
+static void
+fits_convert(uint8_t const* raw, size_t n, Out* out, bool scale,
+             double bscale, double bzero, double blank, double targetblank)
+{
+  if (!scale) {
+    for (size_t i = 0; i < n; ++i)
+      out[i] = fits_value<In>(raw + i*sizeof(In));
+  } else if (std::is_integral_v<In>) {
+    for (size_t i = 0; i < n; ++i) {
+      In v = fits_value<In>(raw + i*sizeof(In));
+      out[i] = (v == blank)? targetblank: v*bscale + bzero;
+    }
+  } else {
+    for (size_t i = 0; i < n; ++i)
+      out[i] = fits_value<In>(raw + i*sizeof(In))*bscale + bzero;
+  }
+}
+//-------------------------------------------------------------------------
+/// Calls fits_convert() for the type of the target values.
+///
+/// \tparam In is the type of the raw values.
+///
+/// \param type is the type of the target values.
+///
+/// \param out points at the target values.
+///
+/// The other parameters are as for fits_convert().
+template<typename In>
+static void
+fits_convert(Symboltype type, uint8_t const* raw, size_t n, void* out,
+             bool scale, double bscale, double bzero, double blank,
+             double targetblank)
+{
+  switch (type) {
+    case LUX_INT8:
+      fits_convert<In>(raw, n, (uint8_t*) out, scale, bscale, bzero, blank,
+                       targetblank);
+      break;
+    case LUX_INT16:
+      fits_convert<In>(raw, n, (int16_t*) out, scale, bscale, bzero, blank,
+                       targetblank);
+      break;
+    case LUX_INT32:
+      fits_convert<In>(raw, n, (int32_t*) out, scale, bscale, bzero, blank,
+                       targetblank);
+      break;
+    case LUX_INT64:
+      fits_convert<In>(raw, n, (int64_t*) out, scale, bscale, bzero, blank,
+                       targetblank);
+      break;
+    case LUX_FLOAT:
+      fits_convert<In>(raw, n, (float*) out, scale, bscale, bzero, blank,
+                       targetblank);
+      break;
+    case LUX_DOUBLE:
+      fits_convert<In>(raw, n, (double*) out, scale, bscale, bzero, blank,
+                       targetblank);
+      break;
+    default:
+      break;
+  }
+}
+//-------------------------------------------------------------------------
+/// Calls fits_convert() for the types of the raw and target values.
+///
+/// \param type0 is the type of the raw values.
+///
+/// \param type is the type of the target values.
+///
+/// The other parameters are as for fits_convert().
+static void
+fits_convert(Symboltype type0, Symboltype type, uint8_t const* raw, size_t n,
+             void* out, bool scale, double bscale, double bzero, double blank,
+             double targetblank)
+{
+  switch (type0) {
+    case LUX_INT8:
+      fits_convert<uint8_t>(type, raw, n, out, scale, bscale, bzero, blank,
+                            targetblank);
+      break;
+    case LUX_INT16:
+      fits_convert<int16_t>(type, raw, n, out, scale, bscale, bzero, blank,
+                            targetblank);
+      break;
+    case LUX_INT32:
+      fits_convert<int32_t>(type, raw, n, out, scale, bscale, bzero, blank,
+                            targetblank);
+      break;
+    case LUX_INT64:
+      fits_convert<int64_t>(type, raw, n, out, scale, bscale, bzero, blank,
+                            targetblank);
+      break;
+    case LUX_FLOAT:
+      fits_convert<float>(type, raw, n, out, scale, bscale, bzero, blank,
+                          targetblank);
+      break;
+    case LUX_DOUBLE:
+      fits_convert<double>(type, raw, n, out, scale, bscale, bzero, blank,
+                           targetblank);
+      break;
+    default:
+      break;
+  }
+}
+//-------------------------------------------------------------------------
+/// A read-only memory mapping of a whole file, which is unmapped when
+/// the FileMapping goes out of scope.
+struct FileMapping
+{
+  uint8_t const* data = nullptr; //!< The mapped bytes, or `nullptr`.
+  size_t size = 0;              //!< The number of mapped bytes.
+
+  /// Maps a file into memory.
+  ///
+  /// \param fp is the file.
+  ///
+  /// \returns `true` for success, `false` for failure.
+  bool
+  map(FILE* fp)
+  {
+#if HAVE_MMAP
+    struct stat st;
+    if (fstat(fileno(fp), &st) || st.st_size <= 0)
+      return false;
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+    if (p == MAP_FAILED)
+      return false;
+    data = (uint8_t const*) p;
+    size = st.st_size;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  ~FileMapping()
+  {
+#if HAVE_MMAP
+    if (data)
+      munmap((void*) data, size);
+#endif
+  }
+};
+//-------------------------------------------------------------------------
+/// Reads the elements of a Hyperslab of an array stored in a file and
+/// hands them to a function, in runs of adjacent elements.  Only the
+/// selected parts of the file are read, except that runs separated by
+/// small gaps are read together.
+///
+/// \tparam F is the type of the callable.
+///
+/// \param fp is the file.
+///
+/// \param offset is the offset of the array from the start of the file
+/// or of \a map, in bytes.
+///
+/// \param slab is the selection.
+///
+/// \param elsize is the size of an element of the array in the file, in
+/// bytes.
+///
+/// \param record is the number of elements that \a f must get
+/// together, such as the bytes of a table field.  Runs are a multiple
+/// of it long, and are only split at multiples of it.
+///
+/// \param map points at the contents of the file (for example, a
+/// FileMapping), or is `nullptr` to read from \a fp.
+///
+/// \param map_size is the number of bytes at \a map.
+///
+/// \param f is the callable.  It is called as `f(raw, n, k)` for each
+/// run, where `raw` points at the `n` elements of the run and `k` is
+/// the number of selected elements before the run.
+///
+/// \returns `true` for success, `false` for a read error or if the
+/// selection extends beyond the end of \a map.
+template<typename F>
+static bool
+read_hyperslab(FILE* fp, off_t offset, Hyperslab const& slab, size_t elsize,
+               size_t record, uint8_t const* map, size_t map_size, F f)
+{
+  size_t done = 0;
+  if (map) {
+    // like a short fread(), a file that is shorter than its header
+    // says is an error
+    if (offset < 0 || (size_t) offset > map_size
+        || (slab.last() + 1)*elsize > map_size - offset)
+      return false;
+    slab.for_each_run([&](size_t first, size_t n) {
+      f(map + offset + first*elsize, n, done);
+      done += n;
+    });
+    return true;
+  }
+
+  const size_t buffer_size = 1 << 22; // bytes
+  const size_t max_gap = 1 << 13;     // bytes
+  std::vector<uint8_t> buffer;
+  std::vector<std::pair<size_t, size_t>> runs; // pending runs
+  bool ok = true;
+
+  // reads the pending runs
+  auto flush = [&]() {
+    if (runs.empty() || !ok)
+      return;
+    size_t begin = runs.front().first*elsize;
+    size_t end = (runs.back().first + runs.back().second)*elsize;
+    if (fseeko(fp, offset + begin, SEEK_SET))
+      ok = false;
+    else if (end - begin <= buffer_size) {
+      buffer.resize(end - begin);
+      if (fread(buffer.data(), 1, end - begin, fp) != end - begin)
+        ok = false;
+      else
+        for (auto const& run : runs) {
+          f(buffer.data() + run.first*elsize - begin, run.second, done);
+          done += run.second;
+        }
+    } else {                    // a single long run: read it in pieces
+      size_t n = runs.front().second;
+      size_t piece = std::max(buffer_size/elsize/record, (size_t) 1)*record;
+      buffer.resize(piece*elsize);
+      while (ok && n) {
+        size_t m = std::min(n, piece);
+        if (fread(buffer.data(), elsize, m, fp) != m)
+          ok = false;
+        else {
+          f(buffer.data(), m, done);
+          done += m;
+          n -= m;
+        }
+      }
+    }
+    runs.clear();
+  };
+
+  slab.for_each_run([&](size_t first, size_t n) {
+    if (!runs.empty()) {
+      size_t begin = runs.front().first*elsize;
+      size_t end = (runs.back().first + runs.back().second)*elsize;
+      if (first*elsize - end > max_gap
+          || (first + n)*elsize - begin > buffer_size)
+        flush();
+    }
+    runs.emplace_back(first, n);
+  });
+  flush();
+  return ok;
+}
+//-------------------------------------------------------------------------
+/// Reads the indices or counts for a FITS hyperslab from a LUX
+/// argument.
+///
+/// \param iq is the argument, or 0 if it was not specified.
+///
+/// \param ndim is the number of dimensions of the FITS array.
+///
+/// \param values points at where the values are stored.  Dimensions
+/// for which \a iq has no value get 0.
+///
+/// \returns `LUX_OK` for success, `LUX_ERROR` for failure.
+static int32_t
+fits_slab_argument(int32_t iq, int32_t ndim, int32_t* values)
+{
+  zerobytes(values, ndim*sizeof(int32_t));
+  if (!iq)
+    return LUX_OK;
+  int32_t n;
+  Pointer p;
+  iq = lux_long(1, &iq);
+  if (numerical(iq, NULL, NULL, &n, &p) < 0)
+    return LUX_ERROR;
+  if (n > ndim)
+    return luxerror("Found %d values for a FITS array with %d dimensions",
+                    iq, n, ndim);
+  memcpy(values, p.i32, n*sizeof(int32_t));
+  return LUX_OK;
+}
+//-------------------------------------------------------------------------
+int32_t fits_read(int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, float,
+                  int32_t = 0, int32_t = 0, int32_t = 0);
 int32_t lux_fits_read_general(ArgumentCount narg, Symbol ps[], int32_t func)// read fits files
- // status = fits_read(x, name, [h], [x2], [h2], [extvar_preamble])
+ // status = fits_read(x, name, [h], [x2], [h2], [extvar_preamble], [BLANK=],
+ //                    [START=], [COUNT=], [COLUMNS=])
 {
   int32_t        hsym = 0, mode, xhsym=0, xdsym =0;
   float        targetblank = 0.0;
@@ -5734,27 +6809,31 @@ int32_t lux_fits_read_general(ArgumentCount narg, Symbol ps[], int32_t func)// r
  64 bit: generate extension variables */
 
   mode = 2;
-  if (narg >= 3) {
+  if (narg > 2 && ps[2]) {
     mode = 3;
     hsym = ps[2];
   }
-  if (narg >= 4) {
+  if (narg > 3 && ps[3]) {
     mode = mode + 32;
     xdsym = ps[3];
   }
-  if (narg >= 5) {
+  if (narg > 4 && ps[4]) {
     mode = mode + 16;
-    xhsym = ps[3];
+    xhsym = ps[4];
   }
-  if (narg >= 6) {
+  if (narg > 5 && ps[5]) {
     mode = mode + 64;
     if (!symbolIsStringScalar(ps[5]))
       return func? LUX_ZERO: cerror(NEED_STR, ps[5]);
     preamble = string_value(ps[5]);
   }
-  if (narg >= 7)
+  if (narg > 6 && ps[6])
     targetblank = float_arg(ps[6]);
-  mode = fits_read(mode, ps[0], ps[1], hsym, 0, 0, xhsym, xdsym, targetblank);
+  if (narg > 9 && ps[9] && !symbolIsString(ps[9]))
+    return func? LUX_ZERO: cerror(NEED_STR, ps[9]);
+  mode = fits_read(mode, ps[0], ps[1], hsym, 0, 0, xhsym, xdsym, targetblank,
+                   narg > 7? ps[7]: 0, narg > 8? ps[8]: 0,
+                   narg > 9? ps[9]: 0);
   if (func)
     return (mode == LUX_ERROR)? LUX_ZERO: LUX_ONE;
   else
@@ -5830,11 +6909,213 @@ int32_t        anadecrunchrun8(uint8_t [], uint8_t [], int32_t, int32_t, int32_t
   anadecrunchrun(uint8_t *, int16_t [], int32_t, int32_t, int32_t),
   anadecrunch(uint8_t *, int16_t [], int32_t, int32_t, int32_t),
   anadecrunch32(uint8_t *, int32_t [], int32_t, int32_t, int32_t);
+//-------------------------------------------------------------------------
+/// Returns into how many slices of whole rows to cut data for Rice
+/// compression in a LUX FITS file.  Each slice is compressed and
+/// decompressed independently, so the slices can be processed by
+/// different threads.  The number of slices does not depend on the
+/// number of threads, so the file does not depend on it either.
+///
+/// \param ny is the number of rows.
+///
+/// \param nvalues is the number of data values.
+///
+/// \returns the number of slices, at least 1.
+static int32_t
+rice_slice_count(int32_t ny, size_t nvalues)
+{
+  const size_t min_per_slice = 1 << 18;
+  const size_t max_slices = 64;
+
+  size_t n = std::min({ (size_t) ny, nvalues/min_per_slice, max_slices });
+  return n? n: 1;
+}
+//-------------------------------------------------------------------------
+/// Returns the index of the first row of a slice, for data with \a ny
+/// rows cut into \a nslices slices.
+static int32_t
+rice_slice_row(int32_t slice, int32_t nslices, int32_t ny)
+{
+  return (int64_t) ny*slice/nslices;
+}
+//-------------------------------------------------------------------------
+/// Rice-compresses rows of data, with or without run-length encoding.
+///
+/// \param out points at the room for the compressed data, including
+/// the 14-byte compression header.
+///
+/// \param data points at the data, in big-endian byte order.
+///
+/// \param type is the data type, which must be #LUX_INT8, #LUX_INT16,
+/// or (if 64-bit integers are available) #LUX_INT32.
+///
+/// \param runlength says whether to use run-length encoding.
+///
+/// \param slice is the number of bits in the fixed part of each value.
+///
+/// \param nx is the number of values in each row.
+///
+/// \param ny is the number of rows.
+///
+/// \param limit is the number of bytes available at \a out.  It must be
+/// at least 25.
+///
+/// \returns the number of bytes of compressed data, or -1 if it would
+/// not fit or if \a type is not supported.
+static int32_t
+rice_compress(uint8_t* out, uint8_t* data, Symboltype type, bool runlength,
+              int32_t slice, int32_t nx, int32_t ny, int32_t limit)
+{
+  switch (type) {
+    case LUX_INT8:
+      return runlength? anacrunchrun8(out, data, slice, nx, ny, limit):
+        anacrunch8(out, data, slice, nx, ny, limit);
+    case LUX_INT16:
+      return runlength? anacrunchrun(out, (int16_t*) data, slice, nx, ny, limit):
+        anacrunch(out, (int16_t*) data, slice, nx, ny, limit);
+#if SIZEOF_LONG_LONG_INT == 8        // 64-bit integers
+    case LUX_INT32:
+      return runlength? -1: anacrunch32(out, (int32_t*) data, slice, nx, ny,
+                                        limit);
+#endif
+    default:
+      return -1;
+  }
+}
+//-------------------------------------------------------------------------
+/// Rice-decompresses rows of data compressed by rice_compress().
+///
+/// \param in points at the compressed data, just beyond the 14-byte
+/// compression header, or at the start of a slice.
+///
+/// \param out points at the room for the decompressed data, which are
+/// in big-endian byte order.
+///
+/// \param type is the data type.
+///
+/// \param runlength says whether run-length encoding was used.
+///
+/// \param slice is the number of bits in the fixed part of each value.
+///
+/// \param nx is the number of values in each row.
+///
+/// \param ny is the number of rows.
+///
+/// \returns `true` if successful, `false` otherwise.
+static bool
+rice_decompress(uint8_t* in, uint8_t* out, Symboltype type, bool runlength,
+                int32_t slice, int32_t nx, int32_t ny)
+{
+  switch (type) {
+    case LUX_INT8:
+      return (runlength? anadecrunchrun8(in, out, slice, nx, ny):
+              anadecrunch8(in, out, slice, nx, ny)) == 1;
+    case LUX_INT16:
+      return (runlength? anadecrunchrun(in, (int16_t*) out, slice, nx, ny):
+              anadecrunch(in, (int16_t*) out, slice, nx, ny)) == 1;
+#if SIZEOF_LONG_LONG_INT == 8        // 64-bit integers
+    case LUX_INT32:
+      return !runlength
+        && anadecrunch32(in, (int32_t*) out, slice, nx, ny) == 1;
+#endif
+    default:
+      return false;
+  }
+}
+//-------------------------------------------------------------------------
+/// Rice-compresses data in slices of whole rows, using several threads.
+/// The slices follow each other without gaps after a single compression
+/// header, so the result can be decompressed all at once, or one slice
+/// at a time.
+///
+/// \param out points at the room for the compressed data.
+///
+/// \param limit is the number of bytes available at \a out.
+///
+/// \param data points at the data, in native byte order.  The data are
+/// not modified.
+///
+/// \param nslices is the number of slices (see rice_slice_count()).
+///
+/// \param offsets receives the byte offset of each slice from \a out.
+///
+/// The other parameters are as for rice_compress().
+///
+/// \returns the number of bytes of compressed data, or -1 if it would
+/// not fit or if \a type is not supported.
+static int32_t
+rice_compress_slices(uint8_t* out, int32_t limit, uint8_t const* data,
+                     Symboltype type, bool runlength, int32_t slice,
+                     int32_t nx, int32_t ny, int32_t nslices,
+                     std::vector<int32_t>& offsets)
+{
+  switch (type) {
+    case LUX_INT8: case LUX_INT16:
+#if SIZEOF_LONG_LONG_INT == 8        // 64-bit integers
+    case LUX_INT32:
+#endif
+      break;
+    default:
+      return -1;
+  }
+
+  size_t rowsize = (size_t) nx*lux_type_size[type];
+  std::vector<std::vector<uint8_t>> parts(nslices);
+  std::vector<int32_t> sizes(nslices, -1);
+
+  parallel_chunks(parallel_thread_count(nslices), nslices,
+                  [&](size_t, size_t first, size_t last) {
+    std::vector<uint8_t> buffer;
+    for (size_t s = first; s < last; ++s) {
+      int32_t row = rice_slice_row(s, nslices, ny);
+      int32_t nrows = rice_slice_row(s + 1, nslices, ny) - row;
+      size_t n = nrows*rowsize;
+      // FITS data are big-endian, and the compressed data hold the
+      // big-endian values.  Work on a copy so the data stay unchanged.
+      buffer.assign(data + row*rowsize, data + row*rowsize + n);
+#if !WORDS_BIGENDIAN
+      endian(buffer.data(), n, type);
+#endif
+      // the same limit per slice as for the whole
+      int32_t partlimit = std::max<size_t>(2*n, 25);
+      parts[s].resize(partlimit);
+      sizes[s] = rice_compress(parts[s].data(), buffer.data(), type,
+                               runlength, slice, nx, nrows, partlimit);
+    }
+  });
+
+  // each part starts with its own compression header, which we drop
+  int32_t size = 14;
+  for (int32_t s = 0; s < nslices; s++) {
+    if (sizes[s] < 0 || size + sizes[s] - 14 > limit)
+      return -1;
+    offsets[s] = size;
+    memcpy(out + size, parts[s].data() + 14, sizes[s] - 14);
+    size += sizes[s] - 14;
+  }
+
+  // the compression header: total size, number of rows, row length, all
+  // little-endian, then the slice width and compression type
+  int32_t head[3] = { size, ny, nx };
+#if WORDS_BIGENDIAN
+  swapl(head, 3);
+#endif
+  memcpy(out, head, sizeof(head));
+  out[12] = slice;
+  out[13] = parts[0][13];
+  return size;
+}
+//-------------------------------------------------------------------------
+/// If set, then fits_read_compressed() calls this with the number of
+/// slices that it is about to decompress.  For the unit tests.
+void (*fits_slices_hook)(int32_t nslices) = nullptr;
+
 int32_t fits_read_compressed(int32_t mode, int32_t datasym, FILE *fp, int32_t headersym,
                          float targetblank)
 // reads data from an LUX Rice-compressed FITS file open on <fp>.
 // <mode> determines which data to return: &1 -> header in <headersym>;
-// &2 -> data in <datasym>.
+// &2 -> data in <datasym>.  If the header lists the compressed slices
+// (CSLICES and CSLICEn) then the slices are decompressed in parallel.
 // LS 18nov99
 /* Headers:
    <stdlib.h>: malloc(), free(), atol(), realloc()
@@ -5843,8 +7124,9 @@ int32_t fits_read_compressed(int32_t mode, int32_t datasym, FILE *fp, int32_t he
  */
 {
   int32_t        ncbytes, ndim, dims[MAX_DIMS], i, nblock, ok, slice, nx, ny,
-    type0;
-  Symboltype type;
+    slicekey, nslices = 0;
+  Symboltype type, type0;
+  std::vector<int32_t> offsets;
   float        bscale = 0.0, bzero = 0.0, blank = FLT_MAX, min, max;
   char        *block, usescrat, *curblock, runlength;
   Pointer        p;
@@ -5860,9 +7142,14 @@ int32_t fits_read_compressed(int32_t mode, int32_t datasym, FILE *fp, int32_t he
      UNAXIS  =                    2 / NAXIS of uncompressed data
      UNAXIS1 =                  464 / dimension of uncompressed data
      UNAXIS2 =                  438 / dimension of uncompressed data
+     CSLICES =                    2 / number of independently compressed slices
+     CSLICE1 =                   14 / byte offset of compressed slice
+     CSLICE2 =               108873 / byte offset of compressed slice
 
      COMMENT = header text
 
+     The CSLICES and CSLICEn lines are optional.
+
      We assume that BITPIX = 8 and NAXIS = 1, and that the keywords up
      to and including the last UNAXIS.. occur in the order indicated
      above -- as the FITS standard demands.
@@ -5895,6 +7182,7 @@ int32_t fits_read_compressed(int32_t mode, int32_t datasym, FILE *fp, int32_t he
   {
     int dtype = atol(block + 80*5 + 9);
     ndim = atol(block + 80*6 + 9);
+    slicekey = 7 + ndim;        // where CSLICES would be
 
     switch (dtype) {
     case 8:
@@ -5954,12 +7242,31 @@ int32_t fits_read_compressed(int32_t mode, int32_t datasym, FILE *fp, int32_t he
 
   // check if the end of the FITS header is in the current block
   // also check for BZERO and BSCALE
+  // also check for the slice offsets, which must directly follow the
+  // UNAXISn lines
+  auto keyword = [&](char const* line, int32_t lineno) {
+    int32_t k, offset;
+
+    if (lineno == slicekey) {
+      if (sscanf(line, "CSLICES =%d", &nslices) == 1
+          && nslices > 0 && nslices < 100)
+        offsets.resize(nslices, -1);
+      else
+        nslices = 0;
+    } else if (lineno > slicekey && lineno <= slicekey + nslices) {
+      if (sscanf(line, "CSLICE%d =%d", &k, &offset) == 2
+          && k == lineno - slicekey)
+        offsets[k - 1] = offset;
+    } else
+      (void) (sscanf(line, "BSCALE  =%f", &bscale)
+              || sscanf(line, "BZERO   =%f", &bzero)
+              || sscanf(line, "BLANK   =%f", &blank));
+  };
   for (i = 7 + ndim; i < 36; i++)
     if (!strncmp(curblock + 80*i, "END      ", 9))
       break;
-    else (void) (sscanf(block + i*80, "BSCALE  =%f", &bscale)
-                 || sscanf(block + i*80, "BZERO   =%f", &bzero)
-                 || sscanf(block + i*80, "BLANK   =%f", &blank));
+    else
+      keyword(curblock + 80*i, i);
 
   while (i == 36) {
     nblock++;
@@ -5981,7 +7288,7 @@ int32_t fits_read_compressed(int32_t mode, int32_t datasym, FILE *fp, int32_t he
           return 0;
         }
       }
-      curblock += 2880;
+      curblock = block + 2880*(nblock - 1);
     } // end of if (mode & 1)
     if (!fread(curblock, 1, 2880, fp)) {
       if (!usescrat)
@@ -5991,20 +7298,19 @@ int32_t fits_read_compressed(int32_t mode, int32_t datasym, FILE *fp, int32_t he
     for (i = 0; i < 36; i++)
       if (!strncmp(curblock + 80*i, "END      ", 9))
         break;
-      else (void) (sscanf(block + i*80, "BSCALE  =%f", &bscale)
-                   || sscanf(block + i*80, "BZERO   =%f", &bzero)
-                   || sscanf(block + i*80, "BLANK   =%f", &blank));
+      else
+        keyword(curblock + 80*i, i + 36*(nblock - 1));
   } // end of while (i == 36)
 
-  if (!usescrat)
-    free(block);
-
   i += 36*(nblock - 1);
   // we found the end of the FITS header.
   if (mode & 1) {                // want the header
     nx = i;                        // number of lines
-    if (redef_array(headersym, LUX_STRING_ARRAY, 1, &nx) != LUX_OK)
+    if (redef_array(headersym, LUX_STRING_ARRAY, 1, &nx) != LUX_OK) {
+      if (!usescrat)
+        free(block);
       return 0;
+    }
     p.sp = (char**) array_data(headersym);
     curblock = block;
     while (nx--) {
@@ -6015,6 +7321,8 @@ int32_t fits_read_compressed(int32_t mode, int32_t datasym, FILE *fp, int32_t he
       curblock += 80;
     }
   }
+  if (!usescrat)
+    free(block);
   type0 = type;
   if (mode & 2) {                // want the data
     if (internalMode & 1) {        // want to decompress, too
@@ -6090,65 +7398,97 @@ int32_t fits_read_compressed(int32_t mode, int32_t datasym, FILE *fp, int32_t he
       slice = p.ui8[12];
       ny = p.i32[1];
       nx = p.i32[2];
-      p.i32 += 3;
-      p.ui8 += 2;
-#if !WORDS_BIGENDIAN
-#else
+#if WORDS_BIGENDIAN
       swapl(&nx, 1);
       swapl(&ny, 1);
 #endif
-      switch (type0) {
-        case LUX_INT8:
-          ok = runlength?
-            anadecrunchrun8(p.ui8, (uint8_t*) array_data(datasym), slice, nx, ny):
-              anadecrunch8(p.ui8, (uint8_t*) array_data(datasym), slice, nx, ny);
-          break;
-        case LUX_INT16:
-          ok = runlength?
-            anadecrunchrun(p.ui8, (int16_t*) array_data(datasym), slice, nx, ny):
-            anadecrunch(p.ui8, (int16_t*) array_data(datasym), slice, nx, ny);
-          break;
-        case LUX_INT32:
+      ok = (size_t) nx*ny == (size_t) array_size(datasym);
+      if (type0 == LUX_INT32) {
 #if SIZEOF_LONG_LONG_INT == 8        // 64-bit integers
-          if (runlength) {
-            if (!usescrat)
-              free(block);
-            puts("32-bit run-length decompression was not compiled into this version of LUX.");
-            return 0;
-          } else
-            ok = anadecrunch32(p.ui8, array_data(datasym), slice, nx, ny);
+        if (runlength) {
+          puts("32-bit run-length decompression was not compiled into this version of LUX.");
+          ok = 0;
+        }
 #else
-          puts("32-bit decompression was not compiled into this version of LUX.");
-          if (!usescrat)
-            free(block);
-          return 0;
+        puts("32-bit decompression was not compiled into this version of LUX.");
+        ok = 0;
 #endif
-          break;
-      }        // end of switch (type)
-      if (!usescrat)
-        free(block);
-#if !WORDS_BIGENDIAN
+      }
+
+      // the slices must start at the beginning of the compressed data,
+      // and follow each other; if they don't, then we decompress
+      // everything as one slice
+      if (nslices > ny)
+        nslices = 0;
+      for (i = 0; i < nslices; i++)
+        if ((i? offsets[i] <= offsets[i - 1]: offsets[i] != 14)
+            || offsets[i] >= ncbytes)
+          nslices = 0;
+      if (!nslices) {
+        nslices = 1;
+        offsets.assign(1, 14);
+      }
+      if (fits_slices_hook)
+        fits_slices_hook(nslices);
+
+      // FITS data are big-endian, and we must take BZERO, BSCALE, and
+      // BLANK into account unless /RAWVALUES.  We do so for each slice
+      // right after decompressing it.
+      bool scale = !(internalMode & 2) && (bscale || bzero);
+      if (!bscale)
+        bscale = 1.0;
+      bool convert = scale || type != type0;
+      uint8_t* out = (uint8_t*) array_data(datasym);
+      size_t rowsize0 = (size_t) nx*lux_type_size[type0];
+      size_t rowsize = (size_t) nx*lux_type_size[type];
+      std::vector<char> good(nslices, 1);
       if (ok)
-        endian(array_data(datasym), array_size(datasym), type0);
+        parallel_chunks(parallel_thread_count(nslices), nslices,
+                        [&](size_t, size_t first, size_t last) {
+          std::vector<uint8_t> raw;
+          for (size_t s = first; s < last; s++) {
+            int32_t row = rice_slice_row(s, nslices, ny);
+            int32_t nrows = rice_slice_row(s + 1, nslices, ny) - row;
+            size_t n = (size_t) nrows*nx;
+            uint8_t* target = out + row*rowsize;
+            if (convert)
+              raw.resize(nrows*rowsize0);
+            uint8_t* values = convert? raw.data(): target;
+            good[s] = rice_decompress(p.ui8 + offsets[s], values, type0,
+                                      runlength, slice, nx, nrows);
+            if (!good[s])
+              continue;
+            if (convert)
+              fits_convert(type0, type, values, n, target, scale, bscale,
+                           bzero, blank, targetblank);
+#if !WORDS_BIGENDIAN
+            else
+              endian(values, n*lux_type_size[type0], type0);
 #endif
+          }
+        });
+      if (std::find(good.begin(), good.end(), 0) != good.end())
+        ok = 0;
+      if (!usescrat)
+        free(block);
     } // end of if (internalMode & 1)
     else ok = 1;
   } // end of if (mode & 2)
   else ok = 1;
 
-  if (!(internalMode & 2) && (bscale || bzero))
-    apply_bscale_bzero_blank((uint8_t*) array_data(datasym), nx*ny, bscale, bzero, blank,
-                             targetblank, type0, type);
-
   return ok;
 }
 //-------------------------------------------------------------------------
 int32_t        lux_replace(int32_t, int32_t), swapb(char [], int32_t);
 void        swapd(char [], int32_t);
 int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int32_t offsetsym,
-              int32_t xoffsetsym, int32_t xhsym, int32_t xdsym, float targetblank)
+              int32_t xoffsetsym, int32_t xhsym, int32_t xdsym, float targetblank,
+              int32_t startsym, int32_t countsym, int32_t columnssym)
  // internal, read fits files
  // returns status as sym # for 0, 1, or 2
+ // <startsym> and <countsym> select a hyperslab of the main data array,
+ // and <columnssym> the binary table columns for which to create
+ // variables.  If internalMode & 4, then the file is memory-mapped.
 /* Headers:
    <stdio.h>: FILE, fread(), sscanf(), printf(), fclose(), perror(), fseek()
    <stdlib.h>: malloc(), free(), atof()
@@ -6159,14 +7499,14 @@ int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int3
   static char        tforms[] = "IJAEDB";
   static int32_t        tform_sizes[] = { 2, 4, 1, 4, 8, 1};
   FILE        *fin;
-  char        *fitshead, line[80], *lptr, c, **p, *q, *ext_ptr, *sq, *p2, *qb;
+  char        *fitshead, line[80], *lptr, c, **p, *q, *ext_ptr, *sq, *qb;
   int32_t        n, simple_flag, bitpix_flag = 0, naxis_flag = 0, naxis_count;
   int32_t        bitpix, nlines, end_flag = 0, nhblks, lc, iq, id, new_sym;
-  Symboltype type;
+  Symboltype type, type0;
   int32_t        maxdim, i, rsym = 1, nbsize, ext_flag=0, data_offset, npreamble;
-  int32_t        fits_type, ndim_var, *dim_var, n_ext_rows, nrow_bytes, m;
+  int32_t        fits_type, ndim_var, *dim_var, n_ext_rows, nrow_bytes;
   int32_t        xtension_found = 0, tfields, gcount, row_bytes,
-    dim[MAX_DIMS], type0;
+    dim[MAX_DIMS];
   int32_t        ext_stuff_malloc_flag = 0;
   float        bscale = 0.0, bzero = 0.0, blank = FLT_MAX, min, max;
   struct ext_params {
@@ -6176,9 +7516,9 @@ int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int3
     char        *lab;
   };
   struct ext_params *ext_stuff;
-#if LITTLEENDIAN
-  int32_t        nb;
-#endif
+  off_t        ext_offset = 0, ext_data_offset = 0;
+  size_t        ext_size = 0;
+  FileMapping        map;
 
   // first arg is the variable to load, second is name of file
   if ((fin = fopenr_sym(namsym)) == NULL)
@@ -6215,6 +7555,10 @@ int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int3
   lptr = fitshead;
 
   if (!strncmp(fitshead + 320, "COMPRESS= ", 10)) {
+    if (startsym || countsym) {
+      fclose(fin);
+      return luxerror("Cannot read part of a compressed FITS file", namsym);
+    }
     rsym = fits_read_compressed(mode, dsym, fin, hsym, targetblank);
     fclose(fin);
     return rsym;
@@ -6295,7 +7639,7 @@ int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int3
         bscale = atof(lptr + 9);
       else if (!bzero && !strncmp(lptr, "BZERO   ", 8))
         bzero = atof(lptr + 9);
-      else if (blank != FLT_MAX && !strncmp(lptr, "BLANK   ", 8))
+      else if (blank == FLT_MAX && !strncmp(lptr, "BLANK   ", 8))
         blank = atof(lptr + 9);
       else if (strncmp(lptr, "END     ",8) == 0) {
         end_flag = 1;
@@ -6328,7 +7672,11 @@ int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int3
   // printf("nbsize = %d\n", nbsize);
   // if an extension, figure out where
   if (ext_flag) {
-    ext_flag = nhblks*2880 + 2880*( (nbsize-1)/2880 + 1);
+    size_t nbytes = lux_type_size[type];
+    for (i = 0; i < maxdim; i++)
+      nbytes *= dim[i];
+    ext_offset = nhblks*(off_t) 2880 + 2880*((nbytes + 2879)/2880);
+    ext_flag = ext_offset;
     // printf("extension offset = %d\n", ext_flag);
   }
   // return extension offset ?
@@ -6417,35 +7765,43 @@ int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int3
         }
       }
     }
-    iq = array_scratch(type, maxdim, dim);
+    // the part of the data array to read
+    int32_t start[MAX_DIMS], count[MAX_DIMS];
+    if (fits_slab_argument(startsym, maxdim, start) == LUX_ERROR
+        || fits_slab_argument(countsym, maxdim, count) == LUX_ERROR) {
+      fclose(fin);
+      return LUX_ERROR;
+    }
+    Hyperslab slab(maxdim, dim, start, count);
+    if (!slab.valid()) {
+      fclose(fin);
+      return luxerror("The selected part does not fit inside the FITS data "
+                      "array", startsym? startsym: countsym);
+    }
+    for (i = 0; i < maxdim; i++)
+      count[i] = slab.count(i);
+    iq = array_scratch(type, maxdim, count);
     q = (char*) array_data(iq);
 
     if (simple_flag == 1) {
-      // should be in position in file to just read in
-      if (fread(q, 1, nbsize, fin) != nbsize)
+      // read only the selected part, and convert the values while
+      // copying them: FITS data are big-endian, and we must take BZERO,
+      // BSCALE, and BLANK into account unless /RAWVALUES
+      bool scale = !(internalMode & 2) && (bscale || bzero);
+      if (!bscale)
+        bscale = 1.0;
+      if ((internalMode & 4) && !map.data)
+        map.map(fin);
+      if (!read_hyperslab(fin, data_offset, slab, lux_type_size[type0], 1,
+                          map.data, map.size,
+                          [&](uint8_t const* raw, size_t n, size_t k) {
+                            fits_convert(type0, type, raw, n,
+                                         q + k*lux_type_size[type], scale,
+                                         bscale, bzero, blank, targetblank);
+                          }))
       { perror("fits_read in data array");
         fits_problems(12); return fits_fatality(fin);}
-
-      /* fits data is supposed to always be big endian, so fix up data on
-         little endian machines (like alpha's and pc's) */
-#if LITTLEENDIAN
-      switch (type) {
-      case LUX_INT16:           // 16 bits
-        swapb((char *) q, nbsize);
-        break;
-      case LUX_INT32: case LUX_FLOAT: // 32 bits
-        swapl((int32_t *) q, nbsize/4);
-        break;
-      case LUX_INT64: case LUX_DOUBLE: // 64 bits
-        swapd((char *) q, nbsize/8);
-        break;
-      }
-#endif
     }
-    // now correct for BZERO, BSCALE, BLANK
-    if (!(internalMode & 2) && (bscale || bzero))
-      apply_bscale_bzero_blank((uint8_t *) q, nbsize/lux_type_size[type0], bscale, bzero,
-                               blank, targetblank, type0, type);
     // lux_replace ordinarily yields some output when STEPping or TRACEing,
     // but here we don't want that: ensure that noTrace is non-zero
     noTrace++;
@@ -6457,7 +7813,7 @@ int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int3
   // if there is an extension, process the header
   if (ext_flag) {
     // printf("processing the extension header\n");
-    if (fseek(fin, ext_flag, SEEK_SET))
+    if (fseeko(fin, ext_offset, SEEK_SET))
     { fits_problems(13); return fits_fatality(fin);}
     fits_head_malloc_flag = 0;
     nhblks = 0;
@@ -6576,6 +7932,7 @@ int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int3
     for (i=0;i<maxdim;i++) nbsize = nbsize*dim[i];
     // printf("extension: nbsize = %d\n", nbsize);
     n_ext_rows = nbsize/dim[0]/lux_type_size[type];
+    ext_data_offset = ftello(fin);
   }
 
   // check if we want the extension header
@@ -6616,6 +7973,7 @@ int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int3
       // all set up for the most part
       iq = array_scratch(type, maxdim, dim);
       q = ext_ptr = (char*) array_data(iq);
+      ext_size = nbsize;
 
       // should be in position in file to just read in
       if (fread(q, 1, nbsize, fin) != nbsize)
@@ -6649,7 +8007,7 @@ int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int3
   // decode the extension (for binary tables)
   if (mode & 0x40 && ext_flag) {
     // can't do if no extension
-    int32_t        index, itype, ext_ptr_malloc_flag = 0;
+    int32_t        index, itype;
     char        *loc;
     // printf("lc = %d\n", lc);
     lptr = fitshead;
@@ -6727,29 +8085,50 @@ int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int3
          it will be 2-D with repeat as the first dim */
       /* want to use dim for the constructed arrays, so save the binary table row
          count elsewhere */
-      /* if we wanted the extension in a variable, we already read it in, otherwise
-         we read it now */
-    if (!(mode & 0x20)) {
-      q = ext_ptr = (char *) malloc(nbsize);
-      ext_ptr_malloc_flag = 1;
-      // should be in position in file to just read in
-      if (fread(q, 1, nbsize, fin) != nbsize)
-      { perror("fits_read in data array");
-        fits_problems(20);
-        if (ext_ptr_malloc_flag)
-          free(ext_ptr);
-        goto fits_read_1;
-      }
+      /* if we wanted the extension in a variable, we already read it in,
+         otherwise we read only the bytes of the selected columns from the
+         file */
+    uint8_t const* table;
+    size_t table_size;
+    off_t table_offset;
+    if (mode & 0x20) {
+      table = (uint8_t const*) ext_ptr;
+      table_size = ext_size;
+      table_offset = 0;
+    } else {
+      if ((internalMode & 4) && !map.data)
+        map.map(fin);
+      table = map.data;
+      table_size = map.size;
+      table_offset = ext_data_offset;
     }
-      // one way or another, the entire table is now at ext_ptr
 
     npreamble = strlen(preamble);
     row_bytes = 0;
-    lptr = ext_ptr;
     for (index=0;index<=tfields-1;index++) {
-      int32_t        sl;
+      int32_t        sl, col_offset = row_bytes;
       char *ppq;
 
+      id = ext_stuff[index].repeat;
+      fits_type = ext_stuff[index].type;
+      nbsize = tform_sizes[fits_type] * id;
+      row_bytes += nbsize;
+      if (columnssym) {         // only the selected columns
+        bool selected = false;
+        if (symbolIsStringScalar(columnssym))
+          selected = !strcasecmp(string_value(columnssym),
+                                 ext_stuff[index].lab);
+        else if (symbol_class(columnssym) == LUX_ARRAY
+                 && array_type(columnssym) == LUX_STRING_ARRAY) {
+          char **names = (char **) array_data(columnssym);
+          for (i = 0; i < (int32_t) array_size(columnssym) && !selected; i++)
+            selected = names[i] && !strcasecmp(names[i],
+                                               ext_stuff[index].lab);
+        }
+        if (!selected)
+          continue;
+      }
+
       // construct the variable name
       sl = npreamble + strlen(ext_stuff[index].lab);
       sq = (char *) malloc(sl + 1);
@@ -6763,9 +8142,7 @@ int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int3
       // printf("variable name = %s, symbol # %d\n", sq, new_sym);
       free(sq);
       // how we define depends on type
-      id = ext_stuff[index].repeat;
       // dimension count depends on "repeat"
-      fits_type = ext_stuff[index].type;
       if (id <= 1 || fits_type == 2) {
         ndim_var = maxdim-1;
         dim_var = dim+1;
@@ -6795,50 +8172,51 @@ int32_t fits_read(int32_t mode, int32_t dsym, int32_t namsym, int32_t hsym, int3
           type = LUX_INT8;
           break;
       }
+      // the column is a hyperslab of the table, with one run per row
+      int32_t table_dims[2] = { nrow_bytes, n_ext_rows };
+      int32_t col_start[2] = { col_offset, 0 };
+      int32_t col_count[2] = { nbsize, n_ext_rows };
+      Hyperslab column(2, table_dims, col_start, col_count);
+      bool ok = true;
       if (fits_type == 2) {
         char **psa;
 
-        if (redef_strarr(new_sym, ndim_var, dim_var) != 1) {
-          if (ext_ptr_malloc_flag)
-            free(ext_ptr);
+        if (redef_strarr(new_sym, ndim_var, dim_var) != 1)
           goto fits_read_1;
-        }
         psa = (char**) array_data(new_sym);
-        nbsize = tform_sizes[fits_type] * id;
         // need to get a series of strings
-        p2 = lptr;
-        m = n_ext_rows;
-        while (m--) {
-          n = nbsize;  q = (char*) malloc(nbsize + 1);
-          *psa++ = q;
-          while (n--) *q++ = *p2++;  *q = '\0';
-          p2 = p2 + nrow_bytes - nbsize;  }
+        if (nbsize)
+          ok = read_hyperslab(fin, table_offset, column, 1, nbsize, table,
+                              table_size,
+                              [&](uint8_t const* raw, size_t n, size_t k) {
+                                for ( ; n; n -= nbsize, k += nbsize,
+                                        raw += nbsize) {
+                                  q = (char*) malloc(nbsize + 1);
+                                  memcpy(q, raw, nbsize);
+                                  q[nbsize] = '\0';
+                                  psa[k/nbsize] = q;
+                                }
+                              });
       } else {
-        if (redef_array(new_sym, type, ndim_var, dim_var) != 1) {
-          if (ext_ptr_malloc_flag)
-            free(ext_ptr);
+        if (redef_array(new_sym, type, ndim_var, dim_var) != 1)
           goto fits_read_1;
-        }
         // and load all the columns in
-        q = qb = (char*) array_data(new_sym);
-        nbsize = tform_sizes[fits_type] * id;
-        p2 = lptr;
-        m = n_ext_rows;
-        while (m--) { n = nbsize;  while (n--) *q++ = *p2++;
-        p2 = p2 + nrow_bytes - nbsize;  }
-#if LITTLEENDIAN
-        nb = nbsize * n_ext_rows;
-        if (fits_type == 0)  swapb(qb, nb);
-        if (fits_type == 1 || fits_type ==3)  swapl((int32_t *) qb, nb/4);
-        if (fits_type == 4)  swapd((char *) qb, nb/8);
-#endif
+        qb = (char*) array_data(new_sym);
+        if (nbsize)
+          ok = read_hyperslab(fin, table_offset, column, 1,
+                              lux_type_size[type], table, table_size,
+                              [&](uint8_t const* raw, size_t n, size_t k) {
+                                fits_convert(type, type, raw,
+                                             n/lux_type_size[type], qb + k,
+                                             false, 1, 0, 0, 0);
+                              });
+      }
+      if (!ok) {
+        perror("fits_read in data array");
+        fits_problems(20);
+        goto fits_read_1;
       }
-        
-      row_bytes += nbsize;
-      lptr += nbsize;
     }
-    if (ext_ptr_malloc_flag)
-      free(ext_ptr);
   }
     // should be done with any malloc for a long header
   if (fits_head_malloc_flag) free(fitshead);
@@ -6865,9 +8243,10 @@ int32_t lux_fits_write_general(ArgumentCount narg, Symbol ps[], int32_t func)
   char        *file, runlength, *p;
   void        *data, *out;
   int32_t        *dims, ndim, headertype, nheader, slice, nlines, n, type,
-    nx, ny, limit, bitpix[] = {8,16,32,-32,-64}, i, size;
+    nx, ny, limit, bitpix[] = {8,16,32,-32,-64}, i, size, nslices = 1;
   Pointer        header;
   FILE        *fp;
+  std::vector<int32_t> offsets;
 
   if (!symbolIsNumericalArray(ps[0]) || symbolIsComplexArray(ps[0]))
     return func? LUX_ZERO: cerror(ILL_CLASS, ps[0]);
@@ -6926,6 +8305,28 @@ int32_t lux_fits_write_general(ArgumentCount narg, Symbol ps[], int32_t func)
     out = malloc(limit);
     if (!out)
       return func? LUX_ZERO: cerror(ALLOC_ERR, 0);
+#if SIZEOF_LONG_LONG_INT == 8        // 64-bit integers
+    if (type == LUX_INT32 && runlength) {
+      puts("WARNING - no compression with run-length encoding is currently\navailable for 32-bit data.  Using compression without RLE instead.");
+      runlength = 0;
+    }
+#endif
+    // compress slices of whole rows in parallel
+    nslices = rice_slice_count(ny, array_size(ps[0]));
+    offsets.resize(nslices);
+    size = rice_compress_slices((uint8_t*) out, limit, (uint8_t*) data,
+                                (Symboltype) type, runlength, slice, nx, ny,
+                                nslices, offsets);
+    if (size == -1) {                // could not compress
+      free(out);
+      if (internalMode & 1)        // /VOCAL
+        printf("Data compression failed -- storing uncompressed %s.\n", file);
+    }
+  } else
+    size = -1;
+  if (size == -1) {
+    out = data;
+    slice = 0;                        // flag no compression
   }
 
   // FITS data is always bigendian, so we should swap bytes on littleendian
@@ -6934,46 +8335,11 @@ int32_t lux_fits_write_general(ArgumentCount narg, Symbol ps[], int32_t func)
   // of the data and swap that, or (2) swap the original data, write it to
   // the FITS file, and then swap the original data again.  We choose to
   // be frugal with memory, so we go for the double swap.  LS 18nov99
+  // Compressed data are made from swapped copies of the data instead.
 #if !WORDS_BIGENDIAN
-  endian(data, array_size(ps[0])*lux_type_size[type], type);
-#endif
-
-  if (slice) {
-    switch (type) {
-      case LUX_INT8:
-        size = runlength? anacrunchrun8((uint8_t*) out, (uint8_t*) data, slice, nx, ny, limit):
-          anacrunch8((uint8_t*) out, (uint8_t*) data, slice, nx, ny, limit);
-        break;
-      case LUX_INT16:
-        size = runlength? anacrunchrun((uint8_t*) out, (int16_t*) data, slice, nx, ny, limit):
-          anacrunch((uint8_t*) out, (int16_t*) data, slice, nx, ny, limit);
-        break;
-#if SIZEOF_LONG_LONG_INT == 8        // 64-bit integers
-      case LUX_INT32:
-        if (runlength) {
-          puts("WARNING - no compression with run-length encoding is currently\navailable for 32-bit data.  Using compression without RLE instead.");
-          runlength = 0;
-        }
-        size = anacrunch32(out, data, slice, nx, ny, limit);
-        break;
-#else
-        puts("WARNING - no 32-bit compression was compiled into this version of LUX.\nWriting uncompressed data instead.");
+  if (out == data)
+    endian(data, array_size(ps[0])*lux_type_size[type], type);
 #endif
-      default:                        // no compression
-        free(out);
-        out = data;
-        slice = 0;                // flag no compression
-        size = -1;
-        break;
-    } // end of switch (type)
-    if (size == -1                // could not compress
-        && (internalMode & 1))        // /VOCAL
-      printf("Data compression failed -- storing uncompressed %s.\n", file);
-  } else {
-    out = data;
-    slice = 0;                        // flag no compression
-    size = -1;
-  }
 
   if (size == -1)
     size = array_size(ps[0])*lux_type_size[type];
@@ -7006,6 +8372,16 @@ int32_t lux_fits_write_general(ArgumentCount narg, Symbol ps[], int32_t func)
               "dimension of uncompressed data");
       nlines++;
     } // end of for (i = 0)
+    if (nslices > 1) {                // where the slices start
+      fprintf(fp, "%-8.8s= %20d / %-47s", "CSLICES", nslices,
+              "number of independently compressed slices");
+      nlines++;
+      for (i = 0; i < nslices; i++) {
+        fprintf(fp, "CSLICE%-2d= %20d / %-47s", i + 1, offsets[i],
+                "byte offset of compressed slice");
+        nlines++;
+      }
+    }
   } // end of if (size != -1)
   else {                        // we did not compress
     fprintf(fp, "%-8.8s= %20s / %-47s", "SIMPLE", "T",
@@ -7120,7 +8496,8 @@ int32_t lux_fits_write_general(ArgumentCount narg, Symbol ps[], int32_t func)
   // must swap the data back into its original order on littleendian
   // machines
 #if !WORDS_BIGENDIAN
-  endian(out, size, type);
+  if (out == data)
+    endian(data, size, type);
 #endif
 
   // done
@@ -7140,6 +8517,127 @@ int32_t lux_fits_write_f(ArgumentCount narg, Symbol ps[])
   return lux_fits_write_general(narg, ps, 1);
 }
 //-------------------------------------------------------------------------
+int32_t lux_readtable_general(ArgumentCount narg, Symbol ps[], int32_t func)
+// READTABLE, file, x1 [, x2, ...] [, MAXROWS=, SKIP=, COLUMNS=]
+// x = READTABLE(file [, MAXROWS=, SKIP=, COLUMNS=])
+// reads a table of numbers from a text file.  The subroutine puts the
+// selected columns into x1, x2, and so on, each with its own data type;
+// the function returns all of them in a single array.
+{
+  size_t maxrows = SIZE_MAX, skip = 0;
+
+  if (ps[0]) {                        // MAXROWS
+    int32_t n = int_arg(ps[0]);
+    if (n < 0)
+      return luxerror("Need a non-negative number of rows", ps[0]);
+    maxrows = n;
+  }
+  if (ps[1]) {                        // SKIP
+    int32_t n = int_arg(ps[1]);
+    if (n < 0)
+      return luxerror("Need a non-negative number of lines", ps[1]);
+    skip = n;
+  }
+  if (!symbolIsStringScalar(ps[3]))
+    return cerror(NEED_STR, ps[3]);
+  for (int32_t i = 4; i < narg; i++)
+    if (!symbolIsNamed(ps[i]))
+      return cerror(NEED_NAMED, ps[i]);
+
+  FILE* fp = fopen(expand_name(string_value(ps[3]), NULL), "r");
+  if (!fp)
+    return cerror(ERR_OPEN, ps[3]);
+
+  // map the file into memory if we can, and read all of it otherwise
+  FileMapping map;
+  std::vector<char> contents;
+  char const* text;
+  size_t size;
+  if (map.map(fp)) {
+    text = (char const*) map.data;
+    size = map.size;
+  } else {
+    size_t n;
+    contents.resize(1 << 20);
+    size = 0;
+    while ((n = fread(contents.data() + size, 1, contents.size() - size,
+                      fp)) > 0) {
+      size += n;
+      if (size == contents.size())
+        contents.resize(2*size);
+    }
+    text = contents.data();
+  }
+  fclose(fp);
+
+  TextTable table(text, size, skip, maxrows);
+  if (!table.rows())
+    return luxerror("Found no table rows in file %s", ps[3],
+                    string_value(ps[3]));
+
+  // the selected columns
+  std::vector<size_t> columns;
+  if (ps[2]) {                        // COLUMNS
+    int32_t n, iq = lux_long(1, &ps[2]);
+    Pointer p;
+    if (numerical(iq, NULL, NULL, &n, &p) < 0)
+      return LUX_ERROR;
+    for (int32_t i = 0; i < n; i++) {
+      if (p.i32[i] < 0 || (size_t) p.i32[i] >= table.columns())
+        return luxerror("Column index %d is out of range 0 through %d",
+                        ps[2], p.i32[i], (int32_t) table.columns() - 1);
+      columns.push_back(p.i32[i]);
+    }
+  } else
+    for (size_t i = 0; i < table.columns(); i++)
+      columns.push_back(i);
+
+  static Symboltype const types[] = { LUX_INT32, LUX_INT64, LUX_DOUBLE };
+  int32_t nrows = table.rows();
+  std::vector<TextTable::Target> targets(columns.size());
+  int32_t result;
+  if (func) {
+    // one array with the widest type of all selected columns
+    TextTable::Kind kind = TextTable::Int32;
+    for (size_t c : columns)
+      kind = std::max(kind, table.kind(c));
+    int32_t dims[2] = { (int32_t) columns.size(), nrows };
+    result = (dims[0] == 1)? array_scratch(types[kind], 1, &dims[1]):
+      array_scratch(types[kind], 2, dims);
+    if (result == LUX_ERROR)
+      return LUX_ERROR;
+    for (size_t i = 0; i < columns.size(); i++)
+      targets[i] = { (char*) array_data(result) + i*lux_type_size[types[kind]],
+                     kind, columns.size() };
+  } else {
+    // one array per column, each with its own type
+    if (narg - 4 > (int32_t) columns.size())
+      return luxerror("Asked for %d columns but found only %d", ps[3],
+                      narg - 4, (int32_t) columns.size());
+    columns.resize(narg - 4);
+    targets.resize(narg - 4);
+    for (size_t i = 0; i < columns.size(); i++) {
+      TextTable::Kind kind = table.kind(columns[i]);
+      if (redef_array(ps[i + 4], types[kind], 1, &nrows) != LUX_OK)
+        return LUX_ERROR;
+      targets[i] = { array_data(ps[i + 4]), kind, 1 };
+    }
+    result = LUX_OK;
+  }
+  table.read(columns.data(), targets.data(), columns.size());
+  return result;
+}
+//-------------------------------------------------------------------------
+int32_t lux_readtable(ArgumentCount narg, Symbol ps[])
+{
+  return lux_readtable_general(narg, ps, 0);
+}
+//-------------------------------------------------------------------------
+int32_t lux_readtable_f(ArgumentCount narg, Symbol ps[])
+{
+  return lux_readtable_general(narg, ps, 1);
+}
+//-------------------------------------------------------------------------
 int32_t lux_fileread(ArgumentCount narg, Symbol ps[])
  // raw file read routine: fileread,lun,array,start,num,type
  /* the file must be opened with a lun, the start position and num are in units
@@ -31,6 +31,8 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 #include "action.hh"
 #include "bindings.hh"
 #include "lux_func_if.hh"
+#include "LevenbergMarquardt.hh"
+#include "Parallel.hh"
 #include <gsl/gsl_vector.h>
 #include <gsl/gsl_multimin.h>
 #include <limits.h>
@@ -118,25 +120,31 @@ void enforce_bounds(double *par, double *lowbound, double *hibound, int32_t nPar
 int32_t lux_generalfit(ArgumentCount narg, Symbol ps[])
 /* FIT([X,]Y,START,STEP[,LOWBOUND,HIGHBOUND][,WEIGHTS][,QTHRESH,PTHRESH,
    ITHRESH,DTHRESH][,FAC,NITER,NSAME][,ERR][,FIT][,TTHRESH][,/VOCAL,/DOWN,
-   /PCHI][/GAUSSIANS,/POWERFUNC]) */
+   /PCHI][/GAUSSIANS,/POWERFUNC][,/BATCH]) */
 // This routine is intended to enable the user to fit iteratively
 // to any profile specification.
+// With /BATCH, all NITER trial parameter sets of an iteration cycle
+// are generated from the same best-so-far parameters and are evaluated
+// together: a user-defined fit function then gets a 2D parameter array
+// with one column per trial and must return one fit quality per trial,
+// and the built-in profiles are evaluated in parallel.
 // LS 24oct95
 {
   int32_t ySym, xSym, nPoints, n, nPar, nIter, iThresh, nSame, size,
-    iq, i, j, iter, same, fitSym, fitTemp, xTemp, nn, wSym;
+    iq, i, j, iter, same, fitSym, fitTemp, xTemp, nn, wSym, batchTemp;
 
   double *yp, *xp, *start, *step, qThresh, *pThresh, fac, *lowbound,
     *hibound, *err, *par, qBest1, qBest2, *parBest1, *parBest2, *ran,
-    qual, temp, dir, dThresh, qLast, mu, *meanShift, *weights, tThresh;
+    qual, temp, dir, dThresh, qLast, mu, *meanShift, *weights, tThresh,
+    *trials, *trialQual;
 
-  char  vocal, onebyone, vocal_err;
+  char  vocal, onebyone, vocal_err, batch;
   void  randome(void *output, int32_t number, double limit);
   double (*fitProfiles[2])(double *, int32_t, double *, double *, double *, int32_t) =
   { gaussians, powerfunc };
   double (*fitFunc)(double *, int32_t, double *, double *, double *, int32_t);
   extern int32_t    nFixed;
-  int16_t  fitPar, fitArg[4];
+  int16_t  fitPar, fitArg[4], batchPar, batchArg[4];
   int32_t   lux_indgen(int32_t, int32_t []), eval(int32_t);
   void  zap(int32_t);
   time_t starttime;
@@ -343,6 +351,18 @@ int32_t lux_generalfit(ArgumentCount narg, Symbol ps[])
   PoissonChiSq = internalMode & 8; // get Poisson chi-squares fit (if
                                    // applicable)
 
+  onebyone = (internalMode & 64? 1: 0);
+  batch = (internalMode & 256? 1: 0);
+  // internalMode is likely to change due to calling the user function
+
+  if (batch && onebyone) {
+    if (narg <= 14 || !ps[14])
+      free(err);
+    if (!xSym)
+      zap(xTemp);
+    return luxerror("Cannot combine /BATCH and /ONEBYONE", 0);
+  }
+
   i = nPar + 1;
   fitPar = array_scratch(LUX_DOUBLE, 1, &i); // fit parameters
   par = (double *) array_data(fitPar);
@@ -382,9 +402,6 @@ int32_t lux_generalfit(ArgumentCount narg, Symbol ps[])
   else
     starttime = 0;
 
-  onebyone = (internalMode & 64? 1: 0);
-  // internalMode is likely to change due to calling the user function
-
   // get initial fit quality
   if (fitSym) {
     i = eval(fitTemp);
@@ -408,6 +425,29 @@ int32_t lux_generalfit(ArgumentCount narg, Symbol ps[])
     zapTemp(i);
   } else
     qBest2 = qBest1 = fitFunc(par, nPar, xp, yp, weights, nPoints);
+
+  batchPar = batchTemp = 0;
+  trials = trialQual = NULL;
+  if (batch) {
+    if (fitSym) {               // one call evaluates all trials
+      int32_t dims[2] = { nPar, nIter };
+      batchPar = array_scratch(LUX_DOUBLE, 2, dims);
+      symbol_context(batchPar) = 1; // so it won't be deleted
+      trials = (double *) array_data(batchPar);
+      memcpy(batchArg, fitArg, sizeof(fitArg));
+      batchArg[0] = batchPar;
+      batchTemp = nextFreeTempExecutable();
+      symbol_class(batchTemp) = LUX_USR_FUNC;
+      usr_func_arguments(batchTemp) = batchArg;
+      symbol_memory(batchTemp) = (weights? 4: 3)*sizeof(int16_t);
+      usr_func_number(batchTemp) = fitSym;
+    } else {
+      n = nPar*nIter;
+      ALLOCATE(trials, n, double);
+    }
+    ALLOCATE(trialQual, nIter, double);
+  }
+
   ALLOCATE(parBest1, nPar, double);
   ALLOCATE(parBest2, nPar, double);
   ALLOCATE(ran, nPar, double);
@@ -427,41 +467,90 @@ int32_t lux_generalfit(ArgumentCount narg, Symbol ps[])
     qLag = 1;
   do {                          // iterate
     qLast = qBest2;
-    nn = onebyone? nPar: nIter;
-    if (onebyone)
-      randome(ran, nPar, 0);
-    for (i = 0; i < nn; i++) {
-      if (!onebyone)
-        randome(ran, nPar, 0);  // get random numbers
-      mu = 2 - mu/qLast;
-      if (mu < 1)
-        mu = 1;
-      if (onebyone) {
-        par[i] = parBest1[i] + mu*meanShift[i] + err[i]*ran[i];
-        enforce_bounds(par, lowbound, hibound, nPar);
-      } else {
-        for (j = 0; j < nPar; j++) // update parameters
-          par[j] = parBest1[j] + mu*meanShift[j] + err[j]*ran[j];
-        enforce_bounds(par, lowbound, hibound, nPar);
+    if (batch) {
+      // the trials of this cycle do not depend on each other, so we
+      // can evaluate them all at once
+      for (i = 0; i < nIter; i++) {
+        double *trial = trials + i*nPar;
+
+        randome(ran, nPar, 0);
+        mu = 2 - mu/qLast;
+        if (mu < 1)
+          mu = 1;
+        for (j = 0; j < nPar; j++)
+          trial[j] = parBest1[j] + mu*meanShift[j] + err[j]*ran[j];
+        enforce_bounds(trial, lowbound, hibound, nPar);
       }
       if (fitSym) {
-        j = eval(fitTemp);
+        j = eval(batchTemp);
         if (j < 0) {            // some error
           bad = 1;
           break;
         }
-        qual = double_arg(j);
+        iq = lux_double(1, &j);
+        n = 0;
+        if (numerical(iq, NULL, NULL, &n, NULL) < 0 || n != nIter) {
+          if (iq != j)
+            zapTemp(iq);
+          zapTemp(j);
+          j = luxerror("Batch fit function returned %d fit qualities; expected %d",
+                       0, n, nIter);
+          bad = 1;
+          break;
+        }
+        memcpy(trialQual, array_data(iq), nIter*sizeof(double));
+        if (iq != j)
+          zapTemp(iq);
         zapTemp(j);
       } else
-        qual = fitFunc(par, nPar, xp, yp, weights, nPoints); // fit quality
-      if (qual < qBest1) {      // this one is better
-        qBest1 = qual;
-        memcpy(parBest1, par, size);
-      } else {                  // restore parameter
-        if (onebyone)
-          par[i] = parBest1[i];
-      }
-    } // end for (i = 0; i < nn; i++)
+        parallel_for(nIter, 1, [&](size_t begin, size_t end) {
+          for (size_t k = begin; k < end; k++)
+            trialQual[k] = fitFunc(trials + k*nPar, nPar, xp, yp, weights,
+                                   nPoints);
+        });
+      for (i = 0; i < nIter; i++)
+        if (trialQual[i] < qBest1) { // this one is better
+          qBest1 = trialQual[i];
+          memcpy(parBest1, trials + i*nPar, size);
+        }
+      memcpy(par, parBest1, size);
+    } else {
+      nn = onebyone? nPar: nIter;
+      if (onebyone)
+        randome(ran, nPar, 0);
+      for (i = 0; i < nn; i++) {
+        if (!onebyone)
+          randome(ran, nPar, 0);  // get random numbers
+        mu = 2 - mu/qLast;
+        if (mu < 1)
+          mu = 1;
+        if (onebyone) {
+          par[i] = parBest1[i] + mu*meanShift[i] + err[i]*ran[i];
+          enforce_bounds(par, lowbound, hibound, nPar);
+        } else {
+          for (j = 0; j < nPar; j++) // update parameters
+            par[j] = parBest1[j] + mu*meanShift[j] + err[j]*ran[j];
+          enforce_bounds(par, lowbound, hibound, nPar);
+        }
+        if (fitSym) {
+          j = eval(fitTemp);
+          if (j < 0) {            // some error
+            bad = 1;
+            break;
+          }
+          qual = double_arg(j);
+          zapTemp(j);
+        } else
+          qual = fitFunc(par, nPar, xp, yp, weights, nPoints); // fit quality
+        if (qual < qBest1) {      // this one is better
+          qBest1 = qual;
+          memcpy(parBest1, par, size);
+        } else {                  // restore parameter
+          if (onebyone)
+            par[i] = parBest1[i];
+        }
+      } // end for (i = 0; i < nn; i++)
+    } // end if (batch) else
 
     if (bad)
       break;
@@ -621,6 +710,13 @@ int32_t lux_generalfit(ArgumentCount narg, Symbol ps[])
         symbol_class(fitTemp) = LUX_SCALAR;
         zap(fitTemp);
       }
+      if (batchTemp) {
+        symbol_class(batchTemp) = LUX_SCALAR;
+        zap(batchTemp);
+        zap(batchPar);
+      } else
+        free(trials);
+      free(trialQual);
       free(parBest1);
       free(parBest2);
       free(ran);
@@ -643,6 +739,13 @@ int32_t lux_generalfit(ArgumentCount narg, Symbol ps[])
     free(err);
   if (!xSym)
     zap(xTemp);
+  if (batchTemp) {
+    symbol_class(batchTemp) = LUX_SCALAR;
+    zap(batchTemp);
+    zap(batchPar);
+  } else
+    free(trials);
+  free(trialQual);
   free(parBest1);
   free(parBest2);
   free(ran);
@@ -936,6 +1039,317 @@ int32_t lux_generalfit2(ArgumentCount narg, Symbol ps[])
 #endif
 }
 REGISTER(generalfit2, f, fit3, 5, 7, "x:y:start:step:f:err:ithresh:1vocal");
+//------------------------------------------------------------
+// Levenberg-Marquardt fitting
+
+/// Calculates the model values and (if \a jac is not NULL) the
+/// derivatives for the built-in sum of gaussians profile
+/// par[0]+par[1]*exp(-((x - par[2])/par[3])^2) [ +
+/// par[4]*exp(-((x - par[5])/par[6])^2) ... ].  jac[i*nPar + j]
+/// receives the derivative of model[i] with respect to par[j].
+static void
+gaussians_lm(double const *par, int32_t nPar, double const *x,
+             int32_t nData, double *model, double *jac)
+{
+  for (int32_t i = 0; i < nData; i++) {
+    double fit = par[0];
+    double *row = jac? jac + i*nPar: NULL;
+    if (row)
+      row[0] = 1;
+    for (int32_t j = 1; j < nPar - 2; j += 3) {
+      double arg = (x[i] - par[j + 1])/par[j + 2];
+      double e = exp(-arg*arg);
+      fit += par[j]*e;
+      if (row) {
+        row[j] = e;
+        row[j + 1] = 2*par[j]*e*arg/par[j + 2];
+        row[j + 2] = row[j + 1]*arg;
+      }
+    }
+    model[i] = fit;
+  }
+}
+
+/// Calculates the model values and (if \a jac is not NULL) the
+/// derivatives for the built-in power function profile par[0] +
+/// par[1]*x + par[2]*(x - par[3])^par[4].  jac[i*nPar + j] receives the
+/// derivative of model[i] with respect to par[j].
+static void
+powerfunc_lm(double const *par, int32_t nPar, double const *x,
+             int32_t nData, double *model, double *jac)
+{
+  for (int32_t i = 0; i < nData; i++) {
+    double d = x[i] - par[3];
+    double p = pow(d, par[4]);
+    model[i] = par[0] + par[1]*x[i] + par[2]*p;
+    if (jac) {
+      double *row = jac + i*nPar;
+      row[0] = 1;
+      row[1] = x[i];
+      row[2] = p;
+      row[3] = d? -par[2]*par[4]*p/d: 0;
+      row[4] = d > 0? par[2]*p*log(d): 0;
+    }
+  }
+}
+
+/*
+
+  par = FITLM(x, y, start [, step, lowbound, highbound, weights, ithresh,
+              dthresh, err, fit] [, /VOCAL, /GAUSSIANS, /POWERFUNC])
+
+  Fits a profile to <y> as a function of <x> using the
+  Levenberg-Marquardt method.  The profile is either a built-in one
+  (/GAUSSIANS, /POWERFUNC, as for FIT) or else a user-defined function
+  named by <fit> that takes arguments <par> and <x> and returns the
+  model values at <x>.  The derivatives of the built-in profiles are
+  calculated analytically, those of user-defined functions from finite
+  differences.
+
+  If <y> has more than one dimension, then each column (along the
+  first dimension) is fitted separately, and the built-in profiles are
+  fitted to multiple columns in parallel.  <start> may then have one
+  set of start values for all columns, or one for each column.
+
+  <step> contains finite-difference step sizes; parameters with step 0
+  are held fixed.  <lowbound> and <highbound> restrict the parameters.
+  <ithresh> is the maximum number of iterations (default 100).
+  <dthresh> is the relative decrease in chi-square below which the fit
+  is considered to have converged (default 1e-10).  <err> receives
+  estimates of the standard errors in the parameters.
+
+  Returns the best-fit parameters, followed by the fit quality (the
+  square root of the weighted sum of the squares of the residuals),
+  for each fitted column.
+
+*/
+int32_t lux_fitlm(ArgumentCount narg, Symbol ps[])
+{
+  int32_t *dims, ndim, nPoints, nElem, nPar, nProfile, nStart, n, i;
+  int32_t xSym, ySym, startSym, iq;
+  double *x, *y, *start, *step = NULL, *lowbound = NULL, *hibound = NULL,
+    *weights = NULL, dThresh = 1e-10;
+  int32_t iThresh = 100, fitSym = 0;
+  void (*profile)(double const *, int32_t, double const *, int32_t, double *,
+                  double *) = NULL;
+
+  int32_t vocal = (internalMode & 1);
+  switch (internalMode/2 & 3) {
+  case 1:
+    profile = gaussians_lm;
+    break;
+  case 2:
+    profile = powerfunc_lm;
+    break;
+  case 3:
+    return luxerror("Multiple fit functions specified", 0);
+  }
+
+  if (narg > 10 && ps[10]) {    // FIT
+    if (profile)
+      return luxerror("Multiple fit functions specified", ps[10]);
+    if (!symbolIsStringScalar(ps[10]))
+      return cerror(NEED_STR, ps[10]);
+    fitSym = stringpointer(string_value(ps[10]), SP_USER_FUNC);
+    if (fitSym < 0)
+      return luxerror("Sorry, fitting to internal routines is not yet implemented",
+                      ps[10]);
+  } else if (!profile)
+    profile = gaussians_lm;
+
+  if (!symbolIsNumericalArray(ps[1]))
+    return cerror(NEED_NUM_ARR, ps[1]);
+  ySym = lux_double(1, &ps[1]);   // Y
+  if (numerical(ySym, &dims, &ndim, &nElem, NULL) < 0)
+    return LUX_ERROR;
+  nPoints = dims[0];
+  nProfile = nElem/nPoints;
+  y = (double *) array_data(ySym);
+
+  xSym = lux_double(1, &ps[0]);   // X
+  if (numerical(xSym, NULL, NULL, &n, NULL) < 0)
+    return LUX_ERROR;
+  if (n != nPoints)
+    return cerror(INCMP_ARG, ps[0]);
+  x = (double *) array_data(xSym);
+
+  startSym = lux_double(1, &ps[2]); // START
+  if (numerical(startSym, NULL, NULL, &nStart, NULL) < 0)
+    return LUX_ERROR;
+  start = (double *) array_data(startSym);
+
+  if (narg > 3 && ps[3]) {      // STEP
+    iq = lux_double(1, &ps[3]);
+    if (numerical(iq, NULL, NULL, &nPar, NULL) < 0)
+      return LUX_ERROR;
+    step = (double *) array_data(iq);
+  } else {
+    int32_t *sdims, sndim;
+    numerical(startSym, &sdims, &sndim, NULL, NULL);
+    nPar = sdims[0];
+  }
+  // START may hold one set of values (perhaps followed by a fit
+  // quality) for all profiles, or one set for each profile
+  int32_t startStride;
+  if (nStart == nPar || nStart == nPar + 1)
+    startStride = 0;
+  else if (nStart == nPar*nProfile)
+    startStride = nPar;
+  else if (nStart == (nPar + 1)*nProfile)
+    startStride = nPar + 1;
+  else
+    return cerror(INCMP_ARG, ps[2]);
+
+  if (profile == gaussians_lm && (nPar - 1) % 3 != 0)
+    return luxerror("Need one plus a multiple of three parameters for gaussian fits", ps[2]);
+  if (profile == powerfunc_lm && nPar != 5)
+    return luxerror("Need five parameters for power-function fits", ps[2]);
+
+  if (narg > 4 && ps[4]) {      // LOWBOUND
+    iq = lux_double(1, &ps[4]);
+    if (numerical(iq, NULL, NULL, &n, NULL) < 0)
+      return LUX_ERROR;
+    if (n != nPar)
+      return cerror(INCMP_ARG, ps[4]);
+    lowbound = (double *) array_data(iq);
+  }
+  if (narg > 5 && ps[5]) {      // HIGHBOUND
+    iq = lux_double(1, &ps[5]);
+    if (numerical(iq, NULL, NULL, &n, NULL) < 0)
+      return LUX_ERROR;
+    if (n != nPar)
+      return cerror(INCMP_ARG, ps[5]);
+    hibound = (double *) array_data(iq);
+  }
+  if (lowbound && hibound) {
+    for (i = 0; i < nPar; i++)
+      if (hibound[i] <= lowbound[i])
+        return luxerror("High bound %g of parameter %d is not greater than low bound %g", ps[5], hibound[i], i + 1, lowbound[i]);
+  }
+  if (narg > 6 && ps[6]) {      // WEIGHTS
+    iq = lux_double(1, &ps[6]);
+    if (numerical(iq, NULL, NULL, &n, NULL) < 0)
+      return LUX_ERROR;
+    if (n != nPoints && n != nElem)
+      return cerror(INCMP_ARG, ps[6]);
+    weights = (double *) array_data(iq);
+  }
+  int32_t weightStride = (weights && n == nElem)? nPoints: 0;
+  if (narg > 7 && ps[7])        // ITHRESH
+    iThresh = int_arg(ps[7]);
+  if (iThresh <= 0)
+    iThresh = 100;
+  if (narg > 8 && ps[8])        // DTHRESH
+    dThresh = double_arg(ps[8]);
+
+  double *err = NULL;
+  if (narg > 9 && ps[9]) {      // ERR
+    int32_t edims[MAX_DIMS];
+    memcpy(edims, dims, ndim*sizeof(int32_t));
+    edims[0] = nPar;
+    if (redef_array(ps[9], LUX_DOUBLE, ndim, edims) < 0)
+      return LUX_ERROR;
+    err = (double *) array_data(ps[9]);
+  }
+
+  int32_t rdims[MAX_DIMS];
+  memcpy(rdims, dims, ndim*sizeof(int32_t));
+  rdims[0] = nPar + 1;
+  int32_t result = array_scratch(LUX_DOUBLE, ndim, rdims);
+  double *out = (double *) array_data(result);
+
+  // fits one profile; the model must be thread-safe if called from
+  // more than one thread at the same time
+  auto fit_one = [&](int32_t k, LevenbergMarquardt::Model const& model,
+                     LevenbergMarquardt::Jacobian const& jacobian) {
+    LevenbergMarquardt lm(nPar, nPoints, y + k*nPoints,
+                          weights? weights + k*weightStride: NULL);
+    lm.set_bounds(lowbound, hibound);
+    if (step)
+      lm.set_steps(step);
+    lm.set_max_iterations(iThresh);
+    lm.set_tolerance(dThresh);
+    double *par = out + k*(nPar + 1);
+    memcpy(par, start + k*startStride, nPar*sizeof(double));
+    LevenbergMarquardt::Status status = lm.fit(model, jacobian, par);
+    par[nPar] = sqrt(lm.chi2());
+    if (err)
+      lm.errors(err + k*nPar);
+    if (vocal)
+      printf("FITLM profile %d: %s after %zu iterations, quality %g\n",
+             k, status == LevenbergMarquardt::CONVERGED? "converged":
+             "not converged", lm.iterations(), par[nPar]);
+    return status;
+  };
+
+  if (profile) {
+    // the built-in profiles are thread-safe, so we can fit several
+    // profiles in parallel
+    parallel_for(nProfile, 1, [&](size_t begin, size_t end) {
+      auto model = [&](double const *par, double *m) {
+        profile(par, nPar, x, nPoints, m, NULL);
+        return true;
+      };
+      std::vector<double> scratch(nPoints);
+      auto jacobian = [&](double const *par, double const *, double *jac) {
+        profile(par, nPar, x, nPoints, scratch.data(), jac);
+        return true;
+      };
+      for (size_t k = begin; k < end; k++)
+        fit_one(k, model, jacobian);
+    });
+    return result;
+  }
+
+  // a user-defined function; it gets called as <fit>(<par>, <x>) and
+  // must return <nPoints> model values
+  int32_t fitPar = array_scratch(LUX_DOUBLE, 1, &nPar);
+  symbol_context(fitPar) = 1;   // so it won't be deleted prematurely
+  if (isFreeTemp(xSym))
+    symbol_context(xSym) = 1;
+  int16_t fitArg[2] = { (int16_t) fitPar, (int16_t) xSym };
+  int32_t fitTemp = nextFreeTempExecutable();
+  symbol_class(fitTemp) = LUX_USR_FUNC;
+  usr_func_arguments(fitTemp) = fitArg;
+  symbol_memory(fitTemp) = 2*sizeof(int16_t);
+  usr_func_number(fitTemp) = fitSym;
+
+  int32_t error = 0;
+  auto model = [&](double const *par, double *m) {
+    memcpy(array_data(fitPar), par, nPar*sizeof(double));
+    int32_t j = eval(fitTemp);
+    if (j < 0) {
+      error = j;
+      return false;
+    }
+    int32_t iq = lux_double(1, &j), n = 0;
+    bool ok = (numerical(iq, NULL, NULL, &n, NULL) >= 0 && n == nPoints);
+    if (ok)
+      memcpy(m, array_data(iq), nPoints*sizeof(double));
+    else
+      error = luxerror("Fit function returned %d model values; expected %d",
+                       fitSym, n, nPoints);
+    if (iq != j)
+      zapTemp(iq);
+    zapTemp(j);
+    return ok;
+  };
+  for (i = 0; i < nProfile && !error; i++)
+    if (fit_one(i, model, nullptr) == LevenbergMarquardt::MODEL_FAILED)
+      error = LUX_ERROR;
+
+  symbol_class(fitTemp) = LUX_SCALAR;
+  zap(fitTemp);
+  zap(fitPar);
+  if (symbol_context(xSym) == 1)
+    symbol_context(xSym) = -compileLevel;
+  if (error) {
+    zap(result);
+    return LUX_ERROR;
+  }
+  return result;
+}
+REGISTER(fitlm, f, fitlm, 3, 11, "x:y:start:step:lowbound:highbound:weights:ithresh:dthresh:err:fit:1vocal:2gaussians:4powerfunc");
 //------------------------------------------------------------ This
 // This union differs from Pointer in that all integer members are
 // unsigned.
@@ -1108,11 +1522,80 @@ void calculate_distribution(double *distr, double *deviation, int32_t *rtoi,
   }
 }
 
+/// Evaluates the user-defined fit function for a number of members
+/// of a population at once.  The fit function receives a 2D parameter
+/// array with one column per member and must return one fit quality
+/// per member.
+///
+/// \param fitTemp is the temporary executable that calls the fit
+/// function.
+///
+/// \param fitArg is the argument list of \a fitTemp.  Its first element
+/// is temporarily replaced by the batch parameter array.
+///
+/// \param genes points at the parameter values of the population.
+///
+/// \param which points at the indices of the members to evaluate.
+///
+/// \param count is the number of members to evaluate.
+///
+/// \param nPar is the number of parameters per member.
+///
+/// \param partype is the data type of the parameters.
+///
+/// \param deviation points at the fit qualities of the population.
+/// The qualities of the evaluated members are stored in it.
+///
+/// \returns `LUX_OK` on success, `LUX_ERROR` on failure.
+static int32_t
+evaluate_batch(int32_t fitTemp, int16_t *fitArg, uint8_t const *genes,
+               int32_t const *which, int32_t count, int32_t nPar,
+               Symboltype partype, double *deviation)
+{
+  int32_t dims[2] = { nPar, count };
+  int32_t size = nPar*lux_type_size[partype];
+  int16_t save = fitArg[0];
+  int32_t result = LUX_OK;
+
+  int32_t batchPar = array_scratch(partype, 2, dims);
+  symbol_context(batchPar) = 1; // so it doesn't get prematurely deleted
+  uint8_t *p = (uint8_t *) array_data(batchPar);
+  for (int32_t i = 0; i < count; i++)
+    memcpy(p + i*size, genes + which[i]*size, size);
+
+  fitArg[0] = batchPar;
+  int32_t j = eval(fitTemp);
+  fitArg[0] = save;
+  if (j == LUX_ERROR)
+    result = LUX_ERROR;
+  else {
+    int32_t n = 0, iq = lux_double(1, &j);
+    if (numerical(iq, NULL, NULL, &n, NULL) < 0 || n != count)
+      result = luxerror("Batch fit function returned %d fit qualities; expected %d",
+                        0, n, count);
+    else {
+      double *q = (double *) array_data(iq);
+      for (int32_t i = 0; i < count; i++)
+        deviation[which[i]] = q[i];
+    }
+    if (iq != j)
+      zapTemp(iq);
+    zapTemp(j);
+  }
+  zap(batchPar);
+  return result;
+}
+
 int32_t lux_geneticfit(ArgumentCount narg, Symbol ps[])
 /* FIT2(x,y,START,fit [,mu,ngenerations,population,pcross,pmutate,vocal]
-        [,/ELITE,/BYTE,/WORD,/LONG,/FLOAT,/DOUBLE]) */
+        [,/ELITE,/BYTE,/WORD,/LONG,/FLOAT,/DOUBLE,/BATCH]) */
+// With /BATCH, the fit function is called once for the whole initial
+// population and once per generation for all changed offspring, with a
+// 2D parameter array that has one column per member, and must return
+// one fit quality per member.
 {
-  int32_t   fitSym, iq, nPoints, nPopulation, nPar, fitTemp, i, j, size, result,
+  int32_t   fitSym, iq, nPoints, nPopulation, nPar, fitTemp, i, j, size,
+    result = LUX_ERROR,
     *rtoi, pair, k, w, generation, i1, i2, ibit,
     iter = 0, vocal, typesize, nGeneration;
   uscalar p;
@@ -1124,7 +1607,7 @@ int32_t lux_geneticfit(ArgumentCount narg, Symbol ps[])
   void  invertPermutation(int32_t *data, int32_t n),
     indexxr_f(int32_t n, float ra[], int32_t indx[]);
   int32_t   random_distributed(int32_t modulus, double *distr);
-  uint8_t  changed, elite;
+  uint8_t  changed, elite, batch;
   Symboltype partype;
   static uint16_t mask1[] = {
     0xff, 0x7f, 0x3f, 0x1f, 0x0f, 0x07, 0x03, 0x01
@@ -1254,6 +1737,7 @@ int32_t lux_geneticfit(ArgumentCount narg, Symbol ps[])
     vocal = 0;
 
   elite = (internalMode & 1);
+  batch = (internalMode & 16)? 1: 0;
 
   fitPar = array_scratch(partype, 1, &nPar);
   symbol_context(fitPar) = 1;   // so it doesn't get prematurely deleted
@@ -1275,6 +1759,7 @@ int32_t lux_geneticfit(ArgumentCount narg, Symbol ps[])
   // create initial population
   genes = (uint8_t*) malloc(nPopulation*size);
   genes2 = (uint8_t*) malloc(nPopulation*size);
+  uint8_t *genes2end = genes2 + nPopulation*size;
   deviation = (double*) malloc(nPopulation*sizeof(double));
   deviation2 = (double*) malloc(nPopulation*sizeof(double));
   rtoi = (int32_t*) malloc(nPopulation*sizeof(int32_t));
@@ -1305,7 +1790,24 @@ int32_t lux_geneticfit(ArgumentCount narg, Symbol ps[])
 
   /* now calculate the fitness of all members of the population.
      Less is better. */
-  for (i = 0; i < nPopulation; i++) {
+  std::vector<int32_t> pending;
+  if (batch) {
+    pending.resize(nPopulation);
+    std::iota(pending.begin(), pending.end(), 0);
+    if (evaluate_batch(fitTemp, fitArg, genes, pending.data(), nPopulation,
+                       nPar, partype, deviation) == LUX_ERROR)
+      bad = 1;
+    else
+      for (i = 0; i < nPopulation; i++) {
+        deviation[i] = fabs(deviation[i]); // distance from goal
+        if (vocal) {
+          printf("%d/%d: ", i, nPopulation);
+          printgene(genes + i*size, nPar, partype, 0, &deviation[i]);
+          putchar('\n');
+        }
+      }
+  }
+  for (i = 0; i < nPopulation && !batch; i++) {
     memcpy(par, genes + i*size, size);
     j = eval(fitTemp);          // get deviation ("distance from goal")
     if (j == LUX_ERROR) {       // some error occurred
@@ -1379,6 +1881,7 @@ int32_t lux_geneticfit(ArgumentCount narg, Symbol ps[])
     generation = nGeneration;
     // iterate over the desired number of generations
     while (generation--) {        // all generations
+      pending.clear();
       if (elite) {                // always keep the best two
         memcpy(genes2, genes + size*rtoi[nPopulation - 1], size);
         genes2 += size;
@@ -1508,7 +2011,12 @@ int32_t lux_geneticfit(ArgumentCount narg, Symbol ps[])
         genes2 += size;
         memcpy(genes2, child2, size);
         genes2 += size;
-        if (changed) { // TODO: only reevaluate for the changed child, not both
+        if (changed && batch) { // evaluate later, together with the rest
+          int32_t index = nPopulation - (genes2end - genes2)/size;
+          pending.push_back(index - 2);
+          pending.push_back(index - 1);
+          deviation2 += 2;
+        } else if (changed) { // TODO: only reevaluate for the changed child, not both
           memcpy(par, child1, size);
           j = eval(fitTemp);
           if (j == LUX_ERROR) {
@@ -1537,6 +2045,14 @@ int32_t lux_geneticfit(ArgumentCount narg, Symbol ps[])
       genes2 -= nPopulation*size;
       deviation2 -= nPopulation;
 
+      if (!pending.empty()
+          && evaluate_batch(fitTemp, fitArg, genes2, pending.data(),
+                            pending.size(), nPar, partype,
+                            deviation2) == LUX_ERROR) {
+        bad = 4;
+        break;
+      }
+
       memcpy(genes, genes2, nPopulation*size);
       memcpy(deviation, deviation2, nPopulation*sizeof(double));
 
@@ -1587,9 +2103,11 @@ int32_t lux_geneticfit(ArgumentCount narg, Symbol ps[])
     }
   }
 
-  if (bad == 3) {
-    genes2 -= pair*2*nPar*typesize;
-    deviation2 -= pair*2;
+  if (bad >= 3) {
+    if (bad == 3) {
+      genes2 -= pair*2*nPar*typesize;
+      deviation2 -= pair*2;
+    }
 
     if (symbol_context(ySym) == 1)
       symbol_context(ySym) = -compileLevel; // so they'll be deleted
@@ -32,9 +32,13 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 #include <float.h>
 #include <errno.h>
 #include <ctype.h>
+#include <type_traits>
+#include <vector>
 #include "install.hh"
 #include "action.hh"
 #include "calendar.hh"
+#include "Histogram.hh"
+#include "Reduction.hh"
 
 #if !NDEBUG
 size_t InstanceID::s_instance_id = 0; // define static member
@@ -1551,12 +1555,136 @@ int32_t lux_conjugate(ArgumentCount narg, Symbol ps[])
   return result;
 }
 //-------------------------------------------------------------------------
+/// The weighted sum of the values in a class, and the sum of their
+/// weights, for index_total().
+struct ClassSum
+{
+  double real = 0;              //!< The real part of the sum.
+  double imaginary = 0;         //!< The imaginary part of the sum.
+  double weight = 0;            //!< The sum of the weights.
+};
+
+/// Adds two ClassSums.
+///
+/// \param a is the first ClassSum.
+///
+/// \param b is the second ClassSum.
+///
+/// \returns the sum.
+static inline ClassSum
+operator+(ClassSum const& a, ClassSum const& b)
+{
+  return ClassSum{ a.real + b.real, a.imaginary + b.imaginary,
+                   a.weight + b.weight };
+}
+
+/// Sums or averages values by class, for TOTAL and MEAN with a class
+/// argument.
+///
+/// \tparam Value is the type of the values.
+///
+/// \tparam Weight is the type of the weights.
+///
+/// \tparam Out is the type of the results.
+///
+/// \param src points at the values.
+///
+/// \param indx points at the class of each value.
+///
+/// \param weights points at the weight of each value, or is `NULL` if
+/// all weights are equal to 1.
+///
+/// \param n is the number of values.
+///
+/// \param offset is minus the least class, if that is negative, and 0
+/// otherwise.
+///
+/// \param size is the number of classes.
+///
+/// \param mean says whether to calculate averages rather than sums.
+///
+/// \param trgt points at the results, one for each class.  Classes
+/// without values or with zero total weight get 0.
+template<typename Value, typename Weight, typename Out>
+static void
+index_sums(Value const* src, int32_t const* indx, Weight const* weights,
+           size_t n, int32_t offset, size_t size, bool mean, Out* trgt)
+{
+  std::vector<ClassSum> sums(size);
+  histogram(sums.data(), size, n, [&](size_t begin, size_t end,
+                                      ClassSum* s) {
+    for (size_t i = begin; i < end; ++i) {
+      ClassSum& c = s[indx[i] + offset];
+      double w = weights? weights[i]: 1;
+      if constexpr (std::is_arithmetic_v<Value>)
+        c.real += src[i]*w;
+      else {
+        c.real += src[i].real*w;
+        c.imaginary += src[i].imaginary*w;
+      }
+      c.weight += w;
+    }
+  });
+  for (size_t k = 0; k < size; ++k) {
+    double f = (mean && sums[k].weight)? 1/sums[k].weight: 1;
+    if constexpr (std::is_arithmetic_v<Out>)
+      trgt[k] = sums[k].real*f;
+    else {
+      trgt[k].real = sums[k].real*f;
+      trgt[k].imaginary = sums[k].imaginary*f;
+    }
+  }
+}
+
+/// Calls index_sums() for the type of the values.
+///
+/// \param type is the type of the values.
+///
+/// \param src points at the values.
+///
+/// The other parameters are as for index_sums().
+template<typename Weight, typename Out>
+static void
+index_sums(Symboltype type, Pointer src, int32_t const* indx,
+           Weight const* weights, size_t n, int32_t offset, size_t size,
+           bool mean, Out* trgt)
+{
+  switch (type) {
+    case LUX_INT8:
+      index_sums(src.ui8, indx, weights, n, offset, size, mean, trgt);
+      break;
+    case LUX_INT16:
+      index_sums(src.i16, indx, weights, n, offset, size, mean, trgt);
+      break;
+    case LUX_INT32:
+      index_sums(src.i32, indx, weights, n, offset, size, mean, trgt);
+      break;
+    case LUX_INT64:
+      index_sums(src.i64, indx, weights, n, offset, size, mean, trgt);
+      break;
+    case LUX_FLOAT:
+      index_sums(src.f, indx, weights, n, offset, size, mean, trgt);
+      break;
+    case LUX_DOUBLE:
+      index_sums(src.d, indx, weights, n, offset, size, mean, trgt);
+      break;
+    case LUX_CFLOAT:
+      index_sums(src.cf, indx, weights, n, offset, size, mean, trgt);
+      break;
+    case LUX_CDOUBLE:
+      index_sums(src.cd, indx, weights, n, offset, size, mean, trgt);
+      break;
+    default:
+      break;
+  }
+}
+
 int32_t index_total(ArgumentCount narg, Symbol ps[], int32_t mean)
 // accumulates source values by class
 {
-  int32_t       type, offset, *indx, i, size, result, nElem, indices2,
+  int32_t       offset, *indx, i, size, result, nElem, indices2,
     haveWeights, p, psign, pp, nbase, j;
-  Symboltype outType;
+  Symboltype type, outType;
   Pointer       src, trgt, sum, weights, hist;
   Scalar        temp, value;
   FloatComplex  tempcf, valuecf;
@@ -1623,444 +1751,27 @@ int32_t index_total(ArgumentCount narg, Symbol ps[], int32_t mean)
   sum.ui8 += offset*lux_type_size[outType];
   i = nElem;
   if (p == 1) {                         // regular summation
-    if (haveWeights) {          // have <weights>
-      if (mean) {               // want average
-        ALLOCATE(hist.d, size, double);
-        zerobytes(hist.d, size*sizeof(double));
-        hist.d += offset;
-        switch (outType) {
-          case LUX_FLOAT:
-            switch (type) {
-              case LUX_INT8:
-                while (i--) {           // get the sum
-                  hist.f[*indx] += *weights.f;
-                  trgt.f[*indx] += (float) *src.ui8++ * *weights.f++;
-                  indx++;
-                }
-                break;
-              case LUX_INT16:
-                while (i--) {           // first, get the sum
-                  hist.f[*indx] += *weights.f;
-                  trgt.f[*indx] += (float) *src.i16++ * *weights.f++;
-                  indx++;
-                }
-                break;
-              case LUX_INT32:
-                while (i--) {           // first, get the sum
-                  hist.f[*indx] += *weights.f;
-                  trgt.f[*indx] += (float) *src.i32++ * *weights.f++;
-                  indx++;
-                }
-                break;
-              case LUX_INT64:
-                while (i--) {           // first, get the sum
-                  hist.f[*indx] += *weights.f;
-                  trgt.f[*indx] += (float) *src.i64++ * *weights.f++;
-                  indx++;
-                }
-                break;
-              case LUX_FLOAT:
-                while (i--) {           // first, get the sum
-                  hist.f[*indx] += *weights.f;
-                  trgt.f[*indx] += (float) *src.f++ * *weights.f++;
-                  indx++;
-                }
-                break;
-            } // end of switch (type)
-            // and divide by number
-            for (i = -offset; i < size - offset; i++)
-              if (hist.f[i])
-                trgt.f[i] /= hist.f[i];
-            break;
-          case LUX_DOUBLE:
-            switch (type) {
-              case LUX_INT8:
-                while (i--) {           // get the sum
-                  hist.d[*indx] += *weights.d;
-                  trgt.d[*indx] += (double) *src.ui8++ * *weights.d++;
-                  indx++;
-                }
-                break;
-              case LUX_INT16:
-                while (i--) {           // first, get the sum
-                  hist.d[*indx] += *weights.d;
-                  trgt.d[*indx] += (double) *src.i16++ * *weights.d++;
-                  indx++;
-                }
-                break;
-              case LUX_INT32:
-                while (i--) {           // first, get the sum
-                  hist.d[*indx] += *weights.d;
-                  trgt.d[*indx] += (double) *src.i32++ * *weights.d++;
-                  indx++;
-                }
-                break;
-              case LUX_INT64:
-                while (i--) {           // first, get the sum
-                  hist.d[*indx] += *weights.d;
-                  trgt.d[*indx] += (double) *src.i64++ * *weights.d++;
-                  indx++;
-                }
-                break;
-              case LUX_FLOAT:
-                while (i--) {           // first, get the sum
-                  hist.d[*indx] += *weights.d;
-                  trgt.d[*indx] += (double) *src.f++ * *weights.d++;
-                  indx++;
-                }
-                break;
-              case LUX_DOUBLE:
-                while (i--) {           // first, get the sum
-                  hist.d[*indx] += *weights.d;
-                  trgt.d[*indx] += *src.d++ * *weights.d++;
-                  indx++;
-                }
-                break;
-            } // end of switch (type)
-            // and divide by number
-            for (i = -offset; i < size - offset; i++)
-              if (hist.d[i])
-                trgt.d[i] /= hist.d[i];
-            break;
-          case LUX_CFLOAT:
-            while (i--) {
-              hist.f[*indx] += *weights.f;
-              trgt.cf[*indx].real += (float) src.cf->real * *weights.f;
-              trgt.cf[*indx++].imaginary +=
-                (float) src.cf++->imaginary * *weights.f++;
-            }
-            for (i = -offset; i < size - offset; i++)
-              if (hist.f[i]) {
-                trgt.cf[i].real /= hist.f[i];
-                trgt.cf[i].imaginary /= hist.f[i];
-              } else
-                trgt.cf[i].real = trgt.cf->imaginary = 0.0;
-            break;
-          case LUX_CDOUBLE:
-            switch (type) {
-              case LUX_CFLOAT:
-                while (i--) {
-                  hist.d[*indx] += *weights.d;
-                  trgt.cd[*indx].real += (float) src.cf->real * *weights.d;
-                  trgt.cd[*indx++].imaginary +=
-                    (float) src.cf++->imaginary * *weights.d++;
-                }
-                break;
-              case LUX_CDOUBLE:
-                while (i--) {
-                  hist.d[*indx] += *weights.d;
-                  trgt.cd[*indx].real += (float) src.cd->real * *weights.d;
-                  trgt.cd[*indx++].imaginary +=
-                    (float) src.cd++->imaginary * *weights.d++;
-                }
-                break;
-            } // end of switch (type)
-            for (i = -offset; i < size - offset; i++)
-              if (hist.d[i]) {
-                trgt.cd[i].real /= hist.d[i];
-                trgt.cd[i].imaginary /= hist.d[i];
-              } else
-                trgt.cd[i].real = trgt.cf->imaginary = 0.0;
-            break;
-        } // end of switch (outType)
-        free(hist.d - offset);
-      } else {                  // want totals
-        switch (outType) {
-          case LUX_FLOAT:
-            switch (type) {
-              case LUX_INT8:
-                while (i--)             // get the sum
-                  trgt.f[*indx++] += (float) *src.ui8++ * *weights.f++;
-                break;
-              case LUX_INT16:
-                while (i--)             // first, get the sum
-                  trgt.f[*indx++] += (float) *src.i16++ * *weights.f++;
-                break;
-              case LUX_INT32:
-                while (i--)             // first, get the sum
-                  trgt.f[*indx++] += (float) *src.i32++ * *weights.f++;
-                break;
-              case LUX_INT64:
-                while (i--)             // first, get the sum
-                  trgt.f[*indx++] += (float) *src.i64++ * *weights.f++;
-                break;
-              case LUX_FLOAT:
-                while (i--)             // first, get the sum
-                  trgt.f[*indx++] += (float) *src.f++ * *weights.f++;
-                break;
-            } // end of switch (type)
-            break;
-          case LUX_DOUBLE:
-            switch (type) {
-              case LUX_INT8:
-                while (i--)     // get the sum
-                  trgt.d[*indx++] += (double) *src.ui8++ * *weights.d++;
-                break;
-              case LUX_INT16:
-                while (i--)             // first, get the sum
-                  trgt.d[*indx++] += (double) *src.i16++ * *weights.d++;
-                break;
-              case LUX_INT32:
-                while (i--)             // first, get the sum
-                  trgt.d[*indx++] += (double) *src.i32++ * *weights.d++;
-                break;
-              case LUX_INT64:
-                while (i--)             // first, get the sum
-                  trgt.d[*indx++] += (double) *src.i64++ * *weights.d++;
-                break;
-              case LUX_FLOAT:
-                while (i--)             // first get the sum
-                  trgt.d[*indx++] += (double) *src.f++ * *weights.d++;
-                break;
-              case LUX_DOUBLE:
-                while (i--)             // first get the sum
-                  trgt.d[*indx++] += *src.d++ * *weights.d++;
-                break;
-            } // end of switch (type)
-            break;
-          case LUX_CFLOAT:
-            while (i--) {
-              trgt.cf[*indx].real += src.cf->real * *weights.f;
-              trgt.cf[*indx++].imaginary += src.cf++->imaginary * *weights.f++;
-            }
-            break;
-          case LUX_CDOUBLE:
-            switch (type) {
-              case LUX_CFLOAT:
-                while (i--) {
-                  trgt.cd[*indx].real += src.cf->real * *weights.d;
-                  trgt.cd[*indx++].imaginary +=
-                    src.cf++->imaginary * *weights.d++;
-                }
-                break;
-              case LUX_CDOUBLE:
-                while (i--) {
-                  trgt.cd[*indx].real += src.cd->real * *weights.d;
-                  trgt.cd[*indx++].imaginary +=
-                    src.cd++->imaginary * *weights.d++;
-                }
-                break;
-            }
-            break;
-        } // end of switch (outType)
-      }         // end of if (mean) else
-    } else {                    // no <weights>: each element counts once
-      if (mean) {               // want average
-        ALLOCATE(hist.i32, size, int32_t);
-        zerobytes(hist.i32, size*sizeof(int32_t));
-        hist.i32 += offset;
-        switch (outType) {
-          case LUX_FLOAT:
-            switch (type) {
-              case LUX_INT8:
-                while (i--) {           // get the sum
-                  hist.i32[*indx]++;
-                  trgt.f[*indx] += (float) *src.ui8++;
-                  indx++;
-                }
-                break;
-              case LUX_INT16:
-                while (i--) {           // first, get the sum
-                  hist.i32[*indx]++;
-                  trgt.f[*indx] += (float) *src.i16++;
-                  indx++;
-                }
-                break;
-              case LUX_INT32:
-                while (i--) {           // first, get the sum
-                  hist.i32[*indx]++;
-                  trgt.f[*indx] += (float) *src.i32++;
-                  indx++;
-                }
-                break;
-              case LUX_INT64:
-                while (i--) {           // first, get the sum
-                  hist.i32[*indx]++;
-                  trgt.f[*indx] += (float) *src.i64++;
-                  indx++;
-                }
-                break;
-              case LUX_FLOAT:
-                while (i--) {           // first, get the sum
-                  hist.i32[*indx]++;
-                  trgt.f[*indx] += (float) *src.f++;
-                  indx++;
-                }
-                break;
-            } // end of switch (type)
-            // and divide by number
-            for (i = -offset; i < size - offset; i++)
-              if (hist.i32[i])
-                trgt.f[i] /= hist.i32[i];
-            break;
-          case LUX_DOUBLE:
-            switch (type) {
-              case LUX_INT8:
-                while (i--) {           // get the sum
-                  hist.i32[*indx]++;
-                  trgt.d[*indx] += *src.ui8++;
-                  indx++;
-                }
-                break;
-              case LUX_INT16:
-                while (i--) {           // first, get the sum
-                  hist.i32[*indx]++;
-                  trgt.d[*indx] += *src.i16++;
-                  indx++;
-                }
-                break;
-              case LUX_INT32:
-                while (i--) {           // first, get the sum
-                  hist.i32[*indx]++;
-                  trgt.d[*indx] += *src.i32++;
-                  indx++;
-                }
-                break;
-              case LUX_INT64:
-                while (i--) {           // first, get the sum
-                  hist.i32[*indx]++;
-                  trgt.d[*indx] += *src.i64++;
-                  indx++;
-                }
-                break;
-              case LUX_FLOAT:
-                while (i--) {           // first, get the sum
-                  hist.i32[*indx]++;
-                  trgt.d[*indx] += *src.f++;
-                  indx++;
-                }
-                break;
-              case LUX_DOUBLE:
-                while (i--) {           // first, get the sum
-                  hist.i32[*indx]++;
-                  trgt.d[*indx] += *src.d++;
-                  indx++;
-                }
-                break;
-            } // end of switch (type)
-            // and divide by number
-            for (i = -offset; i < size - offset; i++)
-              if (hist.i32[i])
-                trgt.d[i] /= hist.i32[i];
-            break;
-          case LUX_CFLOAT:
-            while (i--) {
-              hist.i32[*indx]++;
-              trgt.cf[*indx].real += (float) src.cf->real;
-              trgt.cf[*indx++].imaginary += (float) src.cf++->imaginary;
-            }
-            for (i = -offset; i < size - offset; i++)
-              if (hist.i32[i]) {
-                trgt.cf[i].real /= hist.i32[i];
-                trgt.cf[i].imaginary /= hist.i32[i];
-              } else
-                trgt.cf[i].real = trgt.cf->imaginary = 0.0;
-            break;
-          case LUX_CDOUBLE:
-            switch (type) {
-              case LUX_CFLOAT:
-                while (i--) {
-                  hist.i32[*indx]++;
-                  trgt.cd[*indx].real += (float) src.cf->real;
-                  trgt.cd[*indx++].imaginary += (float) src.cf++->imaginary;
-                }
-                break;
-              case LUX_CDOUBLE:
-                while (i--) {
-                  hist.i32[*indx]++;
-                  trgt.cd[*indx].real += (float) src.cd->real;
-                  trgt.cd[*indx++].imaginary += (float) src.cd++->imaginary;
-                }
-                break;
-            } // end of switch (type)
-            for (i = -offset; i < size - offset; i++)
-              if (hist.i32[i]) {
-                trgt.cd[i].real /= hist.i32[i];
-                trgt.cd[i].imaginary /= hist.i32[i];
-              } else
-                trgt.cd[i].real = trgt.cf->imaginary = 0.0;
-            break;
-        } // end of switch (outType)
-        free(hist.i32 - offset);
-      } else {                  // want totals
-        switch (outType) {
-          case LUX_FLOAT:
-            switch (type) {
-              case LUX_INT8:
-                while (i--)             // get the sum
-                  trgt.f[*indx++] += (float) *src.ui8++;
-                break;
-              case LUX_INT16:
-                while (i--)             // first, get the sum
-                  trgt.f[*indx++] += (float) *src.i16++;
-                break;
-              case LUX_INT32:
-                while (i--)             // first, get the sum
-                  trgt.f[*indx++] += (float) *src.i32++;
-                break;
-              case LUX_INT64:
-                while (i--)             // first, get the sum
-                  trgt.f[*indx++] += *src.i64++;
-                break;
-              case LUX_FLOAT:
-                while (i--)             // first, get the sum
-                  trgt.f[*indx++] += (float) *src.f++;
-                break;
-            } // end of switch (type)
-            break;
-          case LUX_DOUBLE:
-            switch (type) {
-              case LUX_INT8:
-                while (i--)     // get the sum
-                  trgt.d[*indx++] += *src.ui8++;
-                break;
-              case LUX_INT16:
-                while (i--)             // first, get the sum
-                  trgt.d[*indx++] += *src.i16++;
-                break;
-              case LUX_INT32:
-                while (i--)             // first, get the sum
-                  trgt.d[*indx++] += *src.i32++;
-                break;
-              case LUX_INT64:
-                while (i--)             // first, get the sum
-                  trgt.d[*indx++] += *src.i64++;
-                break;
-              case LUX_FLOAT:
-                while (i--)             // first get the sum
-                  trgt.d[*indx++] += *src.f++;
-                break;
-              case LUX_DOUBLE:
-                while (i--)             // first get the sum
-                  trgt.d[*indx++] += *src.d++;
-                break;
-            } // end of switch (type)
-            break;
-          case LUX_CFLOAT:
-            while (i--) {
-              trgt.cf[*indx].real += src.cf->real;
-              trgt.cf[*indx++].imaginary += src.cf++->imaginary;
-            }
-            break;
-          case LUX_CDOUBLE:
-            switch (type) {
-              case LUX_CFLOAT:
-                while (i--) {
-                  trgt.cd[*indx].real += src.cf->real;
-                  trgt.cd[*indx++].imaginary += src.cf++->imaginary;
-                }
-                break;
-              case LUX_CDOUBLE:
-                while (i--) {
-                  trgt.cd[*indx].real += src.cd->real;
-                  trgt.cd[*indx++].imaginary += src.cd++->imaginary;
-                }
-                break;
-            }
-            break;
-        } // end of switch (outType)
-      }         // end of if (mean) else
-    } // end of if (haveWeights) else
+    void* out = array_data(result);
+    switch (outType) {
+      case LUX_FLOAT:
+        index_sums(type, src, indx, haveWeights? weights.f: NULL, nElem,
+                   offset, size, mean, (float*) out);
+        break;
+      case LUX_DOUBLE:
+        index_sums(type, src, indx, haveWeights? weights.d: NULL, nElem,
+                   offset, size, mean, (double*) out);
+        break;
+      case LUX_CFLOAT:
+        index_sums(type, src, indx, haveWeights? weights.f: NULL, nElem,
+                   offset, size, mean, (FloatComplex*) out);
+        break;
+      case LUX_CDOUBLE:
+        index_sums(type, src, indx, haveWeights? weights.d: NULL, nElem,
+                   offset, size, mean, (DoubleComplex*) out);
+        break;
+      default:
+        break;
+    }
   } else {                      // power summation
     // we set up for the calculation of the powers.  We use a scheme that
     // minimizes the number of multiplications that need to be performed.
@@ -3744,33 +3455,41 @@ public:
   void
   operator()()
   {
-    int done = 0;
+    ReductionShape shape(m_src_loop.rndim, m_src_loop.rdims,
+                         m_src_loop.rsinglestep, m_src_loop.naxes);
+    const InType* src = m_src_data;
+    OutType* tgt = m_tgt_data;
+    const ScalarTransform<IntermediateType>& transform = m_transform;
+    bool identity = (&m_transform == &m_nulltransform);
+    // the divisor is converted first so that negative integer totals are
+    // not converted to unsigned
+    IntermediateType length = std::max(shape.length(), (size_t) 1);
+    bool want_mean = m_want_mean;
+
     if (m_omit_NaNs) {
-      do {
-        IntermediateType sum = 0;
-        size_t m_element_count = 0;
-        do {
-          if (!isnan(*m_src_data)) {
-            sum += m_transform(*m_src_data);
-            ++m_element_count;
-          }
-        } while ((done = m_src_loop.advanceLoop(&m_src_data))
-                 < m_src_loop.naxes);
-        *m_tgt_data++ = m_want_mean?
-          sum/std::max(m_element_count, (size_t) 1): sum;
-      } while (done < m_src_loop.rndim);
+      typedef WeightedSum<IntermediateType> Sum;
+      shape.for_each_output([&](size_t k) {
+        Sum sum = shape.reduce<Sum>(k, [&](ptrdiff_t i) {
+          if (isnan(src[i]))
+            return Sum{};
+          IntermediateType x = src[i];
+          return Sum{identity? x: transform(x), (IntermediateType) 1};
+        });
+        tgt[k] = want_mean?
+          sum.sum/std::max(sum.weight, (IntermediateType) 1): sum.sum;
+      });
+    } else if (identity) {
+      shape.for_each_output([&](size_t k) {
+        IntermediateType sum = shape.reduce<IntermediateType>(k,
+          [src](ptrdiff_t i) { return (IntermediateType) src[i]; });
+        tgt[k] = want_mean? sum/length: sum;
+      });
     } else {
-      do {
-        IntermediateType sum = 0;
-        size_t m_element_count = 0;
-        do {
-          sum += m_transform(*m_src_data);
-          ++m_element_count;
-        } while ((done = m_src_loop.advanceLoop(&m_src_data))
-                 < m_src_loop.naxes);
-        *m_tgt_data++ = m_want_mean?
-          sum/std::max(m_element_count, (size_t) 1): sum;
-      } while (done < m_src_loop.rndim);
+      shape.for_each_output([&](size_t k) {
+        IntermediateType sum = shape.reduce<IntermediateType>(k,
+          [&](ptrdiff_t i) { return transform(src[i]); });
+        tgt[k] = want_mean? sum/length: sum;
+      });
     }
   }
 
@@ -3945,34 +3664,41 @@ public:
   void
   operator()()
   {
-    int done = 0;
-    if (m_omit_NaNs) {
-      do {
-        IntermediateType sum = 0;
-        IntermediateType weight = 0;
-        do {
-          if (!isnan(*m_src_data)) {
-            sum += m_transform(*m_src_data) * *m_weight_data;
-            weight += *m_weight_data;
-          }
-        } while ((done = (m_weight_loop.advanceLoop(&m_weight_data),
-                          m_src_loop.advanceLoop(&m_src_data)))
-                 < m_src_loop.naxes);
-        *m_tgt_data++ = m_want_mean? (weight? sum/weight: 0): sum;
-      } while (done < m_src_loop.rndim);
-    } else {
-      do {
-        IntermediateType sum = 0;
-        IntermediateType weight = 0;
-        do {
-          sum += m_transform(*m_src_data) * *m_weight_data;
-          weight += *m_weight_data;
-        } while ((done = (m_weight_loop.advanceLoop(&m_weight_data),
-                          m_src_loop.advanceLoop(&m_src_data)))
-                 < m_src_loop.naxes);
-        *m_tgt_data++ = m_want_mean? (weight? sum/weight: 0): sum;
-      } while (done < m_src_loop.rndim);
-    }
+    // the weights have the same dimensions and type as the values, so an
+    // element has the same offset in both
+    ReductionShape shape(m_src_loop.rndim, m_src_loop.rdims,
+                         m_src_loop.rsinglestep, m_src_loop.naxes);
+    const InType* src = m_src_data;
+    const InType* w = m_weight_data;
+    OutType* tgt = m_tgt_data;
+    const ScalarTransform<IntermediateType>& transform = m_transform;
+    bool identity = (&m_transform == &m_nulltransform);
+    bool omit_NaNs = m_omit_NaNs;
+    bool want_mean = m_want_mean;
+
+    typedef WeightedSum<IntermediateType> Sum;
+    shape.for_each_output([&](size_t k) {
+      Sum sum;
+      if (omit_NaNs)
+        sum = shape.reduce<Sum>(k, [&](ptrdiff_t i) {
+          if (isnan(src[i]))
+            return Sum{};
+          IntermediateType x = src[i];
+          IntermediateType wi = w[i];
+          return Sum{(identity? x: transform(x))*wi, wi};
+        });
+      else if (identity)
+        sum = shape.reduce<Sum>(k, [src, w](ptrdiff_t i) {
+          IntermediateType wi = w[i];
+          return Sum{(IntermediateType) src[i]*wi, wi};
+        });
+      else
+        sum = shape.reduce<Sum>(k, [&](ptrdiff_t i) {
+          IntermediateType wi = w[i];
+          return Sum{transform(src[i])*wi, wi};
+        });
+      tgt[k] = want_mean? (sum.weight? sum.sum/sum.weight: 0): sum.sum;
+    });
   }
 
 private:
@@ -4577,7 +4303,7 @@ int32_t total(ArgumentCount narg, Symbol ps[], bool mean)
           }
           break;
         case LUX_DOUBLE:
-          {                     // TODO: kahan summation
+          {
             AlgorithmTotal a(srcinfo, src.d, trgt.d, mean, omitNaNs);
             a();
           }
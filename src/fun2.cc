@@ -33,8 +33,11 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 #include <limits.h>
 #include <ctype.h>
 #include <cassert>
+#include <algorithm>
+#include <vector>
 #include "action.hh"
 #include "install.hh"
+#include "Reduction.hh"
 
 extern int32_t  nFixed;
 static  int32_t         result_sym, detrend_flag;
@@ -1737,75 +1740,94 @@ int32_t lux_covariance(ArgumentCount narg, Symbol ps[])
 }
 //-------------------------------------------------------------------------
 
-/// A template function to facilitate the calculation of the weighted standard
-/// deviation or variance.
+/// A template function that calculates the (weighted) variances of real data
+/// values along some of their dimensions.
 ///
 /// \tparam T is the type of the data values and weights.
 ///
-/// \tparam omitNaNs says whether NaN values should be omitted.  This is only
-/// relevant if T is a floating point type.
+/// \param[in] shape says which data values go into which variance.
 ///
-/// \param[in,out] srcinfo is a reference to information about the data values
-/// to process.
+/// \param[in] values points at the first of the data values.
 ///
-/// \param[in,out] winfo is a reference to information about the weights to
-/// process.  It is assumed that \a srcinfo and \a winfo are consistent.
+/// \param[in] weights points at the first of the weights, which have the same
+/// dimensions as the data values.  If it is \c NULL, then all data values have
+/// the same weight.
 ///
-/// \param[in] values points at the first of the data values to process.
+/// \param[in] omitNaNs says whether data values and weights that are NaN
+/// should be omitted.
 ///
-/// \param[in] weights points at the first of the weights to process.
+/// \param[in] sample says whether to calculate the sample variance rather
+/// than the population variance.  It is ignored if there are weights.
 ///
-/// \param[out] M receives the weighted mean value of the data.
+/// \param[in] outtype is the type of the variances, which must be LUX_FLOAT
+/// or LUX_DOUBLE.
 ///
-/// \param[out] S receives the weighted sum of squared deviations from the mean.
+/// \param[in,out] tgt points at where the variances should be stored.  It is
+/// advanced beyond the last of them.
 ///
-/// \param[out] N receives the incremental weighted effective sample size.
-///
-/// \returns a return value as from advanceLoop().
-template<typename T, bool omitNaNs>
-int32_t
-calculations_for_sdev(LoopInfo& srcinfo,
-                      LoopInfo& winfo,
-                      const T* values,
-                      const T* weights,
-                      double& M,
-                      double& S,
-                      double& N)
+/// \returns the (weighted) mean of the data values that went into the last
+/// variance.
+template<typename T>
+double
+variances(ReductionShape const& shape, const T* values, const T* weights,
+          bool omitNaNs, bool sample, Symboltype outtype, Pointer& tgt)
 {
-  // The below algorithm is based on
-  // https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Weighted_incremental_algorithm
-  // attributed to West, D. H. D. (1979). "Updating Mean and Variance Estimates:
-  // An Improved Method". Communications of the ACM. 22 (9):
-  // 532–535. doi:10.1145/359146.359153. S2CID 30671293.  I (Louis Strous, 2023)
-  // changed the accumulation of the sum of squares of the weights to an
-  // incremental calculation of the effective sample size N, which remains much
-  // smaller.
-
-  M = 0;                  // incremental mean
-  S = 0;                  // incremental sum of squared deviations from the mean
-  N = 0;                  // incremental effective sample size
-  double W = 0;           // sum of weights
-
-  int32_t done = 0;
-  do {
-    if ((!omitNaNs              // evaluated at compile time
-         || (!isnan(*values) && !isnan(*weights)))
-        && *weights != 0)
-    {
-      T v = *values;
-      double w = *weights;
-      assert(w > 0 || "weights assumed > 0");
-      W += w;
-      auto old_M = M;
-      auto q = w/W;
-      M = old_M + q*(v - old_M);
-      S += w*(v - old_M)*(v - M);
-      N += (w - N)*q;
-    }
-  } while ((done = (winfo.advanceLoop(weights),
-                    srcinfo.advanceLoop(values)))
-           < srcinfo.naxes);
-  return done;
+  typedef WeightedSum<double> Sum;
+  Pointer out = tgt;
+  double lastmean = 0;
+
+  shape.for_each_output([&](size_t k) {
+    Sum sum;
+    if (weights)
+      sum = shape.reduce<Sum>(k, [&](ptrdiff_t i) {
+        if (omitNaNs && (isnan(values[i]) || isnan(weights[i])))
+          return Sum{};
+        return Sum{(double) values[i]*weights[i], (double) weights[i]};
+      });
+    else if (omitNaNs)
+      sum = shape.reduce<Sum>(k, [&](ptrdiff_t i) {
+        return isnan(values[i])? Sum{}: Sum{(double) values[i], 1.0};
+      });
+    else
+      sum = Sum{shape.reduce<double>(k, [values](ptrdiff_t i) {
+                  return (double) values[i];
+                }), (double) shape.length()};
+    double mean = sum.sum/(sum.weight? sum.weight: 1);
+
+    double S;
+    if (weights)
+      S = shape.reduce<double>(k, [&](ptrdiff_t i) {
+        if (omitNaNs && (isnan(values[i]) || isnan(weights[i])))
+          return 0.0;
+        double d = values[i] - mean;
+        return d*d*weights[i];
+      });
+    else if (omitNaNs)
+      S = shape.reduce<double>(k, [&](ptrdiff_t i) {
+        if (isnan(values[i]))
+          return 0.0;
+        double d = values[i] - mean;
+        return d*d;
+      });
+    else
+      S = shape.reduce<double>(k, [values, mean](ptrdiff_t i) {
+        double d = values[i] - mean;
+        return d*d;
+      });
+
+    double n = sum.weight;
+    if (!weights && sample && n)
+      --n;
+    double variance = S/(n? n: 1);
+    if (outtype == LUX_FLOAT)
+      out.f[k] = (float) variance;
+    else
+      out.d[k] = variance;
+    if (k == shape.outputs() - 1)
+      lastmean = mean;
+  });
+  tgt.ui8 += shape.outputs()*lux_type_size[outtype];
+  return lastmean;
 }
 
 int32_t sdev(ArgumentCount narg, Symbol ps[], int32_t sq)
@@ -1836,7 +1858,7 @@ int32_t sdev(ArgumentCount narg, Symbol ps[], int32_t sq)
 // LS 19 July 2000
 {
   int32_t       result, n, i, n2, save[MAX_DIMS], haveWeights;
-  Pointer       src, trgt, src0, trgt0, weight, weight0;
+  Pointer       src, trgt, src0, trgt0, weight;
   DoubleComplex         cmean;
   LoopInfo      srcinfo, trgtinfo, winfo;
   Symboltype outtype;
@@ -1900,544 +1922,76 @@ int32_t sdev(ArgumentCount narg, Symbol ps[], int32_t sq)
 
   trgt0 = trgt;
 
-  /* Knuth (the Art of Computer Programming, Volume 2: Seminumerical
-     Algorithms) gives the following algorithm for calculating the
-     standard deviation with just one pass through the data and the
-     least round-off error and guaranteed nonnegative variance:
-
-     M₁ = x₁
-     S₁ = 0
-     M_k = M_{k-1} + (x_k - M_{k-1})/k
-     S_k = S_{k-1} + (x_k - M_{k-1})(x_k - M_k)
-     σ = √(S_k/(n - 1))
-
-     TODO: Extend this algorithm to weighted data */
-
-  double        mean, sdev, temp, nn;
+  /* The real-valued cases go through a ReductionShape, which takes
+     two passes through the data: one for the (weighted) mean, and one
+     for the (weighted) sum of squared deviations from that mean.
+     Both sums are pairwise and spread over threads, with results
+     that do not depend on the number of threads. */
 
-  double M, S, N;
+  ReductionShape shape(srcinfo.rndim, srcinfo.rdims, srcinfo.rsinglestep,
+                       srcinfo.naxes);
+  double        mean = 0.0, sdev, temp;
   int32_t done;
 
   if (haveWeights) {
     switch (symbol_type(ps[0])) {
       case LUX_INT8:
-        if (omitNaNs)
-        {
-          do {
-            done = calculations_for_sdev<uint8_t,true>(srcinfo, winfo,
-                                                       src.ui8, weight.ui8,
-                                                       M, S, N);
-            switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) (N? S/N: 0);
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = (N? S/N: 0);
-              break;
-            }
-          } while (done < srcinfo.rndim);
-        }
-        else
-        {
-          do {
-            done = calculations_for_sdev<uint8_t,false>(srcinfo, winfo,
-                                                        src.ui8, weight.ui8,
-                                                        M, S, N);
-            switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) (N? S/N: 0);
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = (N? S/N: 0);
-              break;
-            }
-          } while (done < srcinfo.rndim);
-        }
+        mean = variances(shape, src.ui8, weight.ui8, omitNaNs, false,
+                         outtype, trgt);
         break;
       case LUX_INT16:
-        do {
-          mean = 0.0;
-          memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-          src0 = src;
-          weight0 = weight;
-          nn = 0;
-          do {
-            mean += (double) *src.i16 * *weight.i16;
-            nn += (double) *weight.i16;
-          }
-          while (winfo.advanceLoop(&weight.ui8),
-                 srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-          memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-          src = src0;
-          weight = weight0;
-          mean /= (nn? nn: 1);
-          sdev = 0.0;
-          do {
-            temp = ((double) *src.i16 - mean);
-            sdev += temp*temp* *weight.i16;
-          } while ((done = (winfo.advanceLoop(&weight.ui8),
-                            srcinfo.advanceLoop(&src.ui8))) < srcinfo.naxes);
-          if (!nn)
-            nn = 1;
-          sdev /= nn;
-          switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) sdev;
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = sdev;
-              break;
-          }
-        } while (done < srcinfo.rndim);
+        mean = variances(shape, src.i16, weight.i16, omitNaNs, false,
+                         outtype, trgt);
         break;
       case LUX_INT32:
-        do {
-          mean = 0.0;
-          memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-          src0 = src;
-          weight0 = weight;
-          nn = 0;
-          do {
-            mean += (double) *src.i32 * *weight.i32;
-            nn += (double) *weight.i32;
-          }
-          while (winfo.advanceLoop(&weight.ui8),
-                 srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-          memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-          src = src0;
-          weight = weight0;
-          mean /= (nn? nn: 1);
-          sdev = 0.0;
-          do {
-            temp = ((double) *src.i32 - mean);
-            sdev += temp*temp* *weight.i32;
-          } while ((done = (winfo.advanceLoop(&weight.ui8),
-                            srcinfo.advanceLoop(&src.ui8))) < srcinfo.naxes);
-          if (!nn)
-            nn = 1;
-          sdev /= nn;
-          switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) sdev;
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = sdev;
-              break;
-          }
-        } while (done < srcinfo.rndim);
+        mean = variances(shape, src.i32, weight.i32, omitNaNs, false,
+                         outtype, trgt);
         break;
       case LUX_INT64:
-        do {
-          mean = 0.0;
-          memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-          src0 = src;
-          weight0 = weight;
-          nn = 0;
-          do {
-            mean += (double) *src.i64 * *weight.i64;
-            nn += (double) *weight.i64;
-          }
-          while (winfo.advanceLoop(&weight.ui8),
-                 srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-          memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-          src = src0;
-          weight = weight0;
-          mean /= (nn? nn: 1);
-          sdev = 0.0;
-          do {
-            temp = ((double) *src.i64 - mean);
-            sdev += temp*temp* *weight.i64;
-          } while ((done = (winfo.advanceLoop(&weight.ui8),
-                            srcinfo.advanceLoop(&src.ui8))) < srcinfo.naxes);
-          if (!nn)
-            nn = 1;
-          sdev /= nn;
-          switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) sdev;
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = sdev;
-              break;
-          }
-        } while (done < srcinfo.rndim);
+        mean = variances(shape, src.i64, weight.i64, omitNaNs, false,
+                         outtype, trgt);
         break;
       case LUX_FLOAT:
-        if (omitNaNs) {
-          do {
-            mean = 0.0;
-            memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-            src0 = src;
-            weight0 = weight;
-            nn = 0;
-            do {
-              if (!isnan(*src.f) && !isnan(*weight.f)) {
-                mean += (double) *src.f * *weight.f;
-                nn += (double) *weight.f;
-              }
-            }
-            while (winfo.advanceLoop(&weight.ui8),
-                   srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-            memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-            src = src0;
-            weight = weight0;
-            mean /= (nn? nn: 1);
-            sdev = 0.0;
-            do {
-              if (!isnan(*src.f)) {
-                temp = ((double) *src.f - mean);
-                sdev += temp*temp* *weight.f;
-              }
-            } while ((done = (winfo.advanceLoop(&weight.ui8),
-                              srcinfo.advanceLoop(&src.ui8))) < srcinfo.naxes);
-            if (!nn)
-              nn = 1;
-            sdev /= nn;
-            switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) sdev;
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = sdev;
-              break;
-            }
-          } while (done < srcinfo.rndim);
-        } else {
-          do {
-            mean = 0.0;
-            memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-            src0 = src;
-            weight0 = weight;
-            nn = 0;
-            do {
-              mean += (double) *src.f * *weight.f;
-              nn += (double) *weight.f;
-            }
-            while (winfo.advanceLoop(&weight.ui8),
-                   srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-            memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-            src = src0;
-            weight = weight0;
-            mean /= (nn? nn: 1);
-            sdev = 0.0;
-            do {
-              temp = ((double) *src.f - mean);
-              sdev += temp*temp* *weight.f;
-            } while ((done = (winfo.advanceLoop(&weight.ui8),
-                              srcinfo.advanceLoop(&src.ui8))) < srcinfo.naxes);
-            if (!nn)
-              nn = 1;
-            sdev /= nn;
-            switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) sdev;
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = sdev;
-              break;
-            }
-          } while (done < srcinfo.rndim);
-        }
+        mean = variances(shape, src.f, weight.f, omitNaNs, false,
+                         outtype, trgt);
         break;
       case LUX_DOUBLE:
-        if (omitNaNs) {
-          do {
-            mean = 0.0;
-            memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-            src0 = src;
-            weight0 = weight;
-            nn = 0;
-            do {
-              if (!isnan(*src.d) && !isnan(*weight.d)) {
-                mean += (double) *src.d * *weight.d;
-                nn += (double) *weight.d;
-              }
-            }
-            while (winfo.advanceLoop(&weight.ui8),
-                   srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-            memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-            src = src0;
-            weight = weight0;
-            mean /= (nn? nn: 1);
-            sdev = 0.0;
-            do {
-              if (!isnan(*src.d)) {
-                temp = ((double) *src.d - mean);
-                sdev += temp*temp* *weight.d;
-              }
-            } while ((done = (winfo.advanceLoop(&weight.ui8),
-                              srcinfo.advanceLoop(&src.ui8))) < srcinfo.naxes);
-            if (!nn)
-              nn = 1;
-            sdev /= nn;
-            switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) sdev;
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = sdev;
-              break;
-            }
-          } while (done < srcinfo.rndim);
-        } else {
-          do {
-            mean = 0.0;
-            memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-            src0 = src;
-            weight0 = weight;
-            nn = 0;
-            do {
-              mean += (double) *src.d * *weight.d;
-              nn += (double) *weight.d;
-            }
-            while (winfo.advanceLoop(&weight.ui8),
-                   srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-            memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-            src = src0;
-            weight = weight0;
-            mean /= (nn? nn: 1);
-            sdev = 0.0;
-            do {
-              temp = ((double) *src.d - mean);
-              sdev += temp*temp* *weight.d;
-            } while ((done = (winfo.advanceLoop(&weight.ui8),
-                              srcinfo.advanceLoop(&src.ui8))) < srcinfo.naxes);
-            if (!nn)
-              nn = 1;
-            sdev /= nn;
-            switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) sdev;
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = sdev;
-              break;
-            }
-          } while (done < srcinfo.rndim);
-        }
+        mean = variances(shape, src.d, weight.d, omitNaNs, false,
+                         outtype, trgt);
         break;
     }
     zapTemp(haveWeights);       // delete if it is a temp
   } else {                      // no weights
-    n = 1;                      // initialize number of values per sdev
-    for (i = 0; i < srcinfo.naxes; i++)
-      n *= srcinfo.rdims[i];
+    n = shape.length();         // number of values per sdev
     n2 = (internalMode & 1)? n: n - 1; // sample or population sdev
     if (!n2)
       return luxerror("Single values have no sample standard deviation", ps[0]);
 
+    bool sample = !(internalMode & 1);
     switch (symbol_type(ps[0])) {
       case LUX_INT8:
-        do {
-          mean = 0.0;
-          memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-          src0 = src;
-          do
-            mean += (double) *src.ui8;
-          while (srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-          memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-          src = src0;
-          mean /= n;
-          sdev = 0.0;
-          do {
-            temp = ((double) *src.ui8 - mean);
-            sdev += temp*temp;
-          } while ((done = srcinfo.advanceLoop(&src.ui8)) < srcinfo.naxes);
-          switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) (sdev/n2);
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = (sdev/n2);
-              break;
-          }
-        } while (done < srcinfo.rndim);
+        mean = variances(shape, src.ui8, (const uint8_t*) NULL, omitNaNs,
+                         sample, outtype, trgt);
         break;
       case LUX_INT16:
-        do {
-          mean = 0.0;
-          memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-          src0 = src;
-          do
-            mean += (double) *src.i16;
-          while (srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-          memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-          src = src0;
-          mean /= n;
-          sdev = 0.0;
-          do {
-            temp = ((double) *src.i16 - mean);
-            sdev += temp*temp;
-          } while ((done = srcinfo.advanceLoop(&src.ui8)) < srcinfo.naxes);
-          switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) (sdev/n2);
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = (sdev/n2);
-              break;
-          }
-        } while (done < srcinfo.rndim);
+        mean = variances(shape, src.i16, (const int16_t*) NULL, omitNaNs,
+                         sample, outtype, trgt);
         break;
       case LUX_INT32:
-        do {
-          mean = 0.0;
-          memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-          src0 = src;
-          do
-            mean += (double) *src.i32;
-          while (srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-          memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-          src = src0;
-          mean /= n;
-          sdev = 0.0;
-          do {
-            temp = ((double) *src.i32 - mean);
-            sdev += temp*temp;
-          } while ((done = srcinfo.advanceLoop(&src.ui8)) < srcinfo.naxes);
-          switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) (sdev/n2);
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = (sdev/n2);
-              break;
-          }
-        } while (done < srcinfo.rndim);
+        mean = variances(shape, src.i32, (const int32_t*) NULL, omitNaNs,
+                         sample, outtype, trgt);
         break;
       case LUX_INT64:
-        do {
-          mean = 0.0;
-          memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-          src0 = src;
-          do
-            mean += (double) *src.i64;
-          while (srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-          memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-          src = src0;
-          mean /= n;
-          sdev = 0.0;
-          do {
-            temp = ((double) *src.i64 - mean);
-            sdev += temp*temp;
-          } while ((done = srcinfo.advanceLoop(&src.ui8)) < srcinfo.naxes);
-          switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) (sdev/n2);
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = (sdev/n2);
-              break;
-          }
-        } while (done < srcinfo.rndim);
+        mean = variances(shape, src.i64, (const int64_t*) NULL, omitNaNs,
+                         sample, outtype, trgt);
         break;
       case LUX_FLOAT:
-        if (omitNaNs) {
-          do {
-            mean = 0.0;
-            size_t w = 0;
-            memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-            src0 = src;
-            do {
-              if (!isnan(*src.f)) {
-                mean += (double) *src.f;
-                ++w;
-              }
-            } while (srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-            memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-            src = src0;
-            mean /= w? w: 1;
-            sdev = 0.0;
-            do {
-              if (!isnan(*src.f)) {
-                temp = ((double) *src.f - mean);
-                sdev += temp*temp;
-              }
-            } while ((done = srcinfo.advanceLoop(&src.ui8)) < srcinfo.naxes);
-            if (w && !(internalMode & 1))
-              --w;
-            switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) (sdev/(w? w: 1));
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = (sdev/(w? w: 1));
-              break;
-            }
-          } while (done < srcinfo.rndim);
-        } else {
-          do {
-            mean = 0.0;
-            memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-            src0 = src;
-            do
-              mean += (double) *src.f;
-            while (srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-            memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-            src = src0;
-            mean /= n;
-            sdev = 0.0;
-            do {
-              temp = ((double) *src.f - mean);
-              sdev += temp*temp;
-            } while ((done = srcinfo.advanceLoop(&src.ui8)) < srcinfo.naxes);
-            switch (outtype) {
-            case LUX_FLOAT:
-              *trgt.f++ = (float) (sdev/n2);
-              break;
-            case LUX_DOUBLE:
-              *trgt.d++ = (sdev/n2);
-              break;
-            }
-          } while (done < srcinfo.rndim);
-        }
+        mean = variances(shape, src.f, (const float*) NULL, omitNaNs,
+                         sample, outtype, trgt);
         break;
       case LUX_DOUBLE:
-        if (omitNaNs) {
-          do {
-            mean = 0.0;
-            size_t w = 0;
-            memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-            src0 = src;
-            do {
-              if (!isnan(*src.d)) {
-                mean += (double) *src.d;
-                ++w;
-              }
-            } while (srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-            memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-            src = src0;
-            mean /= w? w: 1;
-            sdev = 0.0;
-            do {
-              if (!isnan(*src.d)) {
-                temp = ((double) *src.d - mean);
-                sdev += temp*temp;
-              }
-            } while ((done = srcinfo.advanceLoop(&src.ui8)) < srcinfo.naxes);
-            if (w && !(internalMode & 1))
-              --w;
-            *trgt.d++ = sdev/(w? w: 1);
-          } while (done < srcinfo.rndim);
-        } else {
-          do {
-            mean = 0.0;
-            memcpy(save, srcinfo.coords, srcinfo.ndim*sizeof(int32_t));
-            src0 = src;
-            do
-              mean += (double) *src.d;
-            while (srcinfo.advanceLoop(&src.ui8) < srcinfo.naxes);
-            memcpy(srcinfo.coords, save, srcinfo.ndim*sizeof(int32_t));
-            src = src0;
-            mean /= n;
-            sdev = 0.0;
-            do {
-              temp = ((double) *src.d - mean);
-              sdev += temp*temp;
-            } while ((done = srcinfo.advanceLoop(&src.ui8)) < srcinfo.naxes);
-            *trgt.d++ = sdev/n2;
-          } while (done < srcinfo.rndim);
-        }
+        mean = variances(shape, src.d, (const double*) NULL, omitNaNs,
+                         sample, outtype, trgt);
         break;
       case LUX_CFLOAT:
         do {
@@ -2572,6 +2126,426 @@ int32_t lux_variance(ArgumentCount narg, Symbol ps[])
   return sdev(narg, ps, 0);
 }
 //-------------------------------------------------------------------------
+/// The number of statistics that STATS returns before the quantiles.
+static const int32_t STATS_COUNT = 5;
+
+/// A template function that copies values of any type to a buffer of
+/// `double`s, omitting NaNs if so desired.
+///
+/// \tparam T is the type of the values.
+///
+/// \param[in] values points at the first value.
+///
+/// \param[in] step is the step size (in elements) between the values.
+///
+/// \param[in] count is the number of values.
+///
+/// \param[in] omitNaNs says whether to omit values that are NaN.
+///
+/// \param[out] buffer points at where the values are stored.
+///
+/// \returns the number of stored values.
+template<typename T>
+static size_t
+stats_gather(const T* values, ptrdiff_t step, size_t count, bool omitNaNs,
+             double* buffer)
+{
+  size_t n = 0;
+  if (omitNaNs) {
+    for (size_t i = 0; i < count; ++i) {
+      double x = values[i*step];
+      if (!isnan(x))
+        buffer[n++] = x;
+    }
+  } else if (step == 1) {
+    for (size_t i = 0; i < count; ++i)
+      buffer[i] = values[i];
+    n = count;
+  } else {
+    for (size_t i = 0; i < count; ++i)
+      buffer[i] = values[i*step];
+    n = count;
+  }
+  return n;
+}
+
+/// Calculates quantiles of some values, rearranging those values.
+///
+/// \param[in,out] values holds the values.
+///
+/// \param[in] fractions points at the quantile fractions, which must be
+/// between 0 and 1.
+///
+/// \param[in] nfractions is the number of fractions.
+///
+/// \param[out] result points at where the quantiles are stored.  They are
+/// NaN if any of the values is NaN, and 0 if there are no values.
+static void
+stats_quantiles(std::vector<double>& values, const double* fractions,
+                int32_t nfractions, double* result)
+{
+  size_t n = values.size();
+  bool haveNaN = std::any_of(values.begin(), values.end(),
+                             [](double x) { return isnan(x); });
+  for (int32_t j = 0; j < nfractions; ++j) {
+    if (!n || haveNaN) {
+      result[j] = n? NAN: 0;
+      continue;
+    }
+    // interpolate linearly between the nearest ranks, as QUANTILE does
+    double target = fractions[j]*(n - 1);
+    size_t t = (size_t) floor(target);
+    double f = target - t;
+    std::nth_element(values.begin(), values.begin() + t, values.end());
+    result[j] = values[t];
+    if (f && t + 1 < n)
+      result[j] += (*std::min_element(values.begin() + t + 1, values.end())
+                    - values[t])*f;
+  }
+}
+
+/// Stores the statistics of a set of values.
+///
+/// \param[in] m holds the moments of the values.
+///
+/// \param[in] sample says whether to return the sample standard deviation
+/// rather than the population standard deviation.
+///
+/// \param[out] result points at where the minimum, maximum, mean, standard
+/// deviation, and number of the values are stored, in that order.
+static void
+stats_store(Moments const& m, bool sample, double* result)
+{
+  double n = sample? m.count - 1: m.count;
+  result[0] = m.min;
+  result[1] = m.max;
+  result[2] = m.mean;
+  result[3] = (n > 0)? sqrt(m.m2/n): (isnan(m.m2)? m.m2: 0);
+  result[4] = m.count;
+}
+
+/// A template function that calculates the statistics of the values of an
+/// array along some of its dimensions.
+///
+/// \tparam T is the type of the values.
+///
+/// \param[in] shape says which values go into which statistics.
+///
+/// \param[in] data points at the first value.
+///
+/// \param[in] fractions points at the quantile fractions.
+///
+/// \param[in] nfractions is the number of fractions.
+///
+/// \param[in] omitNaNs says whether to omit values that are NaN.
+///
+/// \param[in] sample says whether to return sample standard deviations.
+///
+/// \param[out] result points at where the statistics are stored, with
+/// #STATS_COUNT + \a nfractions numbers for each output.
+template<typename T>
+static void
+stats_array(ReductionShape const& shape, const T* data,
+            const double* fractions, int32_t nfractions, bool omitNaNs,
+            bool sample, double* result)
+{
+  size_t nstats = STATS_COUNT + nfractions;
+  shape.for_each_output([&](size_t k) {
+    // each block is copied to a small buffer that stays in the cache, so
+    // that the mean and the deviations from it take a single pass through
+    // memory
+    Moments m = shape.reduce_blocks<Moments>(k, [&](size_t output,
+                                                    size_t begin,
+                                                    size_t end) {
+      double buffer[ReductionShape::block_size];
+      size_t n = 0;
+      shape.for_each_run(output, begin, end,
+                         [&](ptrdiff_t offset, ptrdiff_t step,
+                             size_t count) {
+                           n += stats_gather(data + offset, step, count,
+                                             omitNaNs, buffer + n);
+                         });
+      return Moments::of(buffer, n);
+    });
+    stats_store(m, sample, result + k*nstats);
+    if (nfractions) {
+      std::vector<double> values(shape.length());
+      size_t n = 0;
+      shape.for_each_run(k, 0, shape.length(),
+                         [&](ptrdiff_t offset, ptrdiff_t step,
+                             size_t count) {
+                           n += stats_gather(data + offset, step, count,
+                                             omitNaNs, values.data() + n);
+                         });
+      values.resize(n);
+      stats_quantiles(values, fractions, nfractions,
+                      result + k*nstats + STATS_COUNT);
+    }
+  });
+}
+
+/// A template function that calculates the statistics of all values in a
+/// file array, reading the file only once.
+///
+/// \tparam T is the type of the values.
+///
+/// \param[in] fp is the file, positioned at the first value.
+///
+/// \param[in] nelem is the number of values.
+///
+/// \param[in] swap says whether the bytes of the values must be swapped.
+///
+/// \param[in] fractions points at the quantile fractions.
+///
+/// \param[in] nfractions is the number of fractions.
+///
+/// \param[in] omitNaNs says whether to omit values that are NaN.
+///
+/// \param[in] sample says whether to return the sample standard deviation.
+///
+/// \param[out] result points at where the #STATS_COUNT + \a nfractions
+/// statistics are stored.
+///
+/// \returns `LUX_OK` for success, `LUX_ERROR` for failure.
+template<typename T>
+static int32_t
+stats_file(FILE* fp, size_t nelem, bool swap, const double* fractions,
+           int32_t nfractions, bool omitNaNs, bool sample, double* result)
+{
+  // enough blocks per chunk to keep several threads busy
+  const size_t chunk_blocks = 64;
+  const size_t chunk = chunk_blocks*ReductionShape::block_size;
+  std::vector<T> raw(std::min(chunk, nelem));
+  std::vector<double> buffer(raw.size());
+  std::vector<double> values;   // for the quantiles
+  PairwiseStream<Moments> stream;
+  Moments partial[chunk_blocks];
+
+  for (size_t done = 0; done < nelem; ) {
+    size_t n = std::min(chunk, nelem - done);
+    if (fread(raw.data(), sizeof(T), n, fp) != n)
+      return cerror(READ_ERR, 0);
+    if (swap)
+      endian(raw.data(), n*sizeof(T), lux_symboltype_for_type<T>);
+    size_t nblocks = (n + ReductionShape::block_size - 1)
+      /ReductionShape::block_size;
+    parallel_for(nblocks, 4, [&](size_t begin, size_t end) {
+      for (size_t b = begin; b < end; ++b) {
+        size_t i = b*ReductionShape::block_size;
+        size_t count = std::min(ReductionShape::block_size, n - i);
+        size_t m = stats_gather(raw.data() + i, 1, count, omitNaNs,
+                                buffer.data() + i);
+        partial[b] = Moments::of(buffer.data() + i, m);
+        if (m < count)        // mark the omitted values
+          std::fill(buffer.data() + i + m, buffer.data() + i + count, NAN);
+      }
+    });
+    for (size_t b = 0; b < nblocks; ++b)
+      stream.add(partial[b]);
+    if (nfractions) {
+      try {
+        for (size_t i = 0; i < n; ++i)
+          if (!omitNaNs || !isnan(buffer[i]))
+            values.push_back(buffer[i]);
+      } catch (std::bad_alloc&) {
+        return cerror(ALLOC_ERR, 0);
+      }
+    }
+    done += n;
+  }
+  stats_store(stream.result(), sample, result);
+  if (nfractions)
+    stats_quantiles(values, fractions, nfractions, result + STATS_COUNT);
+  return LUX_OK;
+}
+
+/// Implements the STATS function, which calculates the minimum, maximum,
+/// mean, standard deviation, number of values, and optionally quantiles of an
+/// array, along all or some of its dimensions, in a single pass through the
+/// data.
+///
+/// STATS(<x> [, <mode>, QUANTILES=<q>, /SAMPLE, /POPULATION, /KEEPDIMS,
+///       /OMITNANS])
+///
+/// \param narg is the number of arguments.
+///
+/// \param ps points at the arguments.
+///
+/// \returns the symbol of a `double` array with the statistics along its
+/// first dimension, or `LUX_ERROR` for failure.
+Symbol
+lux_stats(ArgumentCount narg, Symbol ps[])
+{
+  extern Scalar         lastsdev, lastmean, lastmin, lastmax;
+  extern int32_t        lastsdev_sym, lastmean_sym, lastmin_sym, lastmax_sym;
+  bool omitNaNs = (internalMode & 8) != 0;
+  bool sample = !(internalMode & 1);
+  bool filemap = symbol_class(ps[0]) == LUX_FILEMAP;
+
+  Symboltype type = filemap? file_map_type(ps[0]): symbol_type(ps[0]);
+  if (!isNumericalType(type) || isComplexType(type)
+      || !(filemap || symbolIsNumerical(ps[0])))
+    return cerror(ILL_TYPE, ps[0]);
+
+  // the quantile fractions
+  std::vector<double> fractions;
+  if (narg > 2 && ps[2]) {
+    int32_t iq = lux_double(1, &ps[2]);
+    int32_t n;
+    Pointer p;
+    if (numerical(iq, NULL, NULL, &n, &p) < 0)
+      return LUX_ERROR;
+    for (int32_t i = 0; i < n; ++i) {
+      if (p.d[i] < 0 || p.d[i] > 1)
+        return luxerror("Quantile fractions must be between 0 and 1, "
+                        "but one was %g", ps[2], p.d[i]);
+      fractions.push_back(p.d[i]);
+    }
+  }
+  int32_t nstats = STATS_COUNT + fractions.size();
+
+  int32_t result, dims[MAX_DIMS], ndim;
+  double* out;
+
+  if (filemap) {
+    if (narg > 1 && ps[1])
+      return luxerror("STATS of a file array can only be taken over all "
+                      "of its elements", ps[1]);
+    FILE* fp = fopen(file_map_file_name(ps[0]), "r");
+    if (!fp)
+      return cerror(ERR_OPEN, ps[0]);
+    if (file_map_has_offset(ps[0])
+        && fseek(fp, file_map_offset(ps[0]), SEEK_SET)) {
+      fclose(fp);
+      return cerror(POS_ERR, ps[0]);
+    }
+    dims[0] = nstats;
+    ndim = 1;
+    if (internalMode & 2) {     // /KEEPDIMS
+      ndim = file_map_num_dims(ps[0]) + 1;
+      if (ndim > MAX_DIMS) {
+        fclose(fp);
+        return cerror(N_DIMS_OVR, ps[0]);
+      }
+      for (int32_t i = 1; i < ndim; ++i)
+        dims[i] = 1;
+    }
+    result = array_scratch(LUX_DOUBLE, ndim, dims);
+    out = (double*) array_data(result);
+    size_t nelem = file_map_size(ps[0]);
+    bool swap = file_map_swap(ps[0]) != 0;
+    const double* q = fractions.data();
+    int32_t nq = fractions.size();
+    int32_t status = LUX_ERROR;
+    switch (type) {
+      case LUX_INT8:
+        status = stats_file<uint8_t>(fp, nelem, swap, q, nq, omitNaNs,
+                                     sample, out);
+        break;
+      case LUX_INT16:
+        status = stats_file<int16_t>(fp, nelem, swap, q, nq, omitNaNs,
+                                     sample, out);
+        break;
+      case LUX_INT32:
+        status = stats_file<int32_t>(fp, nelem, swap, q, nq, omitNaNs,
+                                     sample, out);
+        break;
+      case LUX_INT64:
+        status = stats_file<int64_t>(fp, nelem, swap, q, nq, omitNaNs,
+                                     sample, out);
+        break;
+      case LUX_FLOAT:
+        status = stats_file<float>(fp, nelem, swap, q, nq, omitNaNs,
+                                   sample, out);
+        break;
+      case LUX_DOUBLE:
+        status = stats_file<double>(fp, nelem, swap, q, nq, omitNaNs,
+                                    sample, out);
+        break;
+      default:
+        break;
+    }
+    fclose(fp);
+    if (status != LUX_OK) {
+      zapTemp(result);
+      return LUX_ERROR;
+    }
+  } else {
+    LoopInfo      srcinfo, trgtinfo;
+    Pointer       src, trgt;
+    int32_t       perresult;
+
+    if (standardLoop(ps[0], (narg > 1 && ps[1])? ps[1]: 0,
+                     SL_COMPRESSALL
+                     | (narg > 1 && ps[1]? 0: SL_ALLAXES)
+                     | SL_EXACT
+                     | SL_EACHCOORD
+                     | SL_UNIQUEAXES
+                     | SL_AXESBLOCK
+                     | ((internalMode & 2)? SL_ONEDIMS: 0),
+                     LUX_DOUBLE, &srcinfo, &src, &perresult, &trgtinfo,
+                     &trgt) < 0)
+      return LUX_ERROR;
+    if (!srcinfo.naxes)
+      srcinfo.naxes++;
+
+    // the statistics go in front of the dimensions of the per-statistic
+    // result
+    dims[0] = nstats;
+    ndim = 1;
+    if (symbol_class(perresult) == LUX_ARRAY) {
+      ndim += array_num_dims(perresult);
+      if (ndim > MAX_DIMS) {
+        zapTemp(perresult);
+        return cerror(N_DIMS_OVR, ps[0]);
+      }
+      memcpy(dims + 1, array_dims(perresult),
+             array_num_dims(perresult)*sizeof(int32_t));
+    }
+    zapTemp(perresult);
+    result = array_scratch(LUX_DOUBLE, ndim, dims);
+    out = (double*) array_data(result);
+
+    ReductionShape shape(srcinfo.rndim, srcinfo.rdims, srcinfo.rsinglestep,
+                         srcinfo.naxes);
+    const double* q = fractions.data();
+    int32_t nq = fractions.size();
+    switch (type) {
+      case LUX_INT8:
+        stats_array(shape, src.ui8, q, nq, omitNaNs, sample, out);
+        break;
+      case LUX_INT16:
+        stats_array(shape, src.i16, q, nq, omitNaNs, sample, out);
+        break;
+      case LUX_INT32:
+        stats_array(shape, src.i32, q, nq, omitNaNs, sample, out);
+        break;
+      case LUX_INT64:
+        stats_array(shape, src.i64, q, nq, omitNaNs, sample, out);
+        break;
+      case LUX_FLOAT:
+        stats_array(shape, src.f, q, nq, omitNaNs, sample, out);
+        break;
+      case LUX_DOUBLE:
+        stats_array(shape, src.d, q, nq, omitNaNs, sample, out);
+        break;
+      default:
+        break;
+    }
+  }
+
+  // the statistics of the last result go into the global symbols
+  double* last = out + array_size(result) - nstats;
+  lastmin.d = last[0];
+  lastmax.d = last[1];
+  lastmean.d = last[2];
+  lastsdev.d = last[3];
+  scalar_type(lastmin_sym) = scalar_type(lastmax_sym)
+    = scalar_type(lastmean_sym) = scalar_type(lastsdev_sym) = LUX_DOUBLE;
+  return result;
+}
+REGISTER(stats, f, stats, 1, 3, "::quantiles:0sample:1population:2keepdims:8omitnans");
+//-------------------------------------------------------------------------
 /*
 Algorithm for calculating the standard deviation with very little
 roundoff error, with one pass through the data, and with guaranteed
@@ -4088,19 +4062,13 @@ int32_t lux_fstring(ArgumentCount narg, Symbol ps[])                         //
    LS 24apr93 */
 {
  extern         int32_t         column;
- char   *p3;
- int32_t        col, mq;
+ int32_t        col;
  int32_t        type_formatted_ascii(int32_t, int32_t [], FILE *);
 
  col = column;
  column = 0;
- type_formatted_ascii(narg, ps, NULL);
+ result_sym = type_formatted_ascii(narg, ps, NULL); // the resultant string
  column = col;
- mq = strlen(curScrat);
- result_sym = string_scratch(mq); // for resultant string
- p3 = string_value(result_sym);
- memcpy(p3, curScrat, mq);
- p3[mq] = '\0';
  return result_sym;
 }
 //-------------------------------------------------------------------------
@@ -34,6 +34,8 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdlib.h>             // for strtol
 #include <string.h>
 #include <sys/types.h>
+#include <type_traits>
+#include "Histogram.hh"
 #include "action.hh"
 #include "cdiv.hh"
 #include "editorcharclass.hh"
@@ -1473,67 +1475,59 @@ int32_t lux_hist_dense(ArgumentCount narg, Symbol ps[])
 // HIST(x,l) returns list of present data values in <l> and corresponding
 // histogram as return value.  LS 18feb98
 {
-  int32_t       nStore, nValue, nData, *value, *freq, x, y, result;
+  int32_t       nValue, nData, *value, *freq, result;
   char  *avalue, *afreq;
   Pointer       src;
-  int32_t       findint(int32_t, int32_t *, int32_t);
 
   if (numerical(ps[0], NULL, NULL, &nData, &src) == LUX_ERROR)
     return LUX_ERROR;
-  nStore = 512;
-  avalue = (char *) malloc(nStore*sizeof(int32_t) + sizeof(Array));
-  afreq = (char *) malloc(nStore*sizeof(int32_t) + sizeof(Array));
-  if (!avalue || !afreq)
-    return cerror(ALLOC_ERR, 0);
-  value = (int32_t *) (avalue + sizeof(Array));
-  freq = (int32_t *) (afreq + sizeof(Array));
 
-  nValue = 0;
-  while (nData--) {
-    switch (symbol_type(ps[0])) {
+  // sort copies of the values, then count the runs of equal values
+  std::vector<int32_t> x(nData);
+  switch (symbol_type(ps[0])) {
     case LUX_INT8:
-      x = (int32_t) *src.ui8++;
+      std::copy(src.ui8, src.ui8 + nData, x.begin());
       break;
     case LUX_INT16:
-      x = (int32_t) *src.i16++;
+      std::copy(src.i16, src.i16 + nData, x.begin());
       break;
     case LUX_INT32:
-      x = (int32_t) *src.i32++;
+      std::copy(src.i32, src.i32 + nData, x.begin());
       break;
     case LUX_INT64:
-      x = *src.i64++;
+      std::copy(src.i64, src.i64 + nData, x.begin());
       break;
     case LUX_FLOAT:
-      x = (int32_t) *src.f++;
+      std::copy(src.f, src.f + nData, x.begin());
       break;
     case LUX_DOUBLE:
-      x = (int32_t) *src.d++;
+      std::copy(src.d, src.d + nData, x.begin());
       break;
-    }
-    y = findint(x, value, nValue);
-    if (y >= 0)                         // already in list
-      freq[y]++;
-    else {                      // not yet in list
-      if (++nValue == nStore) { // need to allocate more room
-        nStore += 512;
-        avalue = (char *) realloc(avalue, nStore*sizeof(int32_t) + sizeof(Array));
-        afreq = (char *) realloc(afreq, nStore*sizeof(int32_t) + sizeof(Array));
-        if (!avalue || !afreq)
-          return cerror(ALLOC_ERR, 0);
-        value = (int32_t *) (avalue + sizeof(Array));
-        freq = (int32_t *) (afreq + sizeof(Array));
-      }
-      y = -y;
-      memmove(value + y, value + y - 1, (nValue - y)*sizeof(int32_t));
-      memmove(freq + y, freq + y - 1, (nValue - y)*sizeof(int32_t));
-      value[--y] = x;
-      freq[y] = 1;
-    }
+    default:
+      return cerror(ILL_TYPE, ps[0]);
   }
-  avalue = (char *) realloc(avalue, nValue*sizeof(int32_t) + sizeof(Array));
-  afreq = (char *) realloc(afreq, nValue*sizeof(int32_t) + sizeof(Array));
-  if (!avalue || !afreq)
+  std::sort(x.begin(), x.end());
+  nValue = 0;
+  for (int32_t i = 0; i < nData; ++i)
+    if (!i || x[i] != x[i - 1])
+      ++nValue;
+
+  avalue = (char *) malloc(nValue*sizeof(int32_t) + sizeof(Array));
+  afreq = (char *) malloc(nValue*sizeof(int32_t) + sizeof(Array));
+  if (!avalue || !afreq) {
+    free(avalue);
+    free(afreq);
     return cerror(ALLOC_ERR, 0);
+  }
+  value = (int32_t *) (avalue + sizeof(Array));
+  freq = (int32_t *) (afreq + sizeof(Array));
+  for (int32_t i = 0, j = -1; i < nData; ++i) {
+    if (!i || x[i] != x[i - 1]) {
+      value[++j] = x[i];
+      freq[j] = 0;
+    }
+    ++freq[j];
+  }
 
   getFreeTempVariable(result);
   symbol_class(result) = LUX_ARRAY;
@@ -1555,22 +1549,185 @@ int32_t lux_hist_dense(ArgumentCount narg, Symbol ps[])
   return result;
 }
 //-------------------------------------------------------------------------
+/// Accumulates the histograms of \a nrows rows of \a size values each,
+/// for HIST.
+///
+/// \tparam T is the type of the values.
+///
+/// \tparam Bin is the type of the bins: `int32_t` for counts, or
+/// `double` for sums of weights.
+///
+/// \param data points at the values.
+///
+/// \param weights points at the weights, one for each value, if \a Bin
+/// is `double`.  It is ignored otherwise.
+///
+/// \param size is the number of values per row.
+///
+/// \param nrows is the number of rows.
+///
+/// \param range is the number of bins per row.
+///
+/// \param bins points at the zeroed bins for all rows.
+template<typename T, typename Bin>
+static void
+hist_rows(T const* data, double const* weights, size_t size, size_t nrows,
+          size_t range, Bin* bins)
+{
+  auto add = [&](size_t begin, size_t end, Bin* b) {
+    if constexpr (std::is_integral_v<Bin>)
+      count_values(data + begin, end - begin, histmin, b);
+    else
+      sum_weights(data + begin, weights + begin, end - begin, histmin, b);
+  };
+
+  if (nrows == 1)
+    histogram(bins, range, size, add);
+  else                          // each row has its own bins
+    parallel_for(nrows, std::max<size_t>((1 << 16)/size, 1),
+                 [&](size_t first, size_t last) {
+                   for (size_t r = first; r < last; ++r)
+                     add(r*size, (r + 1)*size, bins + r*range);
+                 });
+}
+
+/// Accumulates a two-dimensional histogram, for HIST.
+///
+/// \tparam T is the type of the \a x values.
+///
+/// \tparam Bin is the type of the bins: `int32_t` for counts, or
+/// `double` for sums of weights.
+///
+/// \param x points at the \a x values.
+///
+/// \param y points at the \a y values.  Values for which \a y is not
+/// finite are skipped.
+///
+/// \param weights points at the weights, one for each value, if \a Bin
+/// is `double`.  It is ignored otherwise.
+///
+/// \param n is the number of values.
+///
+/// \param ymin is the \a y value that goes into the first row of bins.
+///
+/// \param nx is the number of bins per row.
+///
+/// \param ny is the number of rows of bins.
+///
+/// \param bins points at the zeroed bins.
+template<typename T, typename Bin>
+static void
+hist_2d(T const* x, double const* y, double const* weights, size_t n,
+        int32_t ymin, size_t nx, size_t ny, Bin* bins)
+{
+  histogram(bins, nx*ny, n, [&](size_t begin, size_t end, Bin* b) {
+    for (size_t i = begin; i < end; ++i) {
+      if (!isfinite(y[i]))
+        continue;
+      size_t k = histogram_index(x[i], histmin)
+        + nx*histogram_index(y[i], ymin);
+      if constexpr (std::is_integral_v<Bin>)
+        ++b[k];
+      else
+        b[k] += weights[i];
+    }
+  });
+}
+
+/// Calls hist_rows() or hist_2d() for the type of the data.
+///
+/// \tparam Bin is the type of the bins.
+///
+/// \param type is the type of the data.
+///
+/// \param data points at the data.
+///
+/// \param y points at the \a y values for a two-dimensional
+/// histogram, or is `NULL` otherwise.
+///
+/// \param weights points at the weights, if \a Bin is `double`.
+///
+/// \param size is the number of values per row.
+///
+/// \param nrows is the number of rows.
+///
+/// \param ymin is the \a y value that goes into the first row of bins.
+///
+/// \param nx is the number of bins per row.
+///
+/// \param ny is the number of rows of bins of a two-dimensional
+/// histogram.
+///
+/// \param bins points at the zeroed bins.
+template<typename Bin>
+static void
+hist_dispatch(Symboltype type, Pointer data, double const* y,
+              double const* weights, size_t size, size_t nrows,
+              int32_t ymin, size_t nx, size_t ny, Bin* bins)
+{
+  switch (type) {
+    case LUX_INT8:
+      if (y)
+        hist_2d(data.ui8, y, weights, size, ymin, nx, ny, bins);
+      else
+        hist_rows(data.ui8, weights, size, nrows, nx, bins);
+      break;
+    case LUX_INT16:
+      if (y)
+        hist_2d(data.i16, y, weights, size, ymin, nx, ny, bins);
+      else
+        hist_rows(data.i16, weights, size, nrows, nx, bins);
+      break;
+    case LUX_INT32:
+      if (y)
+        hist_2d(data.i32, y, weights, size, ymin, nx, ny, bins);
+      else
+        hist_rows(data.i32, weights, size, nrows, nx, bins);
+      break;
+    case LUX_INT64:
+      if (y)
+        hist_2d(data.i64, y, weights, size, ymin, nx, ny, bins);
+      else
+        hist_rows(data.i64, weights, size, nrows, nx, bins);
+      break;
+    case LUX_FLOAT:
+      if (y)
+        hist_2d(data.f, y, weights, size, ymin, nx, ny, bins);
+      else
+        hist_rows(data.f, weights, size, nrows, nx, bins);
+      break;
+    case LUX_DOUBLE:
+      if (y)
+        hist_2d(data.d, y, weights, size, ymin, nx, ny, bins);
+      else
+        hist_rows(data.d, weights, size, nrows, nx, bins);
+      break;
+    default:
+      break;
+  }
+}
+
 Symbol
 lux_hist(ArgumentCount narg, Symbol ps[]) // histogram function
                                  // (frequency distribution)
 // general histogram function
 // keyword /FIRST produces a histogram of all elements along the 0th
 // dimension for all higher dimensions
+// WEIGHTS=<w> sums the weights instead of counting the elements
+// Y=<y> produces a two-dimensional histogram of <x> and <y>
 {
-  int32_t       iq, i, n, range, result_sym, *dims, nRepeat,
-        ndim, axis, one = 1, size;
+  int32_t       iq, n, range, result_sym, *dims, nRepeat,
+        ndim, one = 1, size, ymin = 0, yrange = 1;
   Symboltype type;
-  Array *h;
-  Pointer q1, q2;
-  int32_t       lux_zero(int32_t, int32_t []);
+  Pointer q1;
+  double        *weights = NULL, *y = NULL;
 
-  if (narg == 2)
+  if (narg > 1 && ps[1]) {
+    if ((narg > 2 && ps[2]) || (narg > 3 && ps[3]))
+      return luxerror("A dense histogram cannot have weights or a "
+                      "second dimension", ps[1]);
     return lux_hist_dense(narg, ps);
+  }
   iq = ps[0];
   switch (symbol_class(iq))
   {
@@ -1591,6 +1748,50 @@ lux_hist(ArgumentCount narg, Symbol ps[]) // histogram function
     default:
       return cerror(ILL_CLASS, iq);
     }
+  if (!isRealType(type))
+    return cerror(ILL_TYPE, iq);
+  if (narg > 2 && ps[2]) {      // WEIGHTS
+    int32_t iw = lux_double(1, &ps[2]);
+    int32_t nw;
+    Pointer pw;
+    if (numerical(iw, NULL, NULL, &nw, &pw) < 0)
+      return LUX_ERROR;
+    if (nw != n)
+      return cerror(INCMP_ARG, ps[2]);
+    weights = pw.d;
+  }
+  if (narg > 3 && ps[3]) {      // Y
+    if (internalMode & 1)
+      return luxerror("/FIRST cannot be combined with a second dimension",
+                      ps[3]);
+    int32_t iy = lux_double(1, &ps[3]);
+    int32_t ny;
+    Pointer py;
+    if (numerical(iy, NULL, NULL, &ny, &py) < 0)
+      return LUX_ERROR;
+    if (ny != n)
+      return cerror(INCMP_ARG, ps[3]);
+    y = py.d;
+    // the range of the finite y; the other values are not counted
+    double ylo = 0, yhi = -1;
+    for (int32_t i = 0; i < n; i++)
+      if (isfinite(y[i])) {
+        if (ylo > yhi)
+          ylo = yhi = y[i];
+        else if (y[i] < ylo)
+          ylo = y[i];
+        else if (y[i] > yhi)
+          yhi = y[i];
+      }
+    if (ylo > yhi)              // no finite y at all
+      ylo = yhi = 0;
+    if (ylo <= INT32_MIN || yhi >= INT32_MAX
+        || trunc(yhi) + 1 - std::min(trunc(ylo), 0.0) > INT32_MAX)
+      return luxerror("The y values (%g through %g) span too many bins",
+                      ps[3], ylo, yhi);
+    ymin = ylo < 0? (int32_t) ylo: 0;
+    yrange = (int32_t) yhi + 1 - ymin;
+  }
   // always need the range
   minmax( q1.i32, n, type);
   // get long (int32_t) versions of min and max
@@ -1606,86 +1807,43 @@ lux_hist(ArgumentCount narg, Symbol ps[]) // histogram function
            symbolIdent(iq, I_TRUNCATE));
     printf("!histmin and !histmax to find range included\n");
   }
+  if (((double) histmax + 1 - histmin)*yrange > INT32_MAX)
+    return luxerror("A histogram of %g by %d bins is too large", iq,
+                    (double) histmax + 1 - histmin, yrange);
   range = histmax + 1;
   if (histmin < 0)
     range -= histmin;
-  axis = internalMode & 1;
-  if (axis)
+
+  Symboltype outtype = weights? LUX_DOUBLE: LUX_INT32;
+  int32_t rdims[MAX_DIMS];
+  rdims[0] = range;
+  if (internalMode & 1)         // /FIRST
   {
     size = *dims;
     nRepeat = n/size;
-    one = nRepeat*range;
-    result_sym = array_scratch(LUX_INT32, 1, &one);
-    h = HEAD(result_sym);
-    h->dims[0] = range;
-    if (ndim > 1) memcpy(&h->dims[1], &dims[1], sizeof(int32_t)*(ndim - 1));
-    h->ndim = ndim;
+    memcpy(rdims + 1, dims + 1, (ndim - 1)*sizeof(int32_t));
   }
   else
   {
-    one = range;
     size = n;
     nRepeat = 1;
-    result_sym = array_scratch(LUX_INT32, 1, &one);
-    h = HEAD(result_sym);
+    ndim = y? 2: 1;
+    rdims[1] = yrange;
   }
-  q2.i32 = (int32_t *) ((char *)h + sizeof(Array));
-  lux_zero( 1, &result_sym);            // need to zero initially
+  result_sym = array_scratch(outtype, ndim, rdims);
+  zerobytes(array_data(result_sym),
+            array_size(result_sym)*lux_type_size[outtype]);
   // now accumulate the distribution
-  while (nRepeat--)
-  {
-    n = size;
-    switch (type)
-    {
-      case LUX_INT8:
-        while (n--)
-        {
-          i = *q1.ui8++ - histmin;
-          q2.i32[i]++;
-        }
-        break;
-      case LUX_INT16:
-        while (n--)
-        {
-          i = *q1.i16++ - histmin;
-          q2.i32[i]++;
-        }
-        break;
-      case LUX_INT32:
-        while (n--)
-        {
-          i = *q1.i32++ - histmin;
-          q2.i32[i]++;
-        }
-        break;
-      case LUX_INT64:
-        while (n--)
-        {
-          i = *q1.i64++ - histmin;
-          q2.i64[i]++;
-        }
-        break;
-      case LUX_FLOAT:
-        while (n--)
-        {
-          i = *q1.f++ - histmin;
-          q2.i32[i]++;
-        }
-        break;
-      case LUX_DOUBLE:
-        while (n--)
-        {
-          i = *q1.d++ - histmin;
-          q2.i32[i]++;
-        }
-        break;
-      }
-    q2.i32 += range;
-  }
+  if (weights)
+    hist_dispatch(type, q1, y, weights, size, nRepeat, ymin, range, yrange,
+                  (double*) array_data(result_sym));
+  else
+    hist_dispatch(type, q1, y, weights, size, nRepeat, ymin, range, yrange,
+                  (int32_t*) array_data(result_sym));
   return result_sym;
 }
 // ignorelimit, increaselimit, silent are deprecated and ignored
-REGISTER(hist, f, hist, 1, 2, "1first:2ignorelimit:4increaselimit:8silent" );
+REGISTER(hist, f, hist, 1, 4, "::weights:y:1first:2ignorelimit:4increaselimit:8silent" );
 //-------------------------------------------------------------------------
 int32_t lux_sieve(ArgumentCount narg, Symbol ps[])
 /* X=SIEVE(array,condition), where condition is normally a logical array
@@ -43,6 +43,7 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 #include "editor.hh"
 #include "editorcharclass.hh"
 #include "action.hh"
+#include "Bytecode.hh"
 
 extern char const* symbolStack[];
 extern SymbolImpl    sym[];
@@ -105,13 +106,13 @@ extern LuxRoutine lux_area, lux_area2, lux_arestore, lux_astore,
   lux_fits_write, lux_float_inplace, lux_format_set, lux_fprint,
   lux_fprintf, lux_fread, lux_freadf, lux_freads, lux_fzhead,
   lux_fzinspect, lux_fzread, lux_fzwrite, lux_getmin9, lux_help,
-  lux_hex, lux_inserter, lux_int64_inplace,
+  lux_hex, lux_inserter, lux_int64_inplace, lux_iowait,
   lux_limits, lux_list, lux_long_inplace, lux_manualterm,
   lux_multisieve, lux_noecho, lux_noop, lux_one, lux_openr, lux_openu,
   lux_openw, lux_orientation,
   lux_pointer, lux_pop,
   lux_printf, lux_push, lux_quit, lux_read, lux_readarr,
-  lux_readf, lux_readu, lux_record, lux_redim,
+  lux_readf, lux_readtable, lux_readu, lux_record, lux_redim,
   lux_redirect_diagnostic, lux_replace_values, lux_rewindf, lux_sc,
   lux_scb, lux_set, lux_setenv, lux_shift, lux_show, lux_show_func,
   lux_show_subr, lux_spawn, lux_step, lux_string_inplace,
@@ -230,8 +231,8 @@ InternalRoutine         subroutine_table[] = {
   { "area",     1, 4, lux_area, ":seed:numbers:diagonal" }, // topology.c
   { "area2",    2, 6, lux_area2,                            // toplogy.c
     "::seed:numbers:diagonal:sign" },
-  { "arestore", 1, MAX_ARG, lux_arestore, 0 },      // files.c
-  { "astore",   2, MAX_ARG, lux_astore, 0 },        // files.c
+  { "arestore", 2, MAX_ARG, lux_arestore, "%1%names:1map" }, // files.c
+  { "astore",   2, MAX_ARG, lux_astore, "1compress" }, // files.c
   { "atomize",  1, 1, lux_atomize, "1tree:2line" }, // strous.c
   { "batch",    0, 1, lux_batch, "1quit" },         // symbols.c
   { "breakpoint", 0, 1, lux_breakpoint,             // install.c
@@ -290,8 +291,8 @@ InternalRoutine         subroutine_table[] = {
   { "fileread", 5, 5, lux_fileread, 0 },                     // files.c
   { "filetofz", 3, 3, lux_file_to_fz, 0 },                   // files.c
   { "filewrite", 2, 3, lux_filewrite, 0 },                   // files.c
-  { "fits_read", 2, 7, lux_fits_read, // files.c
-    "|1|1translate:2rawvalues::::::blank" },
+  { "fits_read", 2, 10, lux_fits_read, // files.c
+    "|1|1translate:2rawvalues:4mmap:::::::blank:start:count:columns" },
   { "fits_write", 2, 4, lux_fits_write, "1vocal" },       // files.c
   { "fix",      1, MAX_ARG, lux_long_inplace, 0 },        // symbols.c
   { "float",    1, MAX_ARG, lux_float_inplace, 0 },       // symbols.c
@@ -319,6 +320,7 @@ InternalRoutine         subroutine_table[] = {
   { "insert",   2, 4, lux_inserter, 0 },                         // subsc.c
   { "int",      1, MAX_ARG, lux_word_inplace, 0 },               // symbols.c
   { "int64",    1, MAX_ARG, lux_int64_inplace, 0 },              // symbols.c
+  { "iowait",   1, 1, lux_iowait, 0 },                           // files.cc
   { "limits",   0, 6, lux_limits, 0 },                           // plots.c
   { "list",     1, 1, lux_list, 0 },                             // ident.c
   { "long",     1, MAX_ARG, lux_long_inplace, 0 },               // symbols.c
@@ -328,9 +330,9 @@ InternalRoutine         subroutine_table[] = {
 #endif
   { "noecho",   0, 0, lux_noecho, 0 },         // symbols.c
   { "one",      1, 1, lux_one, 0 },            // fun1.c
-  { "openr",    2, 2, lux_openr, "1get_lun" }, // files.c
-  { "openu",    2, 2, lux_openu, "1get_lun" }, // files.c
-  { "openw",    2, 2, lux_openw, "1get_lun" }, // files.c
+  { "openr",    3, 3, lux_openr, "%1%async:1get_lun" }, // files.c
+  { "openu",    3, 3, lux_openu, "%1%async:1get_lun" }, // files.c
+  { "openw",    3, 3, lux_openw, "%1%async:1get_lun" }, // files.c
   { "orientation", 3, 8, lux_orientation, // orientation.c
     "1vocal:2getj:0parallel:4perpendicular:::orientation:values"
     ":wavenumber:grid:aspect:order" },
@@ -346,6 +348,8 @@ InternalRoutine         subroutine_table[] = {
   { "readarr",  1, 1, lux_readarr, 0 },                           // strous.c
   { "readf",    2, MAX_ARG, lux_readf, "1askmore:2word" },        // files.c
   { "readorbits", 0, 1, lux_readorbits, "1list:2replace" },       // astron.c
+  { "readtable", 5, MAX_ARG, lux_readtable,                       // files.cc
+    "%3%maxrows:skip:columns" },
   { "readu",    2, MAX_ARG, lux_readu, 0 },                       // files.c
   { "record",   0, 1, lux_record, "1input:2output:4reset" },      // symbols.c
   { "redim",    2, 9, lux_redim, 0 },                             // subsc.c
@@ -393,7 +397,7 @@ InternalRoutine         subroutine_table[] = {
 #endif
   { "ty",       1, MAX_ARG, lux_type, "1join:2raw:4separate" }, // files.c
   { "type",     1, MAX_ARG, lux_type, "1join:2raw:4separate" }, // files.c
-  { "ulib",     0, 1, lux_ulib, 0 },                            // files.c
+  { "ulib",     0, 1, lux_ulib, "1list:2rebuild" },             // files.c
   { "verify",   0, 1, lux_verify, 0 },             // install.c
   { "wait",     1, 1, lux_wait, 0 },               // fun2.c
   { "watch",    1, 1, lux_watch, "1delete:2list" }, // install.c
@@ -438,7 +442,7 @@ extern LuxRoutine lux_abs, lux_acos, lux_arestore_f, lux_arg,
   lux_imaginary, lux_incomplete_beta, lux_incomplete_gamma,
   lux_index, lux_indgen, lux_inpolygon, intarr, int64arr,
   int64farr, intfarr, lux_int64,
-  lux_isarray, lux_isnan, lux_isscalar, lux_isstring,
+  lux_iowait_f, lux_isarray, lux_isnan, lux_isscalar, lux_isstring,
   lux_istring, lux_j0, lux_j1, lux_jd, lux_jn, lux_cjd,
   lux_ksmooth, lux_laplace2d, lux_lmap, lux_local_maxf,
   lux_local_maxloc, lux_int64map,
@@ -454,7 +458,7 @@ extern LuxRoutine lux_abs, lux_acos, lux_arestore_f, lux_arg,
   lux_power, lux_printf_f, lux_psum, lux_quantile, lux_quit,
   lux_random, lux_randomb, lux_randomd, lux_randomn,
   lux_randomu, lux_randoml, lux_readf_f, lux_readkey,
-  lux_readkeyne, lux_readu_f, lux_real, lux_redim_f,
+  lux_readkeyne, lux_readtable_f, lux_readu_f, lux_real, lux_redim_f,
   lux_regrid, lux_regrid3, lux_regrid3ns, lux_reorder,
   lux_reverse, lux_rfix, lux_root3, lux_runcum, lux_runprod,
   lux_scale, lux_scalerange,
@@ -524,12 +528,12 @@ InternalRoutine function_table[] = {
   { "alog10",   1, 1, lux_log10, "*" },                        // fun1.cc
   { "antilaplace2d", 2, 2, lux_antilaplace2d, 0 },             // poisson.cc
   { "areaconnect", 2, 3, lux_area_connect, "::compact:1raw" }, // topology.cc
-  { "arestore", 1, MAX_ARG, lux_arestore_f, 0 },               // files.cc
+  { "arestore", 2, MAX_ARG, lux_arestore_f, "%1%names:1map" },  // files.cc
   { "arg",      1, 1, lux_arg, 0 },                            // fun3.cc
   { "array",    1, MAX_DIMS + 1, lux_array, 0 },               // symbols.cc
   { "asin",     1, 1, lux_asin, "*" },                         // fun1.cc
   { "asinh",    1, 1, lux_asinh, "*" },                        // fun1.cc
-  { "astore",   2, MAX_ARG, lux_astore_f, 0 },                 // files.cc
+  { "astore",   2, MAX_ARG, lux_astore_f, "1compress" },       // files.cc
   { "astrf",    1, 2, lux_astrf,                               // astron.cc
     "1fromequatorial:2fromecliptical:4fromgalactic:8toequatorial"
     ":16toecliptical:32togalactic:64julian:128besselian" },
@@ -670,16 +674,16 @@ InternalRoutine function_table[] = {
   { "fit",      3, 17, lux_generalfit, // fit.cc
     "|4|::start:step:lowbound:highbound:weights:qthresh:pthresh:ithresh"
     ":dthresh:fac:niter:nsame:err:fit:tthresh:1vocal:4down:8pchi"
-    ":16gaussians:32powerfunc:64onebyone:129verr" },
+    ":16gaussians:32powerfunc:64onebyone:129verr:256batch" },
 #if DEVELOP
   { "fit2",     4, 11, lux_geneticfit, // fit.cc
     "x:y:npar:fit:weights:mu:generations:population:pcross:pmutate:vocal"
-    ":1elite:2byte:4word:6long:8float:10double" },
+    ":1elite:2byte:4word:6long:8float:10double:16batch" },
 #endif
   { "fits_header", 1, 4, lux_fits_header_f, 0 }, // files.cc
   { "fits_key", 2, 2, lux_fitskey, "1comment" }, // strous3.cc
-  { "fits_read", 2, 7, lux_fits_read_f,          // files.cc
-    "|1|1translate:2rawvalues::::::blank" },
+  { "fits_read", 2, 10, lux_fits_read_f,          // files.cc
+    "|1|1translate:2rawvalues:4mmap:::::::blank:start:count:columns" },
   { "fits_xread", 2, 6, lux_fits_xread_f, 0 }, // files.cc
   { "fix",      1, 1, lux_long, "*" },         // symbols.cc
   { "float",    1, 1, lux_float, "*" },        // symbols.cc
@@ -729,6 +733,7 @@ InternalRoutine function_table[] = {
   { "inpolygon", 4, 4, lux_inpolygon, 0 },  // topology.cc
   { "int",      1, 1, lux_word, "*" },      // symbols.cc
   { "int64map", 1, 1, lux_int64map, 0 },  // subsc.cc
+  { "iowait",   1, 1, lux_iowait_f, 0 },   // files.cc
   { "isarray",  1, 1, lux_isarray, 0 },  // subsc.cc
   { "isnan",    1, 1, lux_isnan, 0 },    // fun1.cc; needs IEEE isnan!
   { "isscalar", 1, 1, lux_isscalar, 0 }, // subsc.cc
@@ -775,9 +780,9 @@ InternalRoutine function_table[] = {
   { "num_dim",  1, 1, lux_num_dimen, 0 },             // subsc.cc
   { "num_elem", 1, 2, lux_num_elem, 0 },              // subsc.cc
   { "one",      1, 1, lux_onef, 0 },                  // fun1.cc
-  { "openr",    2, 2, lux_openr_f, "1get_lun" },      // files.cc
-  { "openu",    2, 2, lux_openu_f, "1get_lun" },      // files.cc
-  { "openw",    2, 2, lux_openw_f, "1get_lun" },      // files.cc
+  { "openr",    3, 3, lux_openr_f, "%1%async:1get_lun" }, // files.cc
+  { "openu",    3, 3, lux_openu_f, "%1%async:1get_lun" }, // files.cc
+  { "openw",    3, 3, lux_openw_f, "%1%async:1get_lun" }, // files.cc
   // { "orbitelem", 3, 3, lux_orbitalElement, 0,
   { "ordfilter", 1, 4, lux_orderfilter, // strous2.cc
     "%1%order:1median:2minimum:3maximum" },
@@ -803,6 +808,7 @@ InternalRoutine function_table[] = {
   { "randomn",  3, MAX_DIMS, lux_randomn, "%2%seed" },              // random.cc
   { "randomu",  3, MAX_DIMS, lux_randomu, "%2%seed:period" },       // random.cc
   { "readf",    2, MAX_ARG, lux_readf_f, "1askmore:2word" },        // files.cc
+  { "readtable", 4, 4, lux_readtable_f, "%3%maxrows:skip:columns" }, // files.cc
   { "readu",    2, MAX_ARG, lux_readu_f, 0 },                       // files.cc
   { "real",     1, 1, lux_real, 0 },                                // fun3.cc
   { "redim",    1, 9, lux_redim_f, 0 },                             // subsc.cc
@@ -1253,6 +1259,7 @@ void cleanUp(int32_t context, int32_t which)
   int32_t       i;
   void  zapParseTemps(void);
 
+  bytecode_cleanup();
   comp = which & CLEANUP_COMP;
 /*  while (symbolStackIndex > 0 && !symbolStack[symbolStackIndex])
     symbolStackIndex--; */
@@ -2785,13 +2792,24 @@ int32_t suppressEvalRoutine(int32_t index)
 #define         IGNORE_SIG      1
 #define ASK_SIG                 2
 #define SIG_BREAK       3
+void breakToTopLevel(void)
+// aborts the current calculation and returns to the main prompt
+{
+  extern int32_t        executeLevel, statementDepth;
+  extern jmp_buf        jmpenv;
+  void  cleanUp(int32_t, int32_t);
+
+  curContext = executeLevel = statementDepth = 0;
+  cleanUp(-compileLevel, CLEANUP_ALL);
+  longjmp(jmpenv, 0);
+}
+//----------------------------------------------------------------
 void exception(int32_t sig)
 // exception handler
 {
  int32_t        c, saveHistory(void);
- extern int32_t         curSymbol, executeLevel, step, statementDepth;
- extern jmp_buf         jmpenv;
- void   cleanUp(int32_t, int32_t), Quit(int32_t);
+ extern int32_t         curSymbol, executeLevel, step;
+ void   Quit(int32_t);
 
  if (sig != SIGCONT && curSymbol)
    puts(symbolIdent(curSymbol, 1));
@@ -2867,9 +2885,11 @@ void exception(int32_t sig)
  if (signal(sig, exception) == SIG_ERR)
    luxerror("Could not reinstall exception handler", 0);
  if (c == SIG_BREAK) {
-   curContext = executeLevel = statementDepth = 0;
-   cleanUp(-compileLevel, CLEANUP_ALL);
-   longjmp(jmpenv, 0);
+   // bytecode aborts by itself at the end of a loop body, so that the
+   // variables it assigned to are consistent
+   if (sig == SIGINT && bytecode_defer_break())
+     return;
+   breakToTopLevel();
  }
  return;
 }
@@ -3694,7 +3714,7 @@ int32_t range_warn_flag = 0, redim_warn_flag = 0, error_extra = 0, histmin,
 Scalar  lastmin, lastmax, lastmean, lastsdev;
 extern int32_t ndx, ndxs, nd, ndys, maxregridsize, nExecuted, kb, nArg, tvsmt,
   badmatch, sort_flag, crunch_bits, crunch_slice, byte_count,
-  index_cnt, uTermCol, page;
+  index_cnt, uTermCol, page, lux_nthreads, random_flag, lux_bytecode;
 extern double   meritc;
 extern float plims[], stepx, stepy, slabx, slaby, crunch_bpp;
 extern int16_t  *stackPointer;
@@ -3933,6 +3953,7 @@ void symbolInitialization(void)
  l_ptr("!area_diag",    &area_diag);
  l_ptr("!badmatch",     &badmatch);
  l_ptr("!bc",           &byte_count);
+ l_ptr("!bytecode",     &lux_bytecode);
  fnc_p("!cjd",          12);
  l_ptr("!col",          &uTermCol);
  fnc_p("!cputime",      2);
@@ -3969,6 +3990,8 @@ void symbolInitialization(void)
  d_ptr("!meritc",       &meritc);
  l_ptr("!narg",                 &nArg);
  l_ptr("!nexecuted",    &nExecuted);
+ l_ptr("!nthreads",     &lux_nthreads);
+ l_ptr("!random_flag",  &random_flag);
  l_ptr("!range_warn_flag",      &range_warn_flag);
  l_ptr("!read_count",   &index_cnt);
  fnc_p("!readkey",      8);
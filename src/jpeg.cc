@@ -29,12 +29,17 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 #include <setjmp.h>             // for setjmp(), longjmp()
 #include <jpeglib.h>           // for IJG JPEG v6b stuff
 #include <string.h>             // for memcpy()
+#include <atomic>
+#include <string>
+#include <vector>
 #include "action.hh"            // for LUX-specific stuff
+#include "Parallel.hh"
 
 // a structure for our own error handler
 struct my_error_mgr {
   struct jpeg_error_mgr        pub;
   jmp_buf        setjmp_buffer;
+  char        message[JMSG_LENGTH_MAX]; // for quiet_error_exit()
 };
 typedef struct my_error_mgr *my_error_ptr;
 
@@ -52,6 +57,32 @@ METHODDEF(void) my_error_exit(j_common_ptr cinfo)
   longjmp(myerr->setjmp_buffer, 1);
 }
 //--------------------------------------------------------------------------
+METHODDEF(void) quiet_error_exit(j_common_ptr cinfo)
+// an error handler that keeps the message instead of displaying it,
+// for use outside of the main thread
+{
+  my_error_ptr        myerr = (my_error_ptr) cinfo->err;
+
+  (*cinfo->err->format_message)(cinfo, myerr->message);
+  longjmp(myerr->setjmp_buffer, 1);
+}
+//--------------------------------------------------------------------------
+static int32_t jpeg_shrink_factor(int32_t shrink)
+// returns the shrink factor (1, 2, 4, or 8) to use for a requested
+// shrink factor: the requested one if allowed, or else the next
+// smaller allowed one.  The sign of the requested factor is ignored.
+{
+  if (shrink < 0)
+    shrink = -shrink;
+  if (shrink >= 8)
+    return 8;
+  if (shrink >= 4)
+    return 4;
+  if (shrink >= 2)
+    return 2;
+  return 1;
+}
+//--------------------------------------------------------------------------
 int32_t read_jpeg6b(ArgumentCount narg, Symbol ps[], int32_t isFunc)
 // JREAD,<x>,<file>[,<header>,SHRINK=<shrink>][,/GREYSCALE]
 {
@@ -92,23 +123,10 @@ int32_t read_jpeg6b(ArgumentCount narg, Symbol ps[], int32_t isFunc)
   if (internalMode & 1)                // user wants greyscale output
     cinfo.out_color_space = JCS_GRAYSCALE;
   if (narg > 3 && ps[3]) {        // have <shrink>
-    // the user wants to shrink the image.  shrink factors 1, 2, 4, and 8
-    // are allowed; if the user supplies a different value, then the next
-    // smaller allowed value is used.  The sign of the shrink factor is
-    // ignored.
-    i = int_arg(ps[3]);
-    if (i < 0)
-      i = -i;
-    if (i >= 8)
-      i = 8;
-    else if (i >= 4)
-      i = 4;
-    else if (i >= 2)
-      i = 2;
-    else
-      i = 1;
+    // the user wants to shrink the image.  The decompressor does that
+    // while decoding, which is faster than decoding everything.
     cinfo.scale_num = 1;
-    cinfo.scale_denom = i;
+    cinfo.scale_denom = jpeg_shrink_factor(int_arg(ps[3]));
   }
 
   // 4. start decompression
@@ -190,6 +208,141 @@ int32_t lux_read_jpeg6b_f(ArgumentCount narg, Symbol ps[])
 REGISTER(read_jpeg6b_f, f, jpegread, 2, 4, ":::shrink:1greyscale", HAVE_LIBJPEG);
 REGISTER(read_jpeg6b_f, f, read_jpeg, 2, 4, ":::shrink:1greyscale", HAVE_LIBJPEG);
 //--------------------------------------------------------------------------
+static bool decode_jpeg(char const* filename, int32_t shrink, bool greyscale,
+                        int32_t dims[3], JSAMPLE* image, std::string& message)
+/* reads the JPEG file <filename>, shrunk by factor <shrink> (1, 2, 4,
+   or 8), and converted to greyscale if <greyscale> is true.  If
+   <image> is NULL, then reads just enough to return the number of
+   color components, the width, and the height of the image in
+   <dims>.  Otherwise, <dims> must have those numbers on input, and
+   the image is decoded into <image>, bottom row first.  Returns true
+   if successful.  Otherwise, returns false, and puts a message in
+   <message>.  Does not touch any interpreter state, so it can be
+   used in worker threads. */
+{
+  struct jpeg_decompress_struct        cinfo;
+  struct my_error_mgr                jerr;
+  FILE        *infile;
+  JSAMPROW        row_pointer[1];
+
+  if (!(infile = fopen(filename, "rb"))) {
+    message = "Could not open the file";
+    return false;
+  }
+
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = quiet_error_exit;
+  if (setjmp(jerr.setjmp_buffer)) {
+    // the JPEG code found a fatal error
+    message = jerr.message;
+    jpeg_destroy_decompress(&cinfo);
+    fclose(infile);
+    return false;
+  }
+  jpeg_create_decompress(&cinfo);
+  jpeg_stdio_src(&cinfo, infile);
+  jpeg_read_header(&cinfo, TRUE);
+  if (greyscale)
+    cinfo.out_color_space = JCS_GRAYSCALE;
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = shrink;
+
+  bool ok = true;
+  if (!image) {                 // just the dimensions
+    jpeg_calc_output_dimensions(&cinfo);
+    dims[0] = cinfo.output_components;
+    dims[1] = cinfo.output_width;
+    dims[2] = cinfo.output_height;
+  } else {
+    jpeg_start_decompress(&cinfo);
+    if (cinfo.output_components != dims[0]
+        || (int32_t) cinfo.output_width != dims[1]
+        || (int32_t) cinfo.output_height != dims[2]) {
+      message = "The image has a different size or number of colors";
+      ok = false;
+      jpeg_abort_decompress(&cinfo);
+    } else {
+      size_t stride = (size_t) dims[0]*dims[1];
+      while (cinfo.output_scanline < cinfo.output_height) {
+        row_pointer[0] = image
+          + (cinfo.output_height - cinfo.output_scanline - 1)*stride;
+        jpeg_read_scanlines(&cinfo, row_pointer, 1);
+      }
+      jpeg_finish_decompress(&cinfo);
+    }
+  }
+  jpeg_destroy_decompress(&cinfo);
+  fclose(infile);
+  return ok;
+}
+//--------------------------------------------------------------------------
+int32_t lux_read_jpeg_stack(ArgumentCount narg, Symbol ps[])
+/* X = JPEGREADSTACK(<files> [, SHRINK=<shrink>, /GREYSCALE])
+   reads the JPEG files whose names are in string array <files> into
+   a single BYTE array, with the images stacked along the last
+   dimension.  All images must have the same size and number of
+   colors.  The files are decoded concurrently, each one directly into
+   its place in the result, so the memory use does not depend on the
+   number of threads.  <shrink> and /GREYSCALE are as for JPEGREAD. */
+{
+  std::vector<std::string> files;
+
+  if (symbolIsStringScalar(ps[0]))
+    files.push_back(string_value(ps[0]));
+  else if (symbolIsStringArray(ps[0])) {
+    char** p = (char**) array_data(ps[0]);
+    for (size_t i = 0; i < array_size(ps[0]); i++)
+      files.push_back(p[i]? p[i]: "");
+  } else
+    return cerror(NEED_STR, ps[0]);
+
+  int32_t shrink = (narg > 1 && ps[1])? jpeg_shrink_factor(int_arg(ps[1])): 1;
+  bool greyscale = internalMode & 1;
+
+  // the first image determines the dimensions of the result
+  int32_t dims[3];
+  std::string message;
+  if (!decode_jpeg(files[0].c_str(), shrink, greyscale, dims, NULL, message))
+    return luxerror("%s: %s", ps[0], files[0].c_str(), message.c_str());
+  int32_t rdims[4], ndim = 0;
+  if (dims[0] > 1)
+    rdims[ndim++] = dims[0];
+  rdims[ndim++] = dims[1];
+  rdims[ndim++] = dims[2];
+  rdims[ndim++] = files.size();
+  int32_t result = array_scratch(LUX_INT8, ndim, rdims);
+  if (result == LUX_ERROR)
+    return LUX_ERROR;
+  JSAMPLE* data = (JSAMPLE*) array_data(result);
+  size_t frame = (size_t) dims[0]*dims[1]*dims[2];
+
+  // each thread takes the next file that is not yet taken, so threads
+  // that get small or easy files do not stand idle
+  std::vector<std::string> messages(files.size());
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  size_t nthreads = parallel_thread_count(files.size());
+  parallel_chunks(nthreads, nthreads, [&](size_t, size_t, size_t) {
+    size_t i;
+    while (!failed && (i = next++) < files.size()) {
+      int32_t d[3] = { dims[0], dims[1], dims[2] };
+      if (!decode_jpeg(files[i].c_str(), shrink, greyscale, d,
+                       data + i*frame, messages[i]))
+        failed = true;
+    }
+  });
+  if (failed)
+    for (size_t i = 0; i < files.size(); i++)
+      if (!messages[i].empty()) {
+        zap(result);
+        return luxerror("%s: %s", ps[0], files[i].c_str(),
+                        messages[i].c_str());
+      }
+  return result;
+}
+REGISTER(read_jpeg_stack, f, jpegreadstack, 1, 2, ":shrink:1greyscale", HAVE_LIBJPEG);
+REGISTER(read_jpeg_stack, f, read_jpeg_stack, 1, 2, ":shrink:1greyscale", HAVE_LIBJPEG);
+//--------------------------------------------------------------------------
 int32_t write_jpeg6b(ArgumentCount narg, Symbol ps[], int32_t isFunc)
 // JWRITE,<x>,<file>[,<header>,<quality>]
 {
@@ -27,20 +27,25 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 // END HEADERS
 #include "config.h"
 #include "action.hh"
+#include "MatrixProduct.hh"
 #include <algorithm>
 #include <errno.h>
 #include <gsl/gsl_eigen.h>
 #include <gsl/gsl_linalg.h>
 
 /// Implements LUX function `mproduct` that calculates the matrix product of two
-/// matrices.
+/// matrices.  If both arguments are `FLOAT`, then the calculation is done
+/// in `FLOAT`.  Otherwise, it is done in `DOUBLE`.
 Symbol
 lux_matrix_product(ArgumentCount narg, Symbol ps[])
 {
   Pointer* ptrs;
   LoopInfo* infos;
 
-  StandardArguments sa(narg, ps, "i>D*;i>D*;rD1", &ptrs, &infos);
+  bool single = symbol_type(ps[0]) == LUX_FLOAT
+    && symbol_type(ps[1]) == LUX_FLOAT;
+  StandardArguments sa(narg, ps, single? "iF*;iF*;rF1": "i>D*;i>D*;rD1",
+                       &ptrs, &infos);
   int32_t iq = sa.result();
   if (iq < 0)
     return LUX_ERROR;
@@ -100,53 +105,26 @@ lux_matrix_product(ArgumentCount narg, Symbol ps[])
                  infos[0].dims + infos[0].ndim);
   }
 
-  standard_redef_array(iq, LUX_DOUBLE, tdims.size(), tdims.data(), 0, NULL,
-                       infos[2].mode, &ptrs[2], &infos[2]);
-  {
-    auto i2 = make_iota<int32_t>(2);
-    infos[0].setAxes(i2, SL_EACHBLOCK);
-    infos[1].setAxes(i2, SL_EACHBLOCK);
-    infos[2].setAxes(i2, SL_EACHBLOCK);
-  }
-  if (internalMode & 1) {       // /OUTER
-    do
-    {
-      do
-      {
-        for (int r1 = 0; r1 < dims1[0]; r1++) // rows of #1
-          for (int c2 = 0; c2 < dims2[1]; c2++) // columns of #2
-          {
-            double* p = &ptrs[2].d[r1 + c2*tdims[0]];
-            *p = 0.0;
-            for (int k = 0; k < dims1[1]; k++) // columns of #1 = rows of #2
-              *p += ptrs[0].d[r1 + k*dims1[0]]*ptrs[1].d[k + c2*dims2[0]];
-          }
-        ptrs[0].d += infos[0].singlestep[2];
-        ptrs[2].d += infos[2].singlestep[2];
-      } while (infos[2].advanceLoop(&ptrs[2].ui8),
-               infos[0].advanceLoop(&ptrs[0].ui8) < infos[0].ndim);
-      ptrs[0].d -= infos[0].ndim > 3? infos[0].singlestep[3]: infos[0].nelem;
-      ptrs[1].d += infos[1].singlestep[2];
-    } while (infos[1].advanceLoop(&ptrs[1].ui8) < infos[1].ndim);
-  } else                        // /INNER
-  {
-    do
-    {
-      for (int r1 = 0; r1 < dims1[0]; r1++) // rows of #1
-        for (int c2 = 0; c2 < dims2[1]; c2++) // columns of #2
-        {
-          double* p = &ptrs[2].d[r1 + c2*tdims[0]];
-          *p = 0.0;
-          for (int k = 0; k < dims1[1]; k++) // columns of #1 = rows of #2
-            *p += ptrs[0].d[r1 + k*dims1[0]]*ptrs[1].d[k + c2*dims2[0]];
-        }
-      ptrs[0].d += infos[0].singlestep[2];
-      ptrs[1].d += infos[1].singlestep[2];
-      ptrs[2].d += infos[2].singlestep[2];
-    } while (infos[0].advanceLoop(&ptrs[0].ui8),
-             infos[1].advanceLoop(&ptrs[1].ui8),
-             infos[2].advanceLoop(&ptrs[2].ui8) < infos[2].ndim);
-  }
+  standard_redef_array(iq, single? LUX_FLOAT: LUX_DOUBLE, tdims.size(),
+                       tdims.data(), 0, NULL, infos[2].mode, &ptrs[2],
+                       &infos[2]);
+
+  // the matrices are stored one after the other
+  size_t m = dims1[0];
+  size_t k = dims1[1];
+  size_t n = dims2[1];
+  size_t na = 1;
+  for (int i = 2; i < infos[0].ndim; i++)
+    na *= dims1[i];
+  size_t nb = 1;
+  for (int i = 2; i < infos[1].ndim; i++)
+    nb *= dims2[i];
+  if (single)
+    matrix_product(ptrs[0].f, ptrs[1].f, ptrs[2].f, m, k, n, na, nb,
+                   internalMode & 1);
+  else
+    matrix_product(ptrs[0].d, ptrs[1].d, ptrs[2].d, m, k, n, na, nb,
+                   internalMode & 1);
   return iq;
 }
 REGISTER(matrix_product, f, mproduct, 2, 2, "0inner:1outer");
@@ -2,7 +2,11 @@
 
 #if HAVE_LIBOPENIMAGEIO
 #include "action.hh"
+#include "Parallel.hh"
 #include <OpenImageIO/imageio.h>
+#include <atomic>
+#include <string>
+#include <vector>
 
 // <x> = readimage(<file>)
 int32_t
@@ -43,6 +47,104 @@ lux_read_image_oiio(ArgumentCount narg, Symbol ps[])
 }
 REGISTER(read_image_oiio, f, readimage, 1, 1, NULL, HAVE_LIBOPENIMAGEIO);
 
+// reads image file <filename> into <data> as FLOAT, if <data> is not
+// NULL.  <dims> has the number of channels, the width, and the height
+// of the image.  If <data> is NULL, then sets <dims> from the file;
+// otherwise the file must have those <dims>.  Returns true if
+// successful; otherwise returns false and sets <message>.  Does not
+// touch interpreter state, so can be used in worker threads.
+static bool
+read_image_into(std::string const& filename, int dims[3], float* data,
+                std::string& message)
+{
+  auto in = OIIO::ImageInput::open(filename);
+  if (!in) {
+    message = OIIO::geterror();
+    if (message.empty())
+      message = "Could not open the file";
+    return false;
+  }
+  const auto& spec = in->spec();
+  if (!data) {
+    dims[0] = spec.nchannels;
+    dims[1] = spec.width;
+    dims[2] = spec.height;
+  } else if (spec.nchannels != dims[0] || spec.width != dims[1]
+             || spec.height != dims[2]) {
+    message = "The image has a different size or number of channels";
+    return false;
+  } else if (!in->read_image(0, 0, 0, -1, OIIO::TypeDesc::FLOAT, data)) {
+    message = in->geterror();
+    if (message.empty())
+      message = "Could not read the image";
+    return false;
+  }
+  in->close();
+  return true;
+}
+
+// <x> = readimagestack(<files>)
+// reads the image files named in string array <files> into a single
+// FLOAT array, with the images stacked along the last dimension.  All
+// images must have the same size and number of channels.  The files
+// are decoded concurrently, each one directly into its place in the
+// result, so the memory use does not grow with the number of threads.
+int32_t
+lux_read_image_stack_oiio(ArgumentCount narg, Symbol ps[])
+{
+  std::vector<std::string> files;
+
+  if (symbolIsStringScalar(ps[0]))
+    files.push_back(string_value(ps[0]));
+  else if (symbolIsStringArray(ps[0])) {
+    char** p = (char**) array_data(ps[0]);
+    for (size_t i = 0; i < array_size(ps[0]); i++)
+      files.push_back(p[i]? p[i]: "");
+  } else
+    return cerror(NEED_STR, ps[0]);
+
+  // the first image determines the dimensions of the result
+  int dims[3];
+  std::string message;
+  if (!read_image_into(files[0], dims, nullptr, message))
+    return luxerror("%s: %s", ps[0], files[0].c_str(), message.c_str());
+  int rdims[4];
+  int ndim = 0;
+  if (dims[0] > 1)
+    rdims[ndim++] = dims[0];
+  rdims[ndim++] = dims[1];
+  rdims[ndim++] = dims[2];
+  rdims[ndim++] = files.size();
+  int32_t result = array_scratch(LUX_FLOAT, ndim, rdims);
+  if (result == LUX_ERROR)
+    return LUX_ERROR;
+  auto data = (float*) array_data(result);
+  size_t frame = (size_t) dims[0]*dims[1]*dims[2];
+
+  // each thread takes the next file that is not yet taken
+  std::vector<std::string> messages(files.size());
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  size_t nthreads = parallel_thread_count(files.size());
+  parallel_chunks(nthreads, nthreads, [&](size_t, size_t, size_t) {
+    size_t i;
+    while (!failed && (i = next++) < files.size()) {
+      int d[3] = { dims[0], dims[1], dims[2] };
+      if (!read_image_into(files[i], d, data + i*frame, messages[i]))
+        failed = true;
+    }
+  });
+  if (failed)
+    for (size_t i = 0; i < files.size(); i++)
+      if (!messages[i].empty()) {
+        zap(result);
+        return luxerror("%s: %s", ps[0], files[i].c_str(),
+                        messages[i].c_str());
+      }
+  return result;
+}
+REGISTER(read_image_stack_oiio, f, readimagestack, 1, 1, NULL, HAVE_LIBOPENIMAGEIO);
+
 Symbol
 lux_write_image_oiio(ArgumentCount narg, Symbol ps[])
 {
@@ -23,6 +23,7 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 #include <string.h> // for memcpy
 // END HEADERS
 #include "config.h"
+#include "EpochCache.hh"
 #include "action.hh"
 #if HAVE_LIBGSL
 # include <gsl/gsl_poly.h>
@@ -185,16 +186,30 @@ double *XYZ_eclipticPrecessionMatrix(void)
   return a_from_to;
 }
 //--------------------------------------------------------------------------
+//* The precession matrices for recently used pairs of equinoxes
+static EpochCache<2, std::array<double, 9>> XYZ_precession_cache(64);
+//--------------------------------------------------------------------------
+EpochCache<2, std::array<double, 9>>& XYZ_eclipticPrecessionCache(void)
+{
+  return XYZ_precession_cache;
+}
+//--------------------------------------------------------------------------
 void XYZ_eclipticPrecession(double *pos, double equinox1, double equinox2)
 /* precess the ecliptical cartesian coordinates <pos> from <equinox1>
    to <equinox2>, both measured in JDE. */
 // From 1988A&A...202..309B
 {
-  init_XYZ_eclipticPrecession(equinox1, equinox2);
+  std::array<double, 9> a
+    = XYZ_precession_cache({equinox1, equinox2}, [](double const* key) {
+      init_XYZ_eclipticPrecession(key[0], key[1]);
+      std::array<double, 9> a;
+      memcpy(a.data(), a_from_to, sizeof(a_from_to));
+      return a;
+    });
 
   double xyz[3];
-  xyz[0] = a_from_to[0]*pos[0] + a_from_to[1]*pos[1] + a_from_to[2]*pos[2];
-  xyz[1] = a_from_to[3]*pos[0] + a_from_to[4]*pos[1] + a_from_to[5]*pos[2];
-  xyz[2] = a_from_to[6]*pos[0] + a_from_to[7]*pos[1] + a_from_to[8]*pos[2];
+  xyz[0] = a[0]*pos[0] + a[1]*pos[1] + a[2]*pos[2];
+  xyz[1] = a[3]*pos[0] + a[4]*pos[1] + a[5]*pos[2];
+  xyz[2] = a[6]*pos[0] + a[7]*pos[1] + a[8]*pos[2];
   memcpy(pos, xyz, 3*sizeof(double));
 }
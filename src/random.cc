@@ -22,8 +22,14 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 # include "config.h"
 # include <math.h> // for cos(2) sqrt(2) log(2) sin(1) isnan(1)
 # include <string.h> // for memcpy(5)
+# include <algorithm> // for std::min
+# include <cmath>  // for std::lgamma
+# include <functional>
+# include <vector>
 # include "action.hh"
 # include "install.hh"
+# include "Parallel.hh"
+# include "Philox.hh"
 
 #if HAVE_LIBGSL
 # include <gsl/gsl_rng.h>
@@ -33,6 +39,21 @@ static gsl_rng *rng;
 
 static uint32_t        currentBitSeed = 123459876;
 
+/* If !RANDOM_FLAG is nonzero, then RANDOMU, RANDOMN, RANDOME and
+   RANDOM /UNIFORM, /NORMAL, /SAMPLE, /SHUFFLE use the counter-based
+   Philox generator rather than the Mersenne Twister.  Element <i> of
+   the output is then calculated from counter <philoxCounter + i/2>,
+   so large arrays can be filled in parallel and the results depend
+   only on the seed and not on the number of threads.  RANDOMN and
+   RANDOME then use the Ziggurat method, which needs a variable number
+   of pseudo-random bits per output element, so they draw from a
+   separate Philox stream (the upper half of the 128-bit counter) for
+   each block of output elements instead. */
+int32_t random_flag = 0;
+static Philox philox;
+static uint64_t philoxCounter = 0; // the next unused counter
+static uint64_t philoxStream = 1;  // the next unused stream
+
 //-------------------------------------------------------------------------
 void random_init(int32_t seed)
 {
@@ -44,6 +65,176 @@ void random_init(int32_t seed)
     rng = gsl_rng_alloc(gsl_rng_mt19937);
   gsl_rng_set(rng, s);
 #endif
+  philox = Philox((uint64_t) seed);
+  philoxCounter = 0;
+  philoxStream = 1;
+}
+//-------------------------------------------------------------------------
+template<typename F>
+static void counter_fill(int32_t number, F f)
+// calls f(k, u) for k = 0 through (<number> + 1)/2 - 1, with u[0] and
+// u[1] two uniformly distributed pseudo-random numbers between 0 and
+// 1 (exclusive) calculated from counter <philoxCounter + k>, and
+// advances <philoxCounter> past the used counters.  f is called from
+// multiple threads.
+{
+  uint64_t base = philoxCounter;
+  int32_t npairs = (number + 1)/2;
+
+  parallel_for(npairs, 4096, [&](size_t begin, size_t end) {
+    double u[2];
+
+    for (size_t k = begin; k < end; k++) {
+      philox.uniform(base + k, u);
+      f(k, u);
+    }
+  });
+  philoxCounter += npairs;
+}
+//-------------------------------------------------------------------------
+/* The Ziggurat method (Marsaglia & Tsang 2000) covers the target
+   density f with <n> horizontal layers of equal area <v>: a base
+   layer that contains the tail beyond <r>, and <n> - 1 rectangles
+   above it.  Layer i spans 0 <= x < x[i] at heights between f(x[i])
+   and f(x[i+1]).  A uniformly chosen layer and position are accepted
+   immediately if they fall under the layer above (probability near
+   99%); otherwise the wedge or the tail is sampled. */
+struct Ziggurat {
+  int32_t n;                    // the number of layers
+  double r;                     // where the tail begins
+  double x[257];                // layer edges, x[n] == 0
+  double f[257];                // f(x[i])
+
+  Ziggurat(int32_t n, double r, double v, double (*f_of)(double),
+           double (*f_inverse)(double))
+    : n(n), r(r)
+  {
+    x[0] = v/f_of(r);
+    x[1] = r;
+    for (int32_t i = 1; i < n - 1; i++)
+      x[i + 1] = f_inverse(f_of(x[i]) + v/x[i]);
+    x[n] = 0;
+    for (int32_t i = 0; i <= n; i++)
+      f[i] = f_of(x[i]);
+  }
+};
+
+static double gauss_f(double x) { return exp(-0.5*x*x); }
+static double gauss_f_inverse(double y) { return sqrt(-2*log(y)); }
+static double exp_f(double x) { return exp(-x); }
+static double exp_f_inverse(double y) { return -log(y); }
+
+static Ziggurat const &normal_ziggurat(void)
+{
+  static const Ziggurat z(128, 3.442619855899, 9.91256303526217e-3,
+                          gauss_f, gauss_f_inverse);
+  return z;
+}
+
+static Ziggurat const &exponential_ziggurat(void)
+{
+  static const Ziggurat z(256, 7.69711747013104972, 3.949659822581572e-3,
+                          exp_f, exp_f_inverse);
+  return z;
+}
+
+// a buffered source of pseudo-random bits from a single Philox
+// stream, generated a batch of counters at a time
+class PhiloxBits {
+public:
+  PhiloxBits(uint64_t stream) : stream(stream), counter(0), index(size) { }
+
+  uint64_t next64(void)
+  {
+    if (index == size) {
+      philox.fill(counter, stream, buffer, size/4);
+      counter += size/4;
+      index = 0;
+    }
+    uint64_t result = buffer[index] | ((uint64_t) buffer[index + 1] << 32);
+    index += 2;
+    return result;
+  }
+
+  // returns a uniformly distributed number between 0 and 1 (exclusive)
+  double uniform(void)
+  {
+    return ((next64() >> 11) + 0.5)*(1.0/9007199254740992.0);
+  }
+
+private:
+  static const size_t size = 256;
+  uint64_t stream;
+  uint64_t counter;
+  size_t index;
+  uint32_t buffer[size];
+};
+
+static double ziggurat_normal(PhiloxBits &bits, Ziggurat const &z)
+// returns a standard normal deviate.  The low 7 bits of a 64-bit
+// draw select the layer, the next one the sign, and the upper 53 the
+// position.
+{
+  while (1) {
+    uint64_t r = bits.next64();
+    int32_t i = r & 127;
+    double x = (r >> 11)*(1.0/9007199254740992.0)*z.x[i];
+    double sign = (r & 128)? -1: 1;
+    if (x < z.x[i + 1])
+      return sign*x;
+    if (!i) {                   // the tail
+      double a, b;
+      do {
+        a = -log(bits.uniform())/z.r;
+        b = -log(bits.uniform());
+      } while (2*b < a*a);
+      return sign*(z.r + a);
+    }
+    if (z.f[i] + bits.uniform()*(z.f[i + 1] - z.f[i]) < gauss_f(x))
+      return sign*x;
+  }
+}
+
+static double ziggurat_exponential(PhiloxBits &bits, Ziggurat const &z,
+                                   int32_t *negative)
+// returns an exponential deviate with unit scale, and a random sign
+// in <*negative>.  The low 8 bits of a 64-bit draw select the layer,
+// the next one the sign, and the upper 53 the position.
+{
+  while (1) {
+    uint64_t r = bits.next64();
+    int32_t i = r & 255;
+    double x = (r >> 11)*(1.0/9007199254740992.0)*z.x[i];
+    *negative = (r & 256) != 0;
+    if (x < z.x[i + 1])
+      return x;
+    if (!i)                     // the tail
+      return z.r - log(bits.uniform());
+    if (z.f[i] + bits.uniform()*(z.f[i + 1] - z.f[i]) < exp_f(x))
+      return x;
+  }
+}
+
+template<typename F>
+static void stream_fill(double *output, int32_t number, F f)
+// sets output[k] = f(bits) for k = 0 through <number> - 1, in
+// parallel.  The output is divided into blocks of fixed size and each
+// block draws its pseudo-random bits from its own Philox stream, so
+// the results do not depend on the number of threads.
+{
+  const size_t blocksize = 4096;
+  size_t nblock = (number + blocksize - 1)/blocksize;
+  uint64_t base = philoxStream;
+
+  parallel_for(nblock, 1, [&](size_t begin, size_t end) {
+    for (size_t b = begin; b < end; b++) {
+      PhiloxBits bits(base + b);
+      size_t last = std::min((b + 1)*blocksize, (size_t) number);
+      for (size_t k = b*blocksize; k < last; k++)
+        output[k] = f(bits);
+    }
+  });
+  philoxStream += nblock;
 }
 //-------------------------------------------------------------------------
 double random_one(void)
@@ -150,6 +341,26 @@ void randomu(int32_t seed, void *output, int32_t number, int32_t modulo)
  // check if we are initializing
  if (seed)
    random_init(seed);
+ if (random_flag) {                // counter-based, in parallel
+   if (modulo) {
+     if (modulo < 0)
+       modulo = -modulo;
+     ip = (int32_t *) output;
+     counter_fill(number, [=](size_t k, double const *u) {
+       ip[2*k] = (int32_t) (u[0]*modulo);
+       if (2*k + 1 < (size_t) number)
+         ip[2*k + 1] = (int32_t) (u[1]*modulo);
+     });
+   } else {
+     fp = (double *) output;
+     counter_fill(number, [=](size_t k, double const *u) {
+       fp[2*k] = u[0];
+       if (2*k + 1 < (size_t) number)
+         fp[2*k + 1] = u[1];
+     });
+   }
+   return;
+ }
  if (modulo) {                        // integers
    if (modulo < 0)
      modulo = -modulo;
@@ -173,7 +384,7 @@ void randome(void *output, int32_t number, double limit)
 {
 #if HAVE_LIBGSL
  int32_t        j;
- double        *fp, value;
+ double        *fp;
 
  if (limit < 0)
    limit = 0;
@@ -196,8 +407,8 @@ void randome(void *output, int32_t number, double limit)
     F(x) = y ⇒ F⁻¹(y) = λ - log(1 - y)
     Transform T(u) = F⁻¹(u) = λ - log(1 - u)
  */
- for (j = 0; j < number; j++) {
-   value = 2*random_one() - 1;        // uniform between -1 and +1
+ auto transform = [limit](double value) {
+   value = 2*value - 1;           // uniform between -1 and +1
    int negative = (value < 0);
    if (negative)
      value = -value;                // uniform between 0 and +1
@@ -207,11 +418,140 @@ void randome(void *output, int32_t number, double limit)
      value = INFTY;
    if (negative)
      value = - value;
-   *fp++ = value;
+   return value;
+ };
+ if (random_flag) {                // Ziggurat, in parallel
+   Ziggurat const &z = exponential_ziggurat();
+   stream_fill(fp, number, [&z, limit](PhiloxBits &bits) {
+     int32_t negative;
+     double value = limit + ziggurat_exponential(bits, z, &negative);
+     return negative? -value: value;
+   });
+   return;
  }
+ for (j = 0; j < number; j++)
+   *fp++ = transform(random_one());
 #endif
 }
 //----------------------------------------------------------------------
+static int32_t hypergeometric(double u, int32_t n, int32_t k, int32_t total)
+// returns how many of <n> elements drawn without replacement from a
+// population of <total> elements fall among the first <k> elements of
+// that population, for a uniformly distributed pseudo-random number
+// <u> between 0 and 1.  We walk outward from the mode of the
+// hypergeometric distribution, so the expected work is proportional
+// to its standard deviation.
+{
+  int32_t kmin = n - (total - k), kmax = n < k? n: k;
+  if (kmin < 0)
+    kmin = 0;
+  if (kmin >= kmax)
+    return kmin;
+
+  int32_t mode = (int32_t) (((double) n + 1)*((double) k + 1)/((double) total + 2));
+  if (mode < kmin)
+    mode = kmin;
+  else if (mode > kmax)
+    mode = kmax;
+  auto lchoose = [](double a, double b) {
+    return std::lgamma(a + 1) - std::lgamma(b + 1) - std::lgamma(a - b + 1);
+  };
+  double p = exp(lchoose(k, mode) + lchoose(total - k, n - mode)
+                 - lchoose(total, n));
+  u -= p;
+  if (u <= 0)
+    return mode;
+  int32_t lo = mode, hi = mode;
+  double plo = p, phi = p;
+  while (lo > kmin || hi < kmax) {
+    if (hi < kmax) {
+      phi *= ((double) k - hi)*((double) n - hi)
+        /(((double) hi + 1)*((double) total - k - n + hi + 1));
+      hi++;
+      u -= phi;
+      if (u <= 0)
+        return hi;
+    }
+    if (lo > kmin) {
+      plo *= (double) lo*((double) total - k - n + lo)
+        /(((double) k - lo + 1)*((double) n - lo + 1));
+      lo--;
+      u -= plo;
+      if (u <= 0)
+        return lo;
+    }
+  }
+  return mode;                  // only reached through round-off error
+}
+//----------------------------------------------------------------------
+static void random_unique_counter(int32_t *output, int32_t number,
+                                  int32_t modulo)
+// like random_unique(), but using the counter-based generator, in
+// parallel.  The range 0 through <modulo> - 1 is divided into blocks
+// of fixed size.  The number of selected values in each block is
+// found by recursively splitting the blocks into two groups and
+// drawing the number for the first group from a hypergeometric
+// distribution, and then the blocks are treated in parallel with
+// Knuth's Algorithm S.  Each split and each block has its own range
+// of counters, so the result does not depend on the number of threads.
+{
+  const int32_t blocksize = 65536;
+  int32_t nblock = modulo/blocksize + (modulo % blocksize? 1: 0);
+  std::vector<int32_t> count(nblock), offset(nblock);
+  uint64_t base = philoxCounter;
+
+  // split <n> selected values over blocks <lo> through <hi> - 1; split
+  // number <node> uses the counter <base + node>
+  std::function<void(int32_t, int32_t, int32_t, uint64_t)> split
+    = [&](int32_t lo, int32_t hi, int32_t n, uint64_t node) {
+    if (hi - lo == 1) {
+      count[lo] = n;
+      return;
+    }
+    int32_t mid = (lo + hi)/2;
+    int32_t end = (hi == nblock? modulo: hi*blocksize);
+    double u[2];
+
+    philox.uniform(base + node, u);
+    int32_t nlo = hypergeometric(u[0], n, (mid - lo)*blocksize,
+                                 end - lo*blocksize);
+    split(lo, mid, nlo, 2*node);
+    split(mid, hi, n - nlo, 2*node + 1);
+  };
+  if (nblock)
+    split(0, nblock, number, 1);
+  // the split numbers are less than 4*nblock
+  base += 4*(uint64_t) nblock;
+
+  int32_t sum = 0;
+  for (int32_t b = 0; b < nblock; b++) {
+    offset[b] = sum;
+    sum += count[b];
+  }
+
+  parallel_for(nblock, 1, [&](size_t begin, size_t end) {
+    for (size_t b = begin; b < end; b++) {
+      int32_t t0 = b*blocksize;
+      int32_t size = ((int32_t) b == nblock - 1? modulo - t0: blocksize);
+      int32_t *out = output + offset[b];
+      int32_t n = count[b], m = 0;
+      uint64_t blockbase = base + b*(uint64_t) (blocksize/2);
+      double u[2];
+
+      // Knuth's Algorithm S (D. Knuth, Seminumerical Algorithms)
+      for (int32_t t = 0; m < n; t++) {
+        if (t % 2 == 0)
+          philox.uniform(blockbase + t/2, u);
+        if ((int32_t) ((size - t)*u[t % 2]) < n - m) {
+          *out++ = t0 + t;
+          m++;
+        }
+      }
+    }
+  });
+  philoxCounter = base + nblock*(uint64_t) (blocksize/2);
+}
+//----------------------------------------------------------------------
 void random_unique(int32_t seed, int32_t *output, int32_t number, int32_t modulo)
 // generates <number> uniformly distributed integer pseudo-random numbers
 // in the range 0 to <modulo> - 1 (inclusive) in which no particular
@@ -235,6 +575,10 @@ void random_unique(int32_t seed, int32_t *output, int32_t number, int32_t modulo
   // initialize random number generator, if necessary
   if (seed)
     random_init(seed);
+  if (random_flag) {
+    random_unique_counter(output, number, modulo);
+    return;
+  }
   // Use Knuth's Algorithm S (D. Knuth, Seminumerical Algorithms)
   t = m = 0;
   while (m < number) {
@@ -265,6 +609,22 @@ void random_unique_shuffle(int32_t seed, int32_t *output, int32_t number, int32_
   random_unique(seed, output, number, modulo);
   if (number > modulo)
     return;                        // error
+  if (random_flag) {
+    // a Fisher-Yates shuffle; element <i> uses the uniform number
+    // from counter <base + i/2>, so the result depends only on the seed
+    uint64_t base = philoxCounter;
+    double u[2];
+
+    for (i = number - 1; i > 0; i--) {
+      philox.uniform(base + i/2, u);
+      j = (int32_t) (u[i % 2]*(i + 1));
+      temp = output[i];
+      output[i] = output[j];
+      output[j] = temp;
+    }
+    philoxCounter += (number + 1)/2;
+    return;
+  }
   // now shuffle.  I hope this algorithm is sufficient.  LS
   for (i = 0; i < number; i++) {
     j = (int32_t) (random_one()*number);
@@ -282,22 +642,37 @@ void randomn(int32_t seed, double *output, int32_t number, char hasUniform)
 // must have been allocated by the user at <output>.  If <hasUniform>
 // is non-zero, then it is assumed that uniformly distributed
 // pseudo-random numbers are already present in <output>,
-// otherwise they are generated in this routine.  LS 25oct95
+// otherwise they are generated in this routine.  If !RANDOM_FLAG is
+// non-zero and <hasUniform> is zero, then the Ziggurat method is used
+// instead.  LS 25oct95
 {
 #if HAVE_LIBGSL
-  int32_t        n, i;
+  int32_t        n;
   double        r, a, extra[2];
 
+  if (random_flag && !hasUniform) {
+    if (seed)
+      random_init(seed);
+    Ziggurat const &z = normal_ziggurat();
+    stream_fill(output, number, [&z](PhiloxBits &bits) {
+      return ziggurat_normal(bits, z);
+    });
+    return;
+  }
   n = number%2;
   if (!hasUniform)
     // first get uniformly distributed numbers between 0 and 1.
     randomu(seed, output, number, 0);
-  for (i = 0; i < number/2 ; i++) {
-    r = sqrt(-2.0*log(*output));
-    a = output[1]*2*M_PI;
-    *output++ = r*cos(a);
-    *output++ = r*sin(a);        // is r*sqrt(1-c*c) with c=cos(a) quicker?
-  }
+  // the pairs are independent, so we can transform them in parallel
+  parallel_for(number/2, 4096, [output](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      double r = sqrt(-2.0*log(output[2*i]));
+      double a = output[2*i + 1]*2*M_PI;
+      output[2*i] = r*cos(a);
+      output[2*i + 1] = r*sin(a);
+    }
+  });
+  output += 2*(number/2);
   if (n) {                        // single number left
     randomu(0, extra, 2, 0);
     r = sqrt(-2.0*log(extra[0]));
@@ -307,30 +682,32 @@ void randomn(int32_t seed, double *output, int32_t number, char hasUniform)
 #endif
 }
 //----------------------------------------------------------------------
-int32_t lux_randomu(ArgumentCount narg, Symbol ps[])
- //create an array of random elements in the [0,1.0] range (exclusive)
-{
 #if HAVE_LIBGSL
- double *p;
- int32_t        k, seed, cycle;
- int32_t        dims[8], *pd, j, result_sym, n;
+static int32_t random_scratch(ArgumentCount narg, Symbol ps[], int32_t *seed,
+                              int32_t *cycle)
+// parses the SEED, CYCLE, and dimension arguments of RANDOMU and
+// RANDOMN and returns a matching scratch array, or LUX_ONE if only a
+// seed was given (and the sequence was reinitialized), or LUX_ERROR.
+{
+ int32_t        k;
+ int32_t        dims[8], *pd, j;
 
  if (*ps) {
-   seed = int_arg(*ps);
-   if (seed > 0)
-     seed = -seed;
+   *seed = int_arg(*ps);
+   if (*seed > 0)
+     *seed = -*seed;
  } else
-   seed = 0;
+   *seed = 0;
  ps++;
  narg--;
  if (!narg) {                        // no more arguments
-   random_init(seed);                // just reinitialize
+   random_init(*seed);                // just reinitialize
    return LUX_ONE;
  }
  if (*ps)
-   cycle = int_arg(*ps);
+   *cycle = int_arg(*ps);
  else
-   cycle = 0;
+   *cycle = 0;
  ps++;
  narg--;
  if (symbol_class(*ps) == LUX_ARRAY) {
@@ -345,12 +722,20 @@ int32_t lux_randomu(ArgumentCount narg, Symbol ps[])
      dims[j] = int_arg(ps[j]); //get the dimensions
    pd = dims;
  }
- result_sym = array_scratch(cycle? LUX_INT32: LUX_DOUBLE, narg, pd);
- if (result_sym == LUX_ERROR)
-   return LUX_ERROR;
- p = (double*) array_data(result_sym);
- n = array_size(result_sym);
- randomu(seed, p, n, cycle);
+ return array_scratch(*cycle? LUX_INT32: LUX_DOUBLE, narg, pd);
+}
+#endif
+//-------------------------------------------------------------------------
+int32_t lux_randomu(ArgumentCount narg, Symbol ps[])
+ //create an array of random elements in the [0,1.0] range (exclusive)
+{
+#if HAVE_LIBGSL
+ int32_t        seed, cycle, result_sym;
+
+ result_sym = random_scratch(narg, ps, &seed, &cycle);
+ if (result_sym == LUX_ERROR || result_sym == LUX_ONE)
+   return result_sym;
+ randomu(seed, array_data(result_sym), array_size(result_sym), cycle);
  return result_sym;
 #else
  return cerror(NOSUPPORT, 0, "RANDOMU", "libgsl");
@@ -421,15 +806,21 @@ int32_t lux_randomn(ArgumentCount narg, Symbol ps[])
  */
 {
 #if HAVE_LIBGSL
-  int32_t        result_sym;
+  int32_t        result_sym, seed, cycle;
 
-  // first get a uniform distribution
-  result_sym = lux_randomu(narg,ps);
+  result_sym = random_scratch(narg, ps, &seed, &cycle);
   if (result_sym == LUX_ERROR        // an error occurred
       || result_sym == LUX_ONE)        // we just initialized with a specific seed
     return result_sym;
-  // then apply Box-Muller transformation
-  randomn(0, (double *) array_data(result_sym), array_size(result_sym), 1);
+  if (random_flag)              // Ziggurat
+    randomn(seed, (double *) array_data(result_sym), array_size(result_sym),
+            0);
+  else {
+    // first get a uniform distribution
+    randomu(seed, array_data(result_sym), array_size(result_sym), 0);
+    // then apply Box-Muller transformation
+    randomn(0, (double *) array_data(result_sym), array_size(result_sym), 1);
+  }
   return result_sym;
 #else
  return cerror(NOSUPPORT, 0, "RANDOMN", "libgsl");
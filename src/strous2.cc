@@ -21,6 +21,7 @@ along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 // Various LUX routines by L. Strous.
 #include "config.h"
 #include "action.hh"
+#include "Arena.hh"
 #include <algorithm>
 #include <ctype.h>
 #include <float.h>
@@ -102,6 +103,11 @@ int32_t showstats(ArgumentCount narg, Symbol ps[])
          nTempVariable, nExecutable,
          tempExecutableIndex - TEMP_EXE_START, nSymbolStack,
          curContext, markIndex - 1);
+  // the temporary strings of the main thread
+  Arena::Statistics a = Arena::thread_arena().statistics();
+  printf("ARENA: %zu allocations, %zu bytes in use, %zu at most, "
+         "%zu segments of %zu bytes\n", a.allocations, a.bytes, a.peak_bytes,
+         a.segments, a.capacity);
   return 1;
 }
 //---------------------------------------------------------
@@ -4065,11 +4065,13 @@ find_permutation_changes(FuncType f, double period, double t1, double t2)
 
 /// Implements the LUX function
 ///
-///     jds = planetpermutationchanges(jd1, jd2, planets)
+///     jds = planetpermutationchanges(jd1, jd2, planets [, /cache])
 ///
 /// which calculates Julian Day numbers at which any two of the planets
 /// (specified as for LUX function `astron`) have the same ICRS ecliptic
-/// longitude.
+/// longitude.  With `/cache`, the positions are interpolated from
+/// Chebyshev polynomials fitted to segments of 8 days, which is faster
+/// for long intervals but less accurate.
 ///
 /// \param narg is the number of LUX arguments
 ///
@@ -4090,6 +4092,8 @@ lux_planetpermutationchanges(ArgumentCount narg, Symbol ps[])
   SolarSystemEphemerides sse;
   sse
     .set_coordinate_system(SolarSystemEphemerides::CoordinateSystem::Ecliptic);
+  if (internalMode & 2)         // /CACHE
+    sse.enable_cache();
 
   auto gl = [&](double JD){
     std::vector<double> l(nelem);
@@ -4127,7 +4131,7 @@ lux_planetpermutationchanges(ArgumentCount narg, Symbol ps[])
   }
   return iq;
 }
-REGISTER(planetpermutationchanges, f, planetpermutationchanges, 3, 3, "1verbose", HAVE_LIBGSL);
+REGISTER(planetpermutationchanges, f, planetpermutationchanges, 3, 3, "1verbose:2cache", HAVE_LIBGSL);
 
 // iD;iL*?;rL{1} → iiarx
 // lux_i_sd_iiarx_<ptrspec>_f_
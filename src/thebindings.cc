@@ -16,7 +16,7 @@ int32_t luxerror(char const*, int32_t, ...);
 /// suitable for use as a LUX subroutine or function.
 //
 // This glue function was generated by bindings.pl based on astron.cc
-// line 3514 and may be overwritten at the next compilation.
+// line 3688 and may be overwritten at the next compilation.
 Symbol
 lux_kepler_v_f(int32_t narg, int32_t ps[])
 {
@@ -32,7 +32,7 @@ lux_kepler_v_f(int32_t narg, int32_t ps[])
 /// suitable for use as a LUX subroutine or function.
 //
 // This glue function was generated by bindings.pl based on fun2.cc
-// line 2782 and may be overwritten at the next compilation.
+// line 2756 and may be overwritten at the next compilation.
 Symbol
 lux_esmooth_asymmetric_f(int32_t narg, int32_t ps[])
 {
@@ -48,7 +48,7 @@ lux_esmooth_asymmetric_f(int32_t narg, int32_t ps[])
 /// suitable for use as a LUX subroutine or function.
 //
 // This glue function was generated by bindings.pl based on fun2.cc
-// line 2832 and may be overwritten at the next compilation.
+// line 2806 and may be overwritten at the next compilation.
 Symbol
 lux_esmooth_symmetric_f(int32_t narg, int32_t ps[])
 {
@@ -64,7 +64,7 @@ lux_esmooth_symmetric_f(int32_t narg, int32_t ps[])
 /// suitable for use as a LUX subroutine or function.
 //
 // This glue function was generated by bindings.pl based on fun3.cc
-// line 535 and may be overwritten at the next compilation.
+// line 537 and may be overwritten at the next compilation.
 Symbol
 lux_gsl_fft_f(int32_t narg, int32_t ps[])
 {
@@ -80,7 +80,7 @@ lux_gsl_fft_f(int32_t narg, int32_t ps[])
 /// suitable for use as a LUX subroutine or function.
 //
 // This glue function was generated by bindings.pl based on fun3.cc
-// line 536 and may be overwritten at the next compilation.
+// line 538 and may be overwritten at the next compilation.
 Symbol
 lux_gsl_fft_s(int32_t narg, int32_t ps[])
 {
@@ -96,7 +96,7 @@ lux_gsl_fft_s(int32_t narg, int32_t ps[])
 /// suitable for use as a LUX subroutine or function.
 //
 // This glue function was generated by bindings.pl based on fun3.cc
-// line 566 and may be overwritten at the next compilation.
+// line 568 and may be overwritten at the next compilation.
 Symbol
 lux_gsl_fft_back_f(int32_t narg, int32_t ps[])
 {
@@ -112,7 +112,7 @@ lux_gsl_fft_back_f(int32_t narg, int32_t ps[])
 /// suitable for use as a LUX subroutine or function.
 //
 // This glue function was generated by bindings.pl based on fun3.cc
-// line 567 and may be overwritten at the next compilation.
+// line 569 and may be overwritten at the next compilation.
 Symbol
 lux_gsl_fft_back_s(int32_t narg, int32_t ps[])
 {
@@ -128,7 +128,7 @@ lux_gsl_fft_back_s(int32_t narg, int32_t ps[])
 /// suitable for use as a LUX subroutine or function.
 //
 // This glue function was generated by bindings.pl based on fun3.cc
-// line 590 and may be overwritten at the next compilation.
+// line 592 and may be overwritten at the next compilation.
 Symbol
 lux_hilbert_f(int32_t narg, int32_t ps[])
 {
@@ -144,7 +144,7 @@ lux_hilbert_f(int32_t narg, int32_t ps[])
 /// suitable for use as a LUX subroutine or function.
 //
 // This glue function was generated by bindings.pl based on fun3.cc
-// line 591 and may be overwritten at the next compilation.
+// line 593 and may be overwritten at the next compilation.
 Symbol
 lux_hilbert_s(int32_t narg, int32_t ps[])
 {
@@ -2991,6 +2991,10 @@ lux_hypot_stride_f(int32_t narg, int32_t ps[])
 
 void register_the_bindings()
 {
+#line 3061 "astron.cc"
+  int32_t lux_astrocache(int32_t, int32_t []);
+  register_lux_s(lux_astrocache, "astrocache", 0, 2, "1reset:2show");
+
   register_lux_f(lux_kepler_v_f, "kepler", 2, 2, "0meananomaly:1perifocalanomaly:0trueanomaly:2eccentricanomaly:4tau:8itercount");
 
 #line 349 "astron2.cc"
@@ -3003,6 +3007,10 @@ void register_the_bindings()
   int32_t lux_error(int32_t, int32_t []);
   register_lux_s(lux_error, "error", 0, 2, "1store:2restore" );
 
+#line 2469 "execute.cc"
+  int32_t lux_profile(int32_t, int32_t []);
+  register_lux_s(lux_profile, "profile", 0, 1, "1start:2stop:4reset:8lines:16memory");
+
 #line 78 "filemap.cc"
   int32_t lux_bytfarr(int32_t, int32_t []);
   register_lux_f(lux_bytfarr, "bytfarr", 3, MAX_DIMS + 1, "%1%offset:1readonly:2swap");
@@ -3031,26 +3039,34 @@ void register_the_bindings()
   int32_t lux_int64farr(int32_t, int32_t []);
   register_lux_f(lux_int64farr, "int64farr", 3, MAX_DIMS + 1, "%1%offset:1readonly:2swap");
 
-#line 938 "fit.cc"
+#line 1041 "fit.cc"
   int32_t lux_generalfit2(int32_t, int32_t []);
   register_lux_f(lux_generalfit2, "fit3", 5, 7, "x:y:start:step:f:err:ithresh:1vocal");
 
-#line 968 "fun1.cc"
+#line 1352 "fit.cc"
+  int32_t lux_fitlm(int32_t, int32_t []);
+  register_lux_f(lux_fitlm, "fitlm", 3, 11, "x:y:start:step:lowbound:highbound:weights:ithresh:dthresh:err:fit:1vocal:2gaussians:4powerfunc");
+
+#line 972 "fun1.cc"
   int32_t lux_setnan(int32_t, int32_t []);
   register_lux_f(lux_setnan, "setnan", 1, 2, NULL);
 
-#line 1050 "fun1.cc"
+#line 1054 "fun1.cc"
   int32_t lux_indgen_s(int32_t, int32_t []);
   register_lux_s(lux_indgen_s, "indgen", 1, 2, "*");
 
-#line 5617 "fun1.cc"
+#line 5343 "fun1.cc"
   int32_t lux_log2(int32_t, int32_t []);
   register_lux_f(lux_log2, "log2", 1, 1, nullptr);
 
-#line 205 "fun2.cc"
+#line 208 "fun2.cc"
   int32_t lux_runsum(int32_t, int32_t []);
   register_lux_f(lux_runsum, "runsum", 1, 3, "*");
 
+#line 2547 "fun2.cc"
+  int32_t lux_stats(int32_t, int32_t []);
+  register_lux_f(lux_stats, "stats", 1, 3, "::quantiles:0sample:1population:2keepdims:8omitnans");
+
   register_lux_f(lux_esmooth_asymmetric_f, "esmooth1", 1, 2, NULL);
 
   register_lux_f(lux_esmooth_symmetric_f, "esmooth2", 1, 2, NULL);
@@ -3067,15 +3083,15 @@ void register_the_bindings()
 
   register_lux_s(lux_hilbert_s, "hilbert", 1, 2, "1allaxes");
 
-#line 693 "fun3.cc"
+#line 695 "fun3.cc"
   int32_t lux_fft_expand(int32_t, int32_t []);
   register_lux_f(lux_fft_expand, "fftexpand", 2, 2, NULL);
 
-#line 1688 "fun3.cc"
+#line 1846 "fun3.cc"
   int32_t lux_hist(int32_t, int32_t []);
-  register_lux_f(lux_hist, "hist", 1, 2, "1first:2ignorelimit:4increaselimit:8silent" );
+  register_lux_f(lux_hist, "hist", 1, 4, "::weights:y:1first:2ignorelimit:4increaselimit:8silent" );
 
-#line 4925 "fun3.cc"
+#line 5083 "fun3.cc"
 #if HAVE_LIBGSL
   int32_t lux_welch(int32_t, int32_t []);
   register_lux_f(lux_welch, "welch", 2, 3, "1window:2fast");
@@ -3113,49 +3129,61 @@ void register_the_bindings()
   int32_t lux_gnucontour(int32_t, int32_t []);
   register_lux_s(lux_gnucontour, "gcontour", 1, 1, ":1equalxy:2image");
 
-#line 183 "jpeg.cc"
+#line 201 "jpeg.cc"
 #if HAVE_LIBJPEG
   int32_t lux_read_jpeg6b(int32_t, int32_t []);
   register_lux_s(lux_read_jpeg6b, "jpegread", 2, 4, ":::shrink:1greyscale");
 #endif
 
-#line 184 "jpeg.cc"
+#line 202 "jpeg.cc"
 #if HAVE_LIBJPEG
   int32_t lux_read_jpeg6b(int32_t, int32_t []);
   register_lux_s(lux_read_jpeg6b, "read_jpeg", 2, 4, ":::shrink:1greyscale");
 #endif
 
-#line 190 "jpeg.cc"
+#line 208 "jpeg.cc"
 #if HAVE_LIBJPEG
   int32_t lux_read_jpeg6b_f(int32_t, int32_t []);
   register_lux_f(lux_read_jpeg6b_f, "jpegread", 2, 4, ":::shrink:1greyscale");
 #endif
 
-#line 191 "jpeg.cc"
+#line 209 "jpeg.cc"
 #if HAVE_LIBJPEG
   int32_t lux_read_jpeg6b_f(int32_t, int32_t []);
   register_lux_f(lux_read_jpeg6b_f, "read_jpeg", 2, 4, ":::shrink:1greyscale");
 #endif
 
-#line 297 "jpeg.cc"
+#line 343 "jpeg.cc"
+#if HAVE_LIBJPEG
+  int32_t lux_read_jpeg_stack(int32_t, int32_t []);
+  register_lux_f(lux_read_jpeg_stack, "jpegreadstack", 1, 2, ":shrink:1greyscale");
+#endif
+
+#line 344 "jpeg.cc"
+#if HAVE_LIBJPEG
+  int32_t lux_read_jpeg_stack(int32_t, int32_t []);
+  register_lux_f(lux_read_jpeg_stack, "read_jpeg_stack", 1, 2, ":shrink:1greyscale");
+#endif
+
+#line 450 "jpeg.cc"
 #if HAVE_LIBJPEG
   int32_t lux_write_jpeg6b(int32_t, int32_t []);
   register_lux_s(lux_write_jpeg6b, "jpegwrite", 2, 4, 0);
 #endif
 
-#line 298 "jpeg.cc"
+#line 451 "jpeg.cc"
 #if HAVE_LIBJPEG
   int32_t lux_write_jpeg6b(int32_t, int32_t []);
   register_lux_s(lux_write_jpeg6b, "write_jpeg", 2, 4, 0);
 #endif
 
-#line 304 "jpeg.cc"
+#line 457 "jpeg.cc"
 #if HAVE_LIBJPEG
   int32_t lux_write_jpeg6b_f(int32_t, int32_t []);
   register_lux_f(lux_write_jpeg6b_f, "jpegwrite", 2, 4, 0);
 #endif
 
-#line 305 "jpeg.cc"
+#line 458 "jpeg.cc"
 #if HAVE_LIBJPEG
   int32_t lux_write_jpeg6b_f(int32_t, int32_t []);
   register_lux_f(lux_write_jpeg6b_f, "write_jpeg", 2, 4, 0);
@@ -3797,43 +3825,49 @@ void register_the_bindings()
   register_lux_s(lux_iauXys06a_s, "xys06a", 4, 4, 0);
 
 #endif
-#line 152 "matrix.cc"
+#line 130 "matrix.cc"
   int32_t lux_matrix_product(int32_t, int32_t []);
   register_lux_f(lux_matrix_product, "mproduct", 2, 2, "0inner:1outer");
 
-#line 434 "matrix.cc"
+#line 412 "matrix.cc"
   int32_t lux_svd(int32_t, int32_t []);
   register_lux_s(lux_svd, "svd", 4, 4, "1svarray");
 
-#line 648 "matrix.cc"
+#line 626 "matrix.cc"
   int32_t lux_eigensystem(int32_t, int32_t []);
   register_lux_s(lux_eigensystem, "eigensystem", 2, 4, NULL);
 
-#line 696 "matrix.cc"
+#line 674 "matrix.cc"
   int32_t lux_eigenvalues(int32_t, int32_t []);
   register_lux_f(lux_eigenvalues, "eigenvalues", 1, 1, "0descending:2ascending:0absolute:1relative:");
 
-#line 768 "matrix.cc"
+#line 746 "matrix.cc"
   int32_t lux_transpose_matrix(int32_t, int32_t []);
   register_lux_f(lux_transpose_matrix, "transpose", 1, 1, NULL);
 
-#line 819 "matrix.cc"
+#line 797 "matrix.cc"
   int32_t lux_diagonal_matrix(int32_t, int32_t []);
   register_lux_f(lux_diagonal_matrix, "mdiagonal", 1, 3, NULL);
 
-#line 44 "oiio.cc"
+#line 48 "oiio.cc"
 #if HAVE_LIBOPENIMAGEIO
   int32_t lux_read_image_oiio(int32_t, int32_t []);
   register_lux_f(lux_read_image_oiio, "readimage", 1, 1, NULL);
 #endif
 
-#line 93 "oiio.cc"
+#line 146 "oiio.cc"
+#if HAVE_LIBOPENIMAGEIO
+  int32_t lux_read_image_stack_oiio(int32_t, int32_t []);
+  register_lux_f(lux_read_image_stack_oiio, "readimagestack", 1, 1, NULL);
+#endif
+
+#line 195 "oiio.cc"
 #if HAVE_LIBOPENIMAGEIO
   int32_t lux_write_image_oiio(int32_t, int32_t []);
   register_lux_s(lux_write_image_oiio, "writeimage", 3, 3, NULL);
 #endif
 
-#line 479 "random.cc"
+#line 870 "random.cc"
   int32_t lux_randome(int32_t, int32_t []);
   register_lux_f(lux_randome, "randome", 3, MAX_DIMS, "%1%limit:scale");
 
@@ -3849,43 +3883,43 @@ void register_the_bindings()
   int32_t lux_find(int32_t, int32_t []);
   register_lux_f(lux_find, "find", 2, 3, "1data_monotonic:2at_or_past");
 
-#line 49 "strous2.cc"
+#line 50 "strous2.cc"
   int32_t lux_noop(int32_t, int32_t []);
   register_lux_s(lux_noop, "noop", 0, 0, nullptr);
 
-#line 572 "strous2.cc"
+#line 578 "strous2.cc"
   int32_t lux_tolookup(int32_t, int32_t []);
   register_lux_s(lux_tolookup, "tolookup", 2, 4, "1one");
 
-#line 898 "strous2.cc"
+#line 904 "strous2.cc"
   int32_t lux_quantile(int32_t, int32_t []);
   register_lux_f(lux_quantile, "quantile", 2, 3, "4keepdims");
 
-#line 906 "strous2.cc"
+#line 912 "strous2.cc"
   int32_t lux_median(int32_t, int32_t []);
   register_lux_f(lux_median, "median", 1, 3, "%1%4keepdims");
 
-#line 2556 "strous2.cc"
+#line 2562 "strous2.cc"
   int32_t lux_find_maxloc(int32_t, int32_t []);
   register_lux_f(lux_find_maxloc, "find_maxloc", 1, 3, "::diagonal:1degree:2subgrid:4coords:8old");
 
-#line 2563 "strous2.cc"
+#line 2569 "strous2.cc"
   int32_t lux_find_minloc(int32_t, int32_t []);
   register_lux_f(lux_find_minloc, "find_minloc", 1, 3, "::diagonal:1degree:2subgrid:4coords:8old");
 
-#line 2570 "strous2.cc"
+#line 2576 "strous2.cc"
   int32_t lux_find_extremeloc(int32_t, int32_t []);
   register_lux_f(lux_find_extremeloc, "find_extremeloc", 1, 3, "::diagonal:1degree:2subgrid:4coords:8old");
 
-#line 2577 "strous2.cc"
+#line 2583 "strous2.cc"
   int32_t lux_find_max(int32_t, int32_t []);
   register_lux_f(lux_find_max, "find_max", 1, 3, "::diagonal:1degree:2subgrid");
 
-#line 2584 "strous2.cc"
+#line 2590 "strous2.cc"
   int32_t lux_find_min(int32_t, int32_t []);
   register_lux_f(lux_find_min, "find_min", 1, 3, "::diagonal:1degree:2subgrid");
 
-#line 2591 "strous2.cc"
+#line 2597 "strous2.cc"
   int32_t lux_find_extreme(int32_t, int32_t []);
   register_lux_f(lux_find_extreme, "find_extreme", 1, 3, "::diagonal:1degree:2subgrid");
 
@@ -3919,45 +3953,45 @@ void register_the_bindings()
   int32_t lux_commonfactors(int32_t, int32_t []);
   register_lux_s(lux_commonfactors, "commonfactors", 3, 4, NULL);
 
-#line 4130 "strous3.cc"
+#line 4134 "strous3.cc"
 #if HAVE_LIBGSL
   int32_t lux_planetpermutationchanges(int32_t, int32_t []);
-  register_lux_f(lux_planetpermutationchanges, "planetpermutationchanges", 3, 3, "1verbose");
+  register_lux_f(lux_planetpermutationchanges, "planetpermutationchanges", 3, 3, "1verbose:2cache");
 #endif
 
-#line 4323 "strous3.cc"
+#line 4327 "strous3.cc"
 #if HAVE_LIBGSL
   int32_t lux_permutationnumber(int32_t, int32_t []);
   register_lux_f(lux_permutationnumber, "permutationnumber", 1, 2, "0rank:1index:0linear:2circular");
 #endif
 
-#line 4364 "strous3.cc"
+#line 4368 "strous3.cc"
 #if HAVE_LIBGSL
   int32_t lux_permutation(int32_t, int32_t []);
   register_lux_f(lux_permutation, "permutation", 2, 2, "0rank:1index:0linear:2circular");
 #endif
 
-#line 4501 "strous3.cc"
+#line 4505 "strous3.cc"
 #if HAVE_LIBGSL
   int32_t lux_permutationdistance(int32_t, int32_t []);
   register_lux_f(lux_permutationdistance, "permutationdistance", 2, 2, "0rank:1index:0linear:2circular");
 #endif
 
-#line 4569 "strous3.cc"
+#line 4573 "strous3.cc"
 #if HAVE_LIBGSL
   int32_t lux_factorial(int32_t, int32_t []);
   register_lux_f(lux_factorial, "factorial", 1, 1, NULL);
 #endif
 
-#line 4789 "strous3.cc"
+#line 4793 "strous3.cc"
   int32_t lux_decompose_2d_median3(int32_t, int32_t []);
   register_lux_s(lux_decompose_2d_median3, "decompose2dmedian3", 3, 3, NULL);
 
-#line 4952 "strous3.cc"
+#line 4956 "strous3.cc"
   int32_t lux_compose_2d(int32_t, int32_t []);
   register_lux_s(lux_compose_2d, "compose2d", 3, 3, NULL);
 
-#line 5057 "strous3.cc"
+#line 5061 "strous3.cc"
   int32_t lux_div2(int32_t, int32_t []);
   register_lux_f(lux_div2, "div", 2, 2, NULL);
 
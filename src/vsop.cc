@@ -18,6 +18,8 @@ You should have received a copy of the GNU General Public License
 along with LUX.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "config.h"
+#include <algorithm>            // for std::min
+#include <float.h>              // for DBL_EPSILON
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
@@ -92,6 +94,81 @@ static void gatherVSOP(double T, struct planetIndex *index, double *terms,
   }
 }
 //--------------------------------------------------------------------------
+/// The number of epochs that gatherVSOPmany() processes together, so
+/// that their coordinates stay in the cache while all terms are added.
+static const size_t VSOP_CHUNK = 256;
+
+/// The number of consecutive uniformly spaced epochs for which
+/// gatherVSOPmany() calculates the terms through angle-addition
+/// recurrences before calculating the next one directly again.  This
+/// limits the accumulation of round-off errors.
+static const size_t VSOP_RESEED = 64;
+
+/// Calculates one coordinate of one object for many epochs at once.
+///
+/// \param T points at the epochs, in Julian millennia since J2000.0.
+///
+/// \param n is the number of epochs.
+///
+/// \param dT is the spacing between consecutive epochs if they are
+/// uniformly spaced, or 0 otherwise.
+///
+/// \param index indicates the object and coordinate, like for
+/// gatherVSOP().
+///
+/// \param terms points at the VSOP87 terms.
+///
+/// \param value points at the first result.  The results are stored
+/// 3 elements apart, so the X, Y, and Z coordinates of an epoch can
+/// be next to each other.
+///
+/// If \p dT is 0, then the results are identical to those of
+/// gatherVSOP().  Otherwise, the terms for all but every
+/// #VSOP_RESEED-th epoch are calculated by rotating those of the
+/// previous epoch through a fixed angle, which needs no cosines and
+/// changes the results by no more than a few units in the 14th
+/// significant digit.
+static void gatherVSOPmany(double const* T, size_t n, double dT,
+                           struct planetIndex *index, double const* terms,
+                           double *value)
+{
+  for (size_t k0 = 0; k0 < n; k0 += VSOP_CHUNK) {
+    size_t k1 = std::min(n, k0 + VSOP_CHUNK);
+    for (size_t k = k0; k < k1; k++)
+      value[3*k] = 0.0;
+    for (int32_t i = 5; i >= 0; i--) { // powers of T
+      for (size_t k = k0; k < k1; k++)
+        value[3*k] *= T[k];
+      int32_t nTerm = index[i].nTerms;
+      double const* ptr = terms + 3*(index[i].index);
+      while (nTerm--) {
+        double a = ptr[0];
+        double b = ptr[1];
+        double c = ptr[2];
+        if (dT) {
+          double sd, cd;
+          sincos(c*dT, &sd, &cd); // rotation from one epoch to the next
+          for (size_t k = k0; k < k1; k += VSOP_RESEED) {
+            size_t kend = std::min(k1, k + VSOP_RESEED);
+            double s, co;
+            sincos(b + c*T[k], &s, &co);
+            for (size_t m = k; m < kend; m++) {
+              value[3*m] += a*co;
+              double co2 = co*cd - s*sd;
+              s = s*cd + co*sd;
+              co = co2;
+            }
+          }
+        } else {
+          for (size_t k = k0; k < k1; k++)
+            value[3*k] += a*cos(b + c*T[k]);
+        }
+        ptr += 3;
+      }
+    }
+  }
+}
+//--------------------------------------------------------------------------
 void XYZfromVSOP(double T, int32_t object, double *pos, double tolerance,
                  struct VSOPdata *data)
 {
@@ -143,3 +220,76 @@ void XYZJ2000fromVSOPA(double T, int32_t object, double *pos, double tolerance)
 {
   return XYZfromVSOP(T, object, pos, tolerance, &VSOP87Adata);
 }
+//--------------------------------------------------------------------------
+/// Returns the spacing of uniformly spaced epochs, or 0 if the epochs
+/// are not uniformly spaced to within round-off errors.
+///
+/// \param T points at the epochs.
+///
+/// \param n is the number of epochs.
+static double uniformSpacing(double const* T, size_t n)
+{
+  if (n < 3)
+    return 0;
+  double dT = (T[n - 1] - T[0])/(n - 1);
+  if (!dT)
+    return 0;
+  double limit = 4*DBL_EPSILON*std::max(fabs(T[0]), fabs(T[n - 1]));
+  for (size_t k = 1; k < n; k++)
+    if (fabs(T[k] - (T[0] + k*dT)) > limit)
+      return 0;
+  return dT;
+}
+//--------------------------------------------------------------------------
+static void XYZfromVSOPmany(double const* T, size_t n, int32_t object,
+                            double *pos, double tolerance,
+                            struct VSOPdata *data)
+{
+  switch (object) {
+    case 0:                        // Sun
+      std::fill(pos, pos + 3*n, 0.0);
+      break;
+    default:                        // other planets
+      {
+        double dT = uniformSpacing(T, n);
+        for (int32_t coordinate = 0; coordinate < 3; coordinate++)
+          gatherVSOPmany(T, n, dT,
+                         &data->indices[6*3*(object - 1) + 6*coordinate],
+                         data->terms, pos + coordinate);
+      }
+      break;
+  }
+}
+//--------------------------------------------------------------------------
+/// Calculates heliocentric cartesian coordinates for many epochs at
+/// once, like XYZJ2000fromVSOPA() does for one epoch.  This is much
+/// faster than calling XYZJ2000fromVSOPA() for each epoch, especially
+/// if the epochs are uniformly spaced.
+///
+/// \param T points at the epochs, in Julian millennia since J2000.0.
+///
+/// \param n is the number of epochs.
+///
+/// \param object indicates the object (0 = the Sun, 1 = Mercury,
+/// ..., 8 = Neptune).
+///
+/// \param pos points at an array of at least 3*\p n elements, in
+/// which the X, Y, and Z coordinates of the first epoch are returned,
+/// followed by those of the second epoch, and so on.
+///
+/// \param tolerance indicates the maximum error allowed in the
+/// results due to truncation of the VSOP model series.
+void XYZJ2000fromVSOPAmany(double const* T, size_t n, int32_t object,
+                           double *pos, double tolerance)
+{
+  XYZfromVSOPmany(T, n, object, pos, tolerance, &VSOP87Adata);
+}
+//--------------------------------------------------------------------------
+/// Calculates heliocentric cartesian coordinates for many epochs at
+/// once, like XYZdatefromVSOPC() does for one epoch.  The arguments
+/// are like for XYZJ2000fromVSOPAmany().
+void XYZdatefromVSOPCmany(double const* T, size_t n, int32_t object,
+                          double *pos, double tolerance)
+{
+  XYZfromVSOPmany(T, n, object, pos, tolerance, &VSOP87Cdata);
+}
@@ -37,4 +37,8 @@ extern VSOPdata VSOP87Cdata;
 
 void XYZJ2000fromVSOPA(double T, int32_t object, double *pos, double tolerance);
 void XYZdatefromVSOPC(double T, int32_t object, double *pos, double tolerance);
+void XYZJ2000fromVSOPAmany(double const* T, size_t n, int32_t object,
+                           double *pos, double tolerance);
+void XYZdatefromVSOPCmany(double const* T, size_t n, int32_t object,
+                          double *pos, double tolerance);
 
@@ -0,0 +1,70 @@
+/* This is file benchrandom.cc.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Measures the throughput of the bulk pseudo-random number generators
+// for the Mersenne Twister (!RANDOM_FLAG = 0) and for the counter-based
+// generator with the Ziggurat method (!RANDOM_FLAG = 1).  Build with
+// "make benchrandom"; the optional argument is the number of elements
+// per call.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+extern int32_t random_flag, lux_nthreads;
+void random_init(int32_t seed);
+void randomu(int32_t seed, void *output, int32_t number, int32_t modulo);
+void randomn(int32_t seed, double *output, int32_t number, char hasUniform);
+void randome(void *output, int32_t number, double limit);
+
+template<typename F>
+static double
+throughput(int32_t number, F f)
+{
+  int count = 0;
+  auto start = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed;
+  do {
+    f();
+    ++count;
+    elapsed = std::chrono::steady_clock::now() - start;
+  } while (elapsed.count() < 1);
+  return count*(double) number/elapsed.count()/1e6;
+}
+
+int main(int argc, char *argv[])
+{
+  int32_t number = argc > 1? atoi(argv[1]): 10000000;
+  std::vector<double> output(number);
+
+  random_init(12345);
+  printf("%d elements per call; millions of elements per second\n", number);
+  printf("%-8s %8s %8s %8s\n", "flag", "randomu", "randomn", "randome");
+  for (int flag = 0; flag <= 1; ++flag) {
+    random_flag = flag;
+    double u = throughput(number, [&] { randomu(0, output.data(), number, 0); });
+    double n = throughput(number, [&] { randomn(0, output.data(), number, 0); });
+    double e = throughput(number, [&] { randome(output.data(), number, 0); });
+    printf("%-8d %8.1f %8.1f %8.1f\n", flag, u, n, e);
+  }
+  return 0;
+}
@@ -0,0 +1,145 @@
+/* This is file check-Arena.cc.
+
+   Copyright 2026 Louis Strous
+
+   This file is part of LUX.
+
+   LUX is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   LUX is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+   License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+/// A file providing CppUTest unit tests for the Arena class.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_LIBCPPUTEST
+#endif
+
+#if HAVE_LIBCPPUTEST
+
+# include <cstdint>
+# include <cstring>
+# include <string>
+# include <thread>
+# include <vector>
+
+# include "Arena.hh"
+# include "Bytestack.hh"
+
+# include "CppUTest/TestHarness.h"
+
+TEST_GROUP(ArenaTestGroup)
+{
+};
+
+TEST(ArenaTestGroup, stable)
+{
+  // earlier allocations do not move when new segments are added
+  Arena arena(64);
+  std::vector<char*> texts;
+  for (int i = 0; i < 100; ++i)
+    texts.push_back(arena.sprintf("text number %d", i));
+  for (int i = 0; i < 100; ++i)
+    STRCMP_EQUAL(("text number " + std::to_string(i)).c_str(), texts[i]);
+
+  Arena::Statistics s = arena.statistics();
+  LONGS_EQUAL(100, s.allocations);
+  CHECK_TRUE(s.segments > 1);
+  CHECK_TRUE(s.bytes <= s.capacity);
+  LONGS_EQUAL(s.bytes, s.peak_bytes);
+}
+
+TEST(ArenaTestGroup, alignment)
+{
+  Arena arena(64);
+  arena.allocate(1, 1);
+  auto p = (uintptr_t) arena.allocate(8, 8);
+  LONGS_EQUAL(0, p % 8);
+  p = (uintptr_t) arena.allocate(10, 256);
+  LONGS_EQUAL(0, p % 256);
+}
+
+TEST(ArenaTestGroup, large)
+{
+  // an allocation larger than a segment gets a segment of its own
+  Arena arena(64);
+  std::string text(1000, 'x');
+  char* copy = arena.strdup(text.c_str());
+  STRCMP_EQUAL(text.c_str(), copy);
+  CHECK_TRUE(arena.statistics().capacity >= 1001);
+  char* long_text = arena.sprintf("%s%s", text.c_str(), text.c_str());
+  LONGS_EQUAL(2000, strlen(long_text));
+}
+
+TEST(ArenaTestGroup, reset)
+{
+  Arena arena(64);
+  char* first = arena.strdup("first");
+  Arena::Mark mark = arena.mark();
+  size_t bytes = arena.statistics().bytes;
+  for (int i = 0; i < 50; ++i)
+    arena.sprintf("%d", i*1000);
+  size_t segments = arena.statistics().segments;
+  size_t peak = arena.statistics().peak_bytes;
+
+  // everything after the mark is freed, and the segments are reused
+  arena.reset(mark);
+  LONGS_EQUAL(bytes, arena.statistics().bytes);
+  for (int i = 0; i < 50; ++i)
+    arena.sprintf("%d", i*1000);
+  LONGS_EQUAL(segments, arena.statistics().segments);
+  LONGS_EQUAL(peak, arena.statistics().peak_bytes);
+  STRCMP_EQUAL("first", first);
+
+  arena.clear();
+  LONGS_EQUAL(0, arena.statistics().segments);
+  LONGS_EQUAL(0, arena.statistics().bytes);
+}
+
+TEST(ArenaTestGroup, threads)
+{
+  // each thread has its own arena
+  Arena* arenas[2];
+  std::string text;
+  std::thread t([&arenas, &text]() {
+    arenas[0] = &Arena::thread_arena();
+    text = arenas[0]->sprintf("a%d", 1);
+  });
+  t.join();
+  STRCMP_EQUAL("a1", text.c_str());
+  arenas[1] = &Arena::thread_arena();
+  CHECK_TRUE(arenas[0] != arenas[1]);
+  CHECK_TRUE(&Arena::thread_arena() == arenas[1]);
+}
+
+TEST(ArenaTestGroup, temporaries)
+{
+  // temporary results come from the thread's arena, and each one
+  // frees the previous one
+  Arena& arena = Arena::thread_arena();
+  STRCMP_EQUAL("x = 0001", temp_sprintf("x = %04d", 1));
+  size_t bytes = arena.statistics().bytes;
+  for (int i = 0; i < 1000; ++i)
+    temp_sprintf("x = %04d", i);
+  LONGS_EQUAL(bytes, arena.statistics().bytes);
+  STRCMP_EQUAL("copy", Bytestack_temp_text(NULL, "copy"));
+
+  // but not if something else was allocated after it
+  char* temp = temp_sprintf("kept");
+  char* other = arena.strdup("other");
+  temp_sprintf("next");
+  STRCMP_EQUAL("kept", temp);
+  STRCMP_EQUAL("other", other);
+}
+
+#endif
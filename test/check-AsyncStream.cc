@@ -0,0 +1,155 @@
+/* This is file check-AsyncStream.cc.
+
+   Copyright 2026 Louis Strous
+
+   This file is part of LUX.
+
+   LUX is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   LUX is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+   License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+/// A file providing CppUTest unit tests for the AsyncStream class.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_LIBCPPUTEST, HAVE_FOPENCOOKIE
+#endif
+
+#if HAVE_LIBCPPUTEST
+
+# include <algorithm>
+# include <cstdio>
+# include <cstdlib>
+# include <string>
+# include <vector>
+# include <fcntl.h>
+# include <unistd.h>
+
+# include "AsyncStream.hh"
+
+# include "CppUTest/TestHarness.h"
+
+TEST_GROUP(AsyncStreamTestGroup)
+{
+  std::string name;
+  std::vector<char> data;
+
+  void
+  setup()
+  {
+    char path[] = "/tmp/check-AsyncStream-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0)
+      ::close(fd);
+    name = path;
+    // more data than fit in the buffers at once
+    data.resize(1000);
+    for (size_t i = 0; i < data.size(); ++i)
+      data[i] = (char) (i*7 + i/256);
+  }
+
+  void
+  teardown()
+  {
+    unlink(name.c_str());
+  }
+
+  // writes the data in pieces through an AsyncStream with small buffers
+  void
+  write_data()
+  {
+    AsyncStream stream(open(name.c_str(), O_WRONLY | O_TRUNC), true, 64, 3);
+    for (size_t i = 0; i < data.size(); i += 100)
+      LONGS_EQUAL(100, stream.write(data.data() + i, 100));
+    CHECK_TRUE(stream.wait());
+    LONGS_EQUAL(0, stream.close());
+  }
+};
+
+TEST(AsyncStreamTestGroup, readwrite)
+{
+  write_data();
+
+  AsyncStream stream(open(name.c_str(), O_RDONLY), false, 64, 3);
+  std::vector<char> result(data.size() + 10);
+  LONGS_EQUAL(300, stream.read(result.data(), 300));
+  LONGS_EQUAL(data.size() - 300, stream.read(result.data() + 300, 1000));
+  result.resize(data.size());
+  CHECK_TRUE(result == data);
+  char c;
+  LONGS_EQUAL(0, stream.read(&c, 1)); // end of file
+}
+
+TEST(AsyncStreamTestGroup, seek)
+{
+  write_data();
+
+  AsyncStream stream(open(name.c_str(), O_RDONLY), false, 64, 3);
+  char c[10];
+  LONGS_EQUAL(10, stream.read(c, 10));
+  LONGS_EQUAL(777, stream.seek(777, SEEK_SET));
+  LONGS_EQUAL(10, stream.read(c, 10));
+  CHECK_TRUE(std::equal(c, c + 10, data.begin() + 777));
+  LONGS_EQUAL(787, stream.seek(0, SEEK_CUR));
+  LONGS_EQUAL(995, stream.seek(-5, SEEK_END));
+  LONGS_EQUAL(5, stream.read(c, 10));
+  CHECK_TRUE(std::equal(c, c + 5, data.begin() + 995));
+  LONGS_EQUAL(3, stream.seek(3, SEEK_SET));
+  LONGS_EQUAL(10, stream.read(c, 10));
+  CHECK_TRUE(std::equal(c, c + 10, data.begin() + 3));
+}
+
+TEST(AsyncStreamTestGroup, overwrite)
+{
+  write_data();
+
+  {
+    AsyncStream stream(open(name.c_str(), O_WRONLY), true, 64, 3);
+    char x[20] = { };
+    LONGS_EQUAL(500, stream.seek(500, SEEK_SET));
+    LONGS_EQUAL(20, stream.write(x, 20));
+    LONGS_EQUAL(1000, stream.seek(0, SEEK_END));
+    LONGS_EQUAL(0, stream.close());
+  }
+  std::fill(data.begin() + 500, data.begin() + 520, 0);
+
+  AsyncStream stream(open(name.c_str(), O_RDONLY), false, 64, 3);
+  std::vector<char> result(data.size());
+  LONGS_EQUAL(data.size(), stream.read(result.data(), result.size()));
+  CHECK_TRUE(result == data);
+}
+
+#if HAVE_FOPENCOOKIE
+TEST(AsyncStreamTestGroup, file)
+{
+  AsyncStream* stream;
+  FILE* fp = async_fopen(name.c_str(), true, 1 << 20, &stream);
+  CHECK_TRUE(fp != NULL);
+  LONGS_EQUAL(data.size(), fwrite(data.data(), 1, data.size(), fp));
+  fflush(fp);
+  CHECK_TRUE(stream->wait());
+  LONGS_EQUAL(data.size(), ftell(fp));
+  LONGS_EQUAL(0, fclose(fp));
+
+  fp = async_fopen(name.c_str(), false, 1 << 20, &stream);
+  CHECK_TRUE(fp != NULL);
+  LONGS_EQUAL(0, fseek(fp, 100, SEEK_SET));
+  std::vector<char> result(200);
+  LONGS_EQUAL(200, fread(result.data(), 1, 200, fp));
+  CHECK_TRUE(std::equal(result.begin(), result.end(), data.begin() + 100));
+  LONGS_EQUAL(300, ftell(fp));
+  LONGS_EQUAL(0, fclose(fp));
+}
+#endif
+
+#endif
@@ -0,0 +1,121 @@
+/* This is file check-ChebyshevEphemeris.cc.
+
+   Copyright 2026 Louis Strous
+
+   This file is part of LUX.
+
+   LUX is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   LUX is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+   License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+/// A file providing CppUTest unit tests for the ChebyshevEphemeris
+/// class.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_LIBCPPUTEST
+#endif
+
+#if HAVE_LIBCPPUTEST
+
+# include <cmath>
+# include <cstdio>              // for tmpfile
+
+# include "ChebyshevEphemeris.hh"
+
+# include "CppUTest/TestHarness.h"
+
+TEST_GROUP(ChebyshevEphemerisTestGroup)
+{
+  int calls = 0;
+
+  // an orbit with a period of 365 days and some eccentricity
+  ChebyshevEphemeris::Function orbit = [this](double t) {
+    ++calls;
+    double m = 2*M_PI*t/365;
+    double e = 0.1*std::sin(m);
+    return ChebyshevEphemeris::Coords3{ std::cos(m + e), std::sin(m + e),
+                                        0.01*std::sin(2*m) };
+  };
+};
+
+TEST(ChebyshevEphemerisTestGroup, accuracy)
+{
+  // the rounding of Julian Day numbers limits the attainable accuracy
+  // to about 1e-11
+  ChebyshevEphemeris cache(16, 1e-10, 2451545);
+  double maxerr = 0;
+  for (double t = 2451545 - 40; t < 2451545 + 40; t += 0.37) {
+    ChebyshevEphemeris::Coords3 approx = cache(t, orbit);
+    int before = calls;
+    ChebyshevEphemeris::Coords3 exact = orbit(t);
+    calls = before;
+    for (int i = 0; i < 3; ++i)
+      maxerr = std::max(maxerr, std::abs(approx[i] - exact[i]));
+  }
+  CHECK_TRUE(maxerr < 2e-10);
+  CHECK_TRUE(cache.max_error() <= 1e-10);
+  LONGS_EQUAL(6, cache.size());  // from -48 to +48 days
+
+  // the function is not called for segments that are available
+  int before = calls;
+  cache(2451545 + 3, orbit);
+  LONGS_EQUAL(before, calls);
+  CHECK_TRUE(cache.has_segment(2451545 - 40));
+  CHECK_FALSE(cache.has_segment(2451545 + 100));
+}
+
+TEST(ChebyshevEphemerisTestGroup, unreachable_accuracy)
+{
+  // a segment much longer than the period needs a higher degree than
+  // allowed
+  ChebyshevEphemeris cache(5000, 1e-12);
+  cache(10, orbit);
+  CHECK_TRUE(cache.max_error() > 1e-12);
+}
+
+TEST(ChebyshevEphemerisTestGroup, file)
+{
+  ChebyshevEphemeris cache(16, 1e-12, 2451545);
+  ChebyshevEphemeris::Coords3 a = cache(2451550.5, orbit);
+  ChebyshevEphemeris::Coords3 b = cache(2451590.5, orbit);
+
+  FILE* fp = tmpfile();
+  CHECK_TRUE(cache.write(fp));
+  rewind(fp);
+  ChebyshevEphemeris copy;
+  CHECK_TRUE(copy.read(fp));
+  fclose(fp);
+
+  DOUBLES_EQUAL(16, copy.segment_length(), 0);
+  DOUBLES_EQUAL(1e-12, copy.accuracy(), 0);
+  LONGS_EQUAL(2, copy.size());
+  int before = calls;
+  ChebyshevEphemeris::Coords3 a2 = copy(2451550.5, orbit);
+  ChebyshevEphemeris::Coords3 b2 = copy(2451590.5, orbit);
+  LONGS_EQUAL(before, calls);
+  for (int i = 0; i < 3; ++i) {
+    DOUBLES_EQUAL(a[i], a2[i], 0);
+    DOUBLES_EQUAL(b[i], b2[i], 0);
+  }
+
+  // a damaged file is rejected and leaves the cache unchanged
+  fp = tmpfile();
+  fputs("LUXCHEB1 but not really", fp);
+  rewind(fp);
+  CHECK_FALSE(copy.read(fp));
+  fclose(fp);
+  LONGS_EQUAL(2, copy.size());
+}
+
+#endif
@@ -0,0 +1,102 @@
+/* This is file check-EpochCache.cc.
+
+   Copyright 2026 Louis Strous
+
+   This file is part of LUX.
+
+   LUX is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   LUX is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+   License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+/// A file providing CppUTest unit tests for the EpochCache class
+/// template.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_LIBCPPUTEST
+#endif
+
+#if HAVE_LIBCPPUTEST
+
+# include "EpochCache.hh"
+
+# include "CppUTest/TestHarness.h"
+
+TEST_GROUP(EpochCacheTestGroup)
+{
+  int calls = 0;
+
+  double
+  sum(double const* key)
+  {
+    ++calls;
+    return key[0] + 2*key[1];
+  }
+};
+
+TEST(EpochCacheTestGroup, hits)
+{
+  EpochCache<2, double> cache(16);
+  auto f = [this](double const* key) { return sum(key); };
+
+  DOUBLES_EQUAL(5, cache({1, 2}, f), 0);
+  DOUBLES_EQUAL(4, cache({2, 1}, f), 0);
+  LONGS_EQUAL(2, calls);
+  DOUBLES_EQUAL(5, cache({1, 2}, f), 0);
+  DOUBLES_EQUAL(4, cache({2, 1}, f), 0);
+  LONGS_EQUAL(2, calls);
+  LONGS_EQUAL(2, cache.hits());
+  LONGS_EQUAL(2, cache.misses());
+
+  // keys match only if they are exactly equal
+  cache({1, 2 + 1e-15}, f);
+  LONGS_EQUAL(3, calls);
+}
+
+TEST(EpochCacheTestGroup, bounded)
+{
+  EpochCache<1, double> cache(8);
+  auto f = [this](double const* key) { return sum(key - 1); };
+
+  // more keys than slots: the values remain correct
+  for (int i = 0; i < 100; ++i)
+    DOUBLES_EQUAL(2*i, cache({(double) i}, [this](double const* key) {
+      ++calls;
+      return 2*key[0];
+    }), 0);
+  LONGS_EQUAL(100, calls);
+  LONGS_EQUAL(8, cache.capacity());
+  (void) f;
+}
+
+TEST(EpochCacheTestGroup, disabled)
+{
+  EpochCache<2, double> cache;
+  auto f = [this](double const* key) { return sum(key); };
+
+  cache({1, 2}, f);
+  cache({1, 2}, f);
+  LONGS_EQUAL(2, calls);
+
+  cache.set_capacity(4);
+  cache({1, 2}, f);
+  cache({1, 2}, f);
+  LONGS_EQUAL(3, calls);
+
+  cache.clear();
+  LONGS_EQUAL(0, cache.hits());
+  cache({1, 2}, f);
+  LONGS_EQUAL(4, calls);
+}
+
+#endif
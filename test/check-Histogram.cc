@@ -0,0 +1,136 @@
+/* This is file check-Histogram.cc.
+
+   Copyright 2026 Louis Strous
+
+   This file is part of LUX.
+
+   LUX is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   LUX is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+   License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+/// A file providing CppUTest unit tests for the histogram functions.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_LIBCPPUTEST
+#endif
+
+#if HAVE_LIBCPPUTEST
+
+# include <cmath>
+# include <cstdint>
+# include <vector>
+
+# include "Histogram.hh"
+
+# include "CppUTest/TestHarness.h"
+
+TEST_GROUP(HistogramTestGroup)
+{
+  int32_t saved_nthreads = lux_nthreads;
+
+  void
+  teardown()
+  {
+    lux_nthreads = saved_nthreads;
+  }
+
+  // counts the values one by one
+  template<typename T>
+  std::vector<int32_t>
+  naive(std::vector<T> const& data, int32_t min, size_t nbins)
+  {
+    std::vector<int32_t> bins(nbins);
+    for (T x : data)
+      ++bins[histogram_index(x, min)];
+    return bins;
+  }
+
+  // counts the values using all threads
+  template<typename T>
+  std::vector<int32_t>
+  counted(std::vector<T> const& data, int32_t min, size_t nbins)
+  {
+    std::vector<int32_t> bins(nbins);
+    histogram(bins.data(), nbins, data.size(),
+              [&data, min](size_t begin, size_t end, int32_t* b) {
+                count_values(data.data() + begin, end - begin, min, b);
+              });
+    return bins;
+  }
+};
+
+TEST(HistogramTestGroup, index)
+{
+  LONGS_EQUAL(3, histogram_index((uint8_t) 3, 0));
+  LONGS_EQUAL(5, histogram_index((int16_t) -2, -7));
+  LONGS_EQUAL(2, histogram_index(2.9, 0));
+  LONGS_EQUAL(1, histogram_index(-1.5f, -3));
+}
+
+TEST(HistogramTestGroup, small_types)
+{
+  // enough values for the table-driven paths, and for several threads
+  size_t n = 1000003;
+  std::vector<uint8_t> bytes(n);
+  std::vector<int16_t> words(n);
+  for (size_t i = 0; i < n; ++i) {
+    bytes[i] = (i*i) % 251;
+    words[i] = (int16_t) ((i*7919) % 60000) - 30000;
+  }
+  lux_nthreads = 4;
+  CHECK_TRUE(naive(bytes, 0, 251) == counted(bytes, 0, 251));
+  CHECK_TRUE(naive(words, -30000, 60000) == counted(words, -30000, 60000));
+}
+
+TEST(HistogramTestGroup, threads)
+{
+  size_t n = 2000000;
+  std::vector<float> data(n);
+  std::vector<double> weights(n);
+  for (size_t i = 0; i < n; ++i) {
+    data[i] = 50 + 49*std::sin(i*0.001);
+    weights[i] = 1/(1.0 + i);
+  }
+  std::vector<int32_t> expect = naive(data, 0, 100);
+
+  std::vector<double> sums[2];
+  int32_t nthreads[] = { 1, 6 };
+  for (int j = 0; j < 2; ++j) {
+    lux_nthreads = nthreads[j];
+    CHECK_TRUE(expect == counted(data, 0, 100));
+    sums[j].resize(100);
+    histogram(sums[j].data(), 100, n,
+              [&](size_t begin, size_t end, double* b) {
+                sum_weights(data.data() + begin, weights.data() + begin,
+                            end - begin, 0, b);
+              });
+  }
+  // weighted sums do not depend on the number of threads
+  for (size_t k = 0; k < 100; ++k)
+    DOUBLES_EQUAL(sums[0][k], sums[1][k], 0);
+  double total = 0;
+  for (double s : sums[0])
+    total += s;
+  DOUBLES_EQUAL(std::log(n) + 0.5772156649, total, 1e-6);
+}
+
+TEST(HistogramTestGroup, few_values)
+{
+  // too few values per bin for private copies
+  std::vector<int32_t> data = { 5, 3, 5, 9, 0 };
+  LONGS_EQUAL(1, histogram_slices<int32_t>(10, data.size()));
+  CHECK_TRUE(naive(data, 0, 10) == counted(data, 0, 10));
+}
+
+#endif
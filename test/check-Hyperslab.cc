@@ -0,0 +1,111 @@
+/* This is file check-Hyperslab.cc.
+
+   Copyright 2026 Louis Strous
+
+   This file is part of LUX.
+
+   LUX is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   LUX is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+   License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+/// A file providing CppUTest unit tests for the Hyperslab class.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_LIBCPPUTEST
+#endif
+
+#if HAVE_LIBCPPUTEST
+
+# include <utility>
+# include <vector>
+
+# include "Hyperslab.hh"
+
+# include "CppUTest/TestHarness.h"
+
+TEST_GROUP(HyperslabTestGroup)
+{
+  typedef std::vector<std::pair<size_t, size_t>> Runs;
+
+  Runs
+  runs(Hyperslab const& slab)
+  {
+    Runs result;
+    slab.for_each_run([&result](size_t first, size_t n) {
+      result.emplace_back(first, n);
+    });
+    return result;
+  }
+};
+
+TEST(HyperslabTestGroup, whole)
+{
+  // everything is a single run
+  int32_t dims[] = { 7, 5, 4 };
+  Hyperslab slab(3, dims);
+  CHECK_TRUE(slab.valid());
+  LONGS_EQUAL(140, slab.size());
+  CHECK_TRUE(runs(slab) == Runs({ { 0, 140 } }));
+  LONGS_EQUAL(139, slab.last());
+}
+
+TEST(HyperslabTestGroup, planes)
+{
+  // whole planes merge into one run
+  int32_t dims[] = { 7, 5, 4 };
+  int32_t start[] = { 0, 0, 1 };
+  int32_t count[] = { 7, 5, 2 };
+  Hyperslab slab(3, dims, start, count);
+  CHECK_TRUE(runs(slab) == Runs({ { 35, 70 } }));
+}
+
+TEST(HyperslabTestGroup, box)
+{
+  // a box inside the cube, with one run per row
+  int32_t dims[] = { 7, 5, 4 };
+  int32_t start[] = { 2, 1, 1 };
+  int32_t count[] = { 3, 2, 2 };
+  Hyperslab slab(3, dims, start, count);
+  LONGS_EQUAL(12, slab.size());
+  LONGS_EQUAL(3, slab.count(0));
+  CHECK_TRUE(runs(slab) == Runs({ { 44, 3 }, { 51, 3 }, { 79, 3 },
+                                  { 86, 3 } }));
+  LONGS_EQUAL(88, slab.last());
+}
+
+TEST(HyperslabTestGroup, defaults)
+{
+  // counts of 0 or less extend to the end of the dimension
+  int32_t dims[] = { 7, 5 };
+  int32_t start[] = { 0, 3 };
+  int32_t count[] = { 0, -1 };
+  Hyperslab slab(2, dims, start, count);
+  LONGS_EQUAL(2, slab.count(1));
+  CHECK_TRUE(runs(slab) == Runs({ { 21, 14 } }));
+}
+
+TEST(HyperslabTestGroup, invalid)
+{
+  int32_t dims[] = { 7, 5 };
+  int32_t start[] = { 5, 0 };
+  int32_t count[] = { 3, 1 };
+  Hyperslab slab(2, dims, start, count);
+  CHECK_FALSE(slab.valid());
+  CHECK_TRUE(runs(slab).empty());
+
+  int32_t negative[] = { -1, 0 };
+  CHECK_FALSE(Hyperslab(2, dims, negative).valid());
+}
+
+#endif
@@ -0,0 +1,132 @@
+/* This is file check-LevenbergMarquardt.cc.
+
+   Copyright 2026 Louis Strous
+
+   This file is part of LUX.
+
+   LUX is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   LUX is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+   License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+/// A file providing CppUTest unit tests for the LevenbergMarquardt
+/// class.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_LIBCPPUTEST
+#endif
+
+#if HAVE_LIBCPPUTEST
+
+# include <cmath>               // for exp
+
+# include "LevenbergMarquardt.hh"
+
+# include "CppUTest/TestHarness.h"
+
+static const size_t n = 101;
+
+TEST_GROUP(LevenbergMarquardtTestGroup)
+{
+  double x[n];
+  double y[n];
+
+  void setup()
+  {
+    for (size_t i = 0; i < n; ++i) {
+      x[i] = 0.1*i - 5;
+      double arg = (x[i] - 0.5)/1.5;
+      y[i] = 1 + 3*exp(-arg*arg);
+    }
+  }
+
+  bool gaussian(double const* par, double* model)
+  {
+    for (size_t i = 0; i < n; ++i) {
+      double arg = (x[i] - par[2])/par[3];
+      model[i] = par[0] + par[1]*exp(-arg*arg);
+    }
+    return true;
+  }
+};
+
+TEST(LevenbergMarquardtTestGroup, FiniteDifferences)
+{
+  LevenbergMarquardt lm(4, n, y);
+  double par[4] = { 0, 1, 0, 1 };
+  auto model = [this](double const* p, double* m) { return gaussian(p, m); };
+  LONGS_EQUAL(LevenbergMarquardt::CONVERGED, lm.fit(model, nullptr, par));
+  DOUBLES_EQUAL(1, par[0], 1e-6);
+  DOUBLES_EQUAL(3, par[1], 1e-6);
+  DOUBLES_EQUAL(0.5, par[2], 1e-6);
+  DOUBLES_EQUAL(1.5, par[3], 1e-6);
+  DOUBLES_EQUAL(0, lm.chi2(), 1e-10);
+}
+
+TEST(LevenbergMarquardtTestGroup, ParallelFiniteDifferences)
+{
+  LevenbergMarquardt lm(4, n, y);
+  lm.set_parallel(true);
+  double par[4] = { 0, 1, 0, 1 };
+  auto model = [this](double const* p, double* m) { return gaussian(p, m); };
+  LONGS_EQUAL(LevenbergMarquardt::CONVERGED, lm.fit(model, nullptr, par));
+  DOUBLES_EQUAL(3, par[1], 1e-6);
+  DOUBLES_EQUAL(1.5, par[3], 1e-6);
+}
+
+TEST(LevenbergMarquardtTestGroup, FiniteDifferenceStepAtZero)
+{
+  // the model values are large compared to the effect of a parameter
+  // that starts at zero, so a purely relative step would be lost in
+  // rounding
+  double offset[n];
+  for (size_t i = 0; i < n; ++i)
+    offset[i] = 1e6 + 2*x[i];
+  LevenbergMarquardt lm(1, n, offset);
+  double par[1] = { 0 };
+  auto model = [this](double const* p, double* m) {
+    for (size_t i = 0; i < n; ++i)
+      m[i] = 1e6 + p[0]*x[i];
+    return true;
+  };
+  LONGS_EQUAL(LevenbergMarquardt::CONVERGED, lm.fit(model, nullptr, par));
+  DOUBLES_EQUAL(2, par[0], 1e-6);
+}
+
+TEST(LevenbergMarquardtTestGroup, FixedAndBounded)
+{
+  LevenbergMarquardt lm(4, n, y);
+  double step[4] = { 1, 1, 0, 1 };
+  double lowbound[4] = { -10, -10, -10, 2 };
+  lm.set_steps(step);
+  lm.set_bounds(lowbound, nullptr);
+  double par[4] = { 0, 1, 0.25, 3 };
+  auto model = [this](double const* p, double* m) { return gaussian(p, m); };
+  lm.fit(model, nullptr, par);
+  DOUBLES_EQUAL(0.25, par[2], 0); // held fixed
+  CHECK(par[3] >= 2);           // bounded
+  double err[4];
+  CHECK(lm.errors(err));
+  DOUBLES_EQUAL(0, err[2], 0);
+  CHECK(err[0] > 0);
+}
+
+TEST(LevenbergMarquardtTestGroup, ModelFailure)
+{
+  LevenbergMarquardt lm(4, n, y);
+  double par[4] = { 0, 1, 0, 1 };
+  auto model = [](double const*, double*) { return false; };
+  LONGS_EQUAL(LevenbergMarquardt::MODEL_FAILED, lm.fit(model, nullptr, par));
+}
+
+#endif
@@ -0,0 +1,115 @@
+/* This is file check-MatrixProduct.cc.
+
+   Copyright 2026 Louis Strous
+
+   This file is part of LUX.
+
+   LUX is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   LUX is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+   License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+/// A file providing CppUTest unit tests for matrix_product().
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_LIBCPPUTEST
+#endif
+
+#if HAVE_LIBCPPUTEST
+
+# include <cmath>
+# include <cstdint>
+# include <vector>
+
+# include "MatrixProduct.hh"
+# include "Parallel.hh"
+
+# include "CppUTest/TestHarness.h"
+
+TEST_GROUP(MatrixProductTestGroup)
+{
+  int32_t saved_nthreads = lux_nthreads;
+
+  void
+  teardown()
+  {
+    lux_nthreads = saved_nthreads;
+  }
+
+  // fills a vector with small integers, so that the products are exact
+  template<typename T>
+  std::vector<T>
+  values(size_t n, int seed)
+  {
+    std::vector<T> result(n);
+    for (size_t i = 0; i < n; ++i)
+      result[i] = (int) ((i*7 + seed*13) % 11) - 5;
+    return result;
+  }
+
+  // checks matrix_product() against the definition
+  template<typename T>
+  void
+  check(size_t m, size_t k, size_t n, size_t na, size_t nb, bool outer)
+  {
+    auto a = values<T>(m*k*na, 1);
+    auto b = values<T>(k*n*nb, 2);
+    size_t npairs = outer? na*nb: na;
+    std::vector<T> c(m*n*npairs, -99);
+    matrix_product(a.data(), b.data(), c.data(), m, k, n, na, nb, outer);
+    for (size_t pair = 0; pair < npairs; ++pair) {
+      T const* ai = a.data() + (outer? pair % na: pair)*m*k;
+      T const* bi = b.data() + (outer? pair/na: pair)*k*n;
+      T const* ci = c.data() + pair*m*n;
+      for (size_t r = 0; r < m; ++r)
+        for (size_t j = 0; j < n; ++j) {
+          T sum = 0;
+          for (size_t p = 0; p < k; ++p)
+            sum += ai[r + p*m]*bi[p + j*k];
+          DOUBLES_EQUAL(sum, ci[r + j*m], 0);
+        }
+    }
+  }
+};
+
+TEST(MatrixProductTestGroup, small)
+{
+  check<double>(2, 3, 4, 1, 1, false);
+  check<double>(3, 3, 3, 10, 10, false);
+  check<float>(9, 5, 2, 3, 3, false);
+}
+
+TEST(MatrixProductTestGroup, blocked)
+{
+  // sizes that are not multiples of the block sizes
+  check<double>(101, 300, 37, 1, 1, false);
+  check<float>(211, 259, 45, 2, 2, false);
+  check<double>(5, 1000, 13, 1, 1, false);
+}
+
+TEST(MatrixProductTestGroup, outer)
+{
+  check<double>(3, 2, 4, 3, 2, true);
+  check<float>(40, 40, 40, 2, 3, true);
+}
+
+TEST(MatrixProductTestGroup, threads)
+{
+  // a single product split across threads, and a stack of products
+  lux_nthreads = 4;
+  check<double>(130, 70, 150, 1, 1, false);
+  check<float>(64, 64, 64, 5, 5, false);
+  check<double>(50, 50, 50, 2, 3, true);
+}
+
+#endif
@@ -0,0 +1,115 @@
+/* This is file check-PathIndex.cc.
+
+   Copyright 2026 Louis Strous
+
+   This file is part of LUX.
+
+   LUX is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   LUX is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+   License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+/// A file providing CppUTest unit tests for the PathIndex class.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_LIBCPPUTEST
+#endif
+
+#if HAVE_LIBCPPUTEST
+
+# include <cstdio>              // for fopen, fclose, remove
+# include <cstdlib>             // for mkdtemp
+# include <unistd.h>            // for rmdir
+
+# include "PathIndex.hh"
+
+# include "CppUTest/TestHarness.h"
+
+TEST_GROUP(PathIndexTestGroup)
+{
+  std::string dir1;
+  std::string dir2;
+
+  std::string make_directory()
+  {
+    char name[] = "/tmp/luxpathindexXXXXXX";
+    return mkdtemp(name);
+  }
+
+  void touch(std::string const& dir, char const* name)
+  {
+    FILE* fp = fopen((dir + "/" + name).c_str(), "w");
+    fclose(fp);
+  }
+
+  void setup()
+  {
+    dir1 = make_directory();
+    dir2 = make_directory();
+    touch(dir1, "alpha.lux");
+    touch(dir2, "alpha.lux");
+    touch(dir2, "beta_f.lux");
+  }
+
+  void teardown()
+  {
+    for (auto name : { "alpha.lux", "beta_f.lux", "gamma.lux" }) {
+      remove((dir1 + "/" + name).c_str());
+      remove((dir2 + "/" + name).c_str());
+    }
+    rmdir(dir1.c_str());
+    rmdir(dir2.c_str());
+  }
+};
+
+TEST(PathIndexTestGroup, first_directory_wins)
+{
+  PathIndex index;
+  CHECK_TRUE(index.set_directories({ dir1, dir2 }));
+  CHECK_FALSE(index.set_directories({ dir1, dir2 }));
+
+  size_t directory, name;
+  CHECK_TRUE(index.locate({ "alpha.lux" }, directory, name));
+  LONGS_EQUAL(0, directory);
+  LONGS_EQUAL(0, name);
+  CHECK_TRUE(index.locate({ "beta.lux", "beta_f.lux" }, directory, name));
+  LONGS_EQUAL(1, directory);
+  LONGS_EQUAL(1, name);
+  CHECK_FALSE(index.locate({ "gamma.lux" }, directory, name));
+}
+
+TEST(PathIndexTestGroup, missing_directory)
+{
+  PathIndex index;
+  index.set_directories({ dir1 + "/nonexistent", dir2 });
+
+  size_t directory, name;
+  CHECK_TRUE(index.locate({ "alpha.lux" }, directory, name));
+  LONGS_EQUAL(1, directory);
+}
+
+TEST(PathIndexTestGroup, refresh)
+{
+  PathIndex index;
+  index.set_directories({ dir1, dir2 });
+  CHECK_FALSE(index.refresh());
+
+  touch(dir1, "gamma.lux");
+  size_t directory, name;
+  CHECK_FALSE(index.locate({ "gamma.lux" }, directory, name));
+  CHECK_TRUE(index.refresh());
+  CHECK_TRUE(index.locate({ "gamma.lux" }, directory, name));
+  LONGS_EQUAL(0, directory);
+}
+
+#endif
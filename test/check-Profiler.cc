@@ -0,0 +1,142 @@
+/* This is file check-Profiler.cc.
+
+   Copyright 2026 Louis Strous
+
+   This file is part of LUX.
+
+   LUX is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   LUX is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+   License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+/// A file providing CppUTest unit tests for the Profiler class.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_LIBCPPUTEST
+#endif
+
+#if HAVE_LIBCPPUTEST
+
+# include <cstdio>              // for tmpfile, fgets
+# include <string>
+
+# include "Profiler.hh"
+
+# include "CppUTest/TestHarness.h"
+
+TEST_GROUP(ProfilerTestGroup)
+{
+  Profiler profiler;
+
+  // keeps the profiler busy for about the indicated number of seconds
+  void spin(double seconds)
+  {
+    double end = profiler.now().wall + seconds;
+    while (profiler.now().wall < end)
+      ;
+  }
+
+  Profiler::Statistics find(char const* name)
+  {
+    for (auto const& s : profiler.routines())
+      if (s.name == name)
+        return s;
+    return Profiler::Statistics();
+  }
+};
+
+TEST(ProfilerTestGroup, call_tree)
+{
+  profiler.start();
+  size_t a = profiler.enter(Profiler::USER, 1, "A");
+  spin(0.001);
+  for (int i = 0; i < 2; ++i) {
+    size_t b = profiler.enter(Profiler::FUNCTION, 1, "B");
+    spin(0.001);
+    profiler.leave(b);
+  }
+  profiler.leave(a);
+  profiler.stop();
+
+  Profiler::Statistics sa = find("A");
+  Profiler::Statistics sb = find("B");
+  LONGS_EQUAL(1, sa.calls);
+  LONGS_EQUAL(2, sb.calls);
+  CHECK_TRUE(sa.wall >= sa.self_wall + sb.wall - 1e-9);
+  CHECK_TRUE(sb.wall > 0.0019);
+
+  FILE* fp = tmpfile();
+  CHECK_TRUE(profiler.write_collapsed(fp));
+  rewind(fp);
+  char line[80];
+  std::string text;
+  while (fgets(line, sizeof(line), fp))
+    text += line;
+  fclose(fp);
+  CHECK_TRUE(text.find("A ") == 0);
+  CHECK_TRUE(text.find("\nA;B ") != std::string::npos);
+}
+
+TEST(ProfilerTestGroup, recursion)
+{
+  profiler.start();
+  size_t depth = profiler.enter(Profiler::USER, 1, "A");
+  profiler.enter(Profiler::USER, 1, "A");
+  profiler.enter(Profiler::USER, 1, "A");
+  spin(0.002);
+  profiler.leave(depth);        // leaves all three
+  profiler.stop();
+
+  Profiler::Statistics sa = find("A");
+  LONGS_EQUAL(3, sa.calls);
+  // the time of the recursive calls is counted once
+  CHECK_TRUE(sa.wall < 0.004);
+  DOUBLES_EQUAL(sa.wall, sa.self_wall, 1e-9);
+}
+
+TEST(ProfilerTestGroup, inactive)
+{
+  size_t depth = profiler.enter(Profiler::USER, 1, "A");
+  profiler.leave(depth);
+  CHECK_TRUE(profiler.routines().empty());
+
+  profiler.start();
+  depth = profiler.enter(Profiler::USER, 1, "A");
+  profiler.stop();              // leaves A
+  LONGS_EQUAL(1, find("A").calls);
+  profiler.reset();
+  CHECK_TRUE(profiler.routines().empty());
+}
+
+TEST(ProfilerTestGroup, lines)
+{
+  profiler.start();
+  for (int i = 0; i < 3; ++i) {
+    Profiler::Moment start = profiler.now();
+    profiler.line(5, "FOO", 12, start);
+  }
+  Profiler::Moment start = profiler.now();
+  spin(0.001);
+  profiler.line(5, "FOO", 13, start);
+  profiler.stop();
+
+  std::vector<Profiler::LineStatistics> lines = profiler.lines();
+  LONGS_EQUAL(2, lines.size());
+  LONGS_EQUAL(13, lines[0].line);
+  LONGS_EQUAL(1, lines[0].count);
+  LONGS_EQUAL(12, lines[1].line);
+  LONGS_EQUAL(3, lines[1].count);
+  CHECK_TRUE(lines[1].context == "FOO");
+}
+
+#endif
@@ -0,0 +1,274 @@
+/* This is file check-Reduction.cc.
+
+   Copyright 2026 Louis Strous
+
+   This file is part of LUX.
+
+   LUX is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   LUX is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+   License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+/// A file providing CppUTest unit tests for the ReductionShape class and
+/// its helpers.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_LIBCPPUTEST
+#endif
+
+#if HAVE_LIBCPPUTEST
+
+# include <algorithm>
+# include <cmath>
+# include <vector>
+
+# include "Reduction.hh"
+
+# include "CppUTest/TestHarness.h"
+
+TEST_GROUP(ReductionTestGroup)
+{
+  int32_t saved_nthreads = lux_nthreads;
+
+  void
+  teardown()
+  {
+    lux_nthreads = saved_nthreads;
+  }
+
+  // the sums along the leading naxes dimensions, added one by one
+  std::vector<double>
+  naive(int32_t ndim, int32_t const* dims, int32_t const* steps,
+        int32_t naxes, std::vector<double> const& data)
+  {
+    ReductionShape shape(ndim, dims, steps, naxes);
+    std::vector<double> result(shape.outputs());
+    for (size_t k = 0; k < shape.outputs(); ++k) {
+      for (size_t e = 0; e < shape.length(); ++e) {
+        size_t rest = e;
+        ptrdiff_t offset = shape.offset(k);
+        for (int32_t i = 0; i < naxes; ++i) {
+          offset += (rest % dims[i])*steps[i];
+          rest /= dims[i];
+        }
+        result[k] += data[offset];
+      }
+    }
+    return result;
+  }
+};
+
+TEST(ReductionTestGroup, layouts)
+{
+  // a 3 by 4 by 5 array, summed along various dimensions
+  std::vector<double> data(60);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = i*i;
+
+  struct Layout
+  {
+    int32_t dims[3];
+    int32_t steps[3];
+    int32_t naxes;
+  } layouts[] = {
+    { { 3, 4, 5 }, { 1, 3, 12 }, 1 },  // along dimension 0
+    { { 4, 3, 5 }, { 3, 1, 12 }, 1 },  // along dimension 1
+    { { 5, 3, 4 }, { 12, 1, 3 }, 1 },  // along dimension 2
+    { { 3, 5, 4 }, { 1, 12, 3 }, 2 },  // along dimensions 0 and 2
+    { { 3, 4, 5 }, { 1, 3, 12 }, 3 },  // along all dimensions
+  };
+  for (auto const& layout : layouts) {
+    ReductionShape shape(3, layout.dims, layout.steps, layout.naxes);
+    std::vector<double> expect
+      = naive(3, layout.dims, layout.steps, layout.naxes, data);
+    LONGS_EQUAL(60, shape.outputs()*shape.length());
+    for (size_t k = 0; k < shape.outputs(); ++k)
+      DOUBLES_EQUAL(expect[k],
+                    shape.reduce<double>(k, [&data](ptrdiff_t i) {
+                      return data[i];
+                    }), 0);
+  }
+}
+
+TEST(ReductionTestGroup, weighted)
+{
+  int32_t dims[] = { 10, 2 };
+  int32_t steps[] = { 1, 10 };
+  ReductionShape shape(2, dims, steps, 1);
+  typedef WeightedSum<double> Sum;
+  for (size_t k = 0; k < 2; ++k) {
+    Sum sum = shape.reduce<Sum>(k, [](ptrdiff_t i) {
+      return Sum{ 2.0*i, 2.0 };
+    });
+    DOUBLES_EQUAL(k? 290: 90, sum.sum, 0);
+    DOUBLES_EQUAL(20, sum.weight, 0);
+  }
+}
+
+TEST(ReductionTestGroup, accuracy_and_threads)
+{
+  // many values with a large dynamic range, in several blocks
+  size_t n = 1000003;
+  std::vector<double> data(n);
+  long double exact = 0;
+  double naive = 0, magnitude = 0;
+  for (size_t i = 0; i < n; ++i) {
+    data[i] = std::sin(i*0.1)*std::pow(10.0, (double) (i % 17) - 8);
+    exact += data[i];
+    naive += data[i];
+    magnitude += std::abs(data[i]);
+  }
+  int32_t dims[] = { (int32_t) n };
+  int32_t steps[] = { 1 };
+  ReductionShape shape(1, dims, steps, 1);
+  auto value = [&data](ptrdiff_t i) { return data[i]; };
+
+  lux_nthreads = 1;
+  double one = shape.reduce<double>(0, value);
+  lux_nthreads = 3;
+  double three = shape.reduce<double>(0, value);
+  lux_nthreads = 8;
+  double eight = shape.reduce<double>(0, value);
+
+  // the result does not depend on the number of threads at all
+  DOUBLES_EQUAL(one, three, 0);
+  DOUBLES_EQUAL(one, eight, 0);
+  // and is much more accurate than adding the values one by one
+  double error = std::abs(one - (double) exact);
+  CHECK_TRUE(error < 1e-17*magnitude);
+  CHECK_TRUE(error < 0.1*std::abs(naive - (double) exact));
+}
+
+TEST(ReductionTestGroup, many_outputs)
+{
+  // enough outputs to spread them over threads
+  int32_t dims[] = { 100, 3000 };
+  int32_t steps[] = { 3000, 1 };
+  std::vector<double> data(300000);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = 1.0/(i + 1);
+
+  std::vector<double> results[2];
+  int32_t nthreads[] = { 1, 4 };
+  for (int j = 0; j < 2; ++j) {
+    lux_nthreads = nthreads[j];
+    ReductionShape shape(2, dims, steps, 1);
+    results[j].resize(shape.outputs());
+    shape.for_each_output([&](size_t k) {
+      results[j][k] = shape.reduce<double>(k, [&data](ptrdiff_t i) {
+        return data[i];
+      });
+    });
+  }
+  for (size_t k = 0; k < results[0].size(); ++k) {
+    DOUBLES_EQUAL(results[0][k], results[1][k], 0);
+    double expect = 0;
+    for (size_t i = 0; i < 100; ++i)
+      expect += data[i*3000 + k];
+    DOUBLES_EQUAL(expect, results[0][k], 1e-14*expect);
+  }
+}
+
+TEST(ReductionTestGroup, moments)
+{
+  std::vector<double> data(2500);
+  double sum = 0;
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = 1e6 + std::sin(i*0.7);
+    sum += data[i];
+  }
+  double mean = sum/data.size();
+  double m2 = 0;
+  for (double x : data)
+    m2 += (x - mean)*(x - mean);
+
+  Moments whole = Moments::of(data.data(), data.size());
+  Moments left = Moments::of(data.data(), 1001);
+  Moments right = Moments::of(data.data() + 1001, data.size() - 1001);
+  Moments combined = left + right;
+  for (Moments const& m : { whole, combined }) {
+    DOUBLES_EQUAL(2500, m.count, 0);
+    DOUBLES_EQUAL(*std::min_element(data.begin(), data.end()), m.min, 0);
+    DOUBLES_EQUAL(*std::max_element(data.begin(), data.end()), m.max, 0);
+    DOUBLES_EQUAL(mean, m.mean, 1e-9);
+    DOUBLES_EQUAL(m2, m.m2, 1e-9*m2);
+  }
+
+  // empty sets change nothing
+  Moments empty;
+  DOUBLES_EQUAL(whole.mean, (empty + whole).mean, 0);
+  DOUBLES_EQUAL(whole.m2, (whole + empty).m2, 0);
+
+  // NaN spreads
+  data[3] = NAN;
+  Moments nan = Moments::of(data.data(), 10) + left;
+  CHECK_TRUE(std::isnan(nan.min));
+  CHECK_TRUE(std::isnan(nan.mean));
+  DOUBLES_EQUAL(1011, nan.count, 0);
+}
+
+TEST(ReductionTestGroup, stream)
+{
+  // a stream gives the same result as a pairwise combination of the same
+  // values
+  PairwiseStream<double> stream;
+  DOUBLES_EQUAL(0, stream.result(), 0);
+  double sum = 0;
+  for (int i = 1; i <= 1000; ++i) {
+    stream.add(i);
+    sum += i;
+  }
+  DOUBLES_EQUAL(sum, stream.result(), 0);
+
+  // and with moments
+  std::vector<double> data(10000);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = std::cos(i*1.3);
+  PairwiseStream<Moments> moments;
+  for (size_t i = 0; i < data.size(); i += 1000)
+    moments.add(Moments::of(data.data() + i, 1000));
+  Moments whole = Moments::of(data.data(), data.size());
+  Moments streamed = moments.result();
+  DOUBLES_EQUAL(whole.count, streamed.count, 0);
+  DOUBLES_EQUAL(whole.mean, streamed.mean, 1e-15);
+  DOUBLES_EQUAL(whole.m2, streamed.m2, 1e-12*whole.m2);
+}
+
+TEST(ReductionTestGroup, reduce_blocks)
+{
+  // blocks span at most block_size values, and runs cover them exactly
+  int32_t dims[] = { 700, 5, 3 };
+  int32_t steps[] = { 1, 700, 3500 };
+  ReductionShape shape(3, dims, steps, 2);
+  std::vector<int> visits(10500);
+  for (size_t k = 0; k < shape.outputs(); ++k) {
+    size_t total = shape.reduce_blocks<size_t>(k, [&](size_t output,
+                                                      size_t begin,
+                                                      size_t end) {
+      CHECK_TRUE(end - begin <= ReductionShape::block_size);
+      size_t count = 0;
+      shape.for_each_run(output, begin, end,
+                         [&](ptrdiff_t offset, ptrdiff_t step, size_t n) {
+                           for (size_t i = 0; i < n; ++i)
+                             ++visits[offset + i*step];
+                           count += n;
+                         });
+      return count;
+    });
+    LONGS_EQUAL(3500, total);
+  }
+  for (int v : visits)
+    LONGS_EQUAL(1, v);
+}
+
+#endif
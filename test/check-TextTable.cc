@@ -0,0 +1,173 @@
+/* This is file check-TextTable.cc.
+
+   Copyright 2026 Louis Strous
+
+   This file is part of LUX.
+
+   LUX is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   LUX is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+   License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+/// A file providing CppUTest unit tests for the TextTable class.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_LIBCPPUTEST
+#endif
+
+#if HAVE_LIBCPPUTEST
+
+# include <cmath>
+# include <cstdint>
+# include <string>
+# include <vector>
+
+# include "TextTable.hh"
+
+# include "CppUTest/TestHarness.h"
+
+TEST_GROUP(TextTableTestGroup)
+{
+  int32_t saved_nthreads = lux_nthreads;
+
+  void
+  teardown()
+  {
+    lux_nthreads = saved_nthreads;
+  }
+
+  // reads a column as doubles
+  std::vector<double>
+  column(TextTable const& table, size_t c)
+  {
+    std::vector<double> values(table.rows());
+    TextTable::Target target = { values.data(), TextTable::Double, 1 };
+    table.read(&c, &target, 1);
+    return values;
+  }
+};
+
+TEST(TextTableTestGroup, fields)
+{
+  std::vector<std::string> fields;
+  auto collect = [&fields](size_t, char const* b, char const* e) {
+    fields.emplace_back(b, e);
+  };
+  std::string line = "  1, 2 ;3\t4,, 5 ,";
+  LONGS_EQUAL(7, TextTable::for_each_field(line.data(),
+                                           line.data() + line.size(),
+                                           collect));
+  CHECK_TRUE(fields == std::vector<std::string>({ "1", "2", "3", "4", "",
+                                                  "5", "" }));
+}
+
+TEST(TextTableTestGroup, classify)
+{
+  auto kind = [](std::string const& s) {
+    return TextTable::classify(s.data(), s.data() + s.size());
+  };
+  LONGS_EQUAL(TextTable::Int32, kind("123"));
+  LONGS_EQUAL(TextTable::Int32, kind("-2147483648"));
+  LONGS_EQUAL(TextTable::Int64, kind("2147483648"));
+  LONGS_EQUAL(TextTable::Int64, kind("+9223372036854775807"));
+  LONGS_EQUAL(TextTable::Double, kind("9223372036854775808"));
+  LONGS_EQUAL(TextTable::Double, kind("1.5"));
+  LONGS_EQUAL(TextTable::Double, kind("1e3"));
+  LONGS_EQUAL(TextTable::Double, kind(""));
+  LONGS_EQUAL(TextTable::Double, kind("-"));
+}
+
+TEST(TextTableTestGroup, table)
+{
+  std::string text =
+    "time,count,value\n"
+    "# a comment\n"
+    "1, 10, 0.5\r\n"
+    "\n"
+    "2, 3000000000, -1e-3\n"
+    "3, 7\n";
+  TextTable table(text.data(), text.size(), 1);
+  LONGS_EQUAL(3, table.rows());
+  LONGS_EQUAL(3, table.columns());
+  LONGS_EQUAL(TextTable::Int32, table.kind(0));
+  LONGS_EQUAL(TextTable::Int64, table.kind(1));
+  LONGS_EQUAL(TextTable::Double, table.kind(2)); // short last row
+
+  std::vector<int32_t> time(3);
+  std::vector<int64_t> count(3);
+  size_t columns[] = { 0, 1 };
+  TextTable::Target targets[] = { { time.data(), TextTable::Int32, 1 },
+                                  { count.data(), TextTable::Int64, 1 } };
+  table.read(columns, targets, 2);
+  CHECK_TRUE(time == std::vector<int32_t>({ 1, 2, 3 }));
+  CHECK_TRUE(count == std::vector<int64_t>({ 10, 3000000000, 7 }));
+
+  std::vector<double> value = column(table, 2);
+  DOUBLES_EQUAL(0.5, value[0], 0);
+  DOUBLES_EQUAL(-1e-3, value[1], 0);
+  CHECK_TRUE(std::isnan(value[2]));
+
+  // limit the number of rows
+  TextTable two(text.data(), text.size(), 1, 2);
+  LONGS_EQUAL(2, two.rows());
+  LONGS_EQUAL(TextTable::Double, two.kind(2));
+}
+
+TEST(TextTableTestGroup, repeated_column)
+{
+  // a column that is selected twice fills both targets, also in short
+  // rows
+  std::string text = "1 2\n3 4\n5\n";
+  TextTable table(text.data(), text.size());
+  std::vector<double> values(6, -7);
+  size_t columns[] = { 1, 1 };
+  TextTable::Target targets[] = { { values.data(), TextTable::Double, 2 },
+                                  { values.data() + 1, TextTable::Double,
+                                    2 } };
+  table.read(columns, targets, 2);
+  DOUBLES_EQUAL(2, values[0], 0);
+  DOUBLES_EQUAL(2, values[1], 0);
+  DOUBLES_EQUAL(4, values[2], 0);
+  DOUBLES_EQUAL(4, values[3], 0);
+  CHECK_TRUE(std::isnan(values[4]));
+  CHECK_TRUE(std::isnan(values[5]));
+}
+
+TEST(TextTableTestGroup, threads)
+{
+  // enough text for several chunks
+  std::string text;
+  size_t n = 200000;
+  for (size_t i = 0; i < n; ++i)
+    text += std::to_string(i) + " " + std::to_string(i*0.25) + "\n";
+
+  lux_nthreads = 5;
+  TextTable table(text.data(), text.size());
+  LONGS_EQUAL(n, table.rows());
+  LONGS_EQUAL(TextTable::Int32, table.kind(0));
+  LONGS_EQUAL(TextTable::Double, table.kind(1));
+
+  // both columns into one interleaved array
+  std::vector<double> values(2*n);
+  size_t columns[] = { 0, 1 };
+  TextTable::Target targets[] = { { values.data(), TextTable::Double, 2 },
+                                  { values.data() + 1, TextTable::Double,
+                                    2 } };
+  table.read(columns, targets, 2);
+  for (size_t i = 0; i < n; ++i) {
+    DOUBLES_EQUAL(i, values[2*i], 0);
+    DOUBLES_EQUAL(i*0.25, values[2*i + 1], 0);
+  }
+}
+
+#endif
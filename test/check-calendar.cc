@@ -0,0 +1,117 @@
+/* This is file check-calendar.cc.
+
+   Copyright 2026 Louis Strous
+
+   This file is part of LUX.
+
+   LUX is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   LUX is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+   License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file
+/// A file providing CppUTest unit tests for the Gregorian and Julian
+/// calendar translations.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"            // for HAVE_LIBCPPUTEST
+#endif
+
+#if HAVE_LIBCPPUTEST
+
+# include <cstdint>
+
+# include "calendar.hh"
+
+# include "CppUTest/TestHarness.h"
+
+TEST_GROUP(calendar)
+{
+};
+
+TEST(calendar, known_dates)
+{
+  int32_t year, month, day;
+
+  LONGS_EQUAL(2451545, GregoriantoCJDN(2000, 1, 1));
+  LONGS_EQUAL(2299161, GregoriantoCJDN(1582, 10, 15));
+  LONGS_EQUAL(2299160, JuliantoCJDN(1582, 10, 4));
+  LONGS_EQUAL(0, JuliantoCJDN(-4712, 1, 1));
+
+  CJDNtoGregorian(2451604, &year, &month, &day);
+  LONGS_EQUAL(2000, year);
+  LONGS_EQUAL(2, month);
+  LONGS_EQUAL(29, day);
+
+  CJDNtoJulian(0, &year, &month, &day);
+  LONGS_EQUAL(-4712, year);
+  LONGS_EQUAL(1, month);
+  LONGS_EQUAL(1, day);
+}
+
+TEST(calendar, months_out_of_range)
+{
+  // month numbers beyond 1-12 carry into the year
+  LONGS_EQUAL(GregoriantoCJDN(1999, 3, 1), GregoriantoCJDN(2000, -9, 1));
+  LONGS_EQUAL(GregoriantoCJDN(2001, 5, 43), GregoriantoCJDN(2000, 17, 43));
+  LONGS_EQUAL(JuliantoCJDN(-101, 12, 1), JuliantoCJDN(-100, 0, 1));
+  // -400 is a leap year, -100 is not
+  LONGS_EQUAL(GregoriantoCJDN(-400, 3, 1) - 1, GregoriantoCJDN(-400, 2, 29));
+  LONGS_EQUAL(GregoriantoCJDN(-100, 3, 1), GregoriantoCJDN(-100, 2, 29));
+}
+
+TEST(calendar, round_trip)
+{
+  int32_t year, month, day;
+
+  for (int32_t CJDN = -2000000; CJDN < 4000000; CJDN += 13) {
+    CJDNtoGregorian(CJDN, &year, &month, &day);
+    CHECK_TRUE(month >= 1 && month <= 12);
+    CHECK_TRUE(day >= 1 && day <= 31);
+    LONGS_EQUAL(CJDN, GregoriantoCJDN(year, month, day));
+    CJDNtoJulian(CJDN, &year, &month, &day);
+    LONGS_EQUAL(CJDN, JuliantoCJDN(year, month, day));
+  }
+  for (int32_t CJDN : { INT32_MAX, INT32_MIN + 2000000 }) {
+    CJDNtoGregorian(CJDN, &year, &month, &day);
+    LONGS_EQUAL(CJDN, GregoriantoCJDN(year, month, day));
+    CJDNtoJulian(CJDN, &year, &month, &day);
+    LONGS_EQUAL(CJDN, JuliantoCJDN(year, month, day));
+  }
+}
+
+TEST(calendar, text)
+{
+  LONGS_EQUAL(2457465, GregorianStoCJDN("17 March 2016"));
+  LONGS_EQUAL(2457420, GregorianStoCJDN("1 february 2016"));
+  LONGS_EQUAL(2457465, GregorianStoCJDN("2016-03-17"));
+  LONGS_EQUAL(2457465, CommonStoCJDN(" 2016-03-17T23:59:59Z "));
+  LONGS_EQUAL(2457464, GregorianStoCJDN("2016-03-17T00:30+01:00"));
+  LONGS_EQUAL(1705426, JulianStoCJDN("-0043-03-15"));
+  LONGS_EQUAL(0, GregorianStoCJDN("2016-03-17T"));
+  LONGS_EQUAL(0, GregorianStoCJDN("17 Foo 2016"));
+
+  DOUBLES_EQUAL(2457465.5, GregorianStoCJD("2016-03-17T12:00:00"), 1e-9);
+  DOUBLES_EQUAL(2457465.25 + 1.5/86400,
+                GregorianStoCJD("2016-03-17 07:00:01.5+01:00"), 1e-9);
+
+  char const *text = "2016-03-17T18:00Z";
+  char * const *texts = const_cast<char * const *>(&text);
+  int32_t CJDN;
+  double CJD;
+  GregorianStoCJDNA(texts, &CJDN);
+  LONGS_EQUAL(2457465, CJDN);
+  GregorianStoCJDA(texts, &CJD);
+  DOUBLES_EQUAL(2457465.75, CJD, 1e-9);
+}
+
+#endif
@@ -0,0 +1,125 @@
+/* This is file check-files.cc.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cppunit/extensions/HelperMacros.h>
+#include <stdio.h>              // for fprintf, fopen, fgets
+#include <stdlib.h>             // for mkstemp, exit
+#include <string.h>             // for strcpy, strlen
+#include <sys/wait.h>           // for waitpid
+#include <unistd.h>             // for close, fork, unlink
+#include <string>
+
+#include "config.h"
+#include "luxparser.hh"
+#include "action.hh"
+#include "Arena.hh"
+
+class FilesTest
+  : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE(FilesTest);
+  CPPUNIT_TEST(async_exit);
+  CPPUNIT_TEST(sprintf_text);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void async_exit();
+  void sprintf_text();
+};
+
+int32_t lux_fstring(int32_t, int32_t []);
+int32_t lux_openw(int32_t, int32_t []);
+
+/* Writes to a lun opened with /ASYNC in a child process that exits
+   without closing the lun, and checks that all data reached the
+   file. */
+void
+FilesTest::async_exit()
+{
+  int32_t const nlines = 200000;
+
+  char name[] = "/tmp/check-files-XXXXXX";
+  int fd = mkstemp(name);
+  CPPUNIT_ASSERT(fd >= 0);
+  close(fd);
+
+  fflush(NULL);                 // or the child writes them again
+  pid_t pid = fork();
+  CPPUNIT_ASSERT(pid >= 0);
+  if (!pid) {
+    // OPENW, 3, name, /ASYNC
+    int32_t lun = scalar_scratch(LUX_INT32);
+    scalar_value(lun).i32 = 3;
+    int32_t file = string_scratch(strlen(name));
+    strcpy(string_value(file), name);
+    int32_t ps[3] = { LUX_ONE, lun, file };
+    internalMode = 0;
+    if (lux_openw(3, ps) != LUX_OK)
+      _exit(2);
+    for (int32_t i = 0; i < nlines; i++)
+      fprintf(lux_file[3], "line %d\n", i);
+    exit(0);                    // like QUIT, without CLOSE
+  }
+
+  int status;
+  CPPUNIT_ASSERT(waitpid(pid, &status, 0) == pid);
+  CPPUNIT_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  FILE* fp = fopen(name, "r");
+  CPPUNIT_ASSERT(fp);
+  char line[32], expect[32];
+  int32_t n = 0;
+  bool same = true;
+  while (fgets(line, sizeof(line), fp)) {
+    sprintf(expect, "line %d\n", n++);
+    same = same && !strcmp(line, expect);
+  }
+  fclose(fp);
+  unlink(name);
+  CPPUNIT_ASSERT(same);
+  CPPUNIT_ASSERT(n == nlines);
+}
+
+/* Prints more text with SPRINTF than fits in the scratch buffer, and
+   checks that the temporary pieces are freed again. */
+void
+FilesTest::sprintf_text()
+{
+  int32_t n = 20000;
+  int32_t values = array_scratch(LUX_INT32, 1, &n);
+  std::string expect;
+  for (int32_t i = 0; i < n; i++) {
+    ((int32_t*) array_data(values))[i] = i;
+    expect += std::to_string(i) + ",";
+  }
+  int32_t format = string_scratch(3);
+  strcpy(string_value(format), "%d,");
+
+  Arena& arena = Arena::thread_arena();
+  size_t bytes = arena.statistics().bytes;
+  // SPRINTF('%d,', values)
+  int32_t ps[2] = { format, values };
+  internalMode = 0;
+  int32_t result = lux_fstring(2, ps);
+  CPPUNIT_ASSERT(symbol_class(result) == LUX_STRING);
+  CPPUNIT_ASSERT(string_value(result) == expect);
+  CPPUNIT_ASSERT(arena.statistics().bytes == bytes);
+  CPPUNIT_ASSERT(arena.statistics().allocations > (size_t) n);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FilesTest);
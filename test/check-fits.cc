@@ -0,0 +1,97 @@
+/* This is file check-fits.cc.
+
+Copyright 2026 Louis Strous
+
+This file is part of LUX.
+
+LUX is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+LUX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with LUX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cppunit/extensions/HelperMacros.h>
+#include <stdlib.h>             // for mkstemp
+#include <string.h>             // for memcmp, strcpy, strlen
+#include <unistd.h>             // for close, unlink
+
+#include "config.h"
+#include "luxparser.hh"
+#include "action.hh"
+
+class FitsTest
+  : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE(FitsTest);
+  CPPUNIT_TEST(rice_slices);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void rice_slices();
+};
+
+int32_t lux_fits_read(int32_t, int32_t []);
+int32_t lux_fits_write(int32_t, int32_t []);
+extern void (*fits_slices_hook)(int32_t);
+
+static int32_t slices_read;
+
+static void
+count_slices(int32_t nslices)
+{
+  slices_read = nslices;
+}
+
+/* Writes an array that is large enough to be Rice-compressed in
+   several slices, and reads it back. */
+void
+FitsTest::rice_slices()
+{
+  int32_t dims[2] = { 1024, 600 };
+  int32_t data = array_scratch(LUX_INT16, 2, dims);
+  int16_t* values = (int16_t*) array_data(data);
+  for (int32_t i = 0; i < dims[0]*dims[1]; i++)
+    values[i] = (i % dims[0])*3 + (i/dims[0])*7 % 500;
+
+  char name[] = "/tmp/check-fits-XXXXXX";
+  int fd = mkstemp(name);
+  CPPUNIT_ASSERT(fd >= 0);
+  close(fd);
+  int32_t file = string_scratch(strlen(name));
+  strcpy(string_value(file), name);
+  int32_t slice = scalar_scratch(LUX_INT32);
+  scalar_value(slice).i32 = 5;
+
+  // FITS_WRITE, data, name, , 5
+  int32_t ps[4] = { data, file, 0, slice };
+  internalMode = 0;
+  CPPUNIT_ASSERT(lux_fits_write(4, ps) == LUX_OK);
+
+  // FITS_READ, result, name
+  int32_t result = nextFreeNamedVariable();
+  ps[0] = result;
+  internalMode = 1;             // decompress
+  slices_read = 0;
+  fits_slices_hook = count_slices;
+  int32_t status = lux_fits_read(2, ps);
+  fits_slices_hook = nullptr;
+  unlink(name);
+  CPPUNIT_ASSERT(status == 1);
+
+  // the CSLICEn lines were understood, so the slices were decompressed
+  // separately
+  CPPUNIT_ASSERT(slices_read == 2);
+  CPPUNIT_ASSERT(symbol_class(result) == LUX_ARRAY);
+  CPPUNIT_ASSERT(array_type(result) == LUX_INT16);
+  CPPUNIT_ASSERT(array_size(result) == dims[0]*dims[1]);
+  CPPUNIT_ASSERT(!memcmp(array_data(result), values,
+                         dims[0]*dims[1]*sizeof(int16_t)));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FitsTest);
@@ -59,6 +59,45 @@ int main(void) {
   }
   printf("maxerr = %g\n", maxerr);
 
+  /* now test bulk calculation, for arbitrary epochs (which should
+     give identical results) and for uniformly spaced epochs (which
+     should give nearly identical results) */
+  int bulkbad = 0;
+  for (i = 0; i < NREC; i++) {
+    double T = (JD[i] - J2000)/365250;
+    double single[3];
+    double bulk[3*3];
+    double Ts[3] = { T, 0.3, T };
+    XYZJ2000fromVSOPA(T, planet[i], single, 0);
+    XYZJ2000fromVSOPAmany(Ts, 3, planet[i], bulk, 0);
+    if (single[0] != bulk[6] || single[1] != bulk[7] || single[2] != bulk[8]) {
+      printf("bulk result differs for record %d\n", i);
+      bulkbad++;
+    }
+  }
+#define NUNIFORM (1000)
+  double Ts[NUNIFORM];
+  static double bulk[3*NUNIFORM];
+  int object;
+  double bulkerr = 0;
+  for (object = 1; object <= 8; object++) {
+    for (i = 0; i < NUNIFORM; i++)
+      Ts[i] = 0.1 + i*0.25/365250; /* every 6 hours */
+    XYZdatefromVSOPCmany(Ts, NUNIFORM, object, bulk, 0);
+    for (i = 0; i < NUNIFORM; i++) {
+      XYZdatefromVSOPC(Ts[i], object, pos, 0);
+      int j;
+      for (j = 0; j < 3; j++) {
+        double x = fabs(pos[j] - bulk[3*i + j]);
+        if (x > bulkerr)
+          bulkerr = x;
+      }
+    }
+  }
+  printf("uniform bulk maxerr = %g\n", bulkerr);
+  if (bulkerr > 1e-12)
+    bulkbad++;
+
 #if VSOPTEST
   /* now test tolerance truncation */
   int nmax = 6*8;
@@ -93,5 +132,5 @@ int main(void) {
   }
   printf("Found %d tolerance problems.\n", bad);
 #endif
-  return 0;
+  return bulkbad? 1: 0;
 }